@@ -2,8 +2,12 @@
 
 #include <etl/endianness.h>
 #include <etl/message.h>
+#include <etl/type_traits.h>
 #include <etl/vector.h>
 #include <stdint.h>
+#include <string.h>
+
+#include "pd_conf.h"
 
 static_assert(etl::endianness::value() == etl::endian::little,
     "Only little-endian targets are supported");
@@ -18,6 +22,13 @@ constexpr int MaxChunksPerMsg = 10;
 constexpr int MaxPdoObjects = 11; // 11 for EPR mode.
 constexpr int MaxPdoObjects_SPR = 7; // 7 for SPR mode.
 constexpr int MaxUnchunkedMsgLen = 28;
+// Unchunked extended message packet: extended header + data
+constexpr int MaxUnchunkedExtMsgLen = 2 + MaxExtendedMsgLen;
+
+// Storage sizes, depending on the feature profile (see pd_conf.h)
+constexpr int PdoListSize = PD_FEATURE_EPR ? MaxPdoObjects : MaxPdoObjects_SPR;
+constexpr int MsgBufferSize = PD_FEATURE_EXTENDED ? MaxExtendedMsgLen : MaxUnchunkedMsgLen;
+constexpr int ChunkBufferSize = PD_FEATURE_UNCHUNKED_EXT ? MaxUnchunkedExtMsgLen : MaxUnchunkedMsgLen;
 
 constexpr int nHardResetCount = 2;
 constexpr int nRetryCount = 2;
@@ -34,7 +45,7 @@ namespace PD_REVISION {
 // NOTE: Redefine if you implement an option to build without full PRL support.
 constexpr auto MaxSupportedRevision = PD_REVISION::REV30;
 
-using PDO_LIST = etl::vector<uint32_t, MaxPdoObjects>;
+using PDO_LIST = etl::vector<uint32_t, PdoListSize>;
 
 namespace PD_PACKET_TYPE {
     enum Type {
@@ -188,6 +199,10 @@ union PD_ALERT {
 //
 // Only actually usable ones defined below
 //
+// NOTE: Bitfield layout is implementation-defined, and unions can't be used
+// in constexpr context. New code should use `utils/dobj_codec.h`, with the
+// same field names. Unions are kept for compatibility.
+//
 
 // Bits 30..31
 namespace PDO_TYPE {
@@ -373,7 +388,7 @@ union SNK_PDO_FIXED {
     struct {
         uint32_t max_current : 10; // 10ma step
         uint32_t voltage : 10; // 50mv step
-        uint32_t : 2;
+        uint32_t : 3;
         uint32_t frs_required : 2;
         uint32_t dual_role_data : 1;
         uint32_t usb_comms_capable : 1;
@@ -499,133 +514,183 @@ union BISTDO {
 };
 
 
-class I_PD_MSG {
+// Message operations over header + data storage, without virtual calls.
+// `Derived` provides `header`, `data()`, `data_size()`, `max_size()` and
+// `set_size()`. Operations between different buffer types (for example,
+// PD_MSG <-> PD_CHUNK) go through this base, as a span-style view, and
+// copy data with memcpy.
+template <typename Derived>
+class PD_MSG_OPS {
 public:
-    PD_HEADER header;
-
-    virtual etl::ivector<uint8_t>& get_data() = 0;
-    virtual const etl::ivector<uint8_t>& get_data() const = 0;
-    virtual void clear() = 0;
-
-    virtual bool is_data_msg(uint8_t type) const = 0;
-    virtual bool is_ctrl_msg(uint8_t type) const = 0;
-    virtual bool is_ext_msg(uint8_t type) const = 0;
-    virtual bool is_ext_ctrl_msg(uint8_t type) const = 0;
+    void clear() {
+        self().header.raw_value = 0;
+        self().set_size(0);
+    }
 
-    virtual uint16_t read16(size_t pos) const = 0;
-    virtual uint32_t read32(size_t pos) const = 0;
-    virtual void append16(uint16_t value) = 0;
-    virtual void append32(uint32_t value) = 0;
+    bool is_data_msg(uint8_t type) const {
+        const auto& h = self().header;
+        return h.extended == 0 && h.data_obj_count > 0 && h.message_type == type;
+    }
+    bool is_ctrl_msg(uint8_t type) const {
+        const auto& h = self().header;
+        return h.extended == 0 && h.data_obj_count == 0 && h.message_type == type;
+    }
+    bool is_ext_msg(uint8_t type) const {
+        const auto& h = self().header;
+        return h.extended > 0 && h.message_type == type;
+    }
+    bool is_ext_ctrl_msg(uint8_t type) const {
+        if (!is_ext_msg(PD_EXT_MSGT::Extended_Control) || self().data_size() < 2) {
+            return false;
+        }
+        ECDB ecdb{read16(0)};
+        return ecdb.type == type;
+    }
 
-    virtual void append_from(const I_PD_MSG& src, uint32_t start, uint32_t end) = 0;
-    virtual uint32_t data_size() const = 0;
-    virtual void resize_by_data_obj_count() = 0;
-    virtual uint16_t size_to_pdo_count() const = 0;
+    // Helpers to simplify payload access. Out of range bytes are read as
+    // zeroes. Bounds check is not needed in reality (RX messages are padded
+    // in PRL), but it exists to suppress warnings from code checkers.
+    uint16_t read16(size_t pos) const {
+        if (pos + 2 <= self().data_size()) {
+            uint16_t value;
+            memcpy(&value, self().data() + pos, 2);
+            return value;
+        }
+        return uint16_t(byte_at(pos) | (byte_at(pos + 1) << 8));
+    }
+    uint32_t read32(size_t pos) const {
+        if (pos + 4 <= self().data_size()) {
+            uint32_t value;
+            memcpy(&value, self().data() + pos, 4);
+            return value;
+        }
+        return uint32_t(read16(pos)) | (uint32_t(read16(pos + 2)) << 16);
+    }
 
-    virtual ~I_PD_MSG() = default;
-};
+    // Values that do not fit are truncated, as with byte-by-byte push.
+    void append16(uint16_t value) { append_bytes(&value, 2); }
+    void append32(uint32_t value) { append_bytes(&value, 4); }
 
-template <int BufferSize>
-struct PD_MSG_TPL : public I_PD_MSG {
-    etl::vector<uint8_t, BufferSize> _buffer;
-    static constexpr size_t MAX_SIZE = BufferSize;
+    template <typename Other>
+    void append_from(const PD_MSG_OPS<Other>& src, uint32_t start, uint32_t end) {
+        auto src_size = src.self().data_size();
+        if (end > src_size) { end = src_size; }
+        if (start >= end) { return; }
+        append_bytes(src.self().data() + start, end - start);
+    }
 
-    etl::ivector<uint8_t>& get_data() override { return _buffer; }
-    const etl::ivector<uint8_t>& get_data() const override { return _buffer; }
+    // Copy header + data from a buffer of any type
+    template <typename Other>
+    void assign(const PD_MSG_OPS<Other>& src) {
+        if (static_cast<const void*>(&src) == static_cast<const void*>(this)) { return; }
+        self().header = src.self().header;
+        self().set_size(0);
+        append_bytes(src.self().data(), src.self().data_size());
+    }
 
-    PD_MSG_TPL() = default;
+    // Grown range is zero-filled, so a size taken from the header (see
+    // resize_by_data_obj_count()) never exposes stale bytes. Resize first,
+    // then write data.
+    void resize(size_t size) {
+        if (size > self().max_size()) { size = self().max_size(); }
+        auto old_size = self().data_size();
+        if (size > old_size) { memset(self().data() + old_size, 0, size - old_size); }
+        self().set_size(size);
+    }
 
-    PD_MSG_TPL(const I_PD_MSG& src) {
-        *this = src;
+    void resize_by_data_obj_count() {
+        resize(self().header.data_obj_count * 4);
     }
 
-    PD_MSG_TPL& operator=(const I_PD_MSG& src) {
-        if (this == &src) return *this;
+    uint16_t size_to_pdo_count() const {
+        return static_cast<uint16_t>((self().data_size() + 3) / 4); // 4 bytes per PDO
+    }
 
-        header = src.header;
+    template <typename> friend class PD_MSG_OPS;
 
-        const auto& src_data = src.get_data();
-        size_t copy_size = (src_data.size() < BufferSize) ? src_data.size() : BufferSize;
-        _buffer.assign(src_data.begin(), src_data.begin() + copy_size);
+protected:
+    Derived& self() { return static_cast<Derived&>(*this); }
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
 
-        return *this;
+    uint8_t byte_at(size_t pos) const {
+        return pos < self().data_size() ? self().data()[pos] : 0;
     }
 
-    void clear() override {
-        header.raw_value = 0;
-        _buffer.clear();
+    void append_bytes(const void* src, size_t len) {
+        auto size = self().data_size();
+        auto available = self().max_size() - size;
+        if (len > available) { len = available; }
+        if (len == 0) { return; }
+        memcpy(self().data() + size, src, len);
+        self().set_size(size + len);
     }
+};
 
-    bool is_data_msg(uint8_t type) const override {
-        return header.extended == 0 && header.data_obj_count > 0 &&
-            header.message_type == type;
-    }
-    bool is_ctrl_msg(uint8_t type) const override {
-        return header.extended == 0 && header.data_obj_count == 0 &&
-            header.message_type == type;
-    }
-    bool is_ext_msg(uint8_t type) const override {
-        return header.extended > 0 && header.message_type == type;
-    }
-    bool is_ext_ctrl_msg(uint8_t type) const override {
-        if (!is_ext_msg(PD_EXT_MSGT::Extended_Control) || _buffer.size() < 2) {
-            return false;
-        }
-        ECDB ecdb{read16(0)};
-        return ecdb.type == type;
-    }
+// Message buffer with inline storage. Standard layout and trivially
+// copyable: copies of the same type are plain memcpy.
+template <int BufferSize>
+struct PD_MSG_TPL : public PD_MSG_OPS<PD_MSG_TPL<BufferSize>> {
+    static constexpr size_t MAX_SIZE = BufferSize;
 
-    // Helpers to simplify payload access
-    uint16_t read16(size_t pos) const override {
-        size_t size = _buffer.size();
-        // Bounds check is not needed, but it exists to suppress warnings from
-        // code checkers. In reality, RX messages are padded in PRL.
-        return uint16_t((pos >= size) ? 0 : _buffer[pos]) |
-            (uint16_t((pos + 1 >= size) ? 0 : _buffer[pos + 1]) << 8);
-    }
-    uint32_t read32(size_t pos) const override {
-        size_t size = _buffer.size();
-        return uint32_t((pos >= size) ? 0 : _buffer[pos]) |
-            (uint32_t((pos + 1 >= size) ? 0 : _buffer[pos + 1]) << 8) |
-            (uint32_t((pos + 2 >= size) ? 0 : _buffer[pos + 2]) << 16) |
-            (uint32_t((pos + 3 >= size) ? 0 : _buffer[pos + 3]) << 24);
-    }
+    PD_HEADER header{0};
+    uint16_t len{0};
+    uint8_t buf[BufferSize]{};
 
-    void append16(uint16_t value) override {
-        if (_buffer.available() > 0) { _buffer.push_back(value & 0xff); }
-        if (_buffer.available() > 0) { _buffer.push_back((value >> 8) & 0xff); }
-    }
-    void append32(uint32_t value) override {
-        append16(value & 0xffff);
-        append16((value >> 16) & 0xffff);
+    PD_MSG_TPL() = default;
+
+    template <typename Other>
+    PD_MSG_TPL(const PD_MSG_OPS<Other>& src) { this->assign(src); }
+
+    template <typename Other>
+    PD_MSG_TPL& operator=(const PD_MSG_OPS<Other>& src) {
+        this->assign(src);
+        return *this;
     }
 
-    void append_from(const I_PD_MSG& src, uint32_t start, uint32_t end) override {
-        // Bounds check is not needed, but it exists to suppress warnings from code checkers.
-        auto available = _buffer.available();
+    uint8_t* data() { return buf; }
+    const uint8_t* data() const { return buf; }
+    uint32_t data_size() const { return len; }
+    size_t max_size() const { return MAX_SIZE; }
+    void set_size(size_t size) { len = static_cast<uint16_t>(size); }
+};
 
-        if (end > src.data_size()) { end = src.data_size(); }
-        if (start >= end) { return; }
-        if (available == 0) { return; }
-        if (end - start > available) { end = start + available; }
+using PD_MSG = PD_MSG_TPL<MsgBufferSize>;
+using PD_CHUNK = PD_MSG_TPL<ChunkBufferSize>;
 
-        _buffer.insert(_buffer.end(), src.get_data().begin() + start, src.get_data().begin() + end);
-    }
+// Chunk with data placed in an external buffer. Allows drivers to let PRL
+// build messages directly inside a hardware-specific TX frame.
+struct PD_CHUNK_EXT : public PD_MSG_OPS<PD_CHUNK_EXT> {
+    static constexpr size_t MAX_SIZE = ChunkBufferSize;
 
-    uint32_t data_size() const override {
-        return _buffer.size();
-    }
+    PD_HEADER header{0};
 
-    void resize_by_data_obj_count() override {
-        _buffer.resize(header.data_obj_count * 4);
+    explicit PD_CHUNK_EXT(uint8_t* storage) : storage{storage} {}
+
+    // This is a view, copy data only
+    PD_CHUNK_EXT(const PD_CHUNK_EXT&) = delete;
+    PD_CHUNK_EXT& operator=(const PD_CHUNK_EXT& src) {
+        assign(src);
+        return *this;
     }
 
-    uint16_t size_to_pdo_count() const override {
-        return static_cast<uint16_t>((_buffer.size() + 3) / 4); // 4 bytes per PDO
+    template <typename Other>
+    PD_CHUNK_EXT& operator=(const PD_MSG_OPS<Other>& src) {
+        assign(src);
+        return *this;
     }
+
+    uint8_t* data() { return storage; }
+    const uint8_t* data() const { return storage; }
+    uint32_t data_size() const { return len; }
+    size_t max_size() const { return MAX_SIZE; }
+    void set_size(size_t size) { len = static_cast<uint16_t>(size); }
+
+private:
+    uint8_t* storage;
+    uint16_t len{0};
 };
 
-using PD_MSG = PD_MSG_TPL<MaxExtendedMsgLen>;
-using PD_CHUNK = PD_MSG_TPL<MaxUnchunkedMsgLen>;
+static_assert(etl::is_trivially_copyable<PD_CHUNK>::value, "PD_CHUNK must be trivially copyable");
+static_assert(etl::is_trivially_copyable<PD_MSG>::value, "PD_MSG must be trivially copyable");
 
 } // namespace pd
@@ -4,11 +4,54 @@
 #include "pd_log.h"
 #include "port.h"
 #include "utils/dobj_utils.h"
+#include "utils/payload_views.h"
 
 namespace pd {
 
 using namespace dobj_utils;
 
+namespace {
+    //
+    // Sink PDO table, built at compile time. PDO 1 runtime flags and the
+    // EPR AVS power are added in `get_sink_pdo_list()`.
+    //
+    // See [rev3.2] 6.4.1.3 Sink Power Data Objects
+    //
+    constexpr uint32_t default_sink_pdos[] = {
+        //
+        // SPR PDOs first. Fixed ones first, ordered by voltage. Then PPS.
+        //
+        dobj::snk_pdo_fixed::encode(5000, 3000), // PDO 1 is always vSafe5V
+        dobj::snk_pdo_fixed::encode(9000, 3000),
+        dobj::snk_pdo_fixed::encode(12000, 3000),
+        dobj::snk_pdo_fixed::encode(15000, 3000),
+        dobj::snk_pdo_fixed::encode(20000, 5000),
+        // Before rev3.2, the minimum PPS voltage was 3.3 V, then updated to 5 V.
+        dobj::snk_pdo_spr_pps::encode(5000, 11000, 3000),
+        dobj::snk_pdo_spr_pps::encode(5000, 21000, 5000),
+#if PD_FEATURE_EPR
+        //
+        // EPR PDOs. MUST start from 8. If the SPR PDO count is < 7, the gap
+        // MUST be padded with zeros. The EPR block can have up to 3 Fixed
+        // PDOs + 1 AVS.
+        //
+        dobj::snk_pdo_fixed::encode(28000, 5000),
+        dobj::snk_pdo_fixed::encode(36000, 5000),
+        dobj::snk_pdo_fixed::encode(48000, 5000),
+        dobj::snk_pdo_epr_avs::encode(15000, 50000, 0), // PDP is set at runtime
+#endif
+    };
+
+    constexpr size_t SPR_SINK_PDO_COUNT = 7;
+
+    static_assert(dobj::get_pdo_variant(default_sink_pdos[0]) == PDO_VARIANT::FIXED &&
+        dobj::pdo_fixed::get_mv(default_sink_pdos[0]) == 5000, "PDO 1 must be vSafe5V");
+#if PD_FEATURE_EPR
+    static_assert(sizeof(default_sink_pdos) / sizeof(uint32_t) == SPR_SINK_PDO_COUNT + 4,
+        "EPR PDOs must start from position 8");
+#endif
+} // namespace
+
 //
 // Custom handlers. You are expected to override these in your application.
 //
@@ -22,80 +65,20 @@ auto DPM::get_sink_pdo_list() -> PDO_LIST {
     // hide some capabilities. This list does NOT depend on the SRC and
     // exists to describe SNK needs.
     //
-    // NOTE: This can be just a list of uint32_t constants, but for better
-    // readability we use PDO structures to fill the data.
-    //
-
-    //
-    // SPR PDOs first. Fixed ones first, ordered by voltage. Then PPS.
-    //
+    for (auto pdo : default_sink_pdos) { sink_pdo_list.push_back(pdo); }
 
-    // See [rev3.2] 6.4.1.3 Sink Power Data Objects
-    SNK_PDO_FIXED pdo1{create_pdo_variant_bits(PDO_VARIANT::FIXED)};
-
-    // PDO 1 is always vSafe5V, with extra flags to describe demands.
+    // PDO 1 has extra flags to describe demands.
     // NOTE: These flags should be zero in following PDO-s
-    pdo1.dual_role_power = 0; // No DRP support, Sink only
-    pdo1.higher_capability = 1; // Require more power for full functionality
-    pdo1.unconstrained_power = 1;
-    if (has_usb_comm()) { pdo1.usb_comms_capable = 1; }
-    pdo1.dual_role_data = 0; // No DFP support, UFP only
-    pdo1.frs_required = 0; // No FRS support
-
-    set_snk_pdo_limits(pdo1.raw_value, PDO_LIMITS().set_mv(5000).set_ma(3000));
-    sink_pdo_list.push_back(pdo1.raw_value);
-
-    //
-    // Fill the rest of the SPR PDOs, 2...7
-    //
-    SNK_PDO_FIXED pdo2{create_pdo_variant_bits(PDO_VARIANT::FIXED)};
-    set_snk_pdo_limits(pdo2.raw_value, PDO_LIMITS().set_mv(9000).set_ma(3000));
-    sink_pdo_list.push_back(pdo2.raw_value);
-
-    SNK_PDO_FIXED pdo3{create_pdo_variant_bits(PDO_VARIANT::FIXED)};
-    set_snk_pdo_limits(pdo3.raw_value, PDO_LIMITS().set_mv(12000).set_ma(3000));
-    sink_pdo_list.push_back(pdo3.raw_value);
-
-    SNK_PDO_FIXED pdo4{create_pdo_variant_bits(PDO_VARIANT::FIXED)};
-    set_snk_pdo_limits(pdo4.raw_value, PDO_LIMITS().set_mv(15000).set_ma(3000));
-    sink_pdo_list.push_back(pdo4.raw_value);
+    // DRP, DRD and FRS stay zero: Sink only, UFP only, no FRS support.
+    auto& pdo1 = sink_pdo_list[0];
+    pdo1 = dobj::snk_pdo_fixed::higher_capability::set(pdo1, 1); // Require more power for full functionality
+    pdo1 = dobj::snk_pdo_fixed::unconstrained_power::set(pdo1, 1);
+    if (has_usb_comm()) { pdo1 = dobj::snk_pdo_fixed::usb_comms_capable::set(pdo1, 1); }
 
-    SNK_PDO_FIXED pdo5{create_pdo_variant_bits(PDO_VARIANT::FIXED)};
-    set_snk_pdo_limits(pdo5.raw_value, PDO_LIMITS().set_mv(20000).set_ma(5000));
-    sink_pdo_list.push_back(pdo5.raw_value);
-
-    // Before rev3.2, the minimum PPS voltage was 3.3 V, then updated to 5 V.
-    SNK_PDO_SPR_PPS pdo6{create_pdo_variant_bits(PDO_VARIANT::APDO_PPS)};
-    set_snk_pdo_limits(pdo6.raw_value,
-        PDO_LIMITS().set_mv_min(5000).set_mv_max(11000).set_ma(3000));
-    sink_pdo_list.push_back(pdo6.raw_value);
-
-    SNK_PDO_SPR_PPS pdo7{create_pdo_variant_bits(PDO_VARIANT::APDO_PPS)};
-    set_snk_pdo_limits(pdo7.raw_value,
-        PDO_LIMITS().set_mv_min(5000).set_mv_max(21000).set_ma(5000));
-    sink_pdo_list.push_back(pdo7.raw_value);
-
-    //
-    // EPR PDOs. MUST start from 8. If the SPR PDO count is < 7, the gap MUST be
-    // padded with zeros. The EPR block can have up to 3 Fixed PDOs + 1 AVS.
-    //
-
-    SNK_PDO_FIXED pdo8{create_pdo_variant_bits(PDO_VARIANT::FIXED)};
-    set_snk_pdo_limits(pdo8.raw_value, PDO_LIMITS().set_mv(28000).set_ma(5000));
-    sink_pdo_list.push_back(pdo8.raw_value);
-
-    SNK_PDO_FIXED pdo9{create_pdo_variant_bits(PDO_VARIANT::FIXED)};
-    set_snk_pdo_limits(pdo9.raw_value, PDO_LIMITS().set_mv(36000).set_ma(5000));
-    sink_pdo_list.push_back(pdo9.raw_value);
-
-    SNK_PDO_FIXED pdo10{create_pdo_variant_bits(PDO_VARIANT::FIXED)};
-    set_snk_pdo_limits(pdo10.raw_value, PDO_LIMITS().set_mv(48000).set_ma(5000));
-    sink_pdo_list.push_back(pdo10.raw_value);
-
-    SNK_PDO_EPR_AVS pdo11{create_pdo_variant_bits(PDO_VARIANT::APDO_EPR_AVS)};
-    set_snk_pdo_limits(pdo11.raw_value,
-        PDO_LIMITS().set_mv_min(15000).set_mv_max(50000).set_pdp(get_epr_watts()));
-    sink_pdo_list.push_back(pdo11.raw_value);
+#if PD_FEATURE_EPR
+    auto& epr_avs = sink_pdo_list[SPR_SINK_PDO_COUNT + 3];
+    epr_avs = dobj::snk_pdo_epr_avs::pdp::set(epr_avs, get_epr_watts());
+#endif
 
     return sink_pdo_list;
 }
@@ -104,22 +87,18 @@ void DPM::fill_rdo_flags(uint32_t &rdo) {
     // Fill common RDO flags here.
     // This is the default implementation. You can override it if required.
 
-    RDO_ANY rdo_bits{rdo};
-
-    rdo_bits.epr_capable = 1;
-    // Unchunked extended messages (long transfers) are NOT supported (and not
-    // needed, because chunking is enough).
-    // DON'T try to set this bit; it will break everything!
-    rdo_bits.unchunked_ext_msg_supported = 0;
-    rdo_bits.no_usb_suspend = 1;
-    rdo_bits.usb_comm_capable = has_usb_comm() ? 1 : 0;
-
-    rdo = rdo_bits.raw_value;
+    rdo = dobj::rdo::epr_capable::set(rdo, PD_FEATURE_EPR ? 1 : 0);
+    // Unchunked extended messages (long transfers) save chunk request round
+    // trips. Supported only with PD_FEATURE_UNCHUNKED_EXT, and PE clears
+    // this bit if the TCPC can't transfer long packets.
+    rdo = dobj::rdo::unchunked_ext_msg_supported::set(rdo, PD_FEATURE_UNCHUNKED_EXT ? 1 : 0);
+    rdo = dobj::rdo::no_usb_suspend::set(rdo, 1);
+    rdo = dobj::rdo::usb_comm_capable::set(rdo, has_usb_comm() ? 1 : 0);
 }
 
 // This is called when `SRC Capabilities` and `EPR SRC Capabilities`
 // are received from the power source. Returns the RDO and appropriate PDO as a pair
-auto DPM::get_request_data_object(const etl::ivector<uint32_t>& src_caps) -> etl::pair<uint32_t, uint32_t> {
+auto DPM::get_request_data_object(const etl::ivector<uint32_t>& src_caps, const SRC_CAPS_SUMMARY& summary) -> etl::pair<uint32_t, uint32_t> {
     // This is the default stub implementation, with simple trigger support.
     // Customize if required.
 
@@ -135,15 +114,32 @@ auto DPM::get_request_data_object(const etl::ivector<uint32_t>& src_caps) -> etl
         return {0, 0};
     }
 
-    for (uint32_t i = 0, max = src_caps.size(); i < max; i++) {
-        const auto pdo = src_caps[i];
-        // Skip padded positions
-        if (pdo == 0) { continue; }
+    const PdoSpan caps{src_caps};
+
+    // Variants are already known from validation, if the summary is for
+    // this list
+    const bool known = summary.size() == caps.size();
+
+    // Nothing of the requested variant, go to the fallback directly
+    uint32_t max = caps.size();
+    if (known && trigger_match_type == TRIGGER_MATCH_TYPE::BY_PDO_VARIANT &&
+        !summary.has(trigger_pdo_variant))
+    {
+        max = 0;
+    }
+
+    for (uint32_t i = 0; i < max; i++) {
+        const auto pdo = caps[i];
 
-        const auto id = get_src_pdo_variant(pdo);
-        // Skip unsupported PDO variants
+        // Zero PDOs pad the SPR part of EPR capabilities
+        const auto id = known ? summary.variant(i) :
+            (pdo == 0 ? PDO_VARIANT::UNKNOWN : get_src_pdo_variant(pdo));
+        // Skip padded positions and unsupported PDO variants
         if (id == PDO_VARIANT::UNKNOWN) { continue; }
 
+        // Decoded once, for both matching and the RDO
+        const auto limits = get_src_pdo_limits(pdo, id);
+
         if (trigger_match_type == TRIGGER_MATCH_TYPE::BY_POSITION)
         {
             // If the position matches, we can use it. Don't check ma/mv limits,
@@ -156,17 +152,15 @@ auto DPM::get_request_data_object(const etl::ivector<uint32_t>& src_caps) -> etl
             if (trigger_match_type == TRIGGER_MATCH_TYPE::BY_PDO_VARIANT &&
                 id != trigger_pdo_variant) { continue;}
 
-            if (!match_limits(pdo, trigger_mv, trigger_ma)) { continue; }
+            if (!match_limits(id, limits, trigger_mv, trigger_ma)) { continue; }
         }
 
         // Create RDO
-        RDO_ANY rdo{};
-        fill_rdo_flags(rdo.raw_value);
-        rdo.obj_position = i + 1; // zero-based index + 1
+        uint32_t rdo{0};
+        fill_rdo_flags(rdo);
+        rdo = dobj::rdo::obj_position::set(rdo, i + 1); // zero-based index + 1
 
         // Fill PDO-specific fields (volts/current/watts)
-        auto limits = get_src_pdo_limits(pdo);
-
         uint32_t mv = trigger_mv ? trigger_mv : limits.mv_min;
         mv = etl::clamp<uint32_t>(mv, limits.mv_min, limits.mv_max);
 
@@ -179,20 +173,20 @@ auto DPM::get_request_data_object(const etl::ivector<uint32_t>& src_caps) -> etl
         switch (id) {
             case PDO_VARIANT::FIXED:
                 // `mv` is always exact for FIXED PDO
-                set_rdo_limits_fixed(rdo.raw_value, ma, ma);
-                return {rdo.raw_value, pdo};
+                set_rdo_limits_fixed(rdo, ma, ma);
+                return {rdo, pdo};
 
             case PDO_VARIANT::APDO_PPS:
-                set_rdo_limits_pps(rdo.raw_value, mv, ma);
-                return {rdo.raw_value, pdo};
+                set_rdo_limits_pps(rdo, mv, ma);
+                return {rdo, pdo};
 
             case PDO_VARIANT::APDO_SPR_AVS:
-                set_rdo_limits_avs(rdo.raw_value, mv, ma);
-                return {rdo.raw_value, pdo};
+                set_rdo_limits_avs(rdo, mv, ma);
+                return {rdo, pdo};
 
             case PDO_VARIANT::APDO_EPR_AVS:
-                set_rdo_limits_avs(rdo.raw_value, mv, ma);
-                return {rdo.raw_value, pdo};
+                set_rdo_limits_avs(rdo, mv, ma);
+                return {rdo, pdo};
 
             default:
                 DPM_LOGE("get_request_data_object: unsupported PDO variant");
@@ -202,13 +196,13 @@ auto DPM::get_request_data_object(const etl::ivector<uint32_t>& src_caps) -> etl
 
     // By default, return vSafe5V based on the first entry in the SRC capabilities
     const auto pdo = src_caps[0];
-    RDO_FIXED rdo{};
-    fill_rdo_flags(rdo.raw_value);
-    rdo.obj_position = 0 + 1; // Position = zero-based index + 1
+    uint32_t rdo{0};
+    fill_rdo_flags(rdo);
+    rdo = dobj::rdo::obj_position::set(rdo, 0 + 1); // Position = zero-based index + 1
 
     auto limits = get_src_pdo_limits(pdo);
-    set_rdo_limits_fixed(rdo.raw_value, limits.ma, limits.ma);
-    return {rdo.raw_value, pdo};
+    set_rdo_limits_fixed(rdo, limits.ma, limits.ma);
+    return {rdo, pdo};
 }
 
 void DPM::request_new_power_level() {
@@ -216,8 +210,9 @@ void DPM::request_new_power_level() {
     // If not, the data will be used at the handshake.
     if (port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT)) {
         port.dpm_requests.set(DPM_REQUEST_FLAG::NEW_POWER_LEVEL);
-        // Don't call wakeup(); keep execution in the driver's "thread".
-        // Rely on the timer's periodic tick to catch the request.
+        // Safe from the app thread: the driver context runs the stack,
+        // see IDispatchContext.
+        port.wakeup();
     }
 }
 
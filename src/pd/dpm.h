@@ -4,6 +4,7 @@
 
 #include "data_objects.h"
 #include "utils/dobj_utils.h"
+#include "utils/src_caps_parser.h"
 
 namespace pd {
 
@@ -12,7 +13,7 @@ class Port; class PE;
 class IDPM {
 public:
     virtual void setup() = 0;
-    virtual etl::pair<uint32_t, uint32_t> get_request_data_object(const etl::ivector<uint32_t>& src_caps) = 0;
+    virtual etl::pair<uint32_t, uint32_t> get_request_data_object(const etl::ivector<uint32_t>& src_caps, const SRC_CAPS_SUMMARY& summary) = 0;
     virtual PDO_LIST get_sink_pdo_list() = 0;
     virtual uint32_t get_epr_watts() = 0;
 };
@@ -38,8 +39,10 @@ public:
 
     // This one is called from `SRC Capabilities` and `EPR SRC Capabilities`.
     // Override with your custom logic to evaluate capabilities and return an
-    // appropriate RDO/PDO pair.
-    virtual etl::pair<uint32_t, uint32_t> get_request_data_object(const etl::ivector<uint32_t>& src_caps) override;
+    // appropriate RDO/PDO pair. `summary` describes `src_caps` (PE passes
+    // `port.source_caps_summary`). If it does not match the list size, PDOs
+    // are decoded instead.
+    virtual etl::pair<uint32_t, uint32_t> get_request_data_object(const etl::ivector<uint32_t>& src_caps, const SRC_CAPS_SUMMARY& summary) override;
 
     // This one is called via `Sink Capabilities` and `EPR Sink Capabilities`
     // requests from the source. By default, it provides the maximum possible
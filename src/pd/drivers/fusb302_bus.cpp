@@ -0,0 +1,104 @@
+#include "../pd_conf.h"
+
+#if defined(USE_FUSB302_RTOS) || defined(USE_FUSB302_SUPERLOOP)
+
+#include "fusb302_bus.h"
+#include "../pd_log.h"
+
+namespace pd {
+
+namespace fusb302 {
+
+bool Fusb302Bus::attach(Fusb302BusChannel& channel) {
+    if (channels.full()) {
+        DRV_LOGE("FUSB302 bus: too many channels");
+        return false;
+    }
+    channels.push_back(&channel);
+    return true;
+}
+
+void Fusb302Bus::setup() {
+    lock();
+    if (!hal_ready) {
+        hal.set_event_handler(
+            hal_event_handler_t::create<Fusb302Bus, &Fusb302Bus::on_hal_event>(*this)
+        );
+        hal.setup();
+        hal_ready = true;
+    }
+    unlock();
+}
+
+void Fusb302Bus::on_hal_event(HAL_EVENT_TYPE event, bool from_isr) {
+    // Each driver checks its own chip, so extra events are harmless
+    for (auto channel : channels) { channel->notify(event, from_isr); }
+}
+
+void Fusb302Bus::update_timer_enable() {
+    bool enable = false;
+    for (auto channel : channels) { enable = enable || channel->timer_enabled; }
+    hal.set_timer_enable(enable);
+}
+
+bool Fusb302Bus::begin_transfer(const Fusb302BusChannel& channel) {
+    lock();
+
+    if (channel.mux_channel != NO_MUX && channel.mux_channel != selected_mux) {
+        if (!select_mux.is_valid() || !select_mux(static_cast<uint8_t>(channel.mux_channel))) {
+            // Mux state is unknown, force select on the next transfer
+            selected_mux = NO_MUX;
+            unlock();
+            return false;
+        }
+        selected_mux = channel.mux_channel;
+    }
+    return true;
+}
+
+Fusb302BusChannel::Fusb302BusChannel(Fusb302Bus& bus, uint8_t i2c_addr, int16_t mux_channel)
+    : bus{bus}, i2c_addr{i2c_addr}, mux_channel{mux_channel}
+{
+    attached = bus.attach(*this);
+}
+
+bool Fusb302BusChannel::read_reg(uint8_t, uint8_t reg, uint8_t& data) {
+    if (!bus.begin_transfer(*this)) { return false; }
+    auto ok = bus.hal.read_reg(i2c_addr, reg, data);
+    bus.end_transfer();
+    return ok;
+}
+
+bool Fusb302BusChannel::write_reg(uint8_t, uint8_t reg, uint8_t data) {
+    if (!bus.begin_transfer(*this)) { return false; }
+    auto ok = bus.hal.write_reg(i2c_addr, reg, data);
+    bus.end_transfer();
+    return ok;
+}
+
+bool Fusb302BusChannel::read_block(uint8_t, uint8_t reg, uint8_t *data, uint32_t size) {
+    if (!bus.begin_transfer(*this)) { return false; }
+    auto ok = bus.hal.read_block(i2c_addr, reg, data, size);
+    bus.end_transfer();
+    return ok;
+}
+
+bool Fusb302BusChannel::write_block(uint8_t, uint8_t reg, const uint8_t *data, uint32_t size) {
+    if (!bus.begin_transfer(*this)) { return false; }
+    auto ok = bus.hal.write_block(i2c_addr, reg, data, size);
+    bus.end_transfer();
+    return ok;
+}
+
+void Fusb302BusChannel::set_timer_enable(bool enable) {
+    bus.lock();
+    timer_enabled = enable;
+    bus.update_timer_enable();
+    bus.unlock();
+}
+
+} // namespace fusb302
+
+} // namespace pd
+
+#endif // USE_FUSB302_RTOS || USE_FUSB302_SUPERLOOP
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <etl/delegate.h>
+#include <etl/vector.h>
+
+#include "fusb302_core.h"
+
+namespace pd {
+
+namespace fusb302 {
+
+class Fusb302BusChannel;
+
+// Several FUSB302 chips on one I2C bus. Each chip driver gets its own
+// `Fusb302BusChannel` as HAL. Chips are selected by I2C address (up to 4
+// chip variants, see `ChipAddress`), and by I2C mux channel if addresses
+// clash.
+//
+// The bus HAL provides I2C, time and the periodic timer. Its timer and
+// interrupt events are passed to all channels. Every chip still needs its
+// own INT pin state, see `Fusb302BusChannel::int_pin`.
+class Fusb302Bus {
+public:
+    static constexpr size_t MAX_CHANNELS = 8;
+    static constexpr int16_t NO_MUX = -1;
+
+    explicit Fusb302Bus(IFusb302Hal& hal) : hal{hal} {}
+
+    // Prohibit copy/move because channels keep references
+    Fusb302Bus(const Fusb302Bus&) = delete;
+    Fusb302Bus& operator=(const Fusb302Bus&) = delete;
+
+    // Switch the I2C mux. Required only for channels with a mux channel.
+    etl::delegate<bool(uint8_t)> select_mux;
+
+    // With RTOS drivers, each chip is served by its own task. Override to
+    // guard transfers with a mutex. Not needed with a single main loop.
+    virtual void lock() {}
+    virtual void unlock() {}
+
+private:
+    friend class Fusb302BusChannel;
+
+    bool attach(Fusb302BusChannel& channel);
+    void setup();
+    void on_hal_event(HAL_EVENT_TYPE event, bool from_isr);
+    void update_timer_enable();
+
+    // Lock the bus and select the mux channel. `end_transfer()` must
+    // follow on success.
+    bool begin_transfer(const Fusb302BusChannel& channel);
+    void end_transfer() { unlock(); }
+
+    IFusb302Hal& hal;
+    etl::vector<Fusb302BusChannel*, MAX_CHANNELS> channels;
+    int16_t selected_mux{NO_MUX};
+    bool hal_ready{false};
+};
+
+// HAL of one chip on a shared bus. The I2C address given by the driver is
+// replaced with the channel's one.
+class Fusb302BusChannel : public IFusb302Hal {
+public:
+    Fusb302BusChannel(Fusb302Bus& bus, uint8_t i2c_addr, int16_t mux_channel = Fusb302Bus::NO_MUX);
+
+    Fusb302BusChannel(const Fusb302BusChannel&) = delete;
+    Fusb302BusChannel& operator=(const Fusb302BusChannel&) = delete;
+
+    void setup() override { bus.setup(); }
+    void set_event_handler(const hal_event_handler_t& handler) override { event_cb = handler; }
+    ITimer::TimeFunc get_time_func() const override { return bus.hal.get_time_func(); }
+
+    bool read_reg(uint8_t i2c_addr, uint8_t reg, uint8_t& data) override;
+    bool write_reg(uint8_t i2c_addr, uint8_t reg, uint8_t data) override;
+    bool read_block(uint8_t i2c_addr, uint8_t reg, uint8_t *data, uint32_t size) override;
+    bool write_block(uint8_t i2c_addr, uint8_t reg, const uint8_t *data, uint32_t size) override;
+
+    bool is_interrupt_active() override { return int_pin.is_valid() && int_pin(); }
+    // The bus timer runs while any channel needs it
+    void set_timer_enable(bool enable) override;
+    bool is_in_isr() override { return bus.hal.is_in_isr(); }
+
+    // State of this chip's INT pin (active = true). The driver keeps
+    // reading IRQ registers while it is active, so a wired-OR line of
+    // several chips can't be used here.
+    etl::delegate<bool()> int_pin;
+
+    // Call from the INT pin handler of this chip
+    void notify_interrupt(bool from_isr) { notify(HAL_EVENT_TYPE::FUSB302_Interrupt, from_isr); }
+
+    bool is_attached() const { return attached; }
+
+private:
+    friend class Fusb302Bus;
+
+    void notify(HAL_EVENT_TYPE event, bool from_isr) {
+        if (event_cb.is_valid()) { event_cb(event, from_isr); }
+    }
+
+    Fusb302Bus& bus;
+    uint8_t i2c_addr;
+    int16_t mux_channel;
+    bool attached{false};
+    bool timer_enabled{true};
+    hal_event_handler_t event_cb;
+};
+
+} // namespace fusb302
+
+} // namespace pd
@@ -0,0 +1,861 @@
+#include "../pd_conf.h"
+
+#if defined(USE_FUSB302_RTOS) || defined(USE_FUSB302_SUPERLOOP)
+
+#include "fusb302_core.h"
+#include "../messages.h"
+#include "../pd_log.h"
+#include "../port.h"
+
+namespace pd {
+
+namespace fusb302 {
+
+#define DRV_LOG_ON_ERROR(expr) \
+    do { \
+        if (!(expr)) { \
+            DRV_LOGE("FUSB302 driver error at {}:{} [{}] in {}", __FILE__, __LINE__, #expr, __func__); \
+        } \
+    } while (0)
+
+#define DRV_RET_FALSE_ON_ERROR(expr) \
+    do { \
+        if (!(expr)) { \
+            DRV_LOGE("FUSB302 driver error at {}:{} [{}] in {}", __FILE__, __LINE__, #expr, __func__); \
+            return false; \
+        } \
+    } while (0)
+
+#define DRV_RET_ON_ERROR(expr) \
+    do { \
+        if (!(expr)) { \
+            DRV_LOGE("FUSB302 driver error at {}:{} [{}] in {}", __FILE__, __LINE__, #expr, __func__); \
+            return; \
+        } \
+    } while (0)
+
+// FIFO TX tokens
+namespace TX_TKN {
+    static constexpr uint8_t TXON = 0xA1;
+    static constexpr uint8_t SOP1 = 0x12;
+    static constexpr uint8_t SOP2 = 0x13;
+    static constexpr uint8_t SOP3 = 0x1B;
+    static constexpr uint8_t RESET1 = 0x15;
+    static constexpr uint8_t RESET2 = 0x16;
+    static constexpr uint8_t PACKSYM = 0x80;
+    static constexpr uint8_t JAM_CRC = 0xFF;
+    static constexpr uint8_t EOP = 0x14;
+    static constexpr uint8_t TX_OFF = 0xFE;
+}
+
+bool Fusb302Core::fusb_setup_begin() {
+    if (flags.test(DRV_FLAG::FUSB_SETUP_FAILED)) { return false; }
+
+    DRV_LOGI("FUSB302 setup starting...");
+    flags.set(DRV_FLAG::FUSB_SETUP_FAILED);
+
+    // Reset chip
+
+    DRV_LOGI("SW (full) reset");
+    Reset rst{0};
+    rst.SW_RES = 1;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Reset::reg, rst.raw_value));
+
+    // Read ID to check connection
+    DeviceID id;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, DeviceID::reg, id.raw_value));
+    DRV_LOGI("FUSB302 ID: PROD={}, VER={}, REV={}",
+        id.PRODUCT_ID, id.VERSION_ID, id.REVISION_ID);
+
+    // Power up all blocks
+    DRV_LOGI("Power up all blocks");
+    Power pwr{0};
+    pwr.PWR = PowerBlock::ALL;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Power::reg, pwr.raw_value));
+
+    // By default disable all interrupts except VBUSOK.
+    DRV_LOGI("Disable all interrupts except VBUSOK");
+    Mask1 mask{0xFF};
+    mask.M_VBUSOK = 0;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Mask1::reg, mask.raw_value));
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Maska::reg, 0xFF));
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Maskb::reg, 0xFF));
+    // ...and remove global interrupt mask
+    Control0 ctl0;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Control0::reg, ctl0.raw_value));
+    ctl0.INT_MASK = 0;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Control0::reg, ctl0.raw_value));
+
+    // Now wait SETUP_VBUS_SYNC_MS before fusb_setup_end()
+    return true;
+}
+
+bool Fusb302Core::fusb_setup_end() {
+    if (flags.test(DRV_FLAG::FUSB_SETUP_DONE)) { return true; }
+
+    // Sync VBUSOK
+    Status0 status0;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Status0::reg, status0.raw_value));
+    vbus_ok.store(static_cast<bool>(status0.VBUSOK));
+    DRV_LOGI("Read initial VBUSOK: {}", vbus_ok.load());
+
+    DRV_RET_FALSE_ON_ERROR(fusb_set_polarity(TCPC_POLARITY::NONE));
+    flags.clear(DRV_FLAG::FUSB_SETUP_FAILED);
+    flags.set(DRV_FLAG::FUSB_SETUP_DONE);
+
+    DRV_RET_FALSE_ON_ERROR(fusb_set_rxtx_interrupts(true));
+
+    // NOTE: We don't touch data/power role bits.
+    // - defaults are OK for sink/UFP
+    // - the driver API has no appropriate methods.
+    DRV_LOGI("Setup done.");
+    return true;
+}
+
+bool Fusb302Core::fusb_set_rxtx_interrupts(bool enable) {
+    DRV_LOGI("Set RX/TX interrupts {}", enable ? "ON" : "OFF");
+    //
+    // NOTE: Use I_BC_LVL interrupts sparingly because there are many false
+    // positives on BMC exchange. In most scenarios, better alternatives exist.
+    //
+    Mask1 mask;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Mask1::reg, mask.raw_value));
+    mask.M_COLLISION = enable ? 0 : 1;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Mask1::reg, mask.raw_value));
+
+    Maska maska;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Maska::reg, maska.raw_value));
+    maska.M_HARDRST = enable ? 0 : 1;
+    maska.M_TXSENT = enable ? 0 : 1;
+    maska.M_HARDSENT = enable ? 0 : 1;
+    maska.M_RETRYFAIL = enable ? 0 : 1;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Maska::reg, maska.raw_value));
+
+    Maskb maskb;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Maskb::reg, maskb.raw_value));
+    maskb.M_GCRCSENT = enable ? 0 : 1;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Maskb::reg, maskb.raw_value));
+
+    return true;
+}
+
+bool Fusb302Core::fusb_set_low_power(bool enable) {
+    if (enable == low_power) { return true; }
+
+    DRV_LOGI("Set low power mode {}", enable ? "ON" : "OFF");
+
+    if (enable) {
+        // Abort pending measurements, those need the measure block and timer
+        sync_scan_cc.reset();
+        sync_active_cc.reset();
+        meter_state = MeterState::IDLE;
+    }
+
+    // In low power mode keep only VBUSOK detection alive. It is the only
+    // interrupt we expect while detached.
+    //
+    // FUSB302B datasheet, Power register (0x0B): PWR[0] powers the bandgap
+    // and wake circuit, PWR[1..3] the receiver/current references, the
+    // measure block and the internal oscillator. The VBUSOK comparator and
+    // the I_VBUSOK interrupt (Status0/Interrupt) belong to the first group,
+    // so they keep working with PWR = 0x1. The same value is used as the
+    // lowest active power level by other FUSB302 drivers (e.g. Linux
+    // FUSB_REG_POWER_PWR_LOW, "bandgap + wake circuit").
+    DRV_RET_FALSE_ON_ERROR(fusb_set_rxtx_interrupts(!enable));
+
+    Power pwr{0};
+    pwr.PWR = enable ? PowerBlock::BANDGAP_WAKE : PowerBlock::ALL;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Power::reg, pwr.raw_value));
+
+    hal.set_timer_enable(!enable);
+
+    low_power = enable;
+    return true;
+}
+
+bool Fusb302Core::fusb_set_auto_goodcrc(bool enable) {
+    DRV_LOGI("Set auto good crc {}", enable ? "ON" : "OFF");
+    Switches1 sw1;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Switches1::reg, sw1.raw_value));
+    sw1.AUTO_CRC = enable ? 1 : 0;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Switches1::reg, sw1.raw_value));
+    return true;
+}
+
+bool Fusb302Core::fusb_set_tx_auto_retries(uint8_t count) {
+    DRV_LOGI("Set TX auto retries  to {}", count);
+    Control3 ctl3;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Control3::reg, ctl3.raw_value));
+    ctl3.N_RETRIES = count & 3; // 0-3 retries
+    ctl3.AUTO_RETRY = count > 0 ? 1 : 0;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Control3::reg, ctl3.raw_value));
+    return true;
+}
+
+bool Fusb302Core::fusb_flush_rx_fifo() {
+    Control1 ctrl1{0};
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Control1::reg, ctrl1.raw_value));
+    ctrl1.RX_FLUSH = 1;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Control1::reg, ctrl1.raw_value));
+    return true;
+}
+
+bool Fusb302Core::fusb_flush_tx_fifo() {
+    Control0 ctrl0{0};
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Control0::reg, ctrl0.raw_value));
+    ctrl0.TX_FLUSH = 1;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Control0::reg, ctrl0.raw_value));
+    return true;
+}
+
+bool Fusb302Core::fusb_pd_reset() {
+    DRV_LOGI("PD reset");
+    Reset rst{0};
+    rst.PD_RESET = 1;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Reset::reg, rst.raw_value));
+    return true;
+}
+
+bool Fusb302Core::fusb_set_polarity(TCPC_POLARITY polarity) {
+    DRV_LOGI("Set polarity to {}",
+        polarity == TCPC_POLARITY::CC1 ? "CC1" :
+        (polarity == TCPC_POLARITY::CC2 ? "CC2" : "NONE"));
+    //
+    // Attach comparator
+    //
+    Switches0 sw0;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Switches0::reg, sw0.raw_value));
+    sw0.MEAS_CC1 = 0;
+    sw0.MEAS_CC2 = 0;
+
+    if (polarity == TCPC_POLARITY::CC1) { sw0.MEAS_CC1 = 1; }
+    if (polarity == TCPC_POLARITY::CC2) { sw0.MEAS_CC2 = 1; }
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Switches0::reg, sw0.raw_value));
+
+    //
+    // Attach BMC
+    //
+    Switches1 sw1;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Switches1::reg, sw1.raw_value));
+    sw1.TXCC1 = 0;
+    sw1.TXCC2 = 0;
+
+    if (polarity == TCPC_POLARITY::CC1) { sw1.TXCC1 = 1; }
+    if (polarity == TCPC_POLARITY::CC2) { sw1.TXCC2 = 1; }
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Switches1::reg, sw1.raw_value));
+
+    if (polarity == TCPC_POLARITY::NONE) {
+        DRV_RET_FALSE_ON_ERROR(fusb_set_rx_enable(false));
+    }
+
+    this->polarity.store(polarity);
+
+    return true;
+}
+
+bool Fusb302Core::fusb_set_rx_enable(bool enable) {
+    //
+    // NOTE:
+    // - Clearing the TX FIFO is important to interrupt any ongoing TX
+    //   on TX discard.
+    // - Clearing everything seems safe.
+    //
+
+    DRV_LOGI("Set RX enable {}", enable ? "ON" : "OFF");
+
+    DRV_RET_FALSE_ON_ERROR(fusb_flush_rx_fifo());
+    rx_queue.clear_from_producer();
+    DRV_RET_FALSE_ON_ERROR(fusb_flush_tx_fifo());
+
+    DRV_RET_FALSE_ON_ERROR(fusb_set_auto_goodcrc(enable));
+
+    rx_enabled = enable;
+    return true;
+}
+
+void Fusb302Core::fusb_tx_pkt_end(TCPC_TRANSMIT_STATUS status) {
+    // Ensure transmit was not invoked again; otherwise our info is outdated
+    // and should be discarded.
+    auto expected = TCPC_TRANSMIT_STATUS::SENDING;
+    if (port.tcpc_tx_status.compare_exchange_strong(expected, status)) {
+        DRV_LOGI("TX end, status: {}", static_cast<int>(status));
+        has_deferred_wakeup = true;
+    } else {
+        DRV_LOGI("TX end failed: TCPC status changed from outside to {}", static_cast<int>(expected));
+    }
+}
+
+bool Fusb302Core::fusb_tx_pkt_begin(uint8_t frame_idx) {
+    DRV_RET_FALSE_ON_ERROR(fusb_flush_tx_fifo());
+
+    DRV_LOGI("TX begin");
+
+    // Auto-retries MUST be used to get interrupts about completion. Without
+    // auto-retries we can't know when TX is done.
+    //
+    // NOTE: The spec says retries should NOT be used for unchunked extended
+    // messages and cable plug messages. Since we do not support those, just
+    // set SOP retries count according to negotiated protocol revision.
+    DRV_RET_FALSE_ON_ERROR(fusb_set_tx_auto_retries(port.max_retries()));
+
+    auto& frame = tx_frames[frame_idx];
+    auto& chunk = frame.chunk;
+    auto* raw = frame.raw;
+
+    // Only "legacy" packets are sent. We do NOT support unchunked extended
+    // packets or long vendor packets (they are not useful in sink mode), and
+    // PRL does not build those without `unchunked_ext_msg` in HW features.
+
+    // Message data is already in place, and SOP tokens are pre-filled on
+    // setup (the library supports only sink mode). Fill the rest around.
+
+    // At most 28 bytes of data fit the packet. Longer messages must not
+    // reach here, fail the transmit instead of sending a truncated one.
+    uint32_t data_size = chunk.data_size();
+    if (data_size > MaxUnchunkedMsgLen) {
+        DRV_LOGE("TX message too long for FUSB302: {} bytes", data_size);
+        return false;
+    }
+
+    // Add data size (+ 2 for header)
+    raw[4] = static_cast<uint8_t>(TX_TKN::PACKSYM | (data_size + 2));
+
+    // Msg header
+    raw[5] = chunk.header.raw_value & 0xFF;
+    raw[6] = (chunk.header.raw_value >> 8) & 0xFF;
+
+    // Tail
+    auto* tail = raw + TxFrame::DATA_OFFSET + data_size;
+    tail[0] = TX_TKN::JAM_CRC;
+    tail[1] = TX_TKN::EOP;
+    tail[2] = TX_TKN::TX_OFF;
+    tail[3] = TX_TKN::TXON;
+
+    DRV_RET_FALSE_ON_ERROR(hal.write_block(i2c_addr, FIFOs::reg, raw,
+        TxFrame::DATA_OFFSET + data_size + 4));
+    return true;
+}
+
+bool Fusb302Core::fusb_rx_pkt() {
+    ETL_MAYBE_UNUSED uint8_t sop;
+    uint8_t hdr[2];
+    ETL_MAYBE_UNUSED uint8_t crc_junk[4];
+
+    Status1 status1{};
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Status1::reg, status1.raw_value));
+
+    if (status1.RX_EMPTY) {
+        DRV_LOGI("Can't read from empty FIFO");
+        return true;
+    }
+
+    // Pick all pending packets from RX FIFO.
+    //
+    // NOTE: We can get a mixture of chunks and GoodCRC. That's why we read
+    // all available packets in a loop and skip GoodCRC.
+    while (!status1.RX_EMPTY) {
+        // Read directly into a free queue slot. If PRL is too slow and all
+        // slots are taken, the packet still has to be pulled out of the FIFO,
+        // so use the scratch buffer and drop it.
+        PD_CHUNK* slot = rx_queue.reserve();
+        bool has_slot = (slot != nullptr);
+        if (!has_slot) { slot = &rx_drop_chunk; }
+        auto& pkt = *slot;
+
+        DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, FIFOs::reg, sop));
+
+        DRV_RET_FALSE_ON_ERROR(hal.read_block(i2c_addr, FIFOs::reg, hdr, 2));
+        pkt.header.raw_value = (hdr[1] << 8) | hdr[0];
+
+        // Chunked extended messages have non-zero data_obj_count
+        if (pkt.header.extended == 1 && pkt.header.data_obj_count == 0) {
+            // Unchunked extended packets are not supported. This is an abnormal
+            // situation, and all we can do is wipe out the RX FIFO.
+            DRV_LOGE("Unchunked extended packet received, ignoring");
+            fusb_flush_rx_fifo();
+            return false;
+        }
+
+        // After unchunked extended messages are filtered out, the rest have
+        // size data_obj_count*4 bytes. data_obj_count has 3 bits, which means
+        // at most 28 bytes in total. That guarantees `pkt` has enough space.
+        pkt.resize_by_data_obj_count();
+        DRV_RET_FALSE_ON_ERROR(hal.read_block(i2c_addr, FIFOs::reg, pkt.data(), pkt.data_size()));
+
+        DRV_RET_FALSE_ON_ERROR(hal.read_block(i2c_addr, FIFOs::reg, crc_junk, 4));
+
+        // Process all but GoodCRC, coming after TX. Processing of TX was
+        // already scheduled, and here we just ignore GoodCRC as garbage.
+        if (!pkt.is_ctrl_msg(PD_CTRL_MSGT::GoodCRC)) {
+            DRV_LOGI("Message received: type = {}, extended = {}, data size = {}",
+                pkt.header.message_type, pkt.header.extended, pkt.data_size());
+
+            if (has_slot) {
+                rx_queue.commit();
+                has_deferred_wakeup = true;
+            } else {
+                DRV_LOGE("RX queue full, message dropped");
+            }
+        }
+
+        DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Status1::reg, status1.raw_value));
+    }
+    return true;
+}
+
+bool Fusb302Core::fusb_hr_send() {
+    DRV_LOGI("Send hard reset");
+
+    Control3 ctrl3;
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Control3::reg, ctrl3.raw_value));
+    ctrl3.SEND_HARD_RESET = 1;
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Control3::reg, ctrl3.raw_value));
+
+    return true;
+}
+
+bool Fusb302Core::hr_cleanup() {
+    // Cleanup internal states after hard reset received or sent.
+    DRV_RET_FALSE_ON_ERROR(fusb_pd_reset());
+    rx_queue.clear_from_producer();
+    return true;
+}
+
+bool Fusb302Core::fusb_set_bist(TCPC_BIST_MODE mode) {
+    DRV_LOGI("Set BIST mode to {}",
+        mode == TCPC_BIST_MODE::Off ? "Off" :
+        (mode == TCPC_BIST_MODE::Carrier ? "Carrier" :
+        (mode == TCPC_BIST_MODE::TestData ? "TestData" : "Unknown")));
+
+    Control1 ctrl1;
+    Control3 ctrl3;
+
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Control1::reg, ctrl1.raw_value));
+    DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Control3::reg, ctrl3.raw_value));
+    ctrl1.BIST_MODE2 = 0;
+    ctrl3.BIST_TMODE = 0;
+
+    switch (mode) {
+        case TCPC_BIST_MODE::Carrier:
+            ctrl1.BIST_MODE2 = 1;
+            break;
+        case TCPC_BIST_MODE::TestData:
+            ctrl3.BIST_TMODE = 1;
+            break;
+        default:
+            break;
+    }
+
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Control1::reg, ctrl1.raw_value));
+    DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Control3::reg, ctrl3.raw_value));
+
+    if (mode == TCPC_BIST_MODE::Carrier) {
+        Control0 ctrl0;
+        DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Control0::reg, ctrl0.raw_value));
+        ctrl0.TX_START = 1;
+        DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Control0::reg, ctrl0.raw_value));
+    }
+
+    return true;
+}
+
+void Fusb302Core::handle_interrupt() {
+    if (!hal.is_interrupt_active()) { return; }
+
+    DRV_LOGD("Handle PD interrupt");
+
+    for (;;) {
+        Interrupt interrupt;
+        Interrupta interrupta;
+        Interruptb interruptb;
+
+        // TODO: Consider 5-bytes block read (0x3E-0x42) with single call.
+        DRV_LOG_ON_ERROR(hal.read_reg(i2c_addr, Interrupt::reg, interrupt.raw_value));
+        DRV_LOG_ON_ERROR(hal.read_reg(i2c_addr, Interrupta::reg, interrupta.raw_value));
+        DRV_LOG_ON_ERROR(hal.read_reg(i2c_addr, Interruptb::reg, interruptb.raw_value));
+
+        if (interrupt.I_VBUSOK) {
+            Status0 status0;
+            DRV_LOG_ON_ERROR(hal.read_reg(i2c_addr, Status0::reg, status0.raw_value));
+            vbus_ok.store(status0.VBUSOK);
+            DRV_LOGI("IRQ: VBUS changed");
+            has_deferred_wakeup = true;
+        }
+
+        if (interrupta.I_HARDRST) {
+            DRV_LOGI("IRQ: hard reset received");
+            DRV_LOG_ON_ERROR(fusb_set_bist(TCPC_BIST_MODE::Off));
+            DRV_LOG_ON_ERROR(hr_cleanup());
+            port.notify_prl(MsgToPrl_TcpcHardReset{});
+            has_deferred_wakeup = true;
+        }
+
+        if (interrupta.I_HARDSENT) {
+            DRV_LOGI("IRQ: hard reset sent");
+            DRV_LOG_ON_ERROR(hr_cleanup());
+            fusb_tx_pkt_end(TCPC_TRANSMIT_STATUS::SUCCEEDED);
+        }
+
+        if (interrupt.I_COLLISION) {
+            DRV_LOGI("IRQ: tx collision");
+            // Discarding logic is part of PRL, here we just report tx failure
+            fusb_tx_pkt_end(TCPC_TRANSMIT_STATUS::FAILED);
+        }
+        if (interrupta.I_RETRYFAIL) {
+            DRV_LOGI("IRQ: tx retry failed");
+            fusb_tx_pkt_end(TCPC_TRANSMIT_STATUS::FAILED);
+        }
+        if (interrupta.I_TXSENT) {
+            DRV_LOGI("IRQ: tx completed");
+            fusb_tx_pkt_end(TCPC_TRANSMIT_STATUS::SUCCEEDED);
+            // That's not necessary, but force GoodCRC peek to free FIFO faster.
+            DRV_LOG_ON_ERROR(fusb_rx_pkt());
+        }
+        if (interruptb.I_GCRCSENT) {
+            if (rx_enabled) {
+                DRV_LOGI("IRQ: GoodCRC sent");
+                DRV_LOG_ON_ERROR(fusb_rx_pkt());
+            } else {
+                DRV_LOG_ON_ERROR(fusb_flush_rx_fifo());
+            }
+        }
+
+        if (!hal.is_interrupt_active()) { break; }
+
+        DRV_LOGD("Interrupt handled, but still active. Repeat processing...");
+    }
+
+    return;
+}
+
+// Since FUSB302 does not allow making different measurements in parallel,
+// do all in a single place to avoid collisions. Also, use simple FSM to implement
+// non-blocking delays.
+bool Fusb302Core::meter_tick(bool &repeat) {
+    repeat = false;
+    Status0 status0;
+    Switches0 sw0;
+
+    // Should be 250 us, but FreeRTOS does not allow that precise timing.
+    // Use 2 timer ticks (2ms) to guarantee at least 1ms after jitter.
+    static constexpr uint32_t MEASURE_DELAY_MS = 2;
+
+    switch (meter_state) {
+        case MeterState::IDLE:
+            if (sync_active_cc.get_job()) {
+                DRV_LOGV("Active CC measurement begin");
+                meter_state = MeterState::CC_ACTIVE_BEGIN;
+                repeat = true;
+                return true;
+            }
+            if (sync_scan_cc.get_job()) {
+                DRV_LOGV("Scan CC1/CC2 start");
+                meter_state = MeterState::SCAN_CC_BEGIN;
+                repeat = true;
+                return true;
+            }
+            break;
+
+        case MeterState::CC_ACTIVE_BEGIN:
+            meter_wait_until_ts = get_timestamp() + MEASURE_DELAY_MS;
+            meter_state = MeterState::CC_ACTIVE_MEASURE_WAIT;
+            repeat = true;
+            break;
+
+        case MeterState::CC_ACTIVE_MEASURE_WAIT:
+            if (get_timestamp() < meter_wait_until_ts) { break; }
+
+            // Note, CC activity can introduce noise, but since we are waiting
+            // for SinkTxOK, false negatives are acceptable; those will only
+            // cause a small transfer delay.
+            DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Status0::reg, status0.raw_value));
+
+            if (polarity.load() == TCPC_POLARITY::NONE) {
+                DRV_LOGE("Can't measure active CC without polarity set");
+            } else {
+                if (polarity.load() == TCPC_POLARITY::CC1) {
+                    cc1_value.store(static_cast<TCPC_CC_LEVEL::Type>(status0.BC_LVL));
+                } else {
+                    cc2_value.store(static_cast<TCPC_CC_LEVEL::Type>(status0.BC_LVL));
+                }
+            }
+
+            DRV_LOGV("Active CC measurement end");
+            sync_active_cc.job_finish();
+            meter_state = MeterState::IDLE;
+            has_deferred_wakeup = true;
+            break;
+
+        case MeterState::SCAN_CC_BEGIN:
+            DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Switches0::reg, sw0.raw_value));
+            // save MEAS_CC1/MEAS_CC2
+            meter_sw0_backup = sw0;
+
+            // Measure CC1
+            sw0.MEAS_CC1 = 1;
+            sw0.MEAS_CC2 = 0;
+            DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Switches0::reg, sw0.raw_value));
+
+            // Technically, 250 us is OK, but a precise match would be
+            // platform-dependent and probably blocking. We rely on FreeRTOS
+            // ticks instead. The minimal value is 1, and we add one more to
+            // guard against jitter.
+            meter_wait_until_ts = get_timestamp() + MEASURE_DELAY_MS;
+            meter_state = MeterState::SCAN_CC1_MEASURE_WAIT;
+            repeat = true;
+            break;
+
+        case MeterState::SCAN_CC1_MEASURE_WAIT:
+            if (get_timestamp() < meter_wait_until_ts) { break; }
+
+            DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Status0::reg, status0.raw_value));
+            cc1_value.store(static_cast<TCPC_CC_LEVEL::Type>(status0.BC_LVL));
+
+            // Measure CC2
+            DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Switches0::reg, sw0.raw_value));
+            sw0.MEAS_CC1 = 0;
+            sw0.MEAS_CC2 = 1;
+            DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Switches0::reg, sw0.raw_value));
+            meter_wait_until_ts = get_timestamp() + MEASURE_DELAY_MS;
+            meter_state = MeterState::SCAN_CC2_MEASURE_WAIT;
+            repeat = true;
+
+            break;
+
+        case MeterState::SCAN_CC2_MEASURE_WAIT:
+            if (get_timestamp() < meter_wait_until_ts) { break; }
+
+            DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Status0::reg, status0.raw_value));
+            cc2_value.store(static_cast<TCPC_CC_LEVEL::Type>(status0.BC_LVL));
+
+            // Restore previous state
+            DRV_RET_FALSE_ON_ERROR(hal.read_reg(i2c_addr, Switches0::reg, sw0.raw_value));
+            sw0.MEAS_CC1 = meter_sw0_backup.MEAS_CC1;
+            sw0.MEAS_CC2 = meter_sw0_backup.MEAS_CC2;
+            DRV_RET_FALSE_ON_ERROR(hal.write_reg(i2c_addr, Switches0::reg, sw0.raw_value));
+
+            DRV_LOGV("Scan CC2/CC1 end");
+            sync_scan_cc.job_finish();
+            meter_state = MeterState::IDLE;
+            has_deferred_wakeup = true;
+
+            break;
+    }
+
+    return true;
+}
+
+void Fusb302Core::handle_meter() {
+    bool repeat = false;
+
+    while (1) {
+        DRV_RET_ON_ERROR(meter_tick(repeat));
+        if (!repeat) { break; }
+    }
+
+    return;
+}
+
+bool Fusb302Core::get_meter_deadline(uint32_t& ts) const {
+    switch (meter_state) {
+        case MeterState::CC_ACTIVE_MEASURE_WAIT:
+        case MeterState::SCAN_CC1_MEASURE_WAIT:
+        case MeterState::SCAN_CC2_MEASURE_WAIT:
+            ts = meter_wait_until_ts;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void Fusb302Core::handle_timer() {
+    handle_meter();
+    has_deferred_timer = true;
+    return;
+}
+
+void Fusb302Core::handle_tcpc_calls() {
+
+    TCPC_POLARITY _polarity{};
+        if (sync_set_polarity.get_job(_polarity)) {
+            // "Drop" tx for sure
+            port.tcpc_tx_status.store(TCPC_TRANSMIT_STATUS::UNSET);
+            // Since polarity reconfigures the comparator, terminate the
+            // measurer to prevent restoring old config from backup
+            sync_scan_cc.reset();
+            sync_active_cc.reset();
+            meter_state = MeterState::IDLE;
+
+        DRV_LOG_ON_ERROR(fusb_set_polarity(_polarity));
+        sync_set_polarity.job_finish();
+        has_deferred_wakeup = true;
+    }
+
+    bool _rx_enabled{};
+    if (sync_rx_enable.get_job(_rx_enabled)) {
+        port.tcpc_tx_status.store(TCPC_TRANSMIT_STATUS::UNSET);
+        DRV_LOG_ON_ERROR(fusb_set_rx_enable(_rx_enabled));
+        sync_rx_enable.job_finish();
+        has_deferred_wakeup = true;
+    }
+
+    bool _low_power{};
+    if (sync_set_low_power.get_job(_low_power)) {
+        DRV_LOG_ON_ERROR(fusb_set_low_power(_low_power));
+        sync_set_low_power.job_finish();
+    }
+
+    TCPC_BIST_MODE _bist_mode{};
+    if (sync_set_bist.get_job(_bist_mode)) {
+        DRV_LOG_ON_ERROR(fusb_set_bist(_bist_mode));
+        sync_set_bist.job_finish();
+        has_deferred_wakeup = true;
+    }
+
+    auto expected = TCPC_TRANSMIT_STATUS::ENQUEUED;
+    if (port.tcpc_tx_status.compare_exchange_strong(expected, TCPC_TRANSMIT_STATUS::SENDING)) {
+        if (!fusb_tx_pkt_begin(tx_send_idx.load())) {
+            fusb_tx_pkt_end(TCPC_TRANSMIT_STATUS::FAILED);
+        }
+    }
+
+    if (sync_hr_send.get_job()) {
+        // Clean up before sending just in case (probably not required)
+        DRV_LOG_ON_ERROR(fusb_flush_rx_fifo());
+        DRV_LOG_ON_ERROR(fusb_flush_tx_fifo());
+        rx_queue.clear_from_producer();
+
+        // Emulate transmit entry to get result as for ordinary chunk
+        // (because we can have both success and failure)
+        port.tcpc_tx_status.store(TCPC_TRANSMIT_STATUS::SENDING);
+
+        // Initiate hard reset sending. Then PRL should check
+        // port.tcpc_tx_status to get result.
+        if (!fusb_hr_send()) {
+            fusb_tx_pkt_end(TCPC_TRANSMIT_STATUS::FAILED);
+        }
+        sync_hr_send.job_finish();
+        has_deferred_wakeup = true;
+    }
+}
+
+void Fusb302Core::handle_events(uint32_t event_mask) {
+    // Always check interrupt level to avoid deadlock
+    handle_interrupt();
+
+    if (event_mask & MSK_TIMER) {
+        handle_timer();
+    }
+    if (event_mask & MSK_API_CALL) {
+        DRV_LOGI("Handle API call");
+        handle_tcpc_calls();
+    }
+    // Stack wakeup requested from another thread, pass it to the port
+    if (event_mask & MSK_WAKEUP) {
+        has_deferred_wakeup = true;
+    }
+}
+
+void Fusb302Core::flush_deferred() {
+    if (has_deferred_wakeup) {
+        has_deferred_wakeup = false;
+        DRV_LOGD("Waking up port");
+        port.wakeup();
+    }
+    if (has_deferred_timer) {
+        has_deferred_timer = false;
+        port.notify_task(MsgTask_Timer{});
+    }
+}
+
+void Fusb302Core::init_common() {
+    // Pre-fill the constant part of TX frames. Hardcode the message SOP,
+    // since the library supports only sink mode.
+    for (auto& frame : tx_frames) {
+        frame.raw[0] = TX_TKN::SOP1;
+        frame.raw[1] = TX_TKN::SOP1;
+        frame.raw[2] = TX_TKN::SOP1;
+        frame.raw[3] = TX_TKN::SOP2;
+    }
+
+    hal.set_event_handler(
+        hal_event_handler_t::create<Fusb302Core, &Fusb302Core::on_hal_event>(*this)
+    );
+}
+
+void Fusb302Core::on_hal_event(HAL_EVENT_TYPE event, bool from_isr) {
+    switch (event) {
+        case HAL_EVENT_TYPE::Timer:
+            kick_task(MSK_TIMER, from_isr);
+            break;
+        case HAL_EVENT_TYPE::FUSB302_Interrupt:
+            kick_task(MSK_PD_INTERRUPT, from_isr);
+            break;
+        default:
+            DRV_LOGE("Unknown HAL event");
+            break;
+    }
+}
+
+//
+// TCPC API methods.
+//
+
+PD_CHUNK_EXT& Fusb302Core::get_tx_chunk() {
+    // Use the frame not passed to the FIFO writer. If the previous chunk
+    // was built but not transmitted, this returns the same frame again.
+    tx_build_idx = tx_send_idx.load() ^ 1;
+    return tx_frames[tx_build_idx].chunk;
+}
+
+void Fusb302Core::req_transmit() {
+    port.tcpc_tx_status.store(TCPC_TRANSMIT_STATUS::UNSET);
+    tx_send_idx.store(tx_build_idx);
+    port.tcpc_tx_status.store(TCPC_TRANSMIT_STATUS::ENQUEUED);
+    kick_task(MSK_API_CALL);
+}
+
+bool Fusb302Core::try_scan_cc_result(TCPC_CC_LEVEL::Type& cc1, TCPC_CC_LEVEL::Type& cc2) {
+    if (!sync_scan_cc.is_idle()) { return false; }
+    cc1 = cc1_value.load();
+    cc2 = cc2_value.load();
+    return true;
+}
+
+bool Fusb302Core::try_active_cc_result(TCPC_CC_LEVEL::Type& cc) {
+    if (!sync_active_cc.is_idle()) { return false; }
+
+    auto _polarity = polarity.load();
+
+    if (_polarity == TCPC_POLARITY::CC1) {
+        cc = cc1_value.load();
+    }
+    else if (_polarity == TCPC_POLARITY::CC2) {
+        cc = cc2_value.load();
+    } else {
+        // Since this function is used only to wait for SinkTxOK before the first
+        // AMS packet transfer, the result for an unselected polarity does not matter.
+        // Any value that avoids false positives is acceptable.
+        DRV_LOGE("try_active_cc_result: Polarity not selected, returning TCPC_CC_LEVEL::NONE");
+        cc = TCPC_CC_LEVEL::NONE;
+    }
+    return true;
+}
+
+bool Fusb302Core::is_vbus_ok() {
+    return vbus_ok.load();
+}
+
+const PD_CHUNK* Fusb302Core::rx_borrow() {
+    return rx_queue.front();
+}
+
+void Fusb302Core::rx_release() {
+    rx_queue.release();
+}
+
+} // namespace fusb302
+
+} // namespace pd
+
+#endif // USE_FUSB302_RTOS || USE_FUSB302_SUPERLOOP
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <etl/atomic.h>
+#include <etl/delegate.h>
+
+#include "../data_objects.h"
+#include "fusb302_regs.h"
+#include "../idriver.h"
+#include "../utils/atomic_enum_bits.h"
+#include "../utils/leapsync.h"
+#include "../utils/spsc_slot_queue.h"
+
+namespace pd {
+
+class Port;
+
+namespace fusb302 {
+
+// Hal messages to TCPC
+enum class HAL_EVENT_TYPE {
+    Timer,
+    FUSB302_Interrupt
+};
+using hal_event_handler_t = etl::delegate<void(HAL_EVENT_TYPE, bool)>;
+
+// Interface to abstract hardware use.
+class IFusb302Hal {
+public:
+    virtual void setup() = 0;
+    virtual void set_event_handler(const hal_event_handler_t& handler) = 0;
+    virtual ITimer::TimeFunc get_time_func() const = 0;
+
+    virtual bool read_reg(uint8_t i2c_addr, uint8_t reg, uint8_t& data) = 0;
+    virtual bool write_reg(uint8_t i2c_addr, uint8_t reg, uint8_t data) = 0;
+    virtual bool read_block(uint8_t i2c_addr, uint8_t reg, uint8_t *data, uint32_t size) = 0;
+    virtual bool write_block(uint8_t i2c_addr, uint8_t reg, const uint8_t *data, uint32_t size) = 0;
+    virtual bool is_interrupt_active() = 0;
+    // Start/stop the periodic timer. Used to stay idle in low power mode.
+    // Optional, the default keeps the timer running.
+    virtual void set_timer_enable(bool enable) { (void)enable; }
+    // Used to pick the right notification API, if the platform needs it.
+    virtual bool is_in_isr() { return false; }
+};
+
+enum class DRV_FLAG {
+    FUSB_SETUP_DONE,
+    FUSB_SETUP_FAILED,
+    _Count
+};
+
+// Generic FUSB302B logic: registers, FIFO, measurements and TCPC API. Calls
+// are queued and executed by the inherited class in its own context (RTOS
+// task or main loop), see `kick_task()` and `handle_events()`.
+class Fusb302Core : public IDriver {
+protected:
+    static constexpr uint32_t MSK_PD_INTERRUPT = (1u << 0);
+    static constexpr uint32_t MSK_TIMER = (1u << 1);
+    static constexpr uint32_t MSK_API_CALL = (1u << 2);
+    static constexpr uint32_t MSK_WAKEUP = (1u << 3);
+
+    // Wait for VBUSOK sync after power up. Should be 250 us, rounded up to
+    // timer ticks, with a margin for jitter.
+    static constexpr uint32_t SETUP_VBUS_SYNC_MS = 2;
+
+public:
+    Fusb302Core(Port& port, IFusb302Hal& hal) : port{port}, hal{hal} {
+        get_timestamp = hal.get_time_func();
+    };
+
+    // Prohibit copy/move because class contains callback references
+    // and manages hardware resources.
+    Fusb302Core(const Fusb302Core&) = delete;
+    Fusb302Core& operator=(const Fusb302Core&) = delete;
+    Fusb302Core(Fusb302Core&&) = delete;
+    Fusb302Core& operator=(Fusb302Core&&) = delete;
+
+
+    //
+    // TCPC
+    //
+    void req_scan_cc() override {
+        sync_scan_cc.enqueue();
+        kick_task(MSK_API_CALL);
+    };
+    bool try_scan_cc_result(TCPC_CC_LEVEL::Type& cc1, TCPC_CC_LEVEL::Type& cc2) override;
+
+    void req_active_cc() override {
+        sync_active_cc.enqueue();
+        kick_task(MSK_API_CALL);
+    };
+    bool try_active_cc_result(TCPC_CC_LEVEL::Type& cc) override;
+
+    bool is_vbus_ok() override;
+
+    void req_set_polarity(TCPC_POLARITY active_cc) override {
+        sync_set_polarity.enqueue(active_cc);
+        kick_task(MSK_API_CALL);
+    };
+    bool is_set_polarity_done() override { return sync_set_polarity.is_idle(); };
+
+    void req_rx_enable(bool enable) override {
+        sync_rx_enable.enqueue(enable);
+        kick_task(MSK_API_CALL);
+    };
+    bool is_rx_enable_done() override { return sync_rx_enable.is_idle(); };
+
+    const PD_CHUNK* rx_borrow() override;
+    void rx_release() override;
+
+    PD_CHUNK_EXT& get_tx_chunk() override;
+    void req_transmit() override;
+
+    void req_set_bist(TCPC_BIST_MODE mode) override {
+        sync_set_bist.enqueue(mode);
+        kick_task(MSK_API_CALL);
+    };
+    bool is_set_bist_done() override { return sync_set_bist.is_idle(); };
+
+    void req_hr_send() override {
+        sync_hr_send.enqueue();
+        kick_task(MSK_API_CALL);
+    };
+    bool is_hr_send_done() override { return sync_hr_send.is_idle(); };
+
+    void req_set_low_power(bool enable) override {
+        sync_set_low_power.enqueue(enable);
+        kick_task(MSK_API_CALL);
+    };
+
+    auto get_hw_features() -> TCPC_HW_FEATURES override { return tcpc_hw_features; };
+
+    //
+    // Dispatch context
+    //
+    void req_dispatch() override { kick_task(MSK_WAKEUP, hal.is_in_isr()); };
+
+    //
+    // Timer
+    //
+    ITimer::TimeFunc get_time_func() const override { return hal.get_time_func(); };
+
+    AtomicEnumBits<DRV_FLAG> flags{};
+
+protected:
+    // Schedule `handle_events()` with the given mask. Must be safe to call
+    // from ISR when `from_isr` is set.
+    virtual void kick_task(uint32_t event_mask, bool from_isr = false) = 0;
+
+    // Pre-fill TX frames and subscribe to HAL events
+    void init_common();
+    void on_hal_event(HAL_EVENT_TYPE event, bool from_isr);
+
+    // Process events from `kick_task()`, then pass results to the port
+    void handle_events(uint32_t event_mask);
+    void flush_deferred();
+
+    void handle_interrupt();
+    void handle_timer();
+    void handle_tcpc_calls();
+    void handle_meter();
+    bool meter_tick(bool &retry);
+    // Timestamp of the pending measurement step, if any
+    bool get_meter_deadline(uint32_t& ts) const;
+
+    // Chip setup is split around the VBUSOK sync delay, to let the
+    // inherited class wait in its own way.
+    bool fusb_setup_begin();
+    bool fusb_setup_end();
+    bool fusb_set_rxtx_interrupts(bool enable);
+    bool fusb_set_low_power(bool enable);
+    bool fusb_set_auto_goodcrc(bool enable);
+    bool fusb_set_tx_auto_retries(uint8_t count);
+    bool fusb_flush_rx_fifo();
+    bool fusb_flush_tx_fifo();
+    bool fusb_pd_reset();
+    bool fusb_set_polarity(TCPC_POLARITY polarity);
+    bool fusb_set_rx_enable(bool enable);
+    bool fusb_tx_pkt_begin(uint8_t frame_idx);
+    void fusb_tx_pkt_end(TCPC_TRANSMIT_STATUS status);
+    bool fusb_rx_pkt();
+    bool fusb_hr_send();
+    bool fusb_set_bist(TCPC_BIST_MODE mode);
+    // Clear internal states after a hard reset is received or sent.
+    bool hr_cleanup();
+
+    uint8_t i2c_addr{ChipAddress::FUSB302B};
+    Port& port;
+    IFusb302Hal& hal;
+    ITimer::TimeFunc get_timestamp;
+    bool started{false};
+
+    spsc_slot_queue<PD_CHUNK, 4> rx_queue{};
+    // Used to drain the FIFO when all queue slots are busy.
+    PD_CHUNK rx_drop_chunk{};
+    etl::atomic<TCPC_CC_LEVEL::Type> cc1_value{TCPC_CC_LEVEL::NONE};
+    etl::atomic<TCPC_CC_LEVEL::Type> cc2_value{TCPC_CC_LEVEL::NONE};
+    etl::atomic<TCPC_POLARITY> polarity{TCPC_POLARITY::NONE};
+    etl::atomic<bool> vbus_ok{false};
+    bool rx_enabled{false};
+    bool low_power{false};
+    bool has_deferred_wakeup{false};
+    bool has_deferred_timer{false};
+
+
+    static constexpr TCPC_HW_FEATURES tcpc_hw_features{
+        .rx_auto_goodcrc_send = true,
+        .tx_auto_goodcrc_check = true,
+        .tx_auto_retry = true,
+        .unchunked_ext_msg = false
+    };
+
+    // Call sync + param store primitives
+    LeapSync<> sync_scan_cc;
+    LeapSync<> sync_active_cc;
+    LeapSync<TCPC_POLARITY> sync_set_polarity;
+    LeapSync<bool> sync_rx_enable;
+    LeapSync<TCPC_BIST_MODE> sync_set_bist;
+    LeapSync<> sync_hr_send;
+    LeapSync<bool> sync_set_low_power;
+
+    // TX frames in the FIFO format. PRL builds message data in place (via
+    // get_tx_chunk()), and the driver fills the remaining tokens around it.
+    // Two frames allow building the next message while the previous one may
+    // still be written to the FIFO.
+    struct TxFrame {
+        // SOP[4] + PACKSYM[1] + HEAD[2] + DATA[28] + TAIL[4]
+        static constexpr size_t DATA_OFFSET = 4 + 1 + 2;
+        uint8_t raw[DATA_OFFSET + PD_CHUNK_EXT::MAX_SIZE + 4]{};
+        PD_CHUNK_EXT chunk{raw + DATA_OFFSET};
+    };
+    TxFrame tx_frames[2]{};
+    uint8_t tx_build_idx{0};
+    etl::atomic<uint8_t> tx_send_idx{1};
+
+    enum class MeterState {
+        IDLE,
+        CC_ACTIVE_BEGIN,
+        CC_ACTIVE_MEASURE_WAIT,
+        SCAN_CC_BEGIN,
+        SCAN_CC1_MEASURE_WAIT,
+        SCAN_CC2_MEASURE_WAIT,
+    };
+    MeterState meter_state{MeterState::IDLE};
+    uint32_t meter_wait_until_ts{0};
+    Switches0 meter_sw0_backup{0};
+};
+
+} // namespace fusb302
+
+} // namespace pd
@@ -152,6 +152,15 @@ union Power {
     enum { reg = 0x0B };
 };
 
+// Power.PWR bits
+namespace PowerBlock {
+    static constexpr uint8_t BANDGAP_WAKE = 1u << 0; // Bandgap and wake circuit (VBUSOK)
+    static constexpr uint8_t RECEIVER = 1u << 1; // Receiver and current references
+    static constexpr uint8_t MEASURE = 1u << 2; // Measure block
+    static constexpr uint8_t OSCILLATOR = 1u << 3; // Internal oscillator
+    static constexpr uint8_t ALL = 0xF;
+}
+
 union Reset {
     uint8_t raw_value;
     struct {
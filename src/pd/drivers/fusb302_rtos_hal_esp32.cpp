@@ -70,7 +70,18 @@ void Fusb302RtosHalEsp32::init_timer() {
         .skip_unhandled_events = true,
     };
     ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer_handle));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(timer_handle, 1000)); // 1ms tick
+    set_timer_enable(true);
+}
+
+void Fusb302RtosHalEsp32::set_timer_enable(bool enable) {
+    if (enable == timer_enabled) { return; }
+
+    if (enable) {
+        ESP_ERROR_CHECK(esp_timer_start_periodic(timer_handle, 1000)); // 1ms tick
+    } else {
+        ESP_ERROR_CHECK(esp_timer_stop(timer_handle));
+    }
+    timer_enabled = enable;
 }
 
 void Fusb302RtosHalEsp32::init_fusb_interrupt() {
@@ -114,7 +125,7 @@ void Fusb302RtosHalEsp32::setup() {
 // This will not be actually used, object expected to be static.
 Fusb302RtosHalEsp32::~Fusb302RtosHalEsp32() {
     if (started) {
-        esp_timer_stop(timer_handle);
+        if (timer_enabled) { esp_timer_stop(timer_handle); }
         esp_timer_delete(timer_handle);
         gpio_isr_handler_remove(int_io_pin);
 
@@ -21,6 +21,8 @@ public:
     void setup() override;
     ITimer::TimeFunc get_time_func() const override;
     bool is_interrupt_active() override;
+    void set_timer_enable(bool enable) override;
+    bool is_in_isr() override { return xPortInIsrContext(); }
 
     // The I2C API can be used by other application modules independently
     // when the bus is shared between multiple devices.
@@ -50,6 +52,7 @@ protected:
     hal_event_handler_t event_cb;
     esp_timer_handle_t timer_handle;
     bool started{false};
+    bool timer_enabled{false};
     bool i2c_initialized{false};
 
     virtual void init_timer();
@@ -0,0 +1,99 @@
+#include "../pd_conf.h"
+
+#if defined(USE_FUSB302_SUPERLOOP)
+
+#include "fusb302_superloop.h"
+#include "../pd_log.h"
+
+namespace pd {
+
+namespace fusb302 {
+
+// Time left to the timestamp, with care about overflow. 0 if passed.
+static uint32_t time_left(uint32_t ts, uint32_t now) {
+    auto diff = static_cast<int32_t>(ts - now);
+    return diff > 0 ? static_cast<uint32_t>(diff) : 0;
+}
+
+void Fusb302Superloop::setup() {
+    if (started) { return; }
+
+    init_common();
+    hal.setup();
+
+    started = true;
+
+    // The rest of setup is done by poll(), after VBUSOK sync
+    if (!flags.test(DRV_FLAG::FUSB_SETUP_DONE) && fusb_setup_begin()) {
+        setup_wait_until_ts = get_timestamp() + SETUP_VBUS_SYNC_MS;
+        setup_pending = true;
+    }
+}
+
+void Fusb302Superloop::kick_task(uint32_t event_mask, bool from_isr) {
+    (void)from_isr;
+    // Atomic OR is all we need. The main loop wakes up on any IRQ.
+    pending_events.fetch_or(event_mask);
+}
+
+uint32_t Fusb302Superloop::poll() {
+    if (!started) { return NO_DEADLINE; }
+
+    if (setup_pending) {
+        auto left = time_left(setup_wait_until_ts, get_timestamp());
+        if (left) { return left; }
+
+        setup_pending = false;
+        fusb_setup_end();
+    }
+
+    if (flags.test(DRV_FLAG::FUSB_SETUP_FAILED)) { return NO_DEADLINE; }
+
+    for (int round = 0; round < MAX_POLL_ROUNDS; round++) {
+        auto event_mask = pending_events.exchange(0);
+
+        if (timer_armed && !time_left(timer_deadline_ts, get_timestamp())) {
+            timer_armed = false;
+            event_mask |= MSK_TIMER;
+        }
+
+        handle_events(event_mask);
+        // Timer events are rare with rearm, so advance measurements on
+        // every call instead.
+        if (!(event_mask & MSK_TIMER)) { handle_meter(); }
+
+        // May call the driver API back and kick new events
+        flush_deferred();
+
+        if (!has_pending_events() && !hal.is_interrupt_active()) { break; }
+
+        DRV_LOGI("Fusb302Superloop: New event detected, repeat processing...");
+    }
+
+    return get_next_deadline();
+}
+
+uint32_t Fusb302Superloop::get_next_deadline() {
+    if (has_pending_events() || hal.is_interrupt_active()) { return 0; }
+
+    auto now = get_timestamp();
+    uint32_t result = NO_DEADLINE;
+
+    if (timer_armed) {
+        result = time_left(timer_deadline_ts, now);
+    }
+
+    uint32_t meter_ts{0};
+    if (get_meter_deadline(meter_ts)) {
+        auto left = time_left(meter_ts, now);
+        if (left < result) { result = left; }
+    }
+
+    return result;
+}
+
+} // namespace fusb302
+
+} // namespace pd
+
+#endif // USE_FUSB302_SUPERLOOP
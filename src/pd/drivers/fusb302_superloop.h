@@ -0,0 +1,78 @@
+#pragma once
+
+#include <etl/atomic.h>
+
+#include "fusb302_core.h"
+
+namespace pd {
+
+namespace fusb302 {
+
+// FUSB302B driver for firmware without RTOS. All work (I2C included) is
+// done in `poll()`, called from the application main loop. HAL events only
+// set flags, and are safe to come from ISR.
+//
+// Typical loop:
+//
+//   for (;;) {
+//       auto sleep_ms = driver.poll();
+//       // disable interrupts
+//       if (!driver.has_pending_events()) { sleep up to `sleep_ms` or IRQ }
+//       // enable interrupts
+//   }
+//
+// The timer is rearmed by the stack, so HAL does not need a periodic tick.
+// HAL timer events, if any, are still accepted.
+class Fusb302Superloop : public Fusb302Core {
+public:
+    Fusb302Superloop(Port& port, IFusb302Hal& hal) : Fusb302Core{port, hal} {}
+
+    void setup() override;
+
+    // Process pending events and pass results to the port. Returns time
+    // (ms) until the next deadline, when `poll()` should be called again
+    // without new events. 0 - call again immediately, NO_DEADLINE - wait
+    // for events only.
+    uint32_t poll();
+    static constexpr uint32_t NO_DEADLINE = UINT32_MAX;
+
+    // Check before entering sleep, with interrupts disabled. Events wait
+    // until the chip setup is finished.
+    bool has_pending_events() const {
+        return !setup_pending && pending_events.load() != 0;
+    }
+
+    //
+    // Timer
+    //
+    void rearm(uint32_t interval) override {
+        timer_deadline_ts = get_timestamp() + interval;
+        timer_armed = true;
+    };
+    bool is_rearm_supported() override { return true; };
+
+    //
+    // Dispatch context
+    //
+    // Only the main loop runs the stack, ISRs just leave events.
+    bool is_dispatch_context() override { return !hal.is_in_isr(); };
+
+protected:
+    void kick_task(uint32_t event_mask, bool from_isr = false) override;
+    uint32_t get_next_deadline();
+
+    // Limits poll() time, if the stack and the driver keep kicking each other
+    static constexpr int MAX_POLL_ROUNDS = 8;
+
+    etl::atomic<uint32_t> pending_events{0};
+
+    bool setup_pending{false};
+    uint32_t setup_wait_until_ts{0};
+
+    bool timer_armed{false};
+    uint32_t timer_deadline_ts{0};
+};
+
+} // namespace fusb302
+
+} // namespace pd
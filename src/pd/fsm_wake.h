@@ -0,0 +1,39 @@
+#pragma once
+
+#include "port.h"
+#include "utils/afsm.h"
+
+namespace pd {
+
+// Wake conditions for PD states, see `afsm::fsm::run()`. FSM should
+// provide `get_port()`. Usage:
+//
+//   using Wake = FsmWake<PE>;
+//   static constexpr afsm::wake_fn<PE> wake_on[] = {
+//       Wake::flags<&Port::pe_flags, PE_FLAGS_MASK>,
+//       Wake::timers<PD_TIMER::PE_SinkRequestTimer>
+//   };
+template<typename FSM>
+struct FsmWake {
+    // Masked flags of a port member
+    template<auto Member, uint32_t Mask = 0xFFFFFFFF>
+    static uint32_t flags(FSM& fsm) {
+        return (fsm.get_port().*Member).snapshot() & Mask;
+    }
+
+    // Status of timers, 2 bits per timer
+    template<PD_TIMER::Type... Ids>
+    static uint32_t timers(FSM& fsm) {
+        static_assert(sizeof...(Ids) <= 16, "Too many timers");
+        auto& timers = fsm.get_port().timers;
+        uint32_t value = 0;
+        ((value = (value << 2) | timers.get_status(Ids)), ...);
+        return value;
+    }
+
+    static uint32_t prl_busy(FSM& fsm) {
+        return fsm.get_port().is_prl_busy() ? 1 : 0;
+    }
+};
+
+} // namespace pd
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "pd_conf.h"
+#include "data_objects.h"
 
 namespace pd {
 
@@ -30,11 +31,21 @@ enum class TCPC_BIST_MODE {
 };
 
 // Hardware features description to clarify Rx/Tx logic in PRL.
-// Not final. Cases without hardware CRC support may need to be dropped.
+// For TCPCs without CRC support, see utils/soft_crc.h helpers.
 struct TCPC_HW_FEATURES {
+    // If false, driver should check CRC of received frames and reply with
+    // GoodCRC itself (PRL can't do that within tTransmit).
     bool rx_auto_goodcrc_send;
+    // If false, driver reports SUCCEEDED when the message is sent, and passes
+    // received GoodCRC messages to PRL via RX queue, for message ID check.
     bool tx_auto_goodcrc_check;
     bool tx_auto_retry;
+    // Can transfer unchunked extended messages (extended header + up to 260
+    // bytes of data in a single packet), with PD_FEATURE_UNCHUNKED_EXT. Such
+    // packets have Number of Data Objects 0, and PRL does not retry them if
+    // data is longer than MaxExtendedMsgLegacyLen. The TCPC should not
+    // auto-retry them either.
+    bool unchunked_ext_msg;
 };
 
 // NOTE: discarding is done at PRL layer.
@@ -109,10 +120,21 @@ public:
     virtual void req_rx_enable(bool enable) = 0;
     virtual bool is_rx_enable_done() = 0;
 
-    // Fetch pending RX data.
-    virtual bool fetch_rx_data() = 0;
-
-    // Transmit the packet in tx_info
+    // Zero-copy RX. Borrow the oldest received chunk in place, or nullptr
+    // if nothing is pending. The chunk stays valid (and is not reused by the
+    // driver) until rx_release() is called. Repeated calls without release
+    // return the same chunk.
+    virtual const PD_CHUNK* rx_borrow() = 0;
+    virtual void rx_release() = 0;
+
+    // Zero-copy TX. Returns the chunk to build the next outgoing message in.
+    // Its data may be placed directly inside a hardware-specific TX frame,
+    // so req_transmit() does not need to copy it. Call before building each
+    // new message. The returned chunk is not touched by the driver until
+    // req_transmit() is called.
+    virtual PD_CHUNK_EXT& get_tx_chunk() = 0;
+
+    // Transmit the chunk returned by the last get_tx_chunk()
     virtual void req_transmit() = 0;
 
     // Set BIST mode
@@ -122,10 +144,27 @@ public:
     virtual void req_hr_send() = 0;
     virtual bool is_hr_send_done() = 0;
 
+    // Low power mode for the detached state. Only VBUS detection should
+    // stay active, and the driver may stop its periodic timer until the
+    // mode is turned off. Drivers without power management can ignore it.
+    virtual void req_set_low_power(bool enable) = 0;
+
     virtual auto get_hw_features() -> TCPC_HW_FEATURES = 0;
 };
 
-class IDriver: public ITCPC, public ITimer {
+// The context (thread/task) that runs the stack. By default, events are
+// dispatched right in the caller's context. A driver with its own thread
+// should make it the only one running the stack: tell if the current
+// context is that thread, and on request call `Port::wakeup()` from there.
+// Wakeups from other threads and ISRs then only set events.
+class IDispatchContext {
+public:
+    virtual bool is_dispatch_context() { return true; }
+    // Must be safe to call from any thread and ISR
+    virtual void req_dispatch() {}
+};
+
+class IDriver: public ITCPC, public ITimer, public IDispatchContext {
 public:
     virtual void setup() = 0;
 };
@@ -14,7 +14,9 @@ namespace pd {
 #define DEFINE_PARAM_MSG(ClassName, MsgId, ParamType, ParamName) \
     class ClassName : public etl::message<MsgId> { \
     public: \
+        using param_type = ParamType; \
         explicit ClassName(ParamType ParamName) : ParamName{ParamName} {} \
+        ParamType param() const { return ParamName; } \
         const ParamType ParamName; \
     }
 
@@ -106,8 +108,6 @@ enum msg_prl_id {
     MSG_TO_PRL__CTL_MSG_FROM_PE,
     MSG_TO_PRL__DATA_MSG_FROM_PE,
     MSG_TO_PRL__EXT_MSG_FROM_PE,
-
-    MSG_TO_PRL__GET_PRL_STATUS
 };
 
 DEFINE_SIMPLE_MSG(MsgToPrl_EnqueueRestart, MSG_TO_PRL__ENQUEUE_RESTART);
@@ -119,12 +119,4 @@ DEFINE_PARAM_MSG(MsgToPrl_CtlMsgFromPe, MSG_TO_PRL__CTL_MSG_FROM_PE, PD_CTRL_MSG
 DEFINE_PARAM_MSG(MsgToPrl_DataMsgFromPe, MSG_TO_PRL__DATA_MSG_FROM_PE, PD_DATA_MSGT::Type, type);
 DEFINE_PARAM_MSG(MsgToPrl_ExtMsgFromPe, MSG_TO_PRL__EXT_MSG_FROM_PE, PD_EXT_MSGT::Type, type);
 
-class MsgToPrl_GetPrlStatus : public etl::message<MSG_TO_PRL__GET_PRL_STATUS> {
-public:
-    MsgToPrl_GetPrlStatus(bool& is_running_ref, bool& is_busy_ref)
-        : is_running_ref(is_running_ref), is_busy_ref(is_busy_ref) {}
-    bool& is_running_ref;
-    bool& is_busy_ref;
-};
-
 }
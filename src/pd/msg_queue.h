@@ -0,0 +1,185 @@
+#pragma once
+
+#include <etl/type_traits.h>
+#include <etl/utility.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "messages.h"
+
+namespace pd {
+
+//
+// Deferred message delivery, see `Port::msg_queue`.
+//
+// By default, `Port::notify_*()` calls the receiver directly, so a component
+// run can nest into another one (PRL -> PE -> DPM -> ...). With a queue
+// attached, messages between components are stored here, and `Task::tick()`
+// delivers them after component runs, from the top level. Then listeners
+// never nest into each other, and the stack depth is bounded by the deepest
+// single component run. See docs for details.
+//
+// Messages are stored in a compact form: receiver, message index in the
+// receiver's list and a 32-bit parameter. Every message has at most one
+// parameter, see DEFINE_PARAM_MSG.
+//
+
+enum class MSG_QUEUE_TARGET : uint8_t {
+    PE,
+    PRL,
+    DPM
+};
+
+struct DeferredMsg {
+    MSG_QUEUE_TARGET target;
+    uint8_t index;
+    uint32_t param;
+};
+
+template <typename... Ts>
+struct msg_list {};
+
+namespace msg_queue_details {
+    template <typename T, typename List>
+    struct index_of;
+
+    template <typename T>
+    struct index_of<T, msg_list<>> {
+        static constexpr bool found = false;
+        static constexpr uint8_t value = 0;
+    };
+
+    template <typename T, typename Head, typename... Tail>
+    struct index_of<T, msg_list<Head, Tail...>> {
+        using next = index_of<T, msg_list<Tail...>>;
+        static constexpr bool found = etl::is_same<T, Head>::value || next::found;
+        static constexpr uint8_t value = etl::is_same<T, Head>::value ? 0 : uint8_t(next::value + 1);
+    };
+
+    // Messages from DEFINE_PARAM_MSG have `param_type`
+    template <typename T, typename = void>
+    struct has_param : etl::false_type {};
+    template <typename T>
+    struct has_param<T, decltype(void(sizeof(typename T::param_type)))> : etl::true_type {};
+
+    template <typename T>
+    uint32_t pack(const T& msg, etl::true_type) {
+        static_assert(sizeof(typename T::param_type) <= sizeof(uint32_t), "Param too big");
+        return static_cast<uint32_t>(msg.param());
+    }
+    template <typename T>
+    uint32_t pack(const T&, etl::false_type) { return 0; }
+
+    template <typename T>
+    T unpack(uint32_t param, etl::true_type) { return T{static_cast<typename T::param_type>(param)}; }
+    template <typename T>
+    T unpack(uint32_t, etl::false_type) { return T{}; }
+
+    template <typename T, typename Fn>
+    void call_with(Fn& fn, uint32_t param) { fn(unpack<T>(param, has_param<T>{})); }
+
+    // Rebuild the message at `index` and pass it to `fn`. Selected by a
+    // table, to not add a stack frame per list entry.
+    template <typename Fn, typename... Ts>
+    void visit(msg_list<Ts...>, uint8_t index, uint32_t param, Fn&& fn) {
+        using thunk_t = void (*)(Fn&, uint32_t);
+        static constexpr thunk_t thunks[] = { &call_with<Ts, Fn>... };
+        if (index < sizeof...(Ts)) { thunks[index](fn, param); }
+    }
+} // namespace msg_queue_details
+
+// Messages that can be deferred, per receiver. MsgSysUpdate is the component
+// run itself, and is always delivered directly. Only messages sent from the
+// dispatch context can be listed here. MsgToPrl_TcpcHardReset comes from the
+// driver (the FUSB302 RTOS task), and is delivered directly. Its handler only
+// sets an atomic flag.
+using PeDeferredMsgs = msg_list<
+    MsgToPe_PrlMessageReceived,
+    MsgToPe_PrlMessageSent,
+    MsgToPe_PrlReportError,
+    MsgToPe_PrlReportDiscard,
+    MsgToPe_PrlHardResetFromPartner,
+    MsgToPe_PrlHardResetSent>;
+
+using PrlDeferredMsgs = msg_list<
+    MsgToPrl_EnqueueRestart,
+    MsgToPrl_HardResetFromPe,
+    MsgToPrl_PEHardResetDone,
+    MsgToPrl_CtlMsgFromPe,
+    MsgToPrl_DataMsgFromPe,
+    MsgToPrl_ExtMsgFromPe>;
+
+using DpmDeferredMsgs = msg_list<
+    MsgToDpm_Startup,
+    MsgToDpm_TransitToDefault,
+    MsgToDpm_SrcCapsReceived,
+    MsgToDpm_SelectCapDone,
+    MsgToDpm_SrcDisabled,
+    MsgToDpm_Alert,
+    MsgToDpm_EPREntryFailed,
+    MsgToDpm_SnkReady,
+    MsgToDpm_CableAttached,
+    MsgToDpm_CableDetached,
+    MsgToDpm_HandshakeDone,
+    MsgToDpm_NewPowerLevelRejected,
+    MsgToDpm_NewPowerLevelAccepted>;
+
+// FIFO of deferred messages. Used by the dispatch context only, no locks.
+class IMsgQueue {
+public:
+    IMsgQueue(const IMsgQueue&) = delete;
+    IMsgQueue& operator=(const IMsgQueue&) = delete;
+
+    // Returns false if the queue is full. Then the message should be
+    // delivered directly, after the queued ones (see Port::defer()).
+    bool push(const DeferredMsg& msg) {
+        if (count >= capacity) {
+            overflows++;
+            return false;
+        }
+        slots[(head + count) % capacity] = msg;
+        count++;
+        if (count > max_count) { max_count = count; }
+        return true;
+    }
+
+    bool pop(DeferredMsg& msg) {
+        if (count == 0) { return false; }
+        msg = slots[head];
+        head = (head + 1) % capacity;
+        count--;
+        return true;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { head = 0; count = 0; }
+
+    // For queue sizing. Max messages stored at once, and pushes to a full
+    // queue (delivered directly after draining the queue, with nesting).
+    size_t max_size_used() const { return max_count; }
+    uint32_t overflow_count() const { return overflows; }
+
+protected:
+    IMsgQueue(DeferredMsg* slots, size_t capacity) : slots{slots}, capacity{capacity} {}
+
+private:
+    DeferredMsg* slots;
+    size_t capacity;
+    size_t head{0};
+    size_t count{0};
+    size_t max_count{0};
+    uint32_t overflows{0};
+};
+
+// Usually, a few messages are pending at once (a PRL report, a PE reply and
+// a DPM notification). 8 leaves a margin, check `max_size_used()`.
+template <size_t Size = 8>
+class MsgQueue : public IMsgQueue {
+public:
+    MsgQueue() : IMsgQueue(storage, Size) {}
+private:
+    DeferredMsg storage[Size]{};
+};
+
+} // namespace pd
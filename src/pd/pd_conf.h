@@ -17,3 +17,75 @@
 #if !defined(PD_TIMER_RESOLUTION_US)
 #define PD_TIMER_RESOLUTION_US 0
 #endif
+
+// Feature profile. Features not needed by the product can be compiled out,
+// to save RAM and flash. All are enabled by default.
+//
+// - PD_FEATURE_EXTENDED - extended messages and chunking (RCH/TCH). When
+//   disabled, Port message buffers are sized for a single chunk (28 bytes
+//   instead of 260), and received extended messages are answered with
+//   Not_Supported.
+// - PD_FEATURE_EPR - EPR mode (entry, keep-alive, EPR capabilities). Requires
+//   PD_FEATURE_EXTENDED. When disabled, PDO lists are sized for SPR (7 PDOs
+//   instead of 11), and the sink does not report EPR capability.
+// - PD_FEATURE_BIST - BIST carrier / test data modes. When disabled, BIST
+//   requests are answered with Not_Supported.
+// - PD_FEATURE_UNCHUNKED_EXT - unchunked extended messages (whole message in
+//   a single packet, without chunk requests). Disabled by default. Requires
+//   PD_FEATURE_EXTENDED, and a TCPC able to transfer long packets (see
+//   `TCPC_HW_FEATURES::unchunked_ext_msg`). Driver chunk buffers grow from
+//   28 to 262 bytes. Used only when the source supports it too.
+//
+// PD_PROFILE_SPR_MINIMAL disables all of the above, for fixed/PPS SPR sinks.
+#if defined(PD_PROFILE_SPR_MINIMAL)
+    #if !defined(PD_FEATURE_EXTENDED)
+    #define PD_FEATURE_EXTENDED 0
+    #endif
+    #if !defined(PD_FEATURE_EPR)
+    #define PD_FEATURE_EPR 0
+    #endif
+    #if !defined(PD_FEATURE_BIST)
+    #define PD_FEATURE_BIST 0
+    #endif
+#endif
+
+#if !defined(PD_FEATURE_EXTENDED)
+#define PD_FEATURE_EXTENDED 1
+#endif
+
+#if !defined(PD_FEATURE_EPR)
+#define PD_FEATURE_EPR PD_FEATURE_EXTENDED
+#endif
+
+#if !defined(PD_FEATURE_BIST)
+#define PD_FEATURE_BIST 1
+#endif
+
+#if !defined(PD_FEATURE_UNCHUNKED_EXT)
+#define PD_FEATURE_UNCHUNKED_EXT 0
+#endif
+
+#if PD_FEATURE_EPR && !PD_FEATURE_EXTENDED
+#error "PD_FEATURE_EPR requires PD_FEATURE_EXTENDED"
+#endif
+
+#if PD_FEATURE_UNCHUNKED_EXT && !PD_FEATURE_EXTENDED
+#error "PD_FEATURE_UNCHUNKED_EXT requires PD_FEATURE_EXTENDED"
+#endif
+
+// Fast detach by CC open (Rp removed by the source), in ms. While attached,
+// active CC is polled, and the port detaches when CC stays open for this
+// time, without waiting for VBUS to decay. Use tPDDebounce (10..20 ms) or
+// more. 0 disables polling, and detach is detected by VBUS only. Tested
+// in the `test-desktop-cc-detach` env.
+#if !defined(PD_TC_CC_DETACH_DEBOUNCE_MS)
+#define PD_TC_CC_DETACH_DEBOUNCE_MS 0
+#endif
+
+// Debug checks of internal invariants (for example, the stack running in a
+// wrong thread). Uses assert() by default, so NDEBUG disables them. Define
+// your own PD_ASSERT(expr) to log or halt instead.
+#if !defined(PD_ASSERT)
+    #include <assert.h>
+    #define PD_ASSERT(expr) assert(expr)
+#endif
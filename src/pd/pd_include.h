@@ -21,6 +21,14 @@
 #include "drivers/fusb302_rtos.h"
 #endif // USE_FUSB302_RTOS
 
+#ifdef USE_FUSB302_SUPERLOOP
+#include "drivers/fusb302_superloop.h"
+#endif // USE_FUSB302_SUPERLOOP
+
+#if defined(USE_FUSB302_RTOS) || defined(USE_FUSB302_SUPERLOOP)
+#include "drivers/fusb302_bus.h"
+#endif
+
 #ifdef USE_FUSB302_RTOS_HAL_ESP32
 #include "drivers/fusb302_rtos_hal_esp32.h"
 #endif // USE_FUSB302_RTOS_HAL_ESP32
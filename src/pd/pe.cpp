@@ -2,15 +2,20 @@
 #include <etl/array.h>
 
 #include "dpm.h"
+#include "fsm_wake.h"
 #include "idriver.h"
 #include "pd_log.h"
 #include "pe.h"
 #include "port.h"
 #include "utils/dobj_utils.h"
+#include "utils/payload_views.h"
+#include "utils/src_caps_parser.h"
 
 namespace pd {
 
 using afsm::state_id_t;
+using PeWake = FsmWake<PE>;
+using PeFlags = AtomicEnumBits<PE_FLAG>;
 
 enum PE_State {
     // 8.3.3.3 Policy Engine Sink Port State Diagram
@@ -24,7 +29,6 @@ enum PE_State {
 
     PE_SNK_Give_Sink_Cap,
 
-    PE_SNK_EPR_Keep_Alive,
     PE_SNK_Hard_Reset,
     PE_SNK_Transition_to_default,
 
@@ -38,22 +42,28 @@ enum PE_State {
     // [rev3.2] 8.3.3.7.2.1 PE_SNK_Source_Alert_Received State
     PE_SNK_Source_Alert_Received,
 
+    // [rev3.2] 8.3.3.15.2 Give Revision State Diagram
+    PE_Give_Revision,
+
+    // 8.3.3.2.7 PE_SRC_Disabled State
+    PE_Src_Disabled,
+
+    // Optional states go last, to keep IDs sequential when compiled out
+#if PD_FEATURE_EPR
+    PE_SNK_EPR_Keep_Alive,
     // [rev3.2] 8.3.3.26.2 Sink EPR Mode Entry State Diagram
     PE_SNK_Send_EPR_Mode_Entry,
     PE_SNK_EPR_Mode_Entry_Wait_For_Response,
     // [rev3.2] 8.3.3.26.4 Sink EPR Mode Exit State Diagram
     PE_SNK_EPR_Mode_Exit_Received, // Manual exit not needed, only SRC-forced
+#endif
 
+#if PD_FEATURE_BIST
     // [rev3.2] 8.3.3.27 BIST State Diagrams
     PE_BIST_Activate, // Not in spec, common entry point
     PE_BIST_Carrier_Mode,
     PE_BIST_Test_Mode,
-
-    // [rev3.2] 8.3.3.15.2 Give Revision State Diagram
-    PE_Give_Revision,
-
-    // 8.3.3.2.7 PE_SRC_Disabled State
-    PE_Src_Disabled,
+#endif
 };
 
 namespace {
@@ -67,24 +77,43 @@ namespace {
             case PE_SNK_Transition_Sink: return "PE_SNK_Transition_Sink";
             case PE_SNK_Ready: return "PE_SNK_Ready";
             case PE_SNK_Give_Sink_Cap: return "PE_SNK_Give_Sink_Cap";
-            case PE_SNK_EPR_Keep_Alive: return "PE_SNK_EPR_Keep_Alive";
             case PE_SNK_Hard_Reset: return "PE_SNK_Hard_Reset";
             case PE_SNK_Transition_to_default: return "PE_SNK_Transition_to_default";
             case PE_SNK_Soft_Reset: return "PE_SNK_Soft_Reset";
             case PE_SNK_Send_Soft_Reset: return "PE_SNK_Send_Soft_Reset";
             case PE_SNK_Send_Not_Supported: return "PE_SNK_Send_Not_Supported";
             case PE_SNK_Source_Alert_Received: return "PE_SNK_Source_Alert_Received";
+            case PE_Give_Revision: return "PE_Give_Revision";
+            case PE_Src_Disabled: return "PE_Src_Disabled";
+#if PD_FEATURE_EPR
+            case PE_SNK_EPR_Keep_Alive: return "PE_SNK_EPR_Keep_Alive";
             case PE_SNK_Send_EPR_Mode_Entry: return "PE_SNK_Send_EPR_Mode_Entry";
             case PE_SNK_EPR_Mode_Entry_Wait_For_Response: return "PE_SNK_EPR_Mode_Entry_Wait_For_Response";
             case PE_SNK_EPR_Mode_Exit_Received: return "PE_SNK_EPR_Mode_Exit_Received";
+#endif
+#if PD_FEATURE_BIST
             case PE_BIST_Activate: return "PE_BIST_Activate";
             case PE_BIST_Carrier_Mode: return "PE_BIST_Carrier_Mode";
             case PE_BIST_Test_Mode: return "PE_BIST_Test_Mode";
-            case PE_Give_Revision: return "PE_Give_Revision";
-            case PE_Src_Disabled: return "PE_Src_Disabled";
+#endif
             default: return "Unknown PE state";
         }
     }
+
+    ETL_MAYBE_UNUSED void log_src_caps_error(SRC_CAPS_ERROR error, ETL_MAYBE_UNUSED size_t idx) {
+        switch (error) {
+            case SRC_CAPS_ERROR::NONE: break;
+            case SRC_CAPS_ERROR::EMPTY: PE_LOGE("SRC Capabilities can't be empty"); break;
+            case SRC_CAPS_ERROR::TOO_MANY_PDOS: PE_LOGE("SRC Capabilities max count is {}", MaxPdoObjects); break;
+            case SRC_CAPS_ERROR::FIRST_NOT_SAFE5V: PE_LOGE("First PDO MUST be Safe5v FIXED"); break;
+            case SRC_CAPS_ERROR::EPR_PDO_AT_SPR_POSITION: PE_LOGE("EPR PDO prohibited at SPR position {}", idx + 1); break;
+            case SRC_CAPS_ERROR::SPR_PDO_AT_EPR_POSITION: PE_LOGE("SPR PDO prohibited at EPR position {}", idx + 1); break;
+            case SRC_CAPS_ERROR::MULTIPLE_SPR_AVS: PE_LOGE("Only one SPR AVS APDO allowed"); break;
+            case SRC_CAPS_ERROR::MULTIPLE_EPR_AVS: PE_LOGE("Only one EPR AVS APDO allowed"); break;
+            case SRC_CAPS_ERROR::FIXED_NOT_ASCENDING: PE_LOGE("Fixed PDO voltages must be strictly ascending"); break;
+            case SRC_CAPS_ERROR::PPS_NOT_ASCENDING: PE_LOGE("PPS APDO max_voltage must be in ascending order"); break;
+        }
+    }
 } // namespace
 
 class InterceptorForwardErrors : public afsm::interceptor<PE, InterceptorForwardErrors> {
@@ -111,13 +140,16 @@ public:
     static auto on_run_state(PE& pe) -> state_id_t {
         auto& port = pe.port;
 
-        if (!port.pe_flags.test(PE_FLAG::TRANSMIT_REQUEST_SUCCEEDED)) {
-            if (port.pe_flags.test(PE_FLAG::MSG_DISCARDED)) {
+        // One consistent view of the request status flags
+        const auto flags = port.pe_flags.snapshot();
+
+        if (!(flags & PeFlags::mask(PE_FLAG::TRANSMIT_REQUEST_SUCCEEDED))) {
+            if (flags & PeFlags::mask(PE_FLAG::MSG_DISCARDED)) {
                 pe.request_progress = PE_REQUEST_PROGRESS::DISCARDED;
                 return No_State_Change;
             }
 
-            if (port.pe_flags.test(PE_FLAG::PROTOCOL_ERROR)) {
+            if (flags & PeFlags::mask(PE_FLAG::PROTOCOL_ERROR)) {
                 pe.request_progress = PE_REQUEST_PROGRESS::FAILED;
                 return No_State_Change;
             }
@@ -155,6 +187,7 @@ public:
 
         port.notify_prl(MsgToPrl_EnqueueRestart{});
         port.pe_flags.clear(PE_FLAG::HAS_EXPLICIT_CONTRACT);
+        port.unchunked_ext_msg = false;
         port.notify_dpm(MsgToDpm_Startup{});
         return No_State_Change;
     }
@@ -190,6 +223,11 @@ public:
 
 class PE_SNK_Wait_for_Capabilities_State : public afsm::state<PE, PE_SNK_Wait_for_Capabilities_State, PE_SNK_Wait_for_Capabilities> {
 public:
+    static constexpr afsm::wake_fn<PE> wake_on[] = {
+        PeWake::flags<&Port::pe_flags, PeFlags::mask(PE_FLAG::MSG_RECEIVED)>,
+        PeWake::timers<PD_TIMER::PE_SinkWaitCapTimer>
+    };
+
     static auto on_enter_state(PE& pe) -> state_id_t {
         pe.log_state();
 
@@ -233,14 +271,30 @@ public:
         auto& port = pe.port;
         pe.log_state();
 
+        // Validate in place, and store only what fits
+        auto caps = PdoSpan::from_msg(port.rx_emsg);
+
         port.source_caps.clear();
-        for (int i = 0; i < port.rx_emsg.size_to_pdo_count(); i++) {
-            port.source_caps.push_back(port.rx_emsg.read32(i*4));
+        for (auto pdo : caps.first(port.source_caps.max_size())) {
+            port.source_caps.push_back(pdo);
         }
 
         pe.log_source_caps();
 
-        if (!pe.validate_source_caps(port.source_caps)) {
+#if PD_FEATURE_EPR
+        // Chunked EPR_Source_Capabilities are already parsed by RCH, while
+        // chunks arrived. Other messages are parsed here, in one go.
+        auto& parser = port.src_caps_parser;
+        if (!port.rx_emsg.header.extended) { parser.reset(); }
+#else
+        SrcCapsParser parser;
+#endif
+        parser.update(caps);
+        bool valid = parser.finish();
+        port.source_caps_summary = parser.summary();
+
+        if (!valid) {
+            log_src_caps_error(parser.error(), parser.error_position());
             PE_LOGE("Source_Capabilities validation failed");
             return PE_SNK_Send_Not_Supported;
         }
@@ -257,6 +311,7 @@ public:
             PE_LOGE("Source sent too many PDOs for SPR mode ({}), cutting to {}",
                 port.source_caps.size(), MaxPdoObjects_SPR);
             port.source_caps.resize(MaxPdoObjects_SPR);
+            port.source_caps_summary.trim(MaxPdoObjects_SPR);
         }
 
         port.notify_dpm(MsgToDpm_SrcCapsReceived());
@@ -294,10 +349,10 @@ public:
         auto& port = pe.port;
         pe.log_state();
 
-        auto rdo_and_pdo = pe.dpm.get_request_data_object(port.source_caps);
+        auto rdo_and_pdo = pe.dpm.get_request_data_object(port.source_caps, port.source_caps_summary);
 
         PE_LOGD("Selecting PDO[{}] (counting from 1), RDO is 0x{:08X}",
-            RDO_ANY{rdo_and_pdo.first}.obj_position, rdo_and_pdo.first);
+            RdoView{rdo_and_pdo.first}.position(), rdo_and_pdo.first);
 
         // This is not needed, but it exists to suppress warnings from code checkers.
         if (!rdo_and_pdo.first) {
@@ -305,6 +360,11 @@ public:
             return PE_SNK_Hard_Reset;
         }
 
+        // DPM can't know if the TCPC supports long packets
+        if (!pe.is_unchunked_ext_msg_supported()) {
+            rdo_and_pdo.first = dobj::rdo::unchunked_ext_msg_supported::set(rdo_and_pdo.first, 0);
+        }
+
         // Prepare & send request, depending on SPR/EPR mode
         port.tx_emsg.clear();
 
@@ -352,6 +412,10 @@ public:
             {
                 port.pe_flags.set(PE_FLAG::HAS_EXPLICIT_CONTRACT);
                 port.rdo_contracted = port.rdo_to_request;
+                port.unchunked_ext_msg =
+                    dobj::rdo::unchunked_ext_msg_supported::get(port.rdo_contracted) &&
+                    !port.source_caps.empty() &&
+                    dobj::pdo_fixed::unchunked_ext_msg_supported::get(port.source_caps[0]);
 
                 if (pe.active_dpm_request == DPM_REQUEST_FLAG::NEW_POWER_LEVEL) {
                     port.dpm_requests.clear(DPM_REQUEST_FLAG::NEW_POWER_LEVEL);
@@ -458,25 +522,40 @@ public:
 
 class PE_SNK_Ready_State : public afsm::state<PE, PE_SNK_Ready_State, PE_SNK_Ready> {
 public:
+    // Idle contract: skip runs until a message, DPM request, PRL release or
+    // timer (Wait retry, keep-alive) comes.
+    static constexpr afsm::wake_fn<PE> wake_on[] = {
+        PeWake::flags<&Port::pe_flags, PeFlags::mask(PE_FLAG::MSG_RECEIVED)>,
+        PeWake::flags<&Port::dpm_requests>,
+        PeWake::timers<PD_TIMER::PE_SinkRequestTimer,
+                       PD_TIMER::PE_SinkEPRKeepAliveTimer,
+                       PD_TIMER::PE_SinkPPSPeriodicTimer>,
+        PeWake::prl_busy
+    };
+
     static auto on_enter_state(PE& pe) -> state_id_t {
         auto& port = pe.port;
 
+#if PD_FEATURE_EPR
         if (pe.get_previous_state_id() == PE_SNK_EPR_Keep_Alive) {
             // Log returning from EPR Keep-Alive at debug level to reduce noise
             PE_LOGV("PE state => {}", pe_state_to_desc(pe.get_state_id()));
         } else {
             pe.log_state();
         }
+#else
+        pe.log_state();
+#endif
 
         // Ensure flags from the previous send attempt are cleared.
         // If the sink returned to this state, everything starts from scratch.
-        port.pe_flags.clear(PE_FLAG::MSG_DISCARDED);
-        port.pe_flags.clear(PE_FLAG::PROTOCOL_ERROR);
-        port.pe_flags.clear(PE_FLAG::AMS_ACTIVE);
-        port.pe_flags.clear(PE_FLAG::AMS_FIRST_MSG_SENT);
+        port.pe_flags.fetch_and_clear(PeFlags::mask(
+            PE_FLAG::MSG_DISCARDED, PE_FLAG::PROTOCOL_ERROR,
+            PE_FLAG::AMS_ACTIVE, PE_FLAG::AMS_FIRST_MSG_SENT));
 
         pe.active_dpm_request = DPM_REQUEST_FLAG::NONE;
 
+#if PD_FEATURE_EPR
         if (pe.is_in_epr_mode()) {
             // If we are in EPR mode, re-arm the timer for an EPR Keep-Alive request
             port.timers.start(PD_TIMEOUT::tSinkEPRKeepAlive);
@@ -486,6 +565,7 @@ public:
                 port.dpm_requests.set(DPM_REQUEST_FLAG::EPR_MODE_ENTRY);
             }
         }
+#endif
 
         if (pe.is_in_pps_contract()) {
             // The PPS contract should be refreshed at least every 10 s
@@ -512,6 +592,7 @@ public:
                 //
                 switch (hdr.message_type)
                 {
+#if PD_FEATURE_EPR
                 case PD_EXT_MSGT::EPR_Source_Capabilities:
                     if (!pe.is_in_epr_mode()) {
                         // NOTE: This case is NOT specified explicitly in the
@@ -526,10 +607,11 @@ public:
                         return PE_SNK_Give_Sink_Cap;
                     }
                     {
-                        ETL_MAYBE_UNUSED ECDB ecdb{msg.read16(0)};
-                        PE_LOGE("Unsupported PD_EXT_MSGT::Extended_Control type: {}", ecdb.type);
+                        ETL_MAYBE_UNUSED auto ecdb = msg.read16(0);
+                        PE_LOGE("Unsupported PD_EXT_MSGT::Extended_Control type: {}", dobj::ecdb::type::get(ecdb));
                     }
                     return sr_on_unsupported ? PE_SNK_Send_Soft_Reset : PE_SNK_Send_Not_Supported;
+#endif
 
                 default:
                     PE_LOGE("Unexpected PD_EXT_MSGT: {}", hdr.message_type);
@@ -554,22 +636,26 @@ public:
                     if (port.revision >= PD_REVISION::REV30) { return PE_SNK_Send_Not_Supported; }
                     break;
 
+#if PD_FEATURE_BIST
                 case PD_DATA_MSGT::BIST:
                     return PE_BIST_Activate;
+#endif
 
                 case PD_DATA_MSGT::Alert:
                     return PE_SNK_Source_Alert_Received;
 
+#if PD_FEATURE_EPR
                 case PD_DATA_MSGT::EPR_Mode: {
                     // SRC requested to exit EPR mode (should not happen, but
                     // it's allowed by the spec)
-                    EPRMDO eprmdo{msg.read32(0)};
-                    if (eprmdo.action == EPR_MODE_ACTION::EXIT) {
+                    EprModeView eprmdo{msg};
+                    if (eprmdo.action() == EPR_MODE_ACTION::EXIT) {
                         return PE_SNK_EPR_Mode_Exit_Received;
                     }
-                    PE_LOGE("Unsupported PD_DATA_MSGT::EPR_Mode Action: {}", eprmdo.action);
+                    PE_LOGE("Unsupported PD_DATA_MSGT::EPR_Mode Action: {}", eprmdo.action());
                     return sr_on_unsupported ? PE_SNK_Send_Soft_Reset : PE_SNK_Send_Not_Supported;
                 }
+#endif
 
                 default:
                     PE_LOGE("Unexpected PD_DATA_MSGT: {}", hdr.message_type);
@@ -657,6 +743,7 @@ public:
 
             port.pe_flags.set(PE_FLAG::AMS_ACTIVE);
 
+#if PD_FEATURE_EPR
             if (port.dpm_requests.test(DPM_REQUEST_FLAG::EPR_MODE_ENTRY)) {
                 if (pe.is_in_epr_mode()) {
                     PE_LOGI("EPR mode entry requested, but already in EPR mode");
@@ -669,6 +756,7 @@ public:
                     return PE_SNK_Send_EPR_Mode_Entry;
                 }
             }
+#endif
 
             if (port.dpm_requests.test(DPM_REQUEST_FLAG::NEW_POWER_LEVEL)) {
                 pe.active_dpm_request = DPM_REQUEST_FLAG::NEW_POWER_LEVEL;
@@ -686,9 +774,11 @@ public:
         // Keep-alive for EPR mode / PPS contract
         //
 
+#if PD_FEATURE_EPR
         if (port.timers.is_expired(PD_TIMEOUT::tSinkEPRKeepAlive)) {
             return PE_SNK_EPR_Keep_Alive;
         }
+#endif
 
         if (port.timers.is_expired(PD_TIMEOUT::tPPSRequest)) {
             return PE_SNK_Select_Capability;
@@ -712,7 +802,7 @@ public:
         auto& port = pe.port;
         pe.log_state();
 
-        bool is_epr = port.rx_emsg.header.extended;
+        bool is_epr = PD_FEATURE_EPR && port.rx_emsg.header.extended;
         port.tx_emsg.clear();
 
         // DPM is responsible for providing properly padded sink PDOs.
@@ -753,6 +843,7 @@ public:
 };
 
 
+#if PD_FEATURE_EPR
 class PE_SNK_EPR_Keep_Alive_State :
     public afsm::state<PE, PE_SNK_EPR_Keep_Alive_State, PE_SNK_EPR_Keep_Alive>,
     public afsm::interceptor_pack<InterceptorCheckRequestProgress, InterceptorForwardErrors>
@@ -764,11 +855,8 @@ public:
         PE_LOGV("PE state => {}", pe_state_to_desc(pe.get_state_id()));
 
 
-        ECDB ecdb{};
-        ecdb.type = PD_EXT_CTRL_MSGT::EPR_KeepAlive;
-
         port.tx_emsg.clear();
-        port.tx_emsg.append16(ecdb.raw_value);
+        port.tx_emsg.append16(dobj::ecdb::type::make(PD_EXT_CTRL_MSGT::EPR_KeepAlive));
 
         pe.send_ext_msg(PD_EXT_MSGT::Extended_Control);
         return No_State_Change;
@@ -810,10 +898,15 @@ public:
 
     static void on_exit_state(PE&) {}
 };
+#endif // PD_FEATURE_EPR
 
 
 class PE_SNK_Hard_Reset_State : public afsm::state<PE, PE_SNK_Hard_Reset_State, PE_SNK_Hard_Reset> {
 public:
+    static constexpr afsm::wake_fn<PE> wake_on[] = {
+        PeWake::flags<&Port::pe_flags, PeFlags::mask(PE_FLAG::PRL_HARD_RESET_PENDING)>
+    };
+
     static auto on_enter_state(PE& pe) -> state_id_t {
         auto& port = pe.port;
         pe.log_state();
@@ -844,6 +937,10 @@ public:
 
 class PE_SNK_Transition_to_default_State : public afsm::state<PE, PE_SNK_Transition_to_default_State, PE_SNK_Transition_to_default> {
 public:
+    static constexpr afsm::wake_fn<PE> wake_on[] = {
+        PeWake::flags<&Port::pe_flags, PeFlags::mask(PE_FLAG::WAIT_DPM_TRANSIT_TO_DEFAULT)>
+    };
+
     static auto on_enter_state(PE& pe) -> state_id_t {
         auto& port = pe.port;
         pe.log_state();
@@ -882,9 +979,10 @@ public:
         pe.log_state();
 
         // Cleanup pending flags for sure
-        pe.port.pe_flags.clear(PE_FLAG::MSG_RECEIVED);
-        pe.port.pe_flags.clear(PE_FLAG::MSG_DISCARDED);
-        pe.port.pe_flags.clear(PE_FLAG::PROTOCOL_ERROR);
+        pe.port.pe_flags.fetch_and_clear(PeFlags::mask(
+            PE_FLAG::MSG_RECEIVED, PE_FLAG::MSG_DISCARDED, PE_FLAG::PROTOCOL_ERROR));
+        // Chunking is used until the next contract
+        pe.port.unchunked_ext_msg = false;
 
         pe.send_ctrl_msg(PD_CTRL_MSGT::Accept);
         return No_State_Change;
@@ -920,11 +1018,11 @@ public:
         pe.log_state();
 
         // Clean up flags from previous operations
-        port.pe_flags.clear(PE_FLAG::MSG_DISCARDED);
-        port.pe_flags.clear(PE_FLAG::MSG_RECEIVED);
-        port.pe_flags.clear(PE_FLAG::PROTOCOL_ERROR);
+        port.pe_flags.fetch_and_clear(PeFlags::mask(
+            PE_FLAG::MSG_DISCARDED, PE_FLAG::MSG_RECEIVED, PE_FLAG::PROTOCOL_ERROR));
 
         port.pe_flags.set(PE_FLAG::CAN_SEND_SOFT_RESET);
+        port.unchunked_ext_msg = false;
 
         port.notify_prl(MsgToPrl_EnqueueRestart{});
         return No_State_Change;
@@ -1014,6 +1112,7 @@ public:
 };
 
 
+#if PD_FEATURE_EPR
 class PE_SNK_Send_EPR_Mode_Entry_State :
     public afsm::state<PE, PE_SNK_Send_EPR_Mode_Entry_State, PE_SNK_Send_EPR_Mode_Entry>,
     public afsm::interceptor_pack<InterceptorCheckRequestProgress>
@@ -1023,12 +1122,8 @@ public:
         auto& port = pe.port;
         pe.log_state();
 
-        EPRMDO eprmdo{};
-        eprmdo.action = EPR_MODE_ACTION::ENTER;
-        eprmdo.data = pe.dpm.get_epr_watts();
-
         port.tx_emsg.clear();
-        port.tx_emsg.append32(eprmdo.raw_value);
+        port.tx_emsg.append32(dobj::eprmdo::encode(EPR_MODE_ACTION::ENTER, pe.dpm.get_epr_watts()));
 
         pe.send_data_msg(PD_DATA_MSGT::EPR_Mode);
 
@@ -1047,18 +1142,17 @@ public:
         if ((pe.request_progress == PE_REQUEST_PROGRESS::FINISHED) &&
             port.pe_flags.test_and_clear(PE_FLAG::MSG_RECEIVED))
         {
-            if (port.rx_emsg.is_data_msg(PD_DATA_MSGT::EPR_Mode)) {
-                EPRMDO eprmdo{port.rx_emsg.read32(0)};
-
-                if (eprmdo.action == EPR_MODE_ACTION::ENTER_ACKNOWLEDGED) {
+            EprModeView eprmdo{port.rx_emsg};
+            if (eprmdo.valid()) {
+                if (eprmdo.action() == EPR_MODE_ACTION::ENTER_ACKNOWLEDGED) {
                     return PE_SNK_EPR_Mode_Entry_Wait_For_Response;
                 }
 
                 port.pe_flags.set(PE_FLAG::EPR_AUTO_ENTER_DISABLED);
                 port.dpm_requests.clear(DPM_REQUEST_FLAG::EPR_MODE_ENTRY);
 
-                PE_LOGE("EPR mode entry failed [code 0x{:02X}]", eprmdo.action);
-                port.notify_dpm(MsgToDpm_EPREntryFailed(eprmdo.raw_value));
+                PE_LOGE("EPR mode entry failed [code 0x{:02X}]", eprmdo.action());
+                port.notify_dpm(MsgToDpm_EPREntryFailed(eprmdo.raw_value()));
 
                 if (!port.pe_flags.test(PE_FLAG::HANDSHAKE_REPORTED)) {
                     port.pe_flags.set(PE_FLAG::HANDSHAKE_REPORTED);
@@ -1103,17 +1197,16 @@ public:
         auto& port = pe.port;
 
         if (port.pe_flags.test_and_clear(PE_FLAG::MSG_RECEIVED)) {
-            if (port.rx_emsg.is_data_msg(PD_DATA_MSGT::EPR_Mode)) {
-                EPRMDO eprmdo{port.rx_emsg.read32(0)};
-
-                if (eprmdo.action == EPR_MODE_ACTION::ENTER_SUCCEEDED) {
+            EprModeView eprmdo{port.rx_emsg};
+            if (eprmdo.valid()) {
+                if (eprmdo.action() == EPR_MODE_ACTION::ENTER_SUCCEEDED) {
                     port.pe_flags.set(PE_FLAG::IN_EPR_MODE);
                     port.dpm_requests.clear(DPM_REQUEST_FLAG::EPR_MODE_ENTRY);
 
                     return PE_SNK_Wait_for_Capabilities;
                 }
 
-                PE_LOGE("EPR mode entry failed [code 0x{:02X}]", eprmdo.action);
+                PE_LOGE("EPR mode entry failed [code 0x{:02X}]", eprmdo.action());
             }
 
             return PE_SNK_Send_Soft_Reset;
@@ -1150,8 +1243,10 @@ public:
     static state_id_t on_run_state(PE&) { return No_State_Change; }
     static void on_exit_state(PE&) {}
 };
+#endif // PD_FEATURE_EPR
 
 
+#if PD_FEATURE_BIST
 class PE_BIST_Activate_State : public afsm::state<PE, PE_BIST_Activate_State, PE_BIST_Activate> {
 public:
     static auto on_enter_state(PE& pe) -> state_id_t {
@@ -1162,16 +1257,15 @@ public:
         if (!port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT)) { return PE_SNK_Ready; }
 
         // Simplified check - verify PDO index instead of voltage
-        RDO_ANY rdo{port.rdo_contracted};
-        if (rdo.obj_position != 1) { return PE_SNK_Ready; }
+        if (RdoView{port.rdo_contracted}.position() != 1) { return PE_SNK_Ready; }
 
         // Set up supported modes
-        BISTDO bdo{port.rx_emsg.read32(0)};
-        if (bdo.mode == BIST_MODE::Carrier) {
+        auto bist_mode = dobj::bistdo::mode::get(port.rx_emsg.read32(0));
+        if (bist_mode == BIST_MODE::Carrier) {
             pe.tcpc.req_set_bist(TCPC_BIST_MODE::Carrier);
             return No_State_Change;
         }
-        if (bdo.mode == BIST_MODE::TestData) {
+        if (bist_mode == BIST_MODE::TestData) {
             pe.tcpc.req_set_bist(TCPC_BIST_MODE::TestData);
             return No_State_Change;
         }
@@ -1188,8 +1282,8 @@ public:
 
         // Small cheat to avoid storing state. Parse BISTDO again; it should
         // not be corrupted in such a short time.
-        BISTDO bdo{port.rx_emsg.read32(0)};
-        if (bdo.mode == BIST_MODE::Carrier) { return PE_BIST_Carrier_Mode; }
+        auto bist_mode = dobj::bistdo::mode::get(port.rx_emsg.read32(0));
+        if (bist_mode == BIST_MODE::Carrier) { return PE_BIST_Carrier_Mode; }
         return PE_BIST_Test_Mode;
     }
 
@@ -1244,6 +1338,7 @@ public:
 
     static void on_exit_state(PE&) {}
 };
+#endif // PD_FEATURE_BIST
 
 
 class PE_Give_Revision_State : public afsm::state<PE, PE_Give_Revision_State, PE_Give_Revision> {
@@ -1252,14 +1347,14 @@ public:
         auto& port = pe.port;
         pe.log_state();
 
-        RMDO rmdo{};
-        rmdo.rev_major = 3;
-        rmdo.rev_minor = 2;
-        rmdo.ver_major = 1;
-        rmdo.ver_minor = 1;
+        constexpr uint32_t rmdo =
+            dobj::rmdo::rev_major::make(3) |
+            dobj::rmdo::rev_minor::make(2) |
+            dobj::rmdo::ver_major::make(1) |
+            dobj::rmdo::ver_minor::make(1);
 
         port.tx_emsg.clear();
-        port.tx_emsg.append32(rmdo.raw_value);
+        port.tx_emsg.append32(rmdo);
 
         pe.send_data_msg(PD_DATA_MSGT::Revision);
         return No_State_Change;
@@ -1305,21 +1400,27 @@ using PE_STATES = afsm::state_pack<
     PE_SNK_Transition_Sink_State,
     PE_SNK_Ready_State,
     PE_SNK_Give_Sink_Cap_State,
-    PE_SNK_EPR_Keep_Alive_State,
     PE_SNK_Hard_Reset_State,
     PE_SNK_Transition_to_default_State,
     PE_SNK_Soft_Reset_State,
     PE_SNK_Send_Soft_Reset_State,
     PE_SNK_Send_Not_Supported_State,
     PE_SNK_Source_Alert_Received_State,
+    PE_Give_Revision_State,
+    PE_Src_Disabled_State
+#if PD_FEATURE_EPR
+    ,
+    PE_SNK_EPR_Keep_Alive_State,
     PE_SNK_Send_EPR_Mode_Entry_State,
     PE_SNK_EPR_Mode_Entry_Wait_For_Response_State,
-    PE_SNK_EPR_Mode_Exit_Received_State,
+    PE_SNK_EPR_Mode_Exit_Received_State
+#endif
+#if PD_FEATURE_BIST
+    ,
     PE_BIST_Activate_State,
     PE_BIST_Carrier_Mode_State,
-    PE_BIST_Test_Mode_State,
-    PE_Give_Revision_State,
-    PE_Src_Disabled_State
+    PE_BIST_Test_Mode_State
+#endif
 >;
 
 PE::PE(Port& port, IDPM& dpm, PRL& prl, ITCPC& tcpc)
@@ -1386,6 +1487,7 @@ void PE::init() {
     port.pe_flags.clear_all();
     port.dpm_requests.clear_all();
     port.revision = MaxSupportedRevision;
+    port.unchunked_ext_msg = false;
     active_dpm_request = DPM_REQUEST_FLAG::NONE;
     port.timers.stop_range(PD_TIMERS_RANGE::PE);
     change_state(PE_SNK_Startup);
@@ -1413,8 +1515,11 @@ void PE::send_ctrl_msg(PD_CTRL_MSGT::Type msgt) {
 // Utilities
 //
 auto PE::is_epr_mode_available() const -> bool {
-    if (!port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT) ||
-        port.pe_flags.test(PE_FLAG::EPR_AUTO_ENTER_DISABLED) ||
+    // Contract exists, and auto enter is not disabled
+    if (!PD_FEATURE_EPR ||
+        !port.pe_flags.test_match(
+            PeFlags::mask(PE_FLAG::HAS_EXPLICIT_CONTRACT, PE_FLAG::EPR_AUTO_ENTER_DISABLED),
+            PeFlags::mask(PE_FLAG::HAS_EXPLICIT_CONTRACT)) ||
         port.revision < PD_REVISION::REV30)
     {
         return false;
@@ -1423,131 +1528,48 @@ auto PE::is_epr_mode_available() const -> bool {
     // This is not needed, but it exists to suppress warnings from code checkers.
     if (port.source_caps.empty()) { return false; }
 
-    const PDO_FIXED first_src_pdo{port.source_caps[0]};
-    return first_src_pdo.epr_capable;
+    return dobj::pdo_fixed::epr_capable::get(port.source_caps[0]);
+}
+
+bool PE::is_unchunked_ext_msg_supported() {
+    return PD_FEATURE_UNCHUNKED_EXT && tcpc.get_hw_features().unchunked_ext_msg;
 }
 
 bool PE::is_in_epr_mode() const {
-    return port.pe_flags.test(PE_FLAG::IN_EPR_MODE);
+    return PD_FEATURE_EPR && port.pe_flags.test(PE_FLAG::IN_EPR_MODE);
 }
 
 
 auto PE::is_in_spr_contract() const -> bool {
-    const RDO_ANY rdo{port.rdo_contracted};
     return port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT) &&
-        (rdo.obj_position <= MaxPdoObjects_SPR);
+        (RdoView{port.rdo_contracted}.position() <= MaxPdoObjects_SPR);
 }
 
 auto PE::is_in_pps_contract() const -> bool {
     if (!port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT)) { return false; }
 
-    const RDO_ANY rdo{port.rdo_contracted};
+    const auto position = RdoView{port.rdo_contracted}.position();
 
     // This is not needed, but it exists to suppress warnings from code checkers.
-    if (rdo.obj_position == 0 || rdo.obj_position > port.source_caps.size()) {
+    if (position == 0 || position > port.source_caps.size()) {
         return false;
     }
 
-    const PDO_SPR_PPS pdo{port.source_caps[rdo.obj_position-1]};
-
-    return pdo.pdo_type == PDO_TYPE::AUGMENTED &&
-        pdo.apdo_subtype == PDO_AUGMENTED_SUBTYPE::SPR_PPS;
+    return PdoSpan{port.source_caps}.view(position - 1).variant() == PDO_VARIANT::APDO_PPS;
 }
 
-bool PE::validate_source_caps(const etl::ivector<uint32_t>& src_caps) {
-    using namespace dobj_utils;
-
-    if (src_caps.empty()) {
-        PE_LOGE("SRC Capabilities can't be empty");
-        return false;
-    }
-
-    if (src_caps.size() > MaxPdoObjects) {
-        PE_LOGE("SRC Capabilities max count is {}, got {}", MaxPdoObjects, src_caps.size());
-        return false;
-    }
-
-    // First PDO must be Safe5v
-    if (get_src_pdo_variant(src_caps[0]) != PDO_VARIANT::FIXED ||
-        PDO_FIXED{src_caps[0]}.voltage != 100 /* 5000mV in 50mv steps */)
-    {
-        PE_LOGE("First PDO MUST be Safe5v FIXED");
-        return false;
-    }
-
-    // EPR PDOs are prohibited at SPR positions (1-7, counted from 1),
-    // and SPR PDOs are prohibited at EPR positions (8+).
-    for (int i = 0; i < etl::min<int>(src_caps.size(), MaxPdoObjects); i++) {
-        auto pdo = src_caps[i];
-        auto pdo_variant = get_src_pdo_variant(pdo);
-        if (pdo_variant == PDO_VARIANT::APDO_EPR_AVS ||
-            (pdo_variant == PDO_VARIANT::FIXED && PDO_FIXED{pdo}.voltage > 400 /* >20V  in 50mv steps */))
-        {
-            if (i < MaxPdoObjects_SPR) {
-                PE_LOGE("EPR PDO prohibited at SPR position {}", i + 1);
-                return false;
-            }
-        } else {
-            if (i >= MaxPdoObjects_SPR) {
-                PE_LOGE("SPR PDO prohibited at EPR position {}", i + 1);
-                return false;
-            }
-        }
-    }
-
-    // Count AVS APDOs: max 1 SPR AVS and max 1 EPR AVS
-    int spr_avs_count = 0;
-    int epr_avs_count = 0;
-
-    for (size_t i = 0; i < src_caps.size(); i++) {
-        auto pdo_variant = get_src_pdo_variant(src_caps[i]);
-        if (pdo_variant == PDO_VARIANT::APDO_SPR_AVS) {
-            spr_avs_count++;
-            if (spr_avs_count > 1) {
-                PE_LOGE("Only one SPR AVS APDO allowed");
-                return false;
-            }
-        } else if (pdo_variant == PDO_VARIANT::APDO_EPR_AVS) {
-            epr_avs_count++;
-            if (epr_avs_count > 1) {
-                PE_LOGE("Only one EPR AVS APDO allowed");
-                return false;
-            }
-        }
-    }
-
-    // Check Fixed PDO voltages are strictly ascending (no duplicates)
-    uint32_t prev_fixed_voltage = 0;
-    for (size_t i = 0; i < src_caps.size(); i++) {
-        auto pdo_variant = get_src_pdo_variant(src_caps[i]);
-        if (pdo_variant == PDO_VARIANT::FIXED) {
-            uint32_t voltage = PDO_FIXED{src_caps[i]}.voltage;
-            if (voltage <= prev_fixed_voltage) {
-                PE_LOGE("Fixed PDO voltages must be strictly ascending");
-                return false;
-            }
-            prev_fixed_voltage = voltage;
-        }
-    }
-
-    // Check PPS APDO max_voltage is ascending (not strictly - duplicates allowed)
-    uint32_t prev_pps_max_voltage = 0;
-    for (size_t i = 0; i < src_caps.size(); i++) {
-        auto pdo_variant = get_src_pdo_variant(src_caps[i]);
-        if (pdo_variant == PDO_VARIANT::APDO_PPS) {
-            uint32_t max_voltage = PDO_SPR_PPS{src_caps[i]}.max_voltage;
-            if (max_voltage < prev_pps_max_voltage) {
-                PE_LOGE("PPS APDO max_voltage must be in ascending order");
-                return false;
-            }
-            prev_pps_max_voltage = max_voltage;
-        }
-    }
-
-    return true;
+bool PE::validate_source_caps(PdoSpan src_caps) {
+    size_t idx = 0;
+    const auto error = SrcCapsParser::validate(src_caps, &idx);
+    log_src_caps_error(error, idx);
+    return error == SRC_CAPS_ERROR::NONE;
 }
 
 void PE_EventListener::on_receive(const MsgSysUpdate&) {
+    auto local_state = pe.local_state;
+    auto state = pe.get_state_id();
+    auto flags = pe.port.pe_flags.snapshot();
+
     switch (pe.local_state) {
         case PE::LOCAL_STATE::DISABLED:
             if (!pe.port.is_attached) { break; }
@@ -1585,6 +1607,12 @@ void PE_EventListener::on_receive(const MsgSysUpdate&) {
             break;
     }
 
+    if (pe.local_state != local_state || pe.get_state_id() != state ||
+        pe.port.pe_flags.snapshot() != flags)
+    {
+        pe.port.on_state_changed();
+    }
+
     if (pe.has_deferred_wakeup_request) {
         pe.has_deferred_wakeup_request = false;
         // Protection from nested FSM calls. All requested wakeups are postponed
@@ -1641,9 +1669,10 @@ void PE_EventListener::on_receive(const MsgToPe_PrlReportError& msg) {
         return;
     }
 
-    if (port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT) &&
-        port.pe_flags.test(PE_FLAG::AMS_ACTIVE) &&
-        !port.pe_flags.test(PE_FLAG::AMS_FIRST_MSG_SENT))
+    // Contract, AMS started, but its first message is not sent yet
+    if (port.pe_flags.test_match(
+            PeFlags::mask(PE_FLAG::HAS_EXPLICIT_CONTRACT, PE_FLAG::AMS_ACTIVE, PE_FLAG::AMS_FIRST_MSG_SENT),
+            PeFlags::mask(PE_FLAG::HAS_EXPLICIT_CONTRACT, PE_FLAG::AMS_ACTIVE)))
     {
         // Discard is not possible without an RX message, but let's check to be sure.
         if (port.pe_flags.test(PE_FLAG::MSG_RECEIVED)) {
@@ -1672,8 +1701,4 @@ void PE_EventListener::on_receive(const MsgToPe_PrlHardResetSent&) {
     pe.port.pe_flags.clear(PE_FLAG::PRL_HARD_RESET_PENDING);
 }
 
-void PE_EventListener::on_receive_unknown(ETL_MAYBE_UNUSED const etl::imessage& msg) {
-    PE_LOGE("PE unknown message, id: {}", msg.get_message_id());
-}
-
 } // namespace pd
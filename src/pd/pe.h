@@ -1,12 +1,11 @@
 #pragma once
 
-#include <etl/message_router.h>
-
 #include "data_objects.h"
 #include "messages.h"
 #include "pe_defs.h"
 #include "utils/atomic_bits.h"
 #include "utils/afsm.h"
+#include "utils/payload_views.h"
 
 namespace pd {
 
@@ -19,16 +18,8 @@ enum class PE_REQUEST_PROGRESS {
 
 class Port; class IDPM; class ITCPC; class PE; class PRL;
 
-using PE_EventListener_Base = etl::message_router<class PE_EventListener,
-    MsgSysUpdate,
-    MsgToPe_PrlMessageReceived,
-    MsgToPe_PrlMessageSent,
-    MsgToPe_PrlReportError,
-    MsgToPe_PrlReportDiscard,
-    MsgToPe_PrlHardResetFromPartner,
-    MsgToPe_PrlHardResetSent>;
-
-class PE_EventListener : public PE_EventListener_Base {
+// Called directly by Port::notify_pe(), see port.h
+class PE_EventListener {
 public:
     PE_EventListener(PE& pe) : pe(pe) {}
     void on_receive(const MsgSysUpdate& msg);
@@ -38,13 +29,13 @@ public:
     void on_receive(const MsgToPe_PrlReportDiscard& msg);
     void on_receive(const MsgToPe_PrlHardResetFromPartner& msg);
     void on_receive(const MsgToPe_PrlHardResetSent& msg);
-    void on_receive_unknown(const etl::imessage& msg);
 private:
     PE& pe;
 };
 
 
-class PE : public afsm::fsm<PE> {
+// Up to 4 wake conditions per state, see `afsm::fsm::run()`
+class PE : public afsm::fsm<PE, 4> {
 public:
     PE(Port& port, IDPM& dpm, PRL& prl, ITCPC& tcpc);
 
@@ -58,6 +49,7 @@ public:
     void setup();
     void init();
     void request_wakeup() { has_deferred_wakeup_request = true; };
+    Port& get_port() { return port; }
 
     // Helpers
     void send_ctrl_msg(PD_CTRL_MSGT::Type msgt);
@@ -68,7 +60,9 @@ public:
     bool is_in_spr_contract() const;
     bool is_in_pps_contract() const;
     bool is_epr_mode_available() const;
-    static bool validate_source_caps(const etl::ivector<uint32_t>& src_caps);
+    // This side (feature + TCPC) can use unchunked extended messages
+    bool is_unchunked_ext_msg_supported();
+    static bool validate_source_caps(PdoSpan src_caps);
 
     enum class LOCAL_STATE {
         DISABLED, INIT, WORKING
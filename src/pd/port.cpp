@@ -3,24 +3,36 @@
 
 namespace pd {
 
-void Port::notify_task(const etl::imessage& msg) {
-    if (task_rtr) { task_rtr->receive(msg); }
-}
-
-void Port::notify_tc(const etl::imessage& msg) {
-    if (tc_rtr) { tc_rtr->receive(msg); }
+void Port::notify_dpm(const etl::imessage& msg) {
+    // Message type is not known here, can't be deferred
+    deliver_dpm(msg);
 }
 
-void Port::notify_pe(const etl::imessage& msg) {
-    if (pe_rtr) { pe_rtr->receive(msg); }
+void Port::deliver_dpm(const etl::imessage& msg) {
+    if (dpm_rtr) { dpm_rtr->receive(msg); }
 }
 
-void Port::notify_prl(const etl::imessage& msg) {
-    if (prl_rtr) { prl_rtr->receive(msg); }
-}
+bool Port::deliver_deferred() {
+    if (!msg_queue || msg_queue->empty()) { return false; }
 
-void Port::notify_dpm(const etl::imessage& msg) {
-    if (dpm_rtr) { dpm_rtr->receive(msg); }
+    DeferredMsg msg;
+    while (msg_queue->pop(msg)) {
+        switch (msg.target) {
+            case MSG_QUEUE_TARGET::PE:
+                msg_queue_details::visit(PeDeferredMsgs{}, msg.index, msg.param,
+                    [this](const auto& m) { deliver_pe(m); });
+                break;
+            case MSG_QUEUE_TARGET::PRL:
+                msg_queue_details::visit(PrlDeferredMsgs{}, msg.index, msg.param,
+                    [this](const auto& m) { deliver_prl(m); });
+                break;
+            case MSG_QUEUE_TARGET::DPM:
+                msg_queue_details::visit(DpmDeferredMsgs{}, msg.index, msg.param,
+                    [this](const auto& m) { deliver_dpm(m); });
+                break;
+        }
+    }
+    return true;
 }
 
 void Port::wakeup() {
@@ -41,22 +53,12 @@ void Port::wait_dpm_transit_to_default(bool enable) {
 }
 
 bool Port::is_prl_running() {
-    // Those defaults will be returned if PRL instance not yet subscribed
-    // to the message bus. That's an acceptable behavior.
-    bool is_running = false, is_busy = false;
-
-    // NOTE: The message bus is strictly synchronous. MsgBus::receive()
-    // returns only after the receiver processes the message, so passing
-    // references to stack variables here is safe.
-    notify_prl(MsgToPrl_GetPrlStatus{is_running, is_busy});
-    return is_running;
+    // PRL not yet set up is reported as not running. That's acceptable.
+    return prl && prl->is_running();
 }
 
 bool Port::is_prl_busy() {
-    bool is_running = false, is_busy = false;
-
-    notify_prl(MsgToPrl_GetPrlStatus{is_running, is_busy});
-    return is_busy;
+    return prl && prl->is_busy();
 }
 
 } // namespace pd
@@ -2,12 +2,19 @@
 
 #include <etl/message_router.h>
 #include <etl/cyclic_value.h>
+#include <etl/type_traits.h>
 
 #include "data_objects.h"
+#include "pe.h"
 #include "pe_defs.h"
 #include "messages.h"
+#include "msg_queue.h"
+#include "prl.h"
+#include "task.h"
+#include "tc.h"
 #include "timers.h"
 #include "utils/atomic_enum_bits.h"
+#include "utils/src_caps_parser.h"
 
 namespace pd {
 
@@ -33,6 +40,12 @@ public:
     PD_MSG tx_emsg{};
 
     PDO_LIST source_caps{};
+    // Variants of `source_caps`, for DPM. Built by PE with validation.
+    SRC_CAPS_SUMMARY source_caps_summary{};
+#if PD_FEATURE_EPR
+    // EPR_Source_Capabilities validation, fed by RCH while chunks arrive
+    SrcCapsParser src_caps_parser{};
+#endif
     uint8_t hard_reset_counter{0};
     // Used to track contract type (SPR/EPR)
     uint32_t rdo_contracted{0};
@@ -50,6 +63,8 @@ public:
     etl::cyclic_value<int8_t, 0, 7> tx_msg_id_counter{0};
     int8_t tx_retry_counter{0};
     int8_t rx_msg_id_stored{0};
+    // Message ID of the last GoodCRC, for software GoodCRC check only
+    int8_t rx_goodcrc_msg_id{0};
     int8_t rch_chunk_number_expected{0};
     int8_t tch_chunk_number_to_send{0};
     // Probably a single error is enough, but let's keep them separate
@@ -58,8 +73,10 @@ public:
     PRL_ERROR tch_error{};
 
     // shared with DRV
-    PD_CHUNK rx_chunk{};
-    PD_CHUNK tx_chunk{};
+    // Borrowed from the TCPC RX queue by PRL_Rx, valid until released there.
+    const PD_CHUNK* rx_chunk{nullptr};
+    // Driver-provided buffer, set by PRL before building each TX chunk.
+    PD_CHUNK_EXT* tx_chunk{nullptr};
     etl::atomic<TCPC_TRANSMIT_STATUS> tcpc_tx_status{TCPC_TRANSMIT_STATUS::UNSET};
 
 
@@ -68,23 +85,62 @@ public:
     // is enough.
     PD_REVISION::Type revision{PD_REVISION::REV30};
 
+    // Unchunked extended messages are negotiated: both sides set the bit in
+    // PDO1 / RDO of the current contract (see PD_FEATURE_UNCHUNKED_EXT). Set
+    // by PE on Accept, cleared on resets.
+    bool unchunked_ext_msg{false};
+
     //
     // Communication
     //
 
-    etl::imessage_router* task_rtr{nullptr};
-    etl::imessage_router* tc_rtr{nullptr};
-    etl::imessage_router* pe_rtr{nullptr};
-    etl::imessage_router* prl_rtr{nullptr};
+    // Internal components are wired statically. The handler is selected at
+    // compile time by message type, without virtual calls and message ID
+    // checks. This matters for MsgSysUpdate, sent to all on every tick.
+    Task_EventListener* task_rtr{nullptr};
+    TC_EventListener* tc_rtr{nullptr};
+    PE_EventListener* pe_rtr{nullptr};
+    PRL_EventListener* prl_rtr{nullptr};
+    // DPM is user-defined, and stays on a generic router.
     etl::imessage_router* dpm_rtr{nullptr};
 
-    void notify_task(const etl::imessage& msg);
-    void notify_tc(const etl::imessage& msg);
-    void notify_pe(const etl::imessage& msg);
-    void notify_prl(const etl::imessage& msg);
+    PRL* prl{nullptr};
+
+    // Components with pending work. Task::tick() runs only these. Set by
+    // wakeups, expired timers, messages from other components, and by
+    // components that changed their state (others may depend on it).
+    AtomicEnumBits<TASK_RUN_FLAG> pending_runs{};
+
+    // Optional, for deferred delivery of messages between components, see
+    // msg_queue.h. Set before `Task::start()`. If not set, messages are
+    // delivered immediately.
+    IMsgQueue* msg_queue{nullptr};
+
+    // A message to a component is a pending work for it. MsgSysUpdate is
+    // the run itself.
+    template <typename T>
+    void notify_task(const T& msg) { if (task_rtr) { task_rtr->on_receive(msg); } }
+    template <typename T>
+    void notify_tc(const T& msg) { mark_pending<T>(TASK_RUN_FLAG::TC); if (tc_rtr) { tc_rtr->on_receive(msg); } }
+    template <typename T>
+    void notify_pe(const T& msg) {
+        if (!defer(MSG_QUEUE_TARGET::PE, msg, PeDeferredMsgs{})) { deliver_pe(msg); }
+    }
+    template <typename T>
+    void notify_prl(const T& msg) {
+        if (!defer(MSG_QUEUE_TARGET::PRL, msg, PrlDeferredMsgs{})) { deliver_prl(msg); }
+    }
+    template <typename T>
+    void notify_dpm(const T& msg) {
+        if (!defer(MSG_QUEUE_TARGET::DPM, msg, DpmDeferredMsgs{})) { deliver_dpm(msg); }
+    }
     void notify_dpm(const etl::imessage& msg);
     void wakeup();
 
+    // Deliver queued messages, including ones sent by receivers meanwhile.
+    // Returns false if the queue was empty.
+    bool deliver_deferred();
+
     //
     // Helpers
     //
@@ -95,7 +151,39 @@ public:
     bool is_prl_running();
     bool is_prl_busy();
 
+    // Called by a component after its run changed something others can see
+    void on_state_changed() { pending_runs.set_all(); }
+
     uint8_t max_retries() { return revision > PD_REVISION::REV20 ? nRetryCount : nRetryCount_REV20; }
+
+private:
+    template <typename T>
+    void mark_pending(TASK_RUN_FLAG component) {
+        if (!etl::is_same<T, MsgSysUpdate>::value) { pending_runs.set(component); }
+    }
+
+    template <typename T>
+    void deliver_pe(const T& msg) { mark_pending<T>(TASK_RUN_FLAG::PE); if (pe_rtr) { pe_rtr->on_receive(msg); } }
+    template <typename T>
+    void deliver_prl(const T& msg) { mark_pending<T>(TASK_RUN_FLAG::PRL); if (prl_rtr) { prl_rtr->on_receive(msg); } }
+    void deliver_dpm(const etl::imessage& msg);
+
+    // Put the message to the queue, if attached and the message type can be
+    // deferred. Returns false if the message should be delivered directly.
+    // If the queue is full, queued messages are delivered first, to keep
+    // the order.
+    template <typename T, typename List>
+    bool defer(MSG_QUEUE_TARGET target, const T& msg, List) {
+        using index = msg_queue_details::index_of<T, List>;
+        if (!index::found || !msg_queue) { return false; }
+        if (msg_queue->push({ target, index::value,
+            msg_queue_details::pack(msg, msg_queue_details::has_param<T>{}) }))
+        {
+            return true;
+        }
+        deliver_deferred();
+        return false;
+    }
 };
 
 } // namespace pd
@@ -1,14 +1,18 @@
 #include <etl/array.h>
 
+#include "fsm_wake.h"
 #include "idriver.h"
 #include "pd_log.h"
 #include "port.h"
 #include "prl.h"
 #include "utils/etl_state_pack.h"
+#include "utils/payload_views.h"
 
 namespace pd {
 
 using afsm::state_id_t;
+using PrlTxFlags = AtomicEnumBits<PRL_TX_FLAG>;
+using PrlHrFlags = AtomicEnumBits<PRL_HR_FLAG>;
 
 // [rev3.2] 6.12.3 List of Protocol Layer States
 // Table 6.75 Protocol Layer States
@@ -17,10 +21,13 @@ using afsm::state_id_t;
 enum PRL_RCH_State {
     RCH_Wait_For_Message_From_Protocol_Layer,
     RCH_Pass_Up_Message,
+    RCH_Report_Error,
+    // Optional states go last, to keep IDs sequential when compiled out
+#if PD_FEATURE_EXTENDED
     RCH_Processing_Extended_Message,
     RCH_Requesting_Chunk,
     RCH_Waiting_Chunk,
-    RCH_Report_Error,
+#endif
 };
 
 namespace {
@@ -28,10 +35,12 @@ namespace {
         switch (state) {
             case RCH_Wait_For_Message_From_Protocol_Layer: return "RCH_Wait_For_Message_From_Protocol_Layer";
             case RCH_Pass_Up_Message: return "RCH_Pass_Up_Message";
+            case RCH_Report_Error: return "RCH_Report_Error";
+#if PD_FEATURE_EXTENDED
             case RCH_Processing_Extended_Message: return "RCH_Processing_Extended_Message";
             case RCH_Requesting_Chunk: return "RCH_Requesting_Chunk";
             case RCH_Waiting_Chunk: return "RCH_Waiting_Chunk";
-            case RCH_Report_Error: return "RCH_Report_Error";
+#endif
             default: return "Unknown PRL_RCH state";
         }
     }
@@ -45,12 +54,15 @@ enum PRL_TCH_State {
     // TCH_Wait_For_Transmision_Complete (with single 's')
     TCH_Wait_For_Transmission_Complete,
     TCH_Message_Sent,
+    TCH_Message_Received,
+    TCH_Report_Error,
+    // Optional states go last, to keep IDs sequential when compiled out
+#if PD_FEATURE_EXTENDED
     TCH_Prepare_To_Send_Chunked_Message,
     TCH_Construct_Chunked_Message,
     TCH_Sending_Chunked_Message,
     TCH_Wait_Chunk_Request,
-    TCH_Message_Received,
-    TCH_Report_Error,
+#endif
 };
 
 namespace {
@@ -60,12 +72,14 @@ namespace {
             case TCH_Pass_Down_Message: return "TCH_Pass_Down_Message";
             case TCH_Wait_For_Transmission_Complete: return "TCH_Wait_For_Transmission_Complete";
             case TCH_Message_Sent: return "TCH_Message_Sent";
+            case TCH_Message_Received: return "TCH_Message_Received";
+            case TCH_Report_Error: return "TCH_Report_Error";
+#if PD_FEATURE_EXTENDED
             case TCH_Prepare_To_Send_Chunked_Message: return "TCH_Prepare_To_Send_Chunked_Message";
             case TCH_Construct_Chunked_Message: return "TCH_Construct_Chunked_Message";
             case TCH_Sending_Chunked_Message: return "TCH_Sending_Chunked_Message";
             case TCH_Wait_Chunk_Request: return "TCH_Wait_Chunk_Request";
-            case TCH_Message_Received: return "TCH_Message_Received";
-            case TCH_Report_Error: return "TCH_Report_Error";
+#endif
             default: return "Unknown PRL_TCH state";
         }
     }
@@ -158,11 +172,55 @@ namespace {
 } // namespace
 
 
+#if PD_FEATURE_UNCHUNKED_EXT
+namespace {
+    // Unchunked extended message comes in a single packet. Data follows the
+    // extended header, and Number of Data Objects is 0.
+    bool is_unchunked_ext_msg(const PD_CHUNK& chunk) {
+        ExtHeaderView ehdr{chunk};
+        return ehdr.valid() && !ehdr.is_chunked();
+    }
+
+    bool unpack_unchunked_ext_msg(const PD_CHUNK& chunk, PD_MSG& msg) {
+        ExtHeaderView ehdr{chunk};
+
+        if (!ehdr.valid() || ehdr.is_chunked() || ehdr.is_request_chunk() ||
+            (ehdr.data_size() > MaxExtendedMsgLen) ||
+            (chunk.data_size() < 2u + ehdr.data_size()))
+        {
+            return false;
+        }
+
+        msg.clear();
+        msg.header = chunk.header;
+        msg.append_from(chunk, 2, 2 + ehdr.data_size());
+        return true;
+    }
+} // namespace
+#endif
+
+#if PD_FEATURE_EPR
+namespace {
+    // Validate PDOs of EPR_Source_Capabilities received so far, see
+    // SrcCapsParser. Each call processes only new whole PDOs, so PE has
+    // almost nothing left to do when the message completes.
+    void parse_src_caps_received(Port& port) {
+        if (port.rx_emsg.is_ext_msg(PD_EXT_MSGT::EPR_Source_Capabilities)) {
+            port.src_caps_parser.update(port.rx_emsg);
+        }
+    }
+} // namespace
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // [rev3.2] 6.12.2.1.2 Chunked Rx State Diagram
 
 class RCH_Wait_For_Message_From_Protocol_Layer_State : public afsm::state<PRL_RCH, RCH_Wait_For_Message_From_Protocol_Layer_State, RCH_Wait_For_Message_From_Protocol_Layer> {
 public:
+    static constexpr afsm::wake_fn<PRL_RCH> wake_on[] = {
+        FsmWake<PRL_RCH>::flags<&Port::prl_rch_flags, AtomicEnumBits<RCH_FLAG>::mask(RCH_FLAG::RX_ENQUEUED)>
+    };
+
     // The spec requires clearing the extended message buffer (rx_emsg) on enter,
     // but we do that on the first chunk instead because the buffer is shared with PE.
     static auto on_enter_state(PRL_RCH& rch) -> state_id_t {
@@ -175,28 +233,48 @@ public:
 
         if (port.prl_rch_flags.test_and_clear(RCH_FLAG::RX_ENQUEUED)) {
             // Copy header to output struct
-            port.rx_emsg.header = port.rx_chunk.header;
+            port.rx_emsg.header = port.rx_chunk->header;
 
-            if (port.rx_chunk.header.extended) {
-                PD_EXT_HEADER ehdr{port.rx_chunk.read16(0)};
+            if (port.rx_chunk->header.extended) {
+#if PD_FEATURE_EXTENDED
+                ExtHeaderView ehdr{*port.rx_chunk};
+#if PD_FEATURE_EPR
+                port.src_caps_parser.reset();
+#endif
 
-                if (ehdr.chunked) {
+                if (ehdr.is_chunked()) {
                     // The spec says to clear variables below in
                     // RCH_Processing_Extended_Message
                     // on the first chunk, but this place looks more obvious.
                     port.rch_chunk_number_expected = 0;
                     port.rx_emsg.clear();
-                    port.rx_emsg.header = port.rx_chunk.header;
+                    port.rx_emsg.header = port.rx_chunk->header;
                     return RCH_Processing_Extended_Message;
                 }
 
-                // Unchunked extended messages are not supported
+#if PD_FEATURE_UNCHUNKED_EXT
+                if (port.unchunked_ext_msg) {
+                    if (unpack_unchunked_ext_msg(*port.rx_chunk, port.rx_emsg)) {
+                        return RCH_Pass_Up_Message;
+                    }
+                    port.rch_error = PRL_ERROR::RCH_BAD_SEQUENCE;
+                    return RCH_Report_Error;
+                }
+#endif
+                // Unchunked extended messages are not negotiated
                 port.rch_error = PRL_ERROR::RCH_BAD_SEQUENCE;
                 return RCH_Report_Error;
+#else
+                // Extended messages are not supported. Pass up the first
+                // chunk as is (without chunk requests), PE will reply with
+                // Not_Supported.
+                port.rx_emsg = *port.rx_chunk;
+                return RCH_Pass_Up_Message;
+#endif
             }
 
             // Non-extended message
-            port.rx_emsg = port.rx_chunk;
+            port.rx_emsg = *port.rx_chunk;
             port.rx_emsg.resize_by_data_obj_count();
             return RCH_Pass_Up_Message;
         }
@@ -219,6 +297,7 @@ public:
     static void on_exit_state(PRL_RCH&) {}
 };
 
+#if PD_FEATURE_EXTENDED
 class RCH_Processing_Extended_Message_State : public afsm::state<PRL_RCH, RCH_Processing_Extended_Message_State, RCH_Processing_Extended_Message> {
 public:
     static auto on_enter_state(PRL_RCH& rch) -> state_id_t {
@@ -226,14 +305,15 @@ public:
         rch.log_state();
 
 
-        PD_EXT_HEADER ehdr{port.rx_chunk.read16(0)};
+        ExtHeaderView ehdr{*port.rx_chunk};
 
         // Data integrity check
-        if ((ehdr.chunk_number != port.rch_chunk_number_expected) ||
-            (ehdr.chunk_number >= MaxChunksPerMsg) ||
-            (ehdr.data_size > MaxExtendedMsgLen) ||
-            (ehdr.request_chunk != 0) ||
-            (ehdr.chunked != 1))
+        if (!ehdr.valid() ||
+            (ehdr.chunk_number() != port.rch_chunk_number_expected) ||
+            (ehdr.chunk_number() >= MaxChunksPerMsg) ||
+            (ehdr.data_size() > MaxExtendedMsgLen) ||
+            ehdr.is_request_chunk() ||
+            !ehdr.is_chunked())
         {
             port.rch_error = PRL_ERROR::RCH_BAD_SEQUENCE;
             return RCH_Report_Error;
@@ -241,11 +321,14 @@ public:
 
         // Copy as much as possible (without ext header),
         // until desired size reached.
-        port.rx_emsg.append_from(port.rx_chunk, 2, port.rx_chunk.data_size());
+        port.rx_emsg.append_from(*port.rx_chunk, 2, port.rx_chunk->data_size());
         port.rch_chunk_number_expected++;
 
-        if (port.rx_emsg.data_size() >= ehdr.data_size) {
-            port.rx_emsg.get_data().resize(ehdr.data_size);
+        if (port.rx_emsg.data_size() >= ehdr.data_size()) {
+            port.rx_emsg.resize(ehdr.data_size());
+#if PD_FEATURE_EPR
+            parse_src_caps_received(port);
+#endif
             return RCH_Pass_Up_Message;
         }
         return RCH_Requesting_Chunk;
@@ -276,7 +359,7 @@ public:
         ehdr.chunk_number = port.rch_chunk_number_expected;
         ehdr.chunked = 1;
 
-        auto& chunk = port.tx_chunk;
+        auto& chunk = rch.prl.tx_chunk_begin();
         chunk.clear();
         chunk.header = hdr;
         chunk.append16(ehdr.raw_value);
@@ -322,6 +405,11 @@ public:
 
         port.timers.start(PD_TIMEOUT::tChunkSenderResponse);
         port.timers.start(PD_TIMEOUT::tSenderResponse);
+
+#if PD_FEATURE_EPR
+        // The next chunk is on the way, process the data we already have
+        parse_src_caps_received(port);
+#endif
         return No_State_Change;
     }
 
@@ -332,10 +420,14 @@ public:
             // The spec requires informing PE immediately about a new message on
             // a wrong sequence, prior to returning to
             // RCH_Wait_For_Message_From_Protocol_Layer.
-            // But we can safely land only unchunked messages this way.
-
-            // NOTE: if unchunked extended messages are ever supported, filter here too.
-            if (port.rx_chunk.header.extended == 0) {
+            // But we can safely land only unchunked messages this way
+            // (including negotiated unchunked extended ones).
+            bool is_unchunked = (port.rx_chunk->header.extended == 0);
+#if PD_FEATURE_UNCHUNKED_EXT
+            is_unchunked = is_unchunked ||
+                (port.unchunked_ext_msg && is_unchunked_ext_msg(*port.rx_chunk));
+#endif
+            if (is_unchunked) {
                 port.rch_error = PRL_ERROR::RCH_SEQUENCE_DISCARDED;
                 return RCH_Report_Error;
             }
@@ -359,6 +451,7 @@ public:
         rch.prl.port.timers.stop(PD_TIMEOUT::tChunkSenderResponse);
     }
 };
+#endif // PD_FEATURE_EXTENDED
 
 class RCH_Report_Error_State : public afsm::state<PRL_RCH, RCH_Report_Error_State, RCH_Report_Error> {
 public:
@@ -366,9 +459,17 @@ public:
         auto& port = rch.prl.port;
 
         if (port.prl_rch_flags.test_and_clear(RCH_FLAG::RX_ENQUEUED)) {
-            port.rx_emsg = port.rx_chunk;
-            port.rx_emsg.resize_by_data_obj_count();
-            rch.prl.report_pe(MsgToPe_PrlMessageReceived{});
+            bool forward = true;
+#if PD_FEATURE_UNCHUNKED_EXT
+            if (port.rx_chunk->header.extended) {
+                forward = unpack_unchunked_ext_msg(*port.rx_chunk, port.rx_emsg);
+            } else
+#endif
+            {
+                port.rx_emsg = *port.rx_chunk;
+                port.rx_emsg.resize_by_data_obj_count();
+            }
+            if (forward) { rch.prl.report_pe(MsgToPe_PrlMessageReceived{}); }
         }
 
         rch.prl.report_pe(MsgToPe_PrlReportError{port.rch_error});
@@ -384,6 +485,11 @@ public:
 
 class TCH_Wait_For_Message_Request_From_Policy_Engine_State : public afsm::state<PRL_TCH, TCH_Wait_For_Message_Request_From_Policy_Engine_State, TCH_Wait_For_Message_Request_From_Policy_Engine> {
 public:
+    static constexpr afsm::wake_fn<PRL_TCH> wake_on[] = {
+        FsmWake<PRL_TCH>::flags<&Port::prl_tch_flags, AtomicEnumBits<TCH_FLAG>::mask(
+            TCH_FLAG::CHUNK_FROM_RX, TCH_FLAG::MSG_FROM_PE_ENQUEUED)>
+    };
+
     static auto on_enter_state(PRL_TCH& tch) -> state_id_t {
         tch.log_state();
         return No_State_Change;
@@ -420,9 +526,14 @@ public:
                 return No_State_Change;
             }
 
-            if (port.tx_emsg.header.extended) {
+#if PD_FEATURE_EXTENDED
+            // Negotiated unchunked extended messages are passed down as is
+            if (port.tx_emsg.header.extended &&
+                !(PD_FEATURE_UNCHUNKED_EXT && port.unchunked_ext_msg))
+            {
                 return TCH_Prepare_To_Send_Chunked_Message;
             }
+#endif
             return TCH_Pass_Down_Message;
         }
         return No_State_Change;
@@ -437,9 +548,29 @@ public:
         auto& port = tch.prl.port;
         tch.log_state();
 
+        auto& chunk = tch.prl.tx_chunk_begin();
+
+#if PD_FEATURE_UNCHUNKED_EXT
+        if (port.tx_emsg.header.extended) {
+            // Unchunked extended message: the whole data after the extended
+            // header, Number of Data Objects is 0.
+            PD_EXT_HEADER ehdr{0};
+            ehdr.data_size = port.tx_emsg.data_size();
+
+            chunk.clear();
+            chunk.append16(ehdr.raw_value);
+            chunk.append_from(port.tx_emsg, 0, port.tx_emsg.data_size());
+            chunk.header = port.tx_emsg.header;
+            chunk.header.data_obj_count = 0;
+
+            tch.prl.prl_tx_enqueue_chunk();
+            return TCH_Wait_For_Transmission_Complete;
+        }
+#endif
+
         // Copy data to chunk & fill data object count
-        port.tx_chunk = port.tx_emsg;
-        port.tx_chunk.header.data_obj_count = port.tx_emsg.size_to_pdo_count();
+        chunk = port.tx_emsg;
+        chunk.header.data_obj_count = port.tx_emsg.size_to_pdo_count();
 
         tch.prl.prl_tx_enqueue_chunk();
         return TCH_Wait_For_Transmission_Complete;
@@ -475,8 +606,13 @@ public:
         // That means the driver transferred the packet, but PRL_TX has not been
         // called yet. This is possible because TX and RX events can arrive at the
         // same time. In this case, just wait until PRL_TX is called.
+        //
+        // With software GoodCRC check, PRL_TX waits for GoodCRC or tReceive
+        // timeout after SUCCEEDED, and reports by flags. Don't spin meanwhile.
         if (port.tcpc_tx_status.load() == TCPC_TRANSMIT_STATUS::SUCCEEDED) {
-            tch.prl.request_wakeup(); // Probably not needed, but just in case.
+            if (tch.prl.tcpc.get_hw_features().tx_auto_goodcrc_check) {
+                tch.prl.request_wakeup(); // Probably not needed, but just in case.
+            }
             return No_State_Change;
         }
 
@@ -512,6 +648,7 @@ public:
     static void on_exit_state(PRL_TCH&) {}
 };
 
+#if PD_FEATURE_EXTENDED
 class TCH_Prepare_To_Send_Chunked_Message_State : public afsm::state<PRL_TCH, TCH_Prepare_To_Send_Chunked_Message_State, TCH_Prepare_To_Send_Chunked_Message> {
 public:
     static auto on_enter_state(PRL_TCH& tch) -> state_id_t {
@@ -540,14 +677,15 @@ public:
         ehdr.chunk_number = port.tch_chunk_number_to_send;
         ehdr.chunked = 1;
 
-        port.tx_chunk.clear();
-        port.tx_chunk.append16(ehdr.raw_value);
+        auto& chunk = tch.prl.tx_chunk_begin();
+        chunk.clear();
+        chunk.append16(ehdr.raw_value);
         auto offset = port.tch_chunk_number_to_send * MaxExtendedMsgChunkLen;
-        port.tx_chunk.append_from(port.tx_emsg, offset, offset + chunk_data_len);
+        chunk.append_from(port.tx_emsg, offset, offset + chunk_data_len);
 
-        port.tx_chunk.header = port.tx_emsg.header;
+        chunk.header = port.tx_emsg.header;
         // single data object size is 4 bytes
-        port.tx_chunk.header.data_obj_count = port.tx_chunk.size_to_pdo_count();
+        chunk.header.data_obj_count = chunk.size_to_pdo_count();
 
         tch.prl.prl_tx_enqueue_chunk();
         return TCH_Sending_Chunked_Message;
@@ -578,7 +716,9 @@ public:
         if (port.tcpc_tx_status.load() == TCPC_TRANSMIT_STATUS::SUCCEEDED &&
             !port.prl_tx_flags.test(PRL_TX_FLAG::TX_COMPLETED))
         {
-            tch.prl.request_wakeup(); // Probably not needed, but just in case.
+            if (tch.prl.tcpc.get_hw_features().tx_auto_goodcrc_check) {
+                tch.prl.request_wakeup(); // Probably not needed, but just in case.
+            }
             return No_State_Change;
         }
 
@@ -634,11 +774,11 @@ public:
         auto& port = tch.prl.port;
 
         if (port.prl_tch_flags.test_and_clear(TCH_FLAG::CHUNK_FROM_RX)) {
-            if (port.rx_chunk.header.extended) {
-                PD_EXT_HEADER ehdr{port.rx_chunk.read16(0)};
+            if (port.rx_chunk->header.extended) {
+                ExtHeaderView ehdr{*port.rx_chunk};
 
-                if (ehdr.request_chunk == 1) {
-                    if (ehdr.chunk_number == port.tch_chunk_number_to_send) {
+                if (ehdr.is_request_chunk()) {
+                    if (ehdr.chunk_number() == port.tch_chunk_number_to_send) {
                         port.prl_tch_flags.clear(TCH_FLAG::CHUNK_FROM_RX);
                         return TCH_Construct_Chunked_Message;
                     }
@@ -678,6 +818,7 @@ public:
         tch.prl.port.timers.stop(PD_TIMEOUT::tChunkSenderRequest);
     }
 };
+#endif // PD_FEATURE_EXTENDED
 
 class TCH_Message_Received_State : public afsm::state<PRL_TCH, TCH_Message_Received_State, TCH_Message_Received> {
 public:
@@ -725,9 +866,9 @@ public:
 //
 // - Only discards are reported to PE from here.
 // - Success/errors are forwarded to RCH/TCH via flags.
-// - Some room is reserved for CRC processing to stay close to the spec, but
-//   currently only the branches for hardware-supported GoodCRC are active.
-//   This should be revisited and cleaned if software CRC support is not needed.
+// - GoodCRC handling depends on TCPC_HW_FEATURES. If TCPC can't check
+//   GoodCRC in hardware, PRL_Rx forwards received GoodCRC here, and
+//   PRL_Tx waits for it with tReceive timeout.
 
 class PRL_Tx_PHY_Layer_Reset_State : public afsm::state<PRL_Tx, PRL_Tx_PHY_Layer_Reset_State, PRL_Tx_PHY_Layer_Reset> {
 public:
@@ -781,7 +922,7 @@ public:
 
         // For non-AMS messages, or after first AMS message
         if (port.prl_tx_flags.test_and_clear(PRL_TX_FLAG::TX_CHUNK_ENQUEUED)) {
-            if (port.tx_chunk.is_ctrl_msg(PD_CTRL_MSGT::Soft_Reset)) {
+            if (port.tx_chunk->is_ctrl_msg(PD_CTRL_MSGT::Soft_Reset)) {
                 return PRL_Tx_Layer_Reset_for_Transmit;
             }
             return PRL_Tx_Construct_Message;
@@ -822,8 +963,8 @@ public:
         auto& port = prl_tx.prl.port;
         prl_tx.log_state();
 
-        port.tx_chunk.header.message_id = port.tx_msg_id_counter;
-        port.tx_chunk.header.spec_revision = port.revision;
+        port.tx_chunk->header.message_id = port.tx_msg_id_counter;
+        port.tx_chunk->header.spec_revision = port.revision;
 
         // Here we should fill power/data roles. But since we are Sink-only UFP,
         // we can just use default values (zeroes).
@@ -836,8 +977,8 @@ public:
         port.tcpc_tx_status.store(TCPC_TRANSMIT_STATUS::UNSET);
 
         // Reset PRL_TX "output"
-        port.prl_tx_flags.clear(PRL_TX_FLAG::TX_COMPLETED);
-        port.prl_tx_flags.clear(PRL_TX_FLAG::TX_ERROR);
+        port.prl_tx_flags.fetch_and_clear(PrlTxFlags::mask(
+            PRL_TX_FLAG::TX_COMPLETED, PRL_TX_FLAG::TX_ERROR, PRL_TX_FLAG::GOODCRC_RECEIVED));
 
         // Kick driver
         prl_tx.prl.tcpc.req_transmit();
@@ -854,11 +995,6 @@ class PRL_Tx_Wait_for_PHY_Response_State : public afsm::state<PRL_Tx, PRL_Tx_Wai
 public:
     static auto on_enter_state(PRL_Tx& prl_tx) -> state_id_t {
         prl_tx.log_state();
-
-        // Timer should be used ONLY when hardware confirmation is not supported
-        // if (!prl_tx.prl.tcpc.get_hw_features().tx_auto_goodcrc_check) {
-        //    prl_tx.prl.port.timers.start(PD_TIMEOUT::tReceive);
-        // }
         return No_State_Change;
     }
 
@@ -867,35 +1003,57 @@ public:
 
         auto status = port.tcpc_tx_status.load();
 
-        if (status == TCPC_TRANSMIT_STATUS::SUCCEEDED) {
-            return PRL_Tx_Match_MessageID;
-        }
-
         if (status == TCPC_TRANSMIT_STATUS::FAILED) {
             return PRL_Tx_Check_RetryCounter;
         }
 
-        // Actual only for software CRC processing
-        // if (port.timers.is_expired(PD_TIMEOUT::tReceive)) {
-        //    return PRL_Tx_Check_RetryCounter;
-        // }
+        if (prl_tx.prl.tcpc.get_hw_features().tx_auto_goodcrc_check) {
+            if (status == TCPC_TRANSMIT_STATUS::SUCCEEDED) {
+                return PRL_Tx_Match_MessageID;
+            }
+            return No_State_Change;
+        }
+
+        // Software GoodCRC check. Here SUCCEEDED means the message is sent,
+        // and GoodCRC should arrive within tReceive.
+        if (port.prl_tx_flags.test(PRL_TX_FLAG::GOODCRC_RECEIVED)) {
+            return PRL_Tx_Match_MessageID;
+        }
+
+        if (status == TCPC_TRANSMIT_STATUS::SUCCEEDED) {
+            if (port.timers.is_disabled(PD_TIMEOUT::tReceive)) {
+                port.timers.start(PD_TIMEOUT::tReceive);
+            }
+            else if (port.timers.is_expired(PD_TIMEOUT::tReceive)) {
+                return PRL_Tx_Check_RetryCounter;
+            }
+        }
 
         return No_State_Change;
     }
 
-    // static void on_exit_state(PRL_Tx& prl_tx) {
-    //    prl_tx.prl.port.timers.stop(PD_TIMEOUT::tReceive);
-    // }
-    static void on_exit_state(PRL_Tx&) {}
+    static void on_exit_state(PRL_Tx& prl_tx) {
+        prl_tx.prl.port.timers.stop(PD_TIMEOUT::tReceive);
+    }
 };
 
 class PRL_Tx_Match_MessageID_State : public afsm::state<PRL_Tx, PRL_Tx_Match_MessageID_State, PRL_Tx_Match_MessageID> {
 public:
     static auto on_enter_state(PRL_Tx& prl_tx) -> state_id_t {
+        auto& port = prl_tx.prl.port;
         prl_tx.log_state();
 
-        // Since message id match is currently embedded in
+        // With hardware GoodCRC check, message id match is embedded in
         // transfer success status, just forward to next state
+        if (prl_tx.prl.tcpc.get_hw_features().tx_auto_goodcrc_check) {
+            return PRL_Tx_Message_Sent;
+        }
+
+        port.prl_tx_flags.clear(PRL_TX_FLAG::GOODCRC_RECEIVED);
+
+        if (port.rx_goodcrc_msg_id != port.tx_msg_id_counter.get()) {
+            return PRL_Tx_Check_RetryCounter;
+        }
         return PRL_Tx_Message_Sent;
     }
 
@@ -935,8 +1093,17 @@ public:
         // - for Extended Message with data size > MaxExtendedMsgLegacyLen that
         //   has not been chunked
         //
-        // Since we are sink-only and do not support unchunked extended messages,
-        // no extra checks are needed. Always use retries if supported by hardware.
+        // Since we are sink-only, only the second case needs a check. Otherwise,
+        // always use retries if supported by hardware.
+
+#if PD_FEATURE_UNCHUNKED_EXT
+        const auto& chunk = *port.tx_chunk;
+        if (chunk.header.extended && chunk.header.data_obj_count == 0 &&
+            ExtHeaderView{chunk}.data_size() > MaxExtendedMsgLegacyLen)
+        {
+            return PRL_Tx_Transmission_Error;
+        }
+#endif
 
         if (prl_tx.prl.tcpc.get_hw_features().tx_auto_retry) {
             // Don't try to retransmit manually if hardware supports it.
@@ -1033,7 +1200,7 @@ public:
         prl_tx.log_state();
 
         // Soft reset passed without delay
-        if (port.tx_chunk.is_ctrl_msg(PD_CTRL_MSGT::Soft_Reset)) {
+        if (port.tx_chunk->is_ctrl_msg(PD_CTRL_MSGT::Soft_Reset)) {
             port.prl_tx_flags.clear(PRL_TX_FLAG::TX_CHUNK_ENQUEUED);
             return PRL_Tx_Layer_Reset_for_Transmit;
         }
@@ -1089,20 +1256,41 @@ public:
         auto& prl = prl_rx.prl;
         auto& port = prl.port;
 
-        if (port.prl_rch_flags.test(RCH_FLAG::RX_ENQUEUED)) {
+        if (port.prl_rch_flags.test(RCH_FLAG::RX_ENQUEUED) ||
+            port.prl_tch_flags.test(TCH_FLAG::CHUNK_FROM_RX))
+        {
             // In theory, we can have a pending packet in RCH, re-routed by
             // a discard in TCH. Postpone processing of the new one to the next
             // cycle to allow RCH to finish.
             //
-            // This is not expected to happen, because we do multiple RCH/TCH
-            // calls.
+            // Normally, PRL::run_until_idle() calls PRL_Rx again right after
+            // RCH/TCH consumed the chunk.
+            //
+            // The same applies to TCH: the borrowed chunk must stay intact
+            // until consumed.
             prl.request_wakeup();
             return No_State_Change;
         }
 
-        if (!prl.tcpc.fetch_rx_data()) { return No_State_Change; }
+        // The previous chunk (if any) is consumed by RCH/TCH now.
+        // Return it to the driver and borrow the next one.
+        prl.rx_chunk_release();
+
+        port.rx_chunk = prl.tcpc.rx_borrow();
+        if (!port.rx_chunk) { return No_State_Change; }
 
-        if (port.rx_chunk.is_ctrl_msg(PD_CTRL_MSGT::Soft_Reset)) {
+        // GoodCRC goes to PRL_Tx only, if TCPC does not consume it
+        if (port.rx_chunk->is_ctrl_msg(PD_CTRL_MSGT::GoodCRC)) {
+            if (!prl.tcpc.get_hw_features().tx_auto_goodcrc_check) {
+                port.rx_goodcrc_msg_id = port.rx_chunk->header.message_id;
+                port.prl_tx_flags.set(PRL_TX_FLAG::GOODCRC_RECEIVED);
+            }
+            prl.rx_chunk_release();
+            prl.request_wakeup();
+            return No_State_Change;
+        }
+
+        if (port.rx_chunk->is_ctrl_msg(PD_CTRL_MSGT::Soft_Reset)) {
             return PRL_Rx_Layer_Reset_for_Receive;
         }
 
@@ -1144,8 +1332,10 @@ public:
 
 class PRL_Rx_Send_GoodCRC_State : public afsm::state<PRL_Rx, PRL_Rx_Send_GoodCRC_State, PRL_Rx_Send_GoodCRC> {
 public:
-    // All modern hardware sends CRC automatically. This state exists
-    // only to match the spec.
+    // GoodCRC must be sent within tTransmit (195 us), which is not reachable
+    // from the event loop. So, it's always sent by the TCPC driver: in
+    // hardware, or via soft_crc::build_goodcrc() if `rx_auto_goodcrc_send`
+    // is not supported. This state exists only to match the spec.
     //
     // NOTE: PRL_Rx_Layer_Reset_for_Receive relies on reaching
     // PRL_Rx_Store_MessageID immediately; PE should not request a new message
@@ -1166,7 +1356,7 @@ public:
         auto& port = prl_rx.prl.port;
         prl_rx.log_state();
 
-        if (port.rx_msg_id_stored == port.rx_chunk.header.message_id) {
+        if (port.rx_msg_id_stored == port.rx_chunk->header.message_id) {
             // Ignore duplicates
             return PRL_Rx_Wait_for_PHY_Message;
         }
@@ -1184,11 +1374,11 @@ public:
         auto& prl = prl_rx.prl;
         prl_rx.log_state();
 
-        port.rx_msg_id_stored = port.rx_chunk.header.message_id;
+        port.rx_msg_id_stored = port.rx_chunk->header.message_id;
 
         // Rev 3.2 says ping is deprecated => Ignore it completely
         // (it should not discard, affect chunking and so on).
-        if (port.rx_chunk.is_ctrl_msg(PD_CTRL_MSGT::Ping)) { return PRL_Rx_Wait_for_PHY_Message; }
+        if (port.rx_chunk->is_ctrl_msg(PD_CTRL_MSGT::Ping)) { return PRL_Rx_Wait_for_PHY_Message; }
 
         // Discard TX if:
         //
@@ -1202,7 +1392,7 @@ public:
 
         // Safety cleanup for a smooth Soft Reset flow.
         // This seems needed, so it is added here just in case.
-        if (port.rx_chunk.is_ctrl_msg(PD_CTRL_MSGT::Soft_Reset)) {
+        if (port.rx_chunk->is_ctrl_msg(PD_CTRL_MSGT::Soft_Reset)) {
             port.tcpc_tx_status.store(TCPC_TRANSMIT_STATUS::UNSET);
             port.prl_tch_flags.clear(TCH_FLAG::MSG_FROM_PE_ENQUEUED);
         }
@@ -1249,6 +1439,11 @@ public:
 
 class PRL_HR_IDLE_State : public afsm::state<PRL_HR, PRL_HR_IDLE_State, PRL_HR_IDLE> {
 public:
+    static constexpr afsm::wake_fn<PRL_HR> wake_on[] = {
+        FsmWake<PRL_HR>::flags<&Port::prl_hr_flags, PrlHrFlags::mask(
+            PRL_HR_FLAG::HARD_RESET_FROM_PARTNER, PRL_HR_FLAG::HARD_RESET_FROM_PE)>
+    };
+
     static auto on_enter_state(PRL_HR& hr) -> state_id_t {
         hr.log_state();
 
@@ -1259,8 +1454,8 @@ public:
     static auto on_run_state(PRL_HR& hr) -> state_id_t {
         auto& port = hr.prl.port;
 
-        if (port.prl_hr_flags.test(PRL_HR_FLAG::HARD_RESET_FROM_PARTNER) ||
-            port.prl_hr_flags.test(PRL_HR_FLAG::HARD_RESET_FROM_PE))
+        if (port.prl_hr_flags.test_any(PrlHrFlags::mask(
+            PRL_HR_FLAG::HARD_RESET_FROM_PARTNER, PRL_HR_FLAG::HARD_RESET_FROM_PE)))
         {
             return PRL_HR_Reset_Layer;
         }
@@ -1278,6 +1473,7 @@ public:
         hr.log_state();
 
         hr.prl.port.revision = MaxSupportedRevision;
+        hr.prl.port.unchunked_ext_msg = false;
 
         // Start by disabling the RX path (and clearing the FIFO).
         hr.prl.tcpc.req_rx_enable(false);
@@ -1389,6 +1585,11 @@ public:
 
 class PRL_HR_Wait_for_PE_Hard_Reset_Complete_State : public afsm::state<PRL_HR, PRL_HR_Wait_for_PE_Hard_Reset_Complete_State, PRL_HR_Wait_for_PE_Hard_Reset_Complete> {
 public:
+    static constexpr afsm::wake_fn<PRL_HR> wake_on[] = {
+        FsmWake<PRL_HR>::flags<&Port::prl_hr_flags, PrlHrFlags::mask(
+            PRL_HR_FLAG::PE_HARD_RESET_COMPLETE)>
+    };
+
     static auto on_enter_state(PRL_HR& hr) -> state_id_t {
         hr.log_state();
         return No_State_Change;
@@ -1442,6 +1643,7 @@ PRL::PRL(Port& port, IDriver& tcpc)
 {}
 
 void PRL::setup() {
+    port.prl = this;
     port.prl_rtr = &prl_event_listener;
 }
 
@@ -1461,6 +1663,7 @@ void PRL::init() {
     port.prl_rch_flags.clear_all();
     port.prl_tch_flags.clear_all();
     port.tcpc_tx_status.store(TCPC_TRANSMIT_STATUS::UNSET);
+    rx_chunk_release();
 
     port.timers.stop_range(PD_TIMERS_RANGE::PRL);
 
@@ -1479,23 +1682,126 @@ void PRL::init() {
     PRL_LOGI("PRL init end");
 }
 
-void PRL::report_pe(const etl::imessage& msg) {
+PD_CHUNK_EXT& PRL::tx_chunk_begin() {
+    port.tx_chunk = &tcpc.get_tx_chunk();
+    return *port.tx_chunk;
+}
+
+void PRL::rx_chunk_release() {
+    if (port.rx_chunk) {
+        port.rx_chunk = nullptr;
+        tcpc.rx_release();
+        rx_chunks_released++;
+    }
+}
+
+template <typename T>
+void PRL::report_pe(const T& msg) {
     port.notify_pe(msg);
+    has_pe_report = true;
     request_wakeup();
 }
 
+bool PRL::is_busy() const {
+    return (prl_rch.get_state_id() != RCH_Wait_For_Message_From_Protocol_Layer) ||
+        (prl_tch.get_state_id() != TCH_Wait_For_Message_Request_From_Policy_Engine);
+}
+
 void PRL::reset_msg_counters() {
     port.rx_msg_id_stored = -1;
     port.tx_msg_id_counter = 0;
 }
 
+namespace {
+    // Sub-FSMs in the order of run_until_idle() calls
+    constexpr uint8_t RUN_RX = 1u << 0;
+    constexpr uint8_t RUN_RCH = 1u << 1;
+    constexpr uint8_t RUN_TCH = 1u << 2;
+    constexpr uint8_t RUN_TX = 1u << 3;
+    constexpr uint8_t RUN_ALL = RUN_RX | RUN_RCH | RUN_TCH | RUN_TX;
+
+    // Everything sub-FSMs read from each other (besides timers)
+    struct PrlInputs {
+        explicit PrlInputs(const PRL& prl) :
+            rx_state{prl.prl_rx.get_state_id()},
+            rch_state{prl.prl_rch.get_state_id()},
+            tch_state{prl.prl_tch.get_state_id()},
+            tx_state{prl.prl_tx.get_state_id()},
+            tx_flags{prl.port.prl_tx_flags.snapshot()},
+            rch_flags{prl.port.prl_rch_flags.snapshot()},
+            tch_flags{prl.port.prl_tch_flags.snapshot()},
+            tx_status{prl.port.tcpc_tx_status.load()},
+            rx_chunk{prl.port.rx_chunk},
+            rx_chunks_released{prl.rx_chunks_released}
+        {}
+
+        // Sub-FSMs to call again, depending on what changed since `prev`
+        auto changes_since(const PrlInputs& prev) const -> uint8_t {
+            uint8_t mask = 0;
+            // New chunk borrowed or the previous one returned
+            if (rx_state != prev.rx_state || rx_chunk != prev.rx_chunk ||
+                rx_chunks_released != prev.rx_chunks_released)
+            {
+                mask |= RUN_RX;
+            }
+            // TCH checks RCH state when PE sends a new message
+            if (rch_state != prev.rch_state) { mask |= RUN_RCH | RUN_TCH; }
+            if (tch_state != prev.tch_state) { mask |= RUN_TCH; }
+            if (tx_state != prev.tx_state || tx_status != prev.tx_status) { mask |= RUN_TX; }
+            if (tx_flags != prev.tx_flags) { mask |= RUN_TX | RUN_RCH | RUN_TCH; }
+            // PRL_Rx waits for RCH/TCH to consume the chunk
+            if (rch_flags != prev.rch_flags) { mask |= RUN_RCH | RUN_RX; }
+            if (tch_flags != prev.tch_flags) { mask |= RUN_TCH | RUN_RX; }
+            return mask;
+        }
+
+        state_id_t rx_state, rch_state, tch_state, tx_state;
+        uint32_t tx_flags, rch_flags, tch_flags;
+        TCPC_TRANSMIT_STATUS tx_status;
+        const PD_CHUNK* rx_chunk;
+        uint16_t rx_chunks_released;
+    };
+} // namespace
+
+void PRL::run_until_idle() {
+    uint8_t pending = RUN_ALL;
+    last_run_passes = 0;
+    last_run_calls = 0;
+    has_pe_report = false;
+
+    while (pending && last_run_passes < MAX_RUN_PASSES) {
+        last_run_passes++;
+
+        for (uint8_t fsm = RUN_RX; fsm & RUN_ALL; fsm <<= 1) {
+            if (!(pending & fsm)) { continue; }
+            pending &= ~fsm;
+
+            PrlInputs before{*this};
+            switch (fsm) {
+                case RUN_RX: prl_rx.run(); break;
+                case RUN_RCH: prl_rch.run(); break;
+                case RUN_TCH: prl_tch.run(); break;
+                default: prl_tx.run(); break;
+            }
+            last_run_calls++;
+            pending |= PrlInputs{*this}.changes_since(before);
+        }
+
+        // Don't fetch the next RX chunk until PE handles the report. PE
+        // runs before PRL in the next tick (wakeup is already requested).
+        if (has_pe_report) { pending &= ~RUN_RX; }
+    }
+
+    // Iterations limit reached, continue in the next tick
+    if (pending) { request_wakeup(); }
+}
+
 void PRL::prl_tx_enqueue_chunk() {
     // Ensure we prohibit accepting statuses from the driver
     port.tcpc_tx_status.store(TCPC_TRANSMIT_STATUS::UNSET);
 
     // Clear PRL_TX "output"
-    port.prl_tx_flags.clear(PRL_TX_FLAG::TX_COMPLETED);
-    port.prl_tx_flags.clear(PRL_TX_FLAG::TX_ERROR);
+    port.prl_tx_flags.fetch_and_clear(PrlTxFlags::mask(PRL_TX_FLAG::TX_COMPLETED, PRL_TX_FLAG::TX_ERROR));
 
     // Mark tx_chunk ready to be sent
     port.prl_tx_flags.set(PRL_TX_FLAG::TX_CHUNK_ENQUEUED);
@@ -1510,16 +1816,21 @@ void PRL::prl_tx_enqueue_chunk() {
 using RCH_STATES = afsm::state_pack<
     RCH_Wait_For_Message_From_Protocol_Layer_State,
     RCH_Pass_Up_Message_State,
+    RCH_Report_Error_State
+#if PD_FEATURE_EXTENDED
+    ,
     RCH_Processing_Extended_Message_State,
     RCH_Requesting_Chunk_State,
-    RCH_Waiting_Chunk_State,
-    RCH_Report_Error_State
+    RCH_Waiting_Chunk_State
+#endif
 >;
 
 PRL_RCH::PRL_RCH(PRL& prl) : prl{prl} {
     set_states<RCH_STATES>();
 };
 
+Port& PRL_RCH::get_port() { return prl.port; }
+
 void PRL_RCH::log_state() const {
     PRL_LOGI("PRL_RCH state => {}", prl_rch_state_to_desc(get_state_id()));
 }
@@ -1529,18 +1840,23 @@ using TCH_STATES = afsm::state_pack<
     TCH_Pass_Down_Message_State,
     TCH_Wait_For_Transmission_Complete_State,
     TCH_Message_Sent_State,
+    TCH_Message_Received_State,
+    TCH_Report_Error_State
+#if PD_FEATURE_EXTENDED
+    ,
     TCH_Prepare_To_Send_Chunked_Message_State,
     TCH_Construct_Chunked_Message_State,
     TCH_Sending_Chunked_Message_State,
-    TCH_Wait_Chunk_Request_State,
-    TCH_Message_Received_State,
-    TCH_Report_Error_State
+    TCH_Wait_Chunk_Request_State
+#endif
 >;
 
 PRL_TCH::PRL_TCH(PRL& prl) : prl{prl} {
     set_states<TCH_STATES>();
 }
 
+Port& PRL_TCH::get_port() { return prl.port; }
+
 void PRL_TCH::log_state() const {
     PRL_LOGI("PRL_TCH state => {}", prl_tch_state_to_desc(get_state_id()));
 }
@@ -1599,12 +1915,18 @@ PRL_HR::PRL_HR(PRL& prl) : prl{prl} {
     set_states<PRL_HR_STATES>();
 }
 
+Port& PRL_HR::get_port() { return prl.port; }
+
 void PRL_HR::log_state() const {
     PRL_LOGI("PRL_HR state => {}", prl_hr_state_to_desc(get_state_id()));
 }
 
 
 void PRL_EventListener::on_receive(const MsgSysUpdate&) {
+    auto local_state = prl.local_state;
+    auto hr_state = prl.prl_hr.get_state_id();
+    PrlInputs inputs{prl};
+
     switch (prl.local_state) {
         case PRL::LOCAL_STATE::DISABLED:
             if (!prl.port.is_attached) { break; }
@@ -1637,33 +1959,24 @@ void PRL_EventListener::on_receive(const MsgSysUpdate&) {
                 // - Skip TCPC fail here, because it can start retry.
                 // - Skip TCPC discard here, to expose by RX
                 //
-                // Maybe software CRC handling needs more care, but for
-                // hardware CRC this looks OK.
+                // With software GoodCRC check, SUCCEEDED only starts the
+                // tReceive wait, so this is safe too.
                 prl.prl_tx.run();
             }
 
-            prl.prl_rx.run();
-            prl.prl_rch.run();
-            // First TCH call needed when PE enqueued message, to start
-            // chunking / transfer.
-            prl.prl_tch.run();
-            prl.prl_tx.run();
-
-            //
-            // Repeat TCH/RCH calls for quick-consume previous changes
-            //
-
-            // After transfer complete - PE should be notified, call TCH again.
-            prl.prl_tch.run();
-            // Once more to catch edge case
-            prl.prl_tch.run();
-            // Repeat RCH call to land
-            // - re-routed TCH message
-            // - prl_tx status update after chunk request
-            prl.prl_rch.run();
+            // Rx => RCH => TCH => Tx, repeated for FSMs with changed inputs.
+            // This drains queued RX chunks, and passes PE requests and TX
+            // results through the chain in a single tick.
+            prl.run_until_idle();
             break;
     }
 
+    if (prl.local_state != local_state || prl.prl_hr.get_state_id() != hr_state ||
+        PrlInputs{prl}.changes_since(inputs))
+    {
+        prl.port.on_state_changed();
+    }
+
     if (prl.has_deferred_wakeup_request) {
         prl.has_deferred_wakeup_request = false;
         // Protection from nested FSM calls. All requested wakeups are postponed
@@ -1714,15 +2027,4 @@ void PRL_EventListener::on_receive(const MsgToPrl_ExtMsgFromPe& msg) {
     prl.port.prl_tch_flags.set(TCH_FLAG::MSG_FROM_PE_ENQUEUED);
 }
 
-void PRL_EventListener::on_receive(const MsgToPrl_GetPrlStatus& msg) {
-    msg.is_running_ref = (prl.local_state == PRL::LOCAL_STATE::WORKING);
-    msg.is_busy_ref =
-        (prl.prl_rch.get_state_id() != RCH_Wait_For_Message_From_Protocol_Layer) ||
-        (prl.prl_tch.get_state_id() != TCH_Wait_For_Message_Request_From_Policy_Engine);
-}
-
-void PRL_EventListener::on_receive_unknown(ETL_MAYBE_UNUSED const etl::imessage& msg) {
-    PRL_LOGE("PRL unknown message, ID: {}", msg.get_message_id());
-}
-
 } // namespace pd
@@ -24,39 +24,32 @@ public:
     PRL& prl;
 };
 
-class PRL_HR: public afsm::fsm<PRL_HR> {
+class PRL_HR: public afsm::fsm<PRL_HR, 1> {
 public:
     PRL_HR(PRL& prl);
     void log_state() const;
+    Port& get_port();
     PRL& prl;
 };
 
-class PRL_RCH: public afsm::fsm<PRL_RCH> {
+class PRL_RCH: public afsm::fsm<PRL_RCH, 1> {
 public:
     PRL_RCH(PRL& prl);
     void log_state() const;
+    Port& get_port();
     PRL& prl;
 };
 
-class PRL_TCH: public afsm::fsm<PRL_TCH> {
+class PRL_TCH: public afsm::fsm<PRL_TCH, 1> {
 public:
     PRL_TCH(PRL& prl);
     void log_state() const;
+    Port& get_port();
     PRL& prl;
 };
 
-using PRL_EventListener_Base = etl::message_router<class PRL_EventListener,
-    MsgSysUpdate,
-    MsgToPrl_EnqueueRestart,
-    MsgToPrl_HardResetFromPe,
-    MsgToPrl_PEHardResetDone,
-    MsgToPrl_TcpcHardReset,
-    MsgToPrl_CtlMsgFromPe,
-    MsgToPrl_DataMsgFromPe,
-    MsgToPrl_ExtMsgFromPe,
-    MsgToPrl_GetPrlStatus>;
-
-class PRL_EventListener : public PRL_EventListener_Base {
+// Called directly by Port::notify_prl(), see port.h
+class PRL_EventListener {
 public:
     PRL_EventListener(PRL& prl) : prl(prl) {}
     void on_receive(const MsgSysUpdate& msg);
@@ -67,8 +60,6 @@ public:
     void on_receive(const MsgToPrl_CtlMsgFromPe& msg);
     void on_receive(const MsgToPrl_DataMsgFromPe& msg);
     void on_receive(const MsgToPrl_ExtMsgFromPe& msg);
-    void on_receive(const MsgToPrl_GetPrlStatus& msg);
-    void on_receive_unknown(const etl::imessage& msg);
 private:
     PRL& prl;
 };
@@ -86,13 +77,28 @@ public:
     void init();
     void request_wakeup() { has_deferred_wakeup_request = true; };
     // notify + deferred wakeup
-    void report_pe(const etl::imessage& msg);
+    template <typename T>
+    void report_pe(const T& msg);
+
+    bool is_running() const { return local_state == LOCAL_STATE::WORKING; }
+    // RCH or TCH has a transfer in progress
+    bool is_busy() const;
 
     void reset_msg_counters();
 
+    // Get a driver buffer to build the next TX chunk in
+    PD_CHUNK_EXT& tx_chunk_begin();
+    // Return the borrowed RX chunk (if any) to the driver
+    void rx_chunk_release();
+
     // Mark TX chunk for sending (+ cleanup status flags from prev operations)
     void prl_tx_enqueue_chunk();
 
+    // Run Rx/RCH/TCH/Tx until nothing changes (bounded by MAX_RUN_PASSES).
+    // Only FSMs with changed inputs are called again.
+    void run_until_idle();
+    static constexpr uint8_t MAX_RUN_PASSES = 8;
+
     enum class LOCAL_STATE {
         DISABLED, INIT, WORKING
     } local_state{LOCAL_STATE::DISABLED};
@@ -108,6 +114,16 @@ public:
 
     PRL_EventListener prl_event_listener;
     etl::atomic<bool> has_deferred_wakeup_request{false};
+
+    // Counts RX chunks returned to the driver, to detect RX progress
+    uint16_t rx_chunks_released{0};
+    // Set on any report to PE. rx_emsg is a single buffer, so new chunks
+    // are not fetched until PE handles the report.
+    bool has_pe_report{false};
+
+    // Stats of the last run_until_idle() call, for tests and tuning
+    uint8_t last_run_passes{0};
+    uint8_t last_run_calls{0};
 };
 
 } // namespace pd
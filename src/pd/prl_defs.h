@@ -34,6 +34,8 @@ enum class PRL_TX_FLAG {
     // Output signal for RCH/TCH
     TX_COMPLETED,
     TX_ERROR,
+    // GoodCRC received by PRL_Rx (if TCPC can't check it in hardware)
+    GOODCRC_RECEIVED,
     _Count
 };
 
@@ -9,12 +9,35 @@
 
 namespace pd {
 
+// Component to run when the timer expires
+static TASK_RUN_FLAG timer_owner(int timer_id) {
+    if (timer_id < PD_TIMERS_RANGE::PE.first) { return TASK_RUN_FLAG::TC; }
+    if (timer_id < PD_TIMERS_RANGE::PRL.first) { return TASK_RUN_FLAG::PE; }
+    return TASK_RUN_FLAG::PRL;
+}
+
+template <typename Fn>
+void Task::run_if_pending(TASK_RUN_FLAG component, Fn&& run) {
+    auto idx = static_cast<size_t>(component);
+
+    if (port.pending_runs.test_and_clear(component)) {
+        run();
+        runs[idx]++;
+    } else {
+        skipped_runs[idx]++;
+    }
+}
+
 void Task::tick() {
     auto e_group = event_group.exchange(0);
 
     // Proceed only if any event available. This check may be useful
     // for manual loop polling.
     if (e_group) {
+        // Wakeups come from the driver, DPM or components, without details.
+        // Let everyone check.
+        if (e_group & Task::EVENT_WAKEUP_MSK) { port.pending_runs.set_all(); }
+
         if (e_group & Task::EVENT_TIMER_MSK) {
             // Timers don't interact with the system directly. We update
             // internal timestamp value in 2 cases:
@@ -25,13 +48,22 @@ void Task::tick() {
             // The rest operations can use "old" value safe.
             port.timers.set_time(port.timers.get_time());
 
-            port.timers.cleanup();
+            // Only owners of expired timers have work to do. Periodic timer
+            // ticks without expired timers run nothing.
+            port.timers.cleanup([this](int timer_id) {
+                port.pending_runs.set(timer_owner(timer_id));
+            });
         }
 
-        port.notify_tc(MsgSysUpdate{});
-
-        port.notify_pe(MsgSysUpdate{});
-        port.notify_prl(MsgSysUpdate{});
+        // With deferred delivery (Port::msg_queue), messages are delivered
+        // here, between component runs, and receivers run again. First,
+        // pick up messages sent outside of the tick.
+        port.deliver_deferred();
+        do {
+            run_if_pending(TASK_RUN_FLAG::TC, [this] { port.notify_tc(MsgSysUpdate{}); });
+            run_if_pending(TASK_RUN_FLAG::PE, [this] { port.notify_pe(MsgSysUpdate{}); });
+            run_if_pending(TASK_RUN_FLAG::PRL, [this] { port.notify_prl(MsgSysUpdate{}); });
+        } while (port.deliver_deferred());
 
         // Let's rearm timer if needed. 2 cases are possible:
         //
@@ -61,6 +93,8 @@ void Task::tick() {
 }
 
 void Task::dispatch() {
+    PD_ASSERT(driver.is_dispatch_context());
+
     do {
         // `loop()` can be called again while it is already processing events
         // (e.g. via `set_event`). The `IS_IN_TICK` flag acts as a reentrancy
@@ -89,15 +123,69 @@ void Task::start(TC& tc, IDPM& dpm, PE& pe, PRL& prl, IDriver& drv){
     pe.setup();
     dpm.setup();
     tc.setup();
+    // Startup notifications are delivered before return, as without the queue
+    port.deliver_deferred();
 
     tick_guard_flags.clear(GUARD_FLAGS::IS_IN_TICK);
 }
 
 void Task::set_event(uint32_t event_mask) {
     event_group.fetch_or(event_mask);
+
+    // Foreign threads and ISRs only leave events. The driver context picks
+    // them up on its own wakeup.
+    if (!driver.is_dispatch_context()) {
+        driver.req_dispatch();
+        return;
+    }
+    if (group) {
+        group->dispatch();
+        return;
+    }
     dispatch();
 }
 
+bool ITaskGroup::add(Task& task) {
+    if (count >= capacity) { return false; }
+    slots[count++] = &task;
+    task.group = this;
+    return true;
+}
+
+void ITaskGroup::dispatch() {
+    do {
+        // Same reentrancy guard as in Task::dispatch(). Events from nested
+        // calls are picked up by the next pass.
+        if (guard_flags.test_and_set(GUARD_FLAGS::IS_IN_DISPATCH)) {
+            guard_flags.set(GUARD_FLAGS::HAS_DEFERRED_CALL);
+            return;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            auto& task = *slots[(first + i) % count];
+
+            // Skip tasks in `start()`, and tasks owned by another context.
+            // Their events stay pending.
+            if (!task.event_group.load() ||
+                task.tick_guard_flags.test(Task::GUARD_FLAGS::IS_IN_TICK) ||
+                !task.driver.is_dispatch_context())
+            {
+                continue;
+            }
+            task.tick();
+
+            // Timer rearm in `tick()` may ask for one more run
+            if (task.tick_guard_flags.test_and_clear(Task::GUARD_FLAGS::HAS_DEFERRED_CALL)) {
+                guard_flags.set(GUARD_FLAGS::HAS_DEFERRED_CALL);
+            }
+        }
+        // Rotate the order, so that no port is always served first
+        if (count) { first = (first + 1) % count; }
+
+        guard_flags.clear(GUARD_FLAGS::IS_IN_DISPATCH);
+    } while (guard_flags.test_and_clear(GUARD_FLAGS::HAS_DEFERRED_CALL));
+}
+
 void Task_EventListener::on_receive(const MsgTask_Wakeup&) {
     task.set_event(Task::EVENT_WAKEUP_MSK);
 }
@@ -106,8 +194,4 @@ void Task_EventListener::on_receive(const MsgTask_Timer&) {
     task.set_event(Task::EVENT_TIMER_MSK);
 }
 
-void Task_EventListener::on_receive_unknown(ETL_MAYBE_UNUSED const etl::imessage& msg) {
-    TASK_LOGE("Task unknown message, ID: {}", msg.get_message_id());
-}
-
 } // namespace pd
@@ -9,18 +9,22 @@
 
 namespace pd {
 
-class Port; class Task; class TC; class IDPM; class PE; class PRL; class IDriver;
+class Port; class Task; class ITaskGroup; class TC; class IDPM; class PE; class PRL; class IDriver;
 
-using Task_EventListener_Base = etl::message_router<class Task_EventListener,
-    MsgTask_Wakeup,
-    MsgTask_Timer>;
+// Components run by Task::tick(), see Port::pending_runs
+enum class TASK_RUN_FLAG {
+    TC,
+    PE,
+    PRL,
+    _Count
+};
 
-class Task_EventListener : public Task_EventListener_Base {
+// Called directly by Port::notify_task(), see port.h
+class Task_EventListener {
 public:
     Task_EventListener(Task& task) : task(task) {}
     void on_receive(const MsgTask_Wakeup& msg);
     void on_receive(const MsgTask_Timer& msg);
-    void on_receive_unknown(const etl::imessage&);
 private:
     Task& task;
 };
@@ -42,7 +46,17 @@ public:
     static constexpr uint32_t EVENT_TIMER_MSK = 1ul << 0;
     static constexpr uint32_t EVENT_WAKEUP_MSK = 1ul << 1;
 
+    // Component runs done and skipped (no pending work), for profiling.
+    // Indexed by TASK_RUN_FLAG.
+    static constexpr size_t RUN_COUNT = static_cast<size_t>(TASK_RUN_FLAG::_Count);
+    uint32_t runs[RUN_COUNT]{};
+    uint32_t skipped_runs[RUN_COUNT]{};
+
 protected:
+    // Run the component if it has pending work
+    template <typename Fn>
+    void run_if_pending(TASK_RUN_FLAG component, Fn&& run);
+
     Port& port;
     IDriver& driver;
     etl::atomic<uint32_t> event_group{0};
@@ -55,6 +69,52 @@ protected:
     AtomicEnumBits<GUARD_FLAGS> tick_guard_flags{};
 
     Task_EventListener task_event_listener;
+
+    // Set when the task runs in a shared event loop, see ITaskGroup
+    ITaskGroup* group{nullptr};
+    friend class ITaskGroup;
+};
+
+// Runs several ports in one event loop. Joined tasks don't dispatch on
+// their own. The group ticks tasks with pending events round-robin, at
+// most once per pass, so a busy port can't starve the others. Each port
+// keeps its own timers and driver.
+class ITaskGroup {
+public:
+    ITaskGroup(const ITaskGroup&) = delete;
+    ITaskGroup& operator=(const ITaskGroup&) = delete;
+
+    // Returns false if the group is full
+    bool add(Task& task);
+    size_t size() const { return count; }
+
+    // Tick all tasks with pending events, until none left
+    void dispatch();
+
+protected:
+    ITaskGroup(Task** slots, size_t capacity) : slots{slots}, capacity{capacity} {}
+
+private:
+    Task** slots;
+    size_t capacity;
+    size_t count{0};
+    // Task to start the next pass from
+    size_t first{0};
+
+    enum class GUARD_FLAGS {
+        IS_IN_DISPATCH,
+        HAS_DEFERRED_CALL,
+        _Count
+    };
+    AtomicEnumBits<GUARD_FLAGS> guard_flags{};
+};
+
+template <size_t MaxPorts>
+class TaskGroup : public ITaskGroup {
+public:
+    TaskGroup() : ITaskGroup(storage, MaxPorts) {}
+private:
+    Task* storage[MaxPorts]{};
 };
 
 } // namespace pd
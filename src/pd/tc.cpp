@@ -51,9 +51,15 @@ public:
             if (!tc.port.timers.is_disabled(PD_TIMEOUT::TC_VBUS_DEBOUNCE)) {
                 tc.port.timers.stop(PD_TIMEOUT::TC_VBUS_DEBOUNCE);
             }
+            // Nothing to do until VBUS appears. Let the driver sleep and
+            // wake us up by VBUS interrupt only.
+            tc.set_low_power(true);
             return No_State_Change;
         }
 
+        // Timers are needed for debounce.
+        tc.set_low_power(false);
+
         if (tc.port.timers.is_disabled(PD_TIMEOUT::TC_VBUS_DEBOUNCE)) {
             tc.port.timers.start(PD_TIMEOUT::TC_VBUS_DEBOUNCE);
             return No_State_Change;
@@ -68,6 +74,7 @@ public:
 
     static void on_exit_state(TC& tc) {
         tc.port.timers.stop(PD_TIMEOUT::TC_VBUS_DEBOUNCE);
+        tc.set_low_power(false);
     }
 };
 
@@ -122,6 +129,7 @@ class TC_SINK_ATTACHED_State : public afsm::state<TC, TC_SINK_ATTACHED_State, TC
 public:
     static auto on_enter_state(TC& tc) -> state_id_t {
         tc.log_state();
+        tc.cc_detach_poll_pending = false;
         return No_State_Change;
     }
 
@@ -135,16 +143,62 @@ public:
             port.notify_dpm(MsgToDpm_CableAttached{});
         }
 
-        // TODO: Actually, we should check Safe0v. Check if we should be more
-        // strict here. In theory, active CC could also be used, but it has
-        // a lot of zeros during BMC transfers to filter out.
+        // VBUS loss is reported by the TCPC interrupt, so detach happens
+        // on the nearest tick. Note, VBUS may decay slowly after unplug,
+        // use CC polling for faster reaction.
         if (!tc.tcpc.is_vbus_ok()) {
             return TC_DETACHED;
         }
+
+        if (PD_TC_CC_DETACH_DEBOUNCE_MS > 0 && is_cc_open_debounced(tc)) {
+            TC_LOGI("CC open, detaching");
+            return TC_DETACHED;
+        }
         return No_State_Change;
     }
 
-    static void on_exit_state(TC&) {}
+    static void on_exit_state(TC& tc) {
+        tc.port.timers.stop(PD_TIMEOUT::TC_CC_DETACH_POLL);
+        tc.port.timers.stop(PD_TIMEOUT::TC_CC_DETACH_DEBOUNCE);
+    }
+
+private:
+    // Poll active CC and return true when it stays open long enough.
+    // Any non-open sample restarts the debounce, to filter out zeros
+    // during BMC transfers.
+    static bool is_cc_open_debounced(TC& tc) {
+        auto& port = tc.port;
+
+        if (!tc.cc_detach_poll_pending) {
+            if (!port.timers.is_disabled(PD_TIMEOUT::TC_CC_DETACH_POLL) &&
+                !port.timers.is_expired(PD_TIMEOUT::TC_CC_DETACH_POLL))
+            {
+                return false;
+            }
+            port.timers.stop(PD_TIMEOUT::TC_CC_DETACH_POLL);
+            tc.tcpc.req_active_cc();
+            tc.cc_detach_poll_pending = true;
+            return false;
+        }
+
+        TCPC_CC_LEVEL::Type cc;
+        if (!tc.tcpc.try_active_cc_result(cc)) { return false; }
+
+        tc.cc_detach_poll_pending = false;
+        port.timers.start(PD_TIMEOUT::TC_CC_DETACH_POLL);
+
+        if (cc != TCPC_CC_LEVEL::NONE) {
+            port.timers.stop(PD_TIMEOUT::TC_CC_DETACH_DEBOUNCE);
+            return false;
+        }
+
+        if (port.timers.is_disabled(PD_TIMEOUT::TC_CC_DETACH_DEBOUNCE)) {
+            port.timers.start(PD_TIMEOUT::TC_CC_DETACH_DEBOUNCE);
+            return false;
+        }
+
+        return port.timers.is_expired(PD_TIMEOUT::TC_CC_DETACH_DEBOUNCE);
+    }
 };
 
 using TC_STATES = afsm::state_pack<
@@ -163,17 +217,26 @@ void TC::log_state() const {
     TC_LOGI("TC state => {}", tc_state_to_desc(get_state_id()));
 }
 
+void TC::set_low_power(bool enable) {
+    if (low_power == enable) { return; }
+    low_power = enable;
+    tcpc.req_set_low_power(enable);
+}
+
 void TC::setup() {
     port.tc_rtr = &tc_event_listener;
     change_state(TC_DETACHED, true);
 }
 
 void TC_EventListener::on_receive(const MsgSysUpdate&) {
+    auto state = tc.get_state_id();
+    auto is_attached = tc.port.is_attached;
+
     tc.run();
-}
 
-void TC_EventListener::on_receive_unknown(ETL_MAYBE_UNUSED const etl::imessage& msg) {
-    TC_LOGE("TC unknown message, ID: {}", msg.get_message_id());
+    if (tc.get_state_id() != state || tc.port.is_attached != is_attached) {
+        tc.port.on_state_changed();
+    }
 }
 
 } // namespace pd
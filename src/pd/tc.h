@@ -6,20 +6,16 @@
 //
 #pragma once
 
-#include <etl/message_router.h>
-
 #include "messages.h"
 #include "utils/afsm.h"
 
 namespace pd {
 
-using TC_EventListener_Base = etl::message_router<class TC_EventListener, MsgSysUpdate>;
-
-class TC_EventListener : public TC_EventListener_Base {
+// Called directly by Port::notify_tc(), see port.h
+class TC_EventListener {
 public:
     TC_EventListener(class TC& tc) : tc(tc) {}
     void on_receive(const MsgSysUpdate& msg);
-    void on_receive_unknown(const etl::imessage& msg);
 private:
     TC& tc;
 };
@@ -35,6 +31,8 @@ public:
 
     void log_state() const;
     void setup();
+    // Request TCPC low power mode, skipping repeated calls
+    void set_low_power(bool enable);
 
     Port& port;
     ITCPC& tcpc;
@@ -42,6 +40,8 @@ public:
     // Internal variables, used from state classes
     TCPC_CC_LEVEL::Type prev_cc1{TCPC_CC_LEVEL::NONE};
     TCPC_CC_LEVEL::Type prev_cc2{TCPC_CC_LEVEL::NONE};
+    bool low_power{false};
+    bool cc_detach_poll_pending{false};
 
     TC_EventListener tc_event_listener;
 };
@@ -14,7 +14,9 @@ namespace pd {
 // Virtual Timer IDs
 namespace PD_TIMER {
     enum Type {
+        // (!) Check PD_TIMERS_RANGE after update
         TC_DEBOUNCE,
+        TC_CC_DETACH_DEBOUNCE,
 
         // (!) Check PD_TIMERS_RANGE after update
         PE_SinkWaitCapTimer,
@@ -29,7 +31,7 @@ namespace PD_TIMER {
         // (!) Check PD_TIMERS_RANGE after update
         PRL_HardResetCompleteTimer,
         PRL_ActiveCcPollingDebounce, // Custom, not PD spec
-        // PRL_CRCReceive, // All hardware now supports auto GoodCRC
+        PRL_CRCReceive, // For TCPCs without hardware GoodCRC check
         PRL_ChunkSenderResponse,
         PRL_ChunkSenderRequest,
 
@@ -41,46 +43,58 @@ namespace PD_TIMER {
 struct PD_TIMERS_RANGE {
     using Type = etl::pair<PD_TIMER::Type, PD_TIMER::Type>;
 
+    static constexpr Type TC{PD_TIMER::TC_DEBOUNCE, PD_TIMER::TC_CC_DETACH_DEBOUNCE};
     static constexpr Type PE{PD_TIMER::PE_SinkWaitCapTimer, PD_TIMER::PE_BISTContModeTimer};
     static constexpr Type PRL{PD_TIMER::PRL_HardResetCompleteTimer, PD_TIMER::PRL_ChunkSenderRequest};
 };
 
+// Slack is the tolerance of a timeout: the stack may handle it up to `slack`
+// later, to share one wakeup with other timers (with timer rearm support
+// only). Timeout + slack stays inside the spec window, with a margin.
+struct PD_TIMEOUT_VALUE {
+    PD_TIMER::Type id;
+    uint32_t period;
+    uint32_t slack{0};
+};
+
 // 6.6.22 Time Values and Timers
-// {Timer ID, Timeout in us}
+// {Timer ID, Timeout, Slack}
 //
 // Some timeouts can reuse the same timer. PD components operate with
 // PD_TIMEOUT values to hide those details.
 struct PD_TIMEOUT {
-    using Type = etl::pair<PD_TIMER::Type, uint32_t>;
+    using Type = PD_TIMEOUT_VALUE;
 
     // Custom timeouts (not from spec, for manual polarity detection)
     static constexpr Type TC_VBUS_DEBOUNCE {PD_TIMER::TC_DEBOUNCE, 100 * ms_mult}; // 100 ms
     static constexpr Type TC_CC_POLL {PD_TIMER::TC_DEBOUNCE, 20 * ms_mult}; // 20 ms
-
-    static constexpr Type tTypeCSinkWaitCap {PD_TIMER::PE_SinkWaitCapTimer, 465 * ms_mult}; // 310-620 ms
-    static constexpr Type tSenderResponse {PD_TIMER::PE_SenderResponseTimer, 30 * ms_mult}; // 27-36 ms
-    static constexpr Type tSinkRequest {PD_TIMER::PE_SinkRequestTimer, 100 * ms_mult}; // 100 ms before repeat
-    static constexpr Type tPPSRequest {PD_TIMER::PE_SinkPPSPeriodicTimer, 5000 * ms_mult}; // 10s max
+    // Active CC polling in attached state, see PD_TC_CC_DETACH_DEBOUNCE_MS
+    static constexpr Type TC_CC_DETACH_POLL {PD_TIMER::TC_DEBOUNCE, 5 * ms_mult}; // 5 ms
+    static constexpr Type TC_CC_DETACH_DEBOUNCE {PD_TIMER::TC_CC_DETACH_DEBOUNCE, PD_TC_CC_DETACH_DEBOUNCE_MS * ms_mult};
+
+    static constexpr Type tTypeCSinkWaitCap {PD_TIMER::PE_SinkWaitCapTimer, 465 * ms_mult, 100 * ms_mult}; // 310-620 ms
+    static constexpr Type tSenderResponse {PD_TIMER::PE_SenderResponseTimer, 30 * ms_mult, 3 * ms_mult}; // 27-36 ms
+    static constexpr Type tSinkRequest {PD_TIMER::PE_SinkRequestTimer, 100 * ms_mult, 20 * ms_mult}; // 100 ms before repeat
+    static constexpr Type tPPSRequest {PD_TIMER::PE_SinkPPSPeriodicTimer, 5000 * ms_mult, 3000 * ms_mult}; // 10s max
     // PS Transition timeout depends on mode
-    static constexpr Type tPSTransition_SPR {PD_TIMER::PE_PSTransitionTimer, 500 * ms_mult}; // 450-550 ms
-    static constexpr Type tPSTransition_EPR {PD_TIMER::PE_PSTransitionTimer, 925 * ms_mult}; // 830-1020 ms
-    static constexpr Type tSinkEPRKeepAlive {PD_TIMER::PE_SinkEPRKeepAliveTimer, 375 * ms_mult}; // 250-500 ms
-    static constexpr Type tEnterEPR {PD_TIMER::PE_SinkEPREnterTimer, 500 * ms_mult}; // 450-550 ms
+    static constexpr Type tPSTransition_SPR {PD_TIMER::PE_PSTransitionTimer, 500 * ms_mult, 25 * ms_mult}; // 450-550 ms
+    static constexpr Type tPSTransition_EPR {PD_TIMER::PE_PSTransitionTimer, 925 * ms_mult, 50 * ms_mult}; // 830-1020 ms
+    static constexpr Type tSinkEPRKeepAlive {PD_TIMER::PE_SinkEPRKeepAliveTimer, 375 * ms_mult, 75 * ms_mult}; // 250-500 ms
+    static constexpr Type tEnterEPR {PD_TIMER::PE_SinkEPREnterTimer, 500 * ms_mult, 25 * ms_mult}; // 450-550 ms
     static constexpr Type tBISTCarrierMode {PD_TIMER::PE_BISTContModeTimer, 300 * ms_mult}; // 300 ms before exit
 
     static constexpr Type tHardResetComplete {PD_TIMER::PRL_HardResetCompleteTimer, 5 * ms_mult}; // 4-5 ms
-    static constexpr Type tChunkSenderResponse {PD_TIMER::PRL_ChunkSenderResponse, 27 * ms_mult}; // 24-30 ms
-    static constexpr Type tChunkSenderRequest {PD_TIMER::PRL_ChunkSenderRequest, 27 * ms_mult}; // 24-30 ms
-
-    // This should be 1.0 ms, but if timer precision is only 1 ms,
-    // we use 2 ms to be sure AT LEAST 1 ms passed. That is not critical,
-    // because modern TCPCs process GoodCRC in hardware. We should probably
-    // remove this logic entirely when the drivers architecture is clearer.
-    // #if PD_TIMER_RESOLUTION_US != 0
-    //     static constexpr Type tReceive {PD_TIMER::PRL_CRCReceive, 1 * ms_mult}; // 0.9-1.1 ms
-    // #else
-    //     static constexpr Type tReceive {PD_TIMER::PRL_CRCReceive, 2 * ms_mult}; // 0.9-1.1 ms
-    // #endif
+    static constexpr Type tChunkSenderResponse {PD_TIMER::PRL_ChunkSenderResponse, 27 * ms_mult, 2 * ms_mult}; // 24-30 ms
+    static constexpr Type tChunkSenderRequest {PD_TIMER::PRL_ChunkSenderRequest, 27 * ms_mult, 2 * ms_mult}; // 24-30 ms
+
+    // Used only when TCPC can't check GoodCRC in hardware. This should be
+    // 1.0 ms, but if timer precision is only 1 ms, we use 2 ms to be sure
+    // AT LEAST 1 ms passed.
+#if PD_TIMER_RESOLUTION_US != 0
+    static constexpr Type tReceive {PD_TIMER::PRL_CRCReceive, 1 * ms_mult}; // 0.9-1.1 ms
+#else
+    static constexpr Type tReceive {PD_TIMER::PRL_CRCReceive, 2 * ms_mult}; // 0.9-1.1 ms
+#endif
 
     // CC polling timeout while waiting for the SnkTxOK level before AMS transfer.
     static constexpr Type tActiveCcPollingDebounce {PD_TIMER::PRL_ActiveCcPollingDebounce, 20 * ms_mult}; // 20 ms
@@ -95,6 +109,7 @@ public:
     using Base::stop_range;
     using Base::is_disabled;
     using Base::is_expired;
+    using Base::has_expired;
 
     void set_time_provider(const ITimer::TimeFunc func) {
         get_time_func = func;
@@ -106,20 +121,27 @@ public:
 
     void start(const PD_TIMEOUT::Type& timeout) {
         set_time(get_time()); // Update time to actual prior to proceed
-        start(timeout.first, timeout.second);
+        start(timeout.id, timeout.period, timeout.slack);
     }
 
     void stop(const PD_TIMEOUT::Type& timeout) {
-        stop(timeout.first);
+        stop(timeout.id);
     }
 
     bool is_disabled(const PD_TIMEOUT::Type& timeout) {
-        return is_disabled(timeout.first);
+        return is_disabled(timeout.id);
     }
 
     bool is_expired(const PD_TIMEOUT::Type& timeout) {
         set_time(get_time());
-        return is_expired(timeout.first);
+        return is_expired(timeout.id);
+    }
+
+    // Timer status as a value, to detect changes. 0 if disabled.
+    uint32_t get_status(PD_TIMER::Type timer_id) {
+        set_time(get_time());
+        if (is_disabled(timer_id)) { return 0; }
+        return has_expired(timer_id) ? 2 : 1;
     }
 
     uint32_t get_time() {
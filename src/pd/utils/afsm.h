@@ -14,6 +14,11 @@ static constexpr state_id_t No_State_Change = etl::ifsm_state::No_State_Change;
 static constexpr state_id_t Self_Transition = etl::ifsm_state::Self_Transition;
 static constexpr state_id_t Uninitialized = etl::integral_limits<etl::fsm_state_id_t>::max;
 
+// Wake condition of a state: reads a value the state waits on (flags,
+// timer status, driver event...). See `fsm::run()`.
+template<typename FSM>
+using wake_fn = uint32_t(*)(FSM&);
+
 namespace details {
     template<typename...>
     struct first_type;
@@ -66,6 +71,27 @@ namespace details {
         bool main_state_executed;
     };
 
+    template<typename FSM>
+    struct wake_list {
+        const wake_fn<FSM>* fns;
+        size_t count;
+    };
+
+    template<typename...>
+    struct max_wake_count;
+
+    template<>
+    struct max_wake_count<> {
+        static constexpr size_t value = 0;
+    };
+
+    template<typename First, typename... Rest>
+    struct max_wake_count<First, Rest...> {
+        static constexpr size_t value =
+            First::wake_count > max_wake_count<Rest...>::value ?
+            First::wake_count : max_wake_count<Rest...>::value;
+    };
+
 } // namespace details
 
 template<typename FSM, typename Derived>
@@ -150,6 +176,166 @@ public:
     }
 };
 
+// Dispatch backends of `fsm`, selected by its `Dispatch` parameter. The
+// behavior is the same.
+//
+// - `table_dispatch` - calls states and interceptors via function tables.
+// - `inline_dispatch` - expands the state pack into a switch per handler
+//   kind (C++17 fold expressions). States and interceptors are called
+//   directly, so small ones are inlined, and states without interceptors
+//   have no interceptor code at all. One indirect call per enter / run /
+//   exit remains, because `set_states()` selects the pack at runtime.
+//
+// The default is set by `AFSM_INLINE_DISPATCH` (0 / 1).
+struct table_dispatch {};
+
+#if __cplusplus >= 201703L
+struct inline_dispatch {};
+#endif
+
+#if !defined(AFSM_INLINE_DISPATCH)
+#define AFSM_INLINE_DISPATCH 0
+#endif
+
+#if AFSM_INLINE_DISPATCH
+    #if __cplusplus < 201703L
+        #error "AFSM_INLINE_DISPATCH requires C++17"
+    #endif
+using default_dispatch = inline_dispatch;
+#else
+using default_dispatch = table_dispatch;
+#endif
+
+#if __cplusplus >= 201703L
+namespace details {
+    template<typename...>
+    struct type_list {};
+
+    template<typename Pack>
+    struct interceptor_list;
+
+    template<typename... Interceptors>
+    struct interceptor_list<interceptor_pack<Interceptors...>> {
+        using type = type_list<Interceptors...>;
+    };
+
+    template<typename State, typename = void>
+    struct interceptors_of {
+        using type = type_list<>;
+    };
+
+    template<typename State>
+    struct interceptors_of<State, decltype(void(sizeof(typename State::interceptor_pack_type)))> {
+        using type = typename interceptor_list<typename State::interceptor_pack_type>::type;
+    };
+
+    // Interceptors exit in reverse order, skipping ones not entered
+    template<typename FSM, typename... Interceptors>
+    struct reverse_exit {
+        static void call(FSM&, size_t, size_t) {}
+    };
+
+    template<typename FSM, typename First, typename... Rest>
+    struct reverse_exit<FSM, First, Rest...> {
+        static void call(FSM& fsm, size_t index, size_t executed) {
+            reverse_exit<FSM, Rest...>::call(fsm, index + 1, executed);
+            if (index < executed) { First::_afsm_on_exit_state(fsm); }
+        }
+    };
+
+    template<typename FSM>
+    struct inline_ops {
+        enter_result (*enter)(FSM&, state_id_t);
+        state_id_t (*run)(FSM&, state_id_t, bool, uint32_t&, uint32_t&);
+        void (*exit)(FSM&, state_id_t, const enter_result*);
+    };
+
+    // Handlers of a single state, with its interceptors
+    template<typename FSM, typename State, typename Interceptors = typename interceptors_of<State>::type>
+    struct inline_state;
+
+    template<typename FSM, typename State, typename... Interceptors>
+    struct inline_state<FSM, State, type_list<Interceptors...>> {
+        static enter_result enter(FSM& fsm) {
+            enter_result result = {State::STATE_ID, 0, false};
+            state_id_t next = No_State_Change;
+
+            if (((next = Interceptors::_afsm_on_enter_state(fsm),
+                  ++result.interceptors_executed,
+                  next != No_State_Change) || ...))
+            {
+                result.next_state = next;
+                return result;
+            }
+
+            result.next_state = State::_afsm_on_enter_state(fsm);
+            result.main_state_executed = true;
+            return result;
+        }
+
+        static state_id_t run(FSM& fsm, bool run_main, uint32_t& run_calls, uint32_t& run_skips) {
+            state_id_t result = No_State_Change;
+
+            if ((((result = Interceptors::_afsm_on_run_state(fsm)) != No_State_Change) || ...)) {
+                return result;
+            }
+
+            if (!run_main) {
+                run_skips++;
+                return No_State_Change;
+            }
+            run_calls++;
+            return State::_afsm_on_run_state(fsm);
+        }
+
+        static void exit(FSM& fsm, const enter_result* rollback_info) {
+            size_t interceptors_executed = sizeof...(Interceptors);
+
+            if (rollback_info) {
+                // If enter "transaction" was incomplete, do symmetric rollback
+                if (rollback_info->main_state_executed) { State::_afsm_on_exit_state(fsm); }
+                interceptors_executed = rollback_info->interceptors_executed;
+            } else {
+                State::_afsm_on_exit_state(fsm);
+            }
+
+            reverse_exit<FSM, Interceptors...>::call(fsm, 0, interceptors_executed);
+        }
+    };
+
+    // Switch over state ids. Ids are sequential, so compilers build a jump
+    // table or a compare chain, whatever is smaller.
+    template<typename FSM, typename... States>
+    struct inline_switch {
+        static enter_result enter(FSM& fsm, state_id_t state_id) {
+            enter_result result = {state_id, 0, false};
+            (void)((state_id == States::STATE_ID &&
+                    (result = inline_state<FSM, States>::enter(fsm), true)) || ...);
+            return result;
+        }
+
+        static state_id_t run(FSM& fsm, state_id_t state_id, bool run_main,
+                              uint32_t& run_calls, uint32_t& run_skips)
+        {
+            state_id_t result = No_State_Change;
+            (void)((state_id == States::STATE_ID &&
+                    (result = inline_state<FSM, States>::run(fsm, run_main, run_calls, run_skips), true)) || ...);
+            return result;
+        }
+
+        static void exit(FSM& fsm, state_id_t state_id, const enter_result* rollback_info) {
+            (void)((state_id == States::STATE_ID &&
+                    (inline_state<FSM, States>::exit(fsm, rollback_info), true)) || ...);
+        }
+
+        static const inline_ops<FSM>* get_ops() {
+            static constexpr inline_ops<FSM> ops = { &enter, &run, &exit };
+            return &ops;
+        }
+    };
+} // namespace details
+#endif
+
 template<typename... States>
 class state_pack : public pack_base<States...> {
 public:
@@ -164,6 +350,47 @@ public:
 
     static constexpr size_t state_count = pack_base<States...>::element_count;
 
+    using FSMType = typename pack_base<States...>::FirstElement::FSMType;
+    using wake_list_type = details::wake_list<FSMType>;
+
+    // States may declare wake conditions:
+    //
+    //   static constexpr afsm::wake_fn<FSM> wake_on[] = { ... };
+    template<typename State>
+    struct wake_extractor {
+        template<typename T>
+        static auto test(int) -> decltype(T::wake_on[0], etl::true_type{});
+        template<typename>
+        static etl::false_type test(...);
+
+        static constexpr bool has_wake_on = decltype(test<State>(0))::value;
+
+        template<typename T, bool HasWakeOn>
+        struct impl {
+            static constexpr size_t wake_count = 0;
+            static constexpr wake_list_type extract() { return {nullptr, 0}; }
+        };
+
+        template<typename T>
+        struct impl<T, true> {
+            static constexpr size_t wake_count = sizeof(T::wake_on) / sizeof(T::wake_on[0]);
+            static constexpr wake_list_type extract() { return {T::wake_on, wake_count}; }
+        };
+
+        using type = impl<State, has_wake_on>;
+        static constexpr size_t wake_count = type::wake_count;
+    };
+
+    static constexpr size_t max_wake_count =
+        details::max_wake_count<wake_extractor<States>...>::value;
+
+    static const wake_list_type* get_wake_table() {
+        static const wake_list_type table[state_count] = {
+            wake_extractor<States>::type::extract()...
+        };
+        return table;
+    }
+
     template<typename State>
     struct has_interceptors {
         template<typename T>
@@ -203,93 +430,205 @@ public:
     static constexpr size_t get_state_count() {
         return state_count;
     }
+
+#if __cplusplus >= 201703L
+    static const details::inline_ops<FSMType>* get_inline_ops() {
+        return details::inline_switch<FSMType, States...>::get_ops();
+    }
+#endif
 };
 
-template<typename FSMImpl>
+namespace details {
+    template<typename FSM, typename Dispatch>
+    class dispatcher;
+
+    template<typename FSM>
+    class dispatcher<FSM, table_dispatch> {
+    public:
+        using on_enter_fn = state_id_t(*)(FSM&);
+        using on_run_fn = state_id_t(*)(FSM&);
+        using on_exit_fn = void(*)(FSM&);
+
+        template<typename StatePack>
+        void bind() {
+            enter_table = StatePack::get_enter_table();
+            run_table = StatePack::get_run_table();
+            exit_table = StatePack::get_exit_table();
+            interceptor_table = StatePack::get_interceptor_table();
+        }
+
+        enter_result enter(FSM& fsm, state_id_t state_id) const {
+            enter_result result = {state_id, 0, false};
+
+            if (interceptor_table[state_id]) {
+                const auto& pack = *interceptor_table[state_id];
+                auto enter_table_interceptors = static_cast<const on_enter_fn*>(pack.enter_table);
+
+                for (size_t i = 0; i < pack.element_count; ++i) {
+                    auto transition_result = enter_table_interceptors[i](fsm);
+                    if (transition_result != No_State_Change) {
+                        result.next_state = transition_result;
+                        result.interceptors_executed = i + 1;
+                        return result;
+                    }
+                }
+                result.interceptors_executed = pack.element_count;
+            }
+
+            result.next_state = enter_table[state_id](fsm);
+            result.main_state_executed = true;
+
+            return result;
+        }
+
+        state_id_t run(FSM& fsm, state_id_t state_id, bool run_main,
+                       uint32_t& run_calls, uint32_t& run_skips) const
+        {
+            if (interceptor_table[state_id]) {
+                const auto& pack = *interceptor_table[state_id];
+                auto run_table_interceptors = static_cast<const on_run_fn*>(pack.run_table);
+
+                for (size_t i = 0; i < pack.element_count; ++i) {
+                    auto result = run_table_interceptors[i](fsm);
+                    if (result != No_State_Change) {
+                        return result;
+                    }
+                }
+            }
+
+            if (!run_main) {
+                run_skips++;
+                return No_State_Change;
+            }
+            run_calls++;
+            return run_table[state_id](fsm);
+        }
+
+        void exit(FSM& fsm, state_id_t state_id, const enter_result* rollback_info) const {
+            if (rollback_info) {
+                // If enter "transaction" was incomplete, do symmetric rollback
+                if (rollback_info->main_state_executed) {
+                    exit_table[state_id](fsm);
+                }
+
+                if (interceptor_table[state_id] && rollback_info->interceptors_executed > 0) {
+                    const auto& pack = *interceptor_table[state_id];
+                    auto exit_table_interceptors = static_cast<const on_exit_fn*>(pack.exit_table);
+
+                    for (size_t i = rollback_info->interceptors_executed; i > 0; --i) {
+                        exit_table_interceptors[i-1](fsm);
+                    }
+                }
+            } else {
+                exit_table[state_id](fsm);
+                if (interceptor_table[state_id]) {
+                    const auto& pack = *interceptor_table[state_id];
+                    auto exit_table_interceptors = static_cast<const on_exit_fn*>(pack.exit_table);
+
+                    for (size_t i = pack.element_count; i > 0; --i) {
+                        exit_table_interceptors[i-1](fsm);
+                    }
+                }
+            }
+        }
+
+    private:
+        const on_enter_fn* enter_table = nullptr;
+        const on_run_fn* run_table = nullptr;
+        const on_exit_fn* exit_table = nullptr;
+        const interceptor_pack_interface* const* interceptor_table = nullptr;
+    };
+
+#if __cplusplus >= 201703L
+    template<typename FSM>
+    class dispatcher<FSM, inline_dispatch> {
+    public:
+        template<typename StatePack>
+        void bind() { ops = StatePack::get_inline_ops(); }
+
+        enter_result enter(FSM& fsm, state_id_t state_id) const {
+            return ops->enter(fsm, state_id);
+        }
+
+        state_id_t run(FSM& fsm, state_id_t state_id, bool run_main,
+                       uint32_t& run_calls, uint32_t& run_skips) const
+        {
+            return ops->run(fsm, state_id, run_main, run_calls, run_skips);
+        }
+
+        void exit(FSM& fsm, state_id_t state_id, const enter_result* rollback_info) const {
+            ops->exit(fsm, state_id, rollback_info);
+        }
+
+    private:
+        const inline_ops<FSM>* ops = nullptr;
+    };
+#endif
+} // namespace details
+
+// `WakeSlots` - max number of wake conditions per state (see `run()`).
+// 0 disables them, without RAM overhead.
+//
+// `Dispatch` - how states are called, `table_dispatch` or `inline_dispatch`.
+template<typename FSMImpl, size_t WakeSlots = 0, typename Dispatch = default_dispatch>
 class fsm {
 public:
     using on_enter_fn = state_id_t(*)(FSMImpl&);
     using on_run_fn = state_id_t(*)(FSMImpl&);
     using on_exit_fn = void(*)(FSMImpl&);
 
+    // `on_run_state` calls done and skipped by wake conditions
+    uint32_t run_calls{0};
+    uint32_t run_skips{0};
+
 private:
-    const on_enter_fn* enter_table = nullptr;
-    const on_run_fn* run_table = nullptr;
-    const on_exit_fn* exit_table = nullptr;
-    const details::interceptor_pack_interface* const* interceptor_table = nullptr;
+    details::dispatcher<FSMImpl, Dispatch> dispatcher;
+    const details::wake_list<FSMImpl>* wake_table = nullptr;
 
     size_t state_count{0};
     state_id_t current_state_id{Uninitialized};
     state_id_t previous_state_id{Uninitialized};
     bool is_busy{false};
 
-    FSMImpl& impl() { return static_cast<FSMImpl&>(*this); }
+    // Values of wake conditions after the last `on_run_state`
+    uint32_t wake_values[WakeSlots > 0 ? WakeSlots : 1]{};
+    bool wake_armed{false};
 
-    details::enter_result execute_enter(state_id_t state_id) {
-        details::enter_result result = {state_id, 0, false};
-
-        if (interceptor_table[state_id]) {
-            const auto& pack = *interceptor_table[state_id];
-            auto enter_table_interceptors = static_cast<const on_enter_fn*>(pack.enter_table);
-
-            for (size_t i = 0; i < pack.element_count; ++i) {
-                auto transition_result = enter_table_interceptors[i](impl());
-                if (transition_result != No_State_Change) {
-                    result.next_state = transition_result;
-                    result.interceptors_executed = i + 1;
-                    return result;
-                }
-            }
-            result.interceptors_executed = pack.element_count;
-        }
+    FSMImpl& impl() { return static_cast<FSMImpl&>(*this); }
 
-        result.next_state = enter_table[state_id](impl());
-        result.main_state_executed = true;
+    // The state waits, and none of its wake conditions changed
+    bool is_sleeping() {
+        if (WakeSlots == 0 || !wake_armed) { return false; }
 
-        return result;
+        const auto& list = wake_table[current_state_id];
+        for (size_t i = 0; i < list.count; ++i) {
+            if (list.fns[i](impl()) != wake_values[i]) { return false; }
+        }
+        return true;
     }
 
-    state_id_t execute_run(state_id_t state_id) {
-        if (interceptor_table[state_id]) {
-            const auto& pack = *interceptor_table[state_id];
-            auto run_table_interceptors = static_cast<const on_run_fn*>(pack.run_table);
+    void arm_wake() {
+        if (WakeSlots == 0) { return; }
 
-            for (size_t i = 0; i < pack.element_count; ++i) {
-                auto result = run_table_interceptors[i](impl());
-                if (result != No_State_Change) {
-                    return result;
-                }
-            }
+        const auto& list = wake_table[current_state_id];
+        if (!list.count) { return; }
+
+        for (size_t i = 0; i < list.count; ++i) {
+            wake_values[i] = list.fns[i](impl());
         }
-        return run_table[state_id](impl());
+        wake_armed = true;
     }
 
-    void execute_exit(state_id_t state_id, const details::enter_result* rollback_info = nullptr) {
-        if (rollback_info) {
-            // If enter "transaction" was incomplete, do symmetric rollback
-            if (rollback_info->main_state_executed) {
-                exit_table[state_id](impl());
-            }
-
-            if (interceptor_table[state_id] && rollback_info->interceptors_executed > 0) {
-                const auto& pack = *interceptor_table[state_id];
-                auto exit_table_interceptors = static_cast<const on_exit_fn*>(pack.exit_table);
+    details::enter_result execute_enter(state_id_t state_id) {
+        return dispatcher.enter(impl(), state_id);
+    }
 
-                for (size_t i = rollback_info->interceptors_executed; i > 0; --i) {
-                    exit_table_interceptors[i-1](impl());
-                }
-            }
-        } else {
-            exit_table[state_id](impl());
-            if (interceptor_table[state_id]) {
-                const auto& pack = *interceptor_table[state_id];
-                auto exit_table_interceptors = static_cast<const on_exit_fn*>(pack.exit_table);
+    state_id_t execute_run(state_id_t state_id, bool run_main) {
+        return dispatcher.run(impl(), state_id, run_main, run_calls, run_skips);
+    }
 
-                for (size_t i = pack.element_count; i > 0; --i) {
-                    exit_table_interceptors[i-1](impl());
-                }
-            }
-        }
+    void execute_exit(state_id_t state_id, const details::enter_result* rollback_info = nullptr) {
+        dispatcher.exit(impl(), state_id, rollback_info);
     }
 
 public:
@@ -297,11 +636,11 @@ public:
     void set_states(state_id_t initial = Uninitialized) {
         static_assert(etl::is_same<FSMImpl, typename StatePack::FirstElement::FSMType>::value,
                     "StatePack FSMType must match fsm FSMImpl type");
+        static_assert(StatePack::max_wake_count <= WakeSlots,
+                    "Not enough WakeSlots for state wake conditions");
 
-        enter_table = StatePack::get_enter_table();
-        run_table = StatePack::get_run_table();
-        exit_table = StatePack::get_exit_table();
-        interceptor_table = StatePack::get_interceptor_table();
+        dispatcher.template bind<StatePack>();
+        wake_table = StatePack::get_wake_table();
         state_count = StatePack::get_state_count();
 
         current_state_id = Uninitialized;
@@ -322,6 +661,17 @@ public:
         return previous_state_id;
     }
 
+    // Drop wake conditions of the current state, to call `on_run_state`
+    // on the next run.
+    void wake() { wake_armed = false; }
+
+    // Calls `on_run_state` of the current state (after interceptors).
+    //
+    // If the state declares wake conditions (`wake_on`), their values are
+    // saved after each `on_run_state` without transition. Until any of them
+    // changes, `on_run_state` is skipped (interceptors still run). So wake
+    // conditions must cover everything `on_run_state` checks. Conditions are
+    // dropped on state change.
     void run() {
         if (is_busy) {
             struct run_recursion_err : etl::exception {
@@ -337,14 +687,18 @@ public:
 
         if (current_state_id >= state_count) { return; }
 
+        const bool sleeping = is_sleeping();
+
         is_busy = true;
-        auto result = execute_run(current_state_id);
+        auto result = execute_run(current_state_id, !sleeping);
         is_busy = false;
 
         if (result == Self_Transition) {
             change_state(current_state_id, true);
         } else if (result < state_count && result != current_state_id) {
             change_state(result);
+        } else if (!sleeping) {
+            arm_wake();
         }
     }
 
@@ -361,6 +715,8 @@ public:
             return;
         }
 
+        wake_armed = false;
+
         if (new_state_id == Uninitialized) {
             if (current_state_id < state_count) {
                 previous_state_id = current_state_id;
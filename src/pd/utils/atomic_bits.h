@@ -96,6 +96,54 @@ public:
         }
     }
 
+    // Raw value of a storage word. Used to detect changes of the whole set.
+    StorageType load_word(size_t storageIndex = 0) const {
+        if (storageIndex >= STORAGE_SIZE) return 0;
+        return storage[storageIndex].load(etl::memory_order_acquire);
+    }
+
+    //
+    // Word operations. Bits of `mask` are checked / changed at once, with a
+    // single atomic operation, so combinations are never torn. Bit N of the
+    // mask is bit (N + storageIndex * BITS_PER_STORAGE) of the set.
+    //
+
+    bool test_any(StorageType mask, size_t storageIndex = 0) const {
+        return (load_word(storageIndex) & mask) != 0;
+    }
+
+    bool test_all(StorageType mask, size_t storageIndex = 0) const {
+        return (load_word(storageIndex) & mask) == mask;
+    }
+
+    // Bits of `mask` have exactly the `expected` values
+    bool test_match(StorageType mask, StorageType expected, size_t storageIndex = 0) const {
+        return (load_word(storageIndex) & mask) == expected;
+    }
+
+    // Returns previous values of the changed bits
+    StorageType fetch_and_set(StorageType mask, size_t storageIndex = 0) {
+        if (storageIndex >= STORAGE_SIZE) return 0;
+        // acq_rel: same as test_and_set()
+        return storage[storageIndex].fetch_or(mask, etl::memory_order_acq_rel) & mask;
+    }
+
+    StorageType fetch_and_clear(StorageType mask, size_t storageIndex = 0) {
+        if (storageIndex >= STORAGE_SIZE) return 0;
+        // acq_rel: same as test_and_clear()
+        return storage[storageIndex].fetch_and(~mask, etl::memory_order_acq_rel) & mask;
+    }
+
+    // Replace the word if it still has the `expected` value. Otherwise,
+    // `expected` gets the current value. For multi-bit transitions, like
+    // "set A only if B is clear".
+    bool compare_exchange(StorageType& expected, StorageType desired, size_t storageIndex = 0) {
+        if (storageIndex >= STORAGE_SIZE) return false;
+        // acq_rel on success, acquire on failure: as for other RMW operations
+        return storage[storageIndex].compare_exchange_strong(expected, desired,
+            etl::memory_order_acq_rel, etl::memory_order_acquire);
+    }
+
 private:
     etl::array<etl::atomic<StorageType>, STORAGE_SIZE> storage;
 };
@@ -4,6 +4,10 @@
 
 // Strictly typed variant of AtomicBits for enum classes.
 // When you have a lot of enums, this helps to avoid mistakes.
+//
+// Multi-flag operations take masks (see `mask()`), and are limited to sets
+// of up to 32 flags. Those are single atomic operations, so flag
+// combinations are always consistent.
 template<typename E>
 class AtomicEnumBits
 {
@@ -12,6 +16,10 @@ class AtomicEnumBits
 
     AtomicBits<NumBits> bits_;
 
+    static constexpr void check_mask_size() {
+        static_assert(NumBits <= 32, "Too many flags for mask operations");
+    }
+
 public:
     void set(E f) noexcept { bits_.set(static_cast<size_t>(f)); }
     void clear(E f) noexcept { bits_.clear(static_cast<size_t>(f)); }
@@ -21,4 +29,38 @@ public:
 
     void set_all() noexcept { bits_.set_all(); }
     void clear_all() noexcept { bits_.clear_all(); }
+
+    // Mask of flags, for operations below and to compare with `snapshot()`
+    template<typename... Flags>
+    static constexpr uint32_t mask(Flags... flags) noexcept {
+        check_mask_size();
+        static_assert((etl::is_same<Flags, E>::value && ... && true), "Flags must be of the set type");
+        return ((1u << static_cast<size_t>(flags)) | ... | 0u);
+    }
+
+    // All flags as a single value, to detect changes, or to check several
+    // flags in one consistent view.
+    uint32_t snapshot() const noexcept {
+        check_mask_size();
+        return bits_.load_word(0);
+    }
+
+    bool test_any(uint32_t mask) const noexcept { check_mask_size(); return bits_.test_any(mask); }
+    bool test_all(uint32_t mask) const noexcept { check_mask_size(); return bits_.test_all(mask); }
+    // Flags of `mask` have exactly the `expected` values
+    bool test_match(uint32_t mask, uint32_t expected) const noexcept {
+        check_mask_size();
+        return bits_.test_match(mask, expected);
+    }
+
+    // Set / clear flags of `mask`, return their previous values
+    uint32_t fetch_and_set(uint32_t mask) noexcept { check_mask_size(); return bits_.fetch_and_set(mask); }
+    uint32_t fetch_and_clear(uint32_t mask) noexcept { check_mask_size(); return bits_.fetch_and_clear(mask); }
+
+    // Replace all flags, if they still have the `expected` value. Otherwise,
+    // `expected` gets the current value.
+    bool compare_exchange(uint32_t& expected, uint32_t desired) noexcept {
+        check_mask_size();
+        return bits_.compare_exchange(expected, desired);
+    }
 };
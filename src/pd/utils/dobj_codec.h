@@ -0,0 +1,297 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../data_objects.h"
+
+namespace pd {
+
+//
+// constexpr encode / decode of PD data objects, with explicit shifts and
+// masks. Unlike the bitfield unions in data_objects.h, the layout does not
+// depend on the compiler, and values can be built at compile time:
+//
+//   constexpr uint32_t pdo = dobj::snk_pdo_fixed::encode(9000, 3000);
+//   static_assert(dobj::pdo_fixed::voltage::get(pdo) == 9000 / 50, "");
+//   auto rdo = dobj::rdo::obj_position::set(rdo, 2);
+//
+// Field names follow the unions. Raw field values are in spec units, see
+// comments; `encode()` / `*_mv()` / `*_ma()` helpers convert from/to mV
+// and mA.
+//
+namespace dobj {
+
+template <unsigned Shift, unsigned Width, typename T = uint32_t>
+struct field {
+    static_assert(Width > 0 && Shift + Width <= sizeof(T) * 8, "Field out of range");
+
+    static constexpr T MASK = T((uint64_t(1) << Width) - 1);
+
+    static constexpr uint32_t get(T raw) { return uint32_t(raw >> Shift) & MASK; }
+    // Values that do not fit are truncated, as with bitfields
+    static constexpr T set(T raw, uint32_t value) {
+        return T((raw & T(~(MASK << Shift))) | (T(value & MASK) << Shift));
+    }
+    static constexpr T make(uint32_t value) { return set(0, value); }
+};
+
+template <unsigned Bit, typename T = uint32_t>
+using flag = field<Bit, 1, T>;
+
+//
+// [rev3.2] 6.4.1 Power Data Objects, common part
+//
+using pdo_type = field<30, 2>; // PDO_TYPE
+using apdo_subtype = field<28, 2>; // PDO_AUGMENTED_SUBTYPE, APDO only
+
+constexpr PDO_VARIANT get_pdo_variant(uint32_t pdo) {
+    if (pdo == 0) { return PDO_VARIANT::UNKNOWN; }
+    if (pdo_type::get(pdo) == PDO_TYPE::FIXED) { return PDO_VARIANT::FIXED; }
+    if (pdo_type::get(pdo) == PDO_TYPE::AUGMENTED) {
+        switch (apdo_subtype::get(pdo)) {
+            case PDO_AUGMENTED_SUBTYPE::SPR_PPS: return PDO_VARIANT::APDO_PPS;
+            case PDO_AUGMENTED_SUBTYPE::SPR_AVS: return PDO_VARIANT::APDO_SPR_AVS;
+            case PDO_AUGMENTED_SUBTYPE::EPR_AVS: return PDO_VARIANT::APDO_EPR_AVS;
+            default: break;
+        }
+    }
+    return PDO_VARIANT::UNKNOWN;
+}
+
+// Type + subtype bits of a variant, other fields zero
+constexpr uint32_t make_pdo_variant_bits(PDO_VARIANT id) {
+    switch (id) {
+        case PDO_VARIANT::FIXED:
+            return pdo_type::make(PDO_TYPE::FIXED);
+        case PDO_VARIANT::APDO_PPS:
+            return pdo_type::make(PDO_TYPE::AUGMENTED) | apdo_subtype::make(PDO_AUGMENTED_SUBTYPE::SPR_PPS);
+        case PDO_VARIANT::APDO_SPR_AVS:
+            return pdo_type::make(PDO_TYPE::AUGMENTED) | apdo_subtype::make(PDO_AUGMENTED_SUBTYPE::SPR_AVS);
+        case PDO_VARIANT::APDO_EPR_AVS:
+            return pdo_type::make(PDO_TYPE::AUGMENTED) | apdo_subtype::make(PDO_AUGMENTED_SUBTYPE::EPR_AVS);
+        default:
+            return 0;
+    }
+}
+
+// [rev3.2] Table 6.9 Fixed Supply PDO - Source
+namespace pdo_fixed {
+    using max_current = field<0, 10>; // 10ma step
+    using voltage = field<10, 10>; // 50mv step
+    using peak_current = field<20, 2>;
+    using epr_capable = flag<23>;
+    using unchunked_ext_msg_supported = flag<24>;
+    using dual_role_data = flag<25>;
+    using usb_comms_capable = flag<26>;
+    using unconstrained_power = flag<27>;
+    using usb_suspend_supported = flag<28>;
+    using dual_role_power = flag<29>;
+
+    constexpr uint32_t get_mv(uint32_t pdo) { return voltage::get(pdo) * 50u; }
+    constexpr uint32_t get_ma(uint32_t pdo) { return max_current::get(pdo) * 10u; }
+
+    constexpr uint32_t encode(uint32_t mv, uint32_t ma) {
+        return make_pdo_variant_bits(PDO_VARIANT::FIXED) | voltage::make(mv / 50u) | max_current::make(ma / 10u);
+    }
+} // namespace pdo_fixed
+
+// [rev3.2] Table 6.13 SPR Programmable Power Supply APDO - Source
+namespace pdo_spr_pps {
+    using max_current = field<0, 7>; // 50ma step
+    using min_voltage = field<8, 8>; // 100mv step
+    using max_voltage = field<17, 8>; // 100mv step
+    using pps_power_limited = flag<27>;
+
+    constexpr uint32_t get_mv_min(uint32_t pdo) { return min_voltage::get(pdo) * 100u; }
+    constexpr uint32_t get_mv_max(uint32_t pdo) { return max_voltage::get(pdo) * 100u; }
+    constexpr uint32_t get_ma(uint32_t pdo) { return max_current::get(pdo) * 50u; }
+
+    constexpr uint32_t encode(uint32_t mv_min, uint32_t mv_max, uint32_t ma) {
+        return make_pdo_variant_bits(PDO_VARIANT::APDO_PPS) |
+            min_voltage::make(mv_min / 100u) | max_voltage::make(mv_max / 100u) | max_current::make(ma / 50u);
+    }
+} // namespace pdo_spr_pps
+
+// [rev3.2] Table 6.14 SPR Adjustable Voltage Supply APDO - Source
+namespace pdo_spr_avs {
+    using max_current_20v = field<0, 10>; // 15-20V range, 10ma step
+    using max_current_15v = field<10, 10>; // 9-15V range, 10ma step
+    using peak_current = field<26, 2>;
+
+    constexpr uint32_t encode(uint32_t ma_15v, uint32_t ma_20v) {
+        return make_pdo_variant_bits(PDO_VARIANT::APDO_SPR_AVS) |
+            max_current_15v::make(ma_15v / 10u) | max_current_20v::make(ma_20v / 10u);
+    }
+} // namespace pdo_spr_avs
+
+// [rev3.2] Table 6.15 EPR Adjustable Voltage Supply APDO - Source
+namespace pdo_epr_avs {
+    using pdp = field<0, 8>; // 1W step
+    using min_voltage = field<8, 8>; // 100mv step
+    using max_voltage = field<17, 9>; // 100mv step
+    using peak_current = field<26, 2>;
+
+    constexpr uint32_t get_mv_min(uint32_t pdo) { return min_voltage::get(pdo) * 100u; }
+    constexpr uint32_t get_mv_max(uint32_t pdo) { return max_voltage::get(pdo) * 100u; }
+
+    constexpr uint32_t encode(uint32_t mv_min, uint32_t mv_max, uint32_t watts) {
+        return make_pdo_variant_bits(PDO_VARIANT::APDO_EPR_AVS) |
+            min_voltage::make(mv_min / 100u) | max_voltage::make(mv_max / 100u) | pdp::make(watts);
+    }
+} // namespace pdo_epr_avs
+
+// [rev3.2] Table 6.17 Fixed Supply PDO - Sink
+namespace snk_pdo_fixed {
+    using max_current = pdo_fixed::max_current; // 10ma step
+    using voltage = pdo_fixed::voltage; // 50mv step
+    using frs_required = field<23, 2>;
+    using dual_role_data = flag<25>;
+    using usb_comms_capable = flag<26>;
+    using unconstrained_power = flag<27>;
+    using higher_capability = flag<28>;
+    using dual_role_power = flag<29>;
+
+    constexpr uint32_t encode(uint32_t mv, uint32_t ma) { return pdo_fixed::encode(mv, ma); }
+} // namespace snk_pdo_fixed
+
+// [rev3.2] Table 6.20 SPR Programmable Power Supply APDO - Sink
+namespace snk_pdo_spr_pps {
+    using max_current = pdo_spr_pps::max_current; // 50ma step
+    using min_voltage = pdo_spr_pps::min_voltage; // 100mv step
+    using max_voltage = pdo_spr_pps::max_voltage; // 100mv step
+
+    constexpr uint32_t encode(uint32_t mv_min, uint32_t mv_max, uint32_t ma) {
+        return pdo_spr_pps::encode(mv_min, mv_max, ma);
+    }
+} // namespace snk_pdo_spr_pps
+
+// [rev3.2] Table 6.21 SPR Adjustable Voltage Supply APDO - Sink
+namespace snk_pdo_spr_avs {
+    using max_current_20v = pdo_spr_avs::max_current_20v; // 10ma step
+    using max_current_15v = pdo_spr_avs::max_current_15v; // 10ma step
+
+    constexpr uint32_t encode(uint32_t ma_15v, uint32_t ma_20v) { return pdo_spr_avs::encode(ma_15v, ma_20v); }
+} // namespace snk_pdo_spr_avs
+
+// [rev3.2] Table 6.22 EPR Adjustable Voltage Supply APDO - Sink
+namespace snk_pdo_epr_avs {
+    using pdp = pdo_epr_avs::pdp; // 1W step
+    using min_voltage = pdo_epr_avs::min_voltage; // 100mv step
+    using max_voltage = pdo_epr_avs::max_voltage; // 100mv step
+
+    constexpr uint32_t encode(uint32_t mv_min, uint32_t mv_max, uint32_t watts) {
+        return pdo_epr_avs::encode(mv_min, mv_max, watts);
+    }
+} // namespace snk_pdo_epr_avs
+
+//
+// [rev3.2] 6.4.2 Request Data Objects
+//
+
+// Common part of all RDOs
+namespace rdo {
+    using epr_capable = flag<22>;
+    using unchunked_ext_msg_supported = flag<23>;
+    using no_usb_suspend = flag<24>;
+    using usb_comm_capable = flag<25>;
+    using capability_mismatch = flag<26>;
+    using obj_position = field<28, 4>; // !!! numeration starts from 1 !!!
+} // namespace rdo
+
+// [rev3.2] Table 6.23 Fixed and Variable RDO
+namespace rdo_fixed {
+    using max_current = field<0, 10>; // 10ma step
+    using operating_current = field<10, 10>; // 10ma step
+
+    constexpr uint32_t set_limits(uint32_t rdo, uint32_t operating_ma, uint32_t max_ma) {
+        return operating_current::set(max_current::set(rdo, max_ma / 10u), operating_ma / 10u);
+    }
+} // namespace rdo_fixed
+
+// [rev3.2] Table 6.25 PPS RDO
+namespace rdo_pps {
+    using operating_current = field<0, 7>; // 50ma step
+    using output_voltage = field<9, 12>; // 20mv step
+
+    constexpr uint32_t set_limits(uint32_t rdo, uint32_t mv, uint32_t ma) {
+        return operating_current::set(output_voltage::set(rdo, mv / 20u), ma / 50u);
+    }
+} // namespace rdo_pps
+
+// [rev3.2] Table 6.26 AVS RDO
+namespace rdo_avs {
+    using operating_current = field<0, 7>; // 50ma step
+    using output_voltage = field<9, 12>; // 25mv step, least 2 bits MUST be 00
+
+    constexpr uint32_t set_limits(uint32_t rdo, uint32_t mv, uint32_t ma) {
+        // The spec says the step is 25 mV, but the two least significant bits must be zero
+        return operating_current::set(output_voltage::set(rdo, (mv / 100u) << 2), ma / 50u);
+    }
+} // namespace rdo_avs
+
+//
+// Other data objects
+//
+
+// [rev3.2] 6.2.1.1 Message Header
+namespace header {
+    using message_type = field<0, 5, uint16_t>;
+    using port_data_role = flag<5, uint16_t>;
+    using spec_revision = field<6, 2, uint16_t>;
+    using port_power_role = flag<8, uint16_t>;
+    using message_id = field<9, 3, uint16_t>;
+    using data_obj_count = field<12, 3, uint16_t>;
+    using extended = flag<15, uint16_t>;
+} // namespace header
+
+// [rev3.2] 6.2.1.2 Extended Message Header
+namespace ext_header {
+    using data_size = field<0, 9, uint16_t>;
+    using request_chunk = flag<10, uint16_t>;
+    using chunk_number = field<11, 4, uint16_t>;
+    using chunked = flag<15, uint16_t>;
+} // namespace ext_header
+
+// [rev3.2] 6.4.6 Alert Message, Table 6.44
+namespace alert {
+    using ext_type = field<0, 4>;
+    using hot_swappable_batteries = field<16, 4>;
+    using fixed_batteries = field<20, 4>;
+    using battery_status_change = flag<25>;
+    using ocp = flag<26>;
+    using otp = flag<27>;
+    using operating_condition_change = flag<28>;
+    using source_input_change = flag<29>;
+    using ovp = flag<30>;
+    using extended = flag<31>;
+} // namespace alert
+
+// [rev3.2] Table 6.50 EPR Mode Data Object
+namespace eprmdo {
+    using data = field<16, 8>;
+    using action = field<24, 8>; // EPR_MODE_ACTION
+
+    constexpr uint32_t encode(uint32_t act, uint32_t value) { return action::make(act) | data::make(value); }
+} // namespace eprmdo
+
+// [rev3.2] 6.5.14 Extended Control Data Block
+namespace ecdb {
+    using type = field<0, 8, uint16_t>; // PD_EXT_CTRL_MSGT
+    using data = field<8, 8, uint16_t>;
+} // namespace ecdb
+
+// [rev3.2] Table 6.52 Revision Message Data Object
+namespace rmdo {
+    using ver_minor = field<16, 4>;
+    using ver_major = field<20, 4>;
+    using rev_minor = field<24, 4>;
+    using rev_major = field<28, 4>;
+} // namespace rmdo
+
+// [rev3.2] 6.4.3 BIST Data Object
+namespace bistdo {
+    using mode = field<28, 4>; // BIST_MODE
+} // namespace bistdo
+
+} // namespace dobj
+} // namespace pd
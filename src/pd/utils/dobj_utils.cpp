@@ -3,44 +3,33 @@
 namespace pd {
 namespace dobj_utils {
 
-PDO_VARIANT get_src_pdo_variant(uint32_t src_pdo) {
-    if (src_pdo == 0) { return PDO_VARIANT::UNKNOWN; }
-    PDO_EPR_AVS pdo{src_pdo}; // Use this type to just access high bits
-    if (pdo.pdo_type == PDO_TYPE::FIXED) { return PDO_VARIANT::FIXED; }
-    if (pdo.pdo_type == PDO_TYPE::AUGMENTED) {
-        if (pdo.apdo_subtype == PDO_AUGMENTED_SUBTYPE::SPR_PPS) { return PDO_VARIANT::APDO_PPS; }
-        if (pdo.apdo_subtype == PDO_AUGMENTED_SUBTYPE::SPR_AVS) { return PDO_VARIANT::APDO_SPR_AVS; }
-        if (pdo.apdo_subtype == PDO_AUGMENTED_SUBTYPE::EPR_AVS) { return PDO_VARIANT::APDO_EPR_AVS; }
-    }
-    return PDO_VARIANT::UNKNOWN;
+PDO_LIMITS get_src_pdo_limits(uint32_t src_pdo) {
+    return get_src_pdo_limits(src_pdo, get_src_pdo_variant(src_pdo));
 }
 
-PDO_LIMITS get_src_pdo_limits(uint32_t src_pdo) {
+PDO_LIMITS get_src_pdo_limits(uint32_t src_pdo, PDO_VARIANT id) {
+    using namespace dobj;
     PDO_LIMITS limits{};
-    auto id = get_src_pdo_variant(src_pdo);
 
     if (id == PDO_VARIANT::FIXED) {
-        const PDO_FIXED pdo{src_pdo};
         return limits
-            .set_mv(pdo.voltage * 50u)
-            .set_ma(pdo.max_current * 10u);
+            .set_mv(pdo_fixed::get_mv(src_pdo))
+            .set_ma(pdo_fixed::get_ma(src_pdo));
     }
 
     if (id == PDO_VARIANT::APDO_PPS) {
-        const PDO_SPR_PPS pdo{src_pdo};
         return limits
-            .set_mv_min(pdo.min_voltage * 100u)
-            .set_mv_max(pdo.max_voltage * 100u)
-            .set_ma(pdo.max_current * 50u);
+            .set_mv_min(pdo_spr_pps::get_mv_min(src_pdo))
+            .set_mv_max(pdo_spr_pps::get_mv_max(src_pdo))
+            .set_ma(pdo_spr_pps::get_ma(src_pdo));
     }
 
     if (id == PDO_VARIANT::APDO_SPR_AVS) {
-        const PDO_SPR_AVS pdo{src_pdo};
         auto mv_max = 15000u; // 15V
-        auto ma = pdo.max_current_15v * 10u;
-        if (pdo.max_current_20v > 0) {
+        auto ma = pdo_spr_avs::max_current_15v::get(src_pdo) * 10u;
+        if (pdo_spr_avs::max_current_20v::get(src_pdo) > 0) {
             mv_max = 20000u; // 20V
-            ma = pdo.max_current_20v * 10u;
+            ma = pdo_spr_avs::max_current_20v::get(src_pdo) * 10u;
         }
         return limits
             .set_mv_min(9000u)
@@ -49,58 +38,54 @@ PDO_LIMITS get_src_pdo_limits(uint32_t src_pdo) {
     }
 
     if (id == PDO_VARIANT::APDO_EPR_AVS) {
-        const PDO_EPR_AVS pdo{src_pdo};
         return limits
-            .set_mv_min(pdo.min_voltage * 100u)
-            .set_mv_max(pdo.max_voltage * 100u)
-            .set_pdp(pdo.pdp);
+            .set_mv_min(pdo_epr_avs::get_mv_min(src_pdo))
+            .set_mv_max(pdo_epr_avs::get_mv_max(src_pdo))
+            .set_pdp(pdo_epr_avs::pdp::get(src_pdo));
     }
 
     return limits;
 }
 
 void set_snk_pdo_limits(uint32_t& snk_pdo, const PDO_LIMITS& limits) {
+    using namespace dobj;
     auto id = get_snk_pdo_variant(snk_pdo);
+
     if (id == PDO_VARIANT::FIXED) {
-        PDO_FIXED pdo{snk_pdo};
-        pdo.voltage = limits.mv_min / 50u;
-        pdo.max_current = limits.ma / 10u;
-        snk_pdo = pdo.raw_value;
+        snk_pdo = snk_pdo_fixed::voltage::set(snk_pdo, limits.mv_min / 50u);
+        snk_pdo = snk_pdo_fixed::max_current::set(snk_pdo, limits.ma / 10u);
         return;
     }
 
     if (id == PDO_VARIANT::APDO_PPS) {
-        PDO_SPR_PPS pdo{snk_pdo};
-        pdo.min_voltage = limits.mv_min / 100u;
-        pdo.max_voltage = limits.mv_max / 100u;
-        pdo.max_current = limits.ma / 50u;
-        snk_pdo = pdo.raw_value;
+        snk_pdo = snk_pdo_spr_pps::min_voltage::set(snk_pdo, limits.mv_min / 100u);
+        snk_pdo = snk_pdo_spr_pps::max_voltage::set(snk_pdo, limits.mv_max / 100u);
+        snk_pdo = snk_pdo_spr_pps::max_current::set(snk_pdo, limits.ma / 50u);
         return;
     }
 
     if (id == PDO_VARIANT::APDO_SPR_AVS) {
-        PDO_SPR_AVS pdo{snk_pdo};
-        pdo.max_current_15v = limits.ma / 10u;
-        pdo.max_current_20v = limits.ma / 10u;
-        snk_pdo = pdo.raw_value;
+        snk_pdo = snk_pdo_spr_avs::max_current_15v::set(snk_pdo, limits.ma / 10u);
+        snk_pdo = snk_pdo_spr_avs::max_current_20v::set(snk_pdo, limits.ma / 10u);
         return;
     }
 
     if (id == PDO_VARIANT::APDO_EPR_AVS) {
-        PDO_EPR_AVS pdo{snk_pdo};
-        pdo.min_voltage = limits.mv_min / 100u;
-        pdo.max_voltage = limits.mv_max / 100u;
-        pdo.pdp = limits.pdp;
-        snk_pdo = pdo.raw_value;
+        snk_pdo = snk_pdo_epr_avs::min_voltage::set(snk_pdo, limits.mv_min / 100u);
+        snk_pdo = snk_pdo_epr_avs::max_voltage::set(snk_pdo, limits.mv_max / 100u);
+        snk_pdo = snk_pdo_epr_avs::pdp::set(snk_pdo, limits.pdp);
         return;
     }
 }
 
 bool match_limits(uint32_t pdo, uint32_t mv, uint32_t ma) {
     auto id = get_src_pdo_variant(pdo);
+    return match_limits(id, get_src_pdo_limits(pdo, id), mv, ma);
+}
+
+bool match_limits(PDO_VARIANT id, const PDO_LIMITS& limits, uint32_t mv, uint32_t ma) {
     if (id == PDO_VARIANT::UNKNOWN) { return false; }
 
-    auto limits = get_src_pdo_limits(pdo);
     // Voltage check is the same for all PDO kinds
     if (mv < limits.mv_min || mv > limits.mv_max) { return false; }
     // If there is no current limit, no more checks
@@ -127,33 +112,5 @@ bool match_limits(uint32_t pdo, uint32_t mv, uint32_t ma) {
     return false;
 }
 
-uint32_t create_pdo_variant_bits(PDO_VARIANT id) {
-    // WARNING: in spec rev3.2 v1.1, SNK BATTERY/VARIABLE IDs seem swapped
-    // Be careful if you decide to add support.
-    PDO_SPR_PPS pdo{};
-
-    switch (id) {
-        case PDO_VARIANT::FIXED:
-            pdo.pdo_type = PDO_TYPE::FIXED;
-            return pdo.raw_value;
-        case PDO_VARIANT::APDO_PPS:
-            pdo.pdo_type = PDO_TYPE::AUGMENTED;
-            pdo.apdo_subtype = PDO_AUGMENTED_SUBTYPE::SPR_PPS;
-            return pdo.raw_value;
-        case PDO_VARIANT::APDO_SPR_AVS:
-            pdo.pdo_type = PDO_TYPE::AUGMENTED;
-            pdo.apdo_subtype = PDO_AUGMENTED_SUBTYPE::SPR_AVS;
-            return pdo.raw_value;
-        case PDO_VARIANT::APDO_EPR_AVS:
-            pdo.pdo_type = PDO_TYPE::AUGMENTED;
-            pdo.apdo_subtype = PDO_AUGMENTED_SUBTYPE::EPR_AVS;
-            return pdo.raw_value;
-        case PDO_VARIANT::UNKNOWN:
-            break;
-    }
-
-    return 0;
-}
-
 } // namespace dobj_utils
 } // namespace pd
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../data_objects.h"
+#include "dobj_codec.h"
 
 namespace pd {
 namespace dobj_utils {
@@ -12,51 +13,51 @@ public:
     uint32_t ma{0};
     uint32_t pdp{0}; // in watts, for EPR_AVS, optional
 
-    PDO_LIMITS& set_mv_min(uint32_t mv) { mv_min = mv; return *this; }
-    PDO_LIMITS& set_mv_max(uint32_t mv) { mv_max = mv; return *this; }
-    PDO_LIMITS& set_ma(uint32_t ma) { this->ma = ma; return *this; }
-    PDO_LIMITS& set_pdp(uint32_t pdp) { this->pdp = pdp; return *this; }
+    constexpr PDO_LIMITS& set_mv_min(uint32_t mv) { mv_min = mv; return *this; }
+    constexpr PDO_LIMITS& set_mv_max(uint32_t mv) { mv_max = mv; return *this; }
+    constexpr PDO_LIMITS& set_ma(uint32_t ma) { this->ma = ma; return *this; }
+    constexpr PDO_LIMITS& set_pdp(uint32_t pdp) { this->pdp = pdp; return *this; }
 
     // Sugar for fixed objects
-    PDO_LIMITS& set_mv(uint32_t mv) { mv_min = mv; mv_max = mv; return *this; }
+    constexpr PDO_LIMITS& set_mv(uint32_t mv) { mv_min = mv; mv_max = mv; return *this; }
 };
 
-PDO_VARIANT get_src_pdo_variant(uint32_t src_pdo);
+constexpr PDO_VARIANT get_src_pdo_variant(uint32_t src_pdo) {
+    return dobj::get_pdo_variant(src_pdo);
+}
 
-inline PDO_VARIANT get_snk_pdo_variant(uint32_t snk_pdo) {
+constexpr PDO_VARIANT get_snk_pdo_variant(uint32_t snk_pdo) {
     // WARNING: in spec rev3.2 v1.1, SNK BATTERY/VARIABLE IDs seem swapped
     // Be careful if you decide to add support.
     return get_src_pdo_variant(snk_pdo);
 };
 
 PDO_LIMITS get_src_pdo_limits(uint32_t src_pdo);
+// Same, with the variant already known
+PDO_LIMITS get_src_pdo_limits(uint32_t src_pdo, PDO_VARIANT id);
 
 void set_snk_pdo_limits(uint32_t& snk_pdo, const PDO_LIMITS& limits);
 
 bool match_limits(uint32_t pdo, uint32_t mv, uint32_t ma);
+// Same, with the variant and limits already decoded
+bool match_limits(PDO_VARIANT id, const PDO_LIMITS& limits, uint32_t mv, uint32_t ma);
 
-uint32_t create_pdo_variant_bits(PDO_VARIANT id);
+constexpr uint32_t create_pdo_variant_bits(PDO_VARIANT id) {
+    // WARNING: in spec rev3.2 v1.1, SNK BATTERY/VARIABLE IDs seem swapped
+    // Be careful if you decide to add support.
+    return dobj::make_pdo_variant_bits(id);
+}
 
 inline void set_rdo_limits_fixed(uint32_t& rdo, uint32_t operating_ma, uint32_t max_ma) {
-    RDO_FIXED rdo_bits{rdo};
-    rdo_bits.max_current = max_ma / 10u;
-    rdo_bits.operating_current = operating_ma / 10u;
-    rdo = rdo_bits.raw_value;
+    rdo = dobj::rdo_fixed::set_limits(rdo, operating_ma, max_ma);
 }
 
 inline void set_rdo_limits_pps(uint32_t& rdo, uint32_t mv, uint32_t ma) {
-    RDO_PPS rdo_bits{rdo};
-    rdo_bits.output_voltage = mv / 20u;
-    rdo_bits.operating_current = ma / 50u;
-    rdo = rdo_bits.raw_value;
+    rdo = dobj::rdo_pps::set_limits(rdo, mv, ma);
 }
 
 inline void set_rdo_limits_avs(uint32_t& rdo, uint32_t mv, uint32_t ma) {
-    RDO_AVS rdo_bits{rdo};
-    // The spec says the step is 25 mV, but the two least significant bits must be zero
-    rdo_bits.output_voltage = (mv / 100u) << 2;
-    rdo_bits.operating_current = ma / 50u;
-    rdo = rdo_bits.raw_value;
+    rdo = dobj::rdo_avs::set_limits(rdo, mv, ma);
 }
 
 } // namespace dobj_utils
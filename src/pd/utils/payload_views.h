@@ -0,0 +1,182 @@
+#pragma once
+
+#include <string.h>
+
+#include "dobj_utils.h"
+
+namespace pd {
+
+//
+// Typed views over message payloads. The payload size is checked once, when
+// a view is created, then data objects are decoded directly from the
+// message buffer, without copies and per-object bounds checks. Views don't
+// own data, and are valid while the message is not changed.
+//
+
+namespace payload_views_details {
+    inline uint32_t load32(const uint8_t* p) {
+        uint32_t value;
+        memcpy(&value, p, 4);
+        return value;
+    }
+
+    inline uint16_t load16(const uint8_t* p) {
+        uint16_t value;
+        memcpy(&value, p, 2);
+        return value;
+    }
+
+    // Message classes expose data() / data_size() publicly, but the common
+    // base does not. Go through the derived type.
+    template <typename Derived>
+    const Derived& msg_of(const PD_MSG_OPS<Derived>& msg) {
+        return static_cast<const Derived&>(msg);
+    }
+} // namespace payload_views_details
+
+// Source PDO with the variant decoded once.
+class PdoView {
+public:
+    PdoView() = default;
+    explicit PdoView(uint32_t raw)
+        : raw{raw}, id{dobj_utils::get_src_pdo_variant(raw)} {}
+
+    uint32_t raw_value() const { return raw; }
+    PDO_VARIANT variant() const { return id; }
+    // Zero PDOs pad the SPR part of EPR capabilities
+    bool is_padding() const { return raw == 0; }
+
+    bool is_epr() const {
+        return id == PDO_VARIANT::APDO_EPR_AVS ||
+            (id == PDO_VARIANT::FIXED && dobj::pdo_fixed::get_mv(raw) > 20000);
+    }
+
+    dobj_utils::PDO_LIMITS limits() const { return dobj_utils::get_src_pdo_limits(raw, id); }
+
+private:
+    uint32_t raw{0};
+    PDO_VARIANT id{PDO_VARIANT::UNKNOWN};
+};
+
+// List of 32-bit data objects: PDOs of (EPR_)Source_Capabilities, or a PDO
+// list stored elsewhere. Only whole objects are included.
+class PdoSpan {
+public:
+    class iterator {
+    public:
+        explicit iterator(const uint8_t* p) : p{p} {}
+        uint32_t operator*() const { return payload_views_details::load32(p); }
+        iterator& operator++() { p += 4; return *this; }
+        bool operator==(const iterator& other) const { return p == other.p; }
+        bool operator!=(const iterator& other) const { return p != other.p; }
+    private:
+        const uint8_t* p;
+    };
+
+    PdoSpan() = default;
+    PdoSpan(const uint8_t* data, size_t count) : ptr{data}, count{count} {}
+    PdoSpan(const etl::ivector<uint32_t>& pdos)
+        : ptr{reinterpret_cast<const uint8_t*>(pdos.data())}, count{pdos.size()} {}
+
+    template <typename Derived>
+    static PdoSpan from_msg(const PD_MSG_OPS<Derived>& msg) {
+        const auto& m = payload_views_details::msg_of(msg);
+        return {m.data(), m.data_size() / 4};
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // No bounds check, `idx` must be < size()
+    uint32_t operator[](size_t idx) const { return payload_views_details::load32(ptr + idx * 4); }
+    PdoView view(size_t idx) const { return PdoView{(*this)[idx]}; }
+
+    // First `n` objects, or less if the span is shorter
+    PdoSpan first(size_t n) const { return {ptr, n < count ? n : count}; }
+
+    iterator begin() const { return iterator{ptr}; }
+    iterator end() const { return iterator{ptr + count * 4}; }
+
+private:
+    const uint8_t* ptr{nullptr};
+    size_t count{0};
+};
+
+// Request Data Object. From a Request / EPR_Request payload, or from a
+// stored value. EPR_Request also carries a copy of the requested PDO.
+class RdoView {
+public:
+    RdoView() = default;
+    explicit RdoView(uint32_t rdo) : rdo{rdo} {}
+
+    template <typename Derived>
+    static RdoView from_msg(const PD_MSG_OPS<Derived>& msg) {
+        const auto& m = payload_views_details::msg_of(msg);
+        RdoView view{};
+        if (m.data_size() >= 4) { view.rdo = payload_views_details::load32(m.data()); }
+        if (m.data_size() >= 8) { view.pdo_copy = payload_views_details::load32(m.data() + 4); }
+        return view;
+    }
+
+    bool valid() const { return rdo != 0; }
+    uint32_t raw_value() const { return rdo; }
+    // 1-based, 0 if not set
+    uint32_t position() const { return dobj::rdo::obj_position::get(rdo); }
+    bool is_epr_capable() const { return dobj::rdo::epr_capable::get(rdo); }
+    bool is_capability_mismatch() const { return dobj::rdo::capability_mismatch::get(rdo); }
+    // EPR_Request only, 0 otherwise
+    uint32_t pdo() const { return pdo_copy; }
+
+private:
+    uint32_t rdo{0};
+    uint32_t pdo_copy{0};
+};
+
+// Extended message header, at the start of an extended chunk payload.
+class ExtHeaderView {
+public:
+    template <typename Derived>
+    explicit ExtHeaderView(const PD_MSG_OPS<Derived>& chunk) {
+        const auto& m = payload_views_details::msg_of(chunk);
+        if (m.header.extended && m.data_size() >= 2) {
+            ehdr = payload_views_details::load16(m.data());
+            ok = true;
+        }
+    }
+
+    bool valid() const { return ok; }
+    uint16_t raw_value() const { return ehdr; }
+    uint16_t data_size() const { return uint16_t(dobj::ext_header::data_size::get(ehdr)); }
+    uint8_t chunk_number() const { return uint8_t(dobj::ext_header::chunk_number::get(ehdr)); }
+    bool is_chunked() const { return dobj::ext_header::chunked::get(ehdr); }
+    bool is_request_chunk() const { return dobj::ext_header::request_chunk::get(ehdr); }
+
+private:
+    uint16_t ehdr{0};
+    bool ok{false};
+};
+
+// EPR Mode Data Object of an EPR_Mode message.
+class EprModeView {
+public:
+    template <typename Derived>
+    explicit EprModeView(const PD_MSG_OPS<Derived>& msg) {
+        const auto& m = payload_views_details::msg_of(msg);
+        if (msg.is_data_msg(PD_DATA_MSGT::EPR_Mode) && m.data_size() >= 4) {
+            mdo = payload_views_details::load32(m.data());
+            ok = true;
+        }
+    }
+
+    // False if the message is not EPR_Mode
+    bool valid() const { return ok; }
+    uint32_t raw_value() const { return mdo; }
+    uint32_t action() const { return dobj::eprmdo::action::get(mdo); }
+    uint32_t data() const { return dobj::eprmdo::data::get(mdo); }
+
+private:
+    uint32_t mdo{0};
+    bool ok{false};
+};
+
+} // namespace pd
@@ -0,0 +1,80 @@
+#include "soft_crc.h"
+#include "../data_objects.h"
+
+namespace pd {
+namespace soft_crc {
+
+namespace {
+
+// Reflected form of 0x04C11DB7
+constexpr uint32_t CRC_POLY_REFLECTED = 0xEDB88320;
+
+// Slice-by-4 lookup tables (4 KB), built at compile time. table[0] is the
+// classic byte-wise table, table[k] advances CRC of a byte followed by
+// k zero bytes. Slice-by-8 is ~1.3x faster on desktop, but doubles
+// the flash use - not worth it for 30-byte PD frames.
+struct CrcTables {
+    uint32_t t[4][256]{};
+
+    constexpr CrcTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? CRC_POLY_REFLECTED : 0);
+            }
+            t[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 4; k++) {
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+constexpr CrcTables crc_tables{};
+
+} // namespace
+
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
+    const auto& t = crc_tables.t;
+
+    while (len >= 4) {
+        crc ^= uint32_t(data[0]) | (uint32_t(data[1]) << 8) |
+            (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+        crc = t[3][crc & 0xFF] ^ t[2][(crc >> 8) & 0xFF] ^
+            t[1][(crc >> 16) & 0xFF] ^ t[0][crc >> 24];
+        data += 4;
+        len -= 4;
+    }
+
+    while (len--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+size_t append_crc(uint8_t* frame, size_t len) {
+    auto crc = crc32(frame, len);
+    frame[len + 0] = crc & 0xFF;
+    frame[len + 1] = (crc >> 8) & 0xFF;
+    frame[len + 2] = (crc >> 16) & 0xFF;
+    frame[len + 3] = (crc >> 24) & 0xFF;
+    return len + CRC_SIZE;
+}
+
+size_t build_goodcrc(uint16_t rx_header, uint8_t* out) {
+    PD_HEADER rx{rx_header};
+    PD_HEADER hdr{0};
+    hdr.message_type = PD_CTRL_MSGT::GoodCRC;
+    hdr.spec_revision = rx.spec_revision;
+    hdr.message_id = rx.message_id;
+    // Roles are Sink/UFP (zeroes), data objects count is 0.
+
+    out[0] = hdr.raw_value & 0xFF;
+    out[1] = hdr.raw_value >> 8;
+    return append_crc(out, 2);
+}
+
+} // namespace soft_crc
+} // namespace pd
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <etl/platform.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Software CRC/GoodCRC helpers for TCPCs without hardware CRC support.
+//
+// [rev3.2] 5.6.2 CRC. The same CRC-32 as in IEEE 802.3: polynomial
+// 0x04C11DB7, initial value 0xFFFFFFFF, inverted result, sent LSB first.
+// Covers the message header and data, but not the SOP.
+//
+namespace pd {
+namespace soft_crc {
+
+static constexpr uint32_t CRC_INIT = 0xFFFFFFFF;
+// Register value after processing a valid frame with its CRC. This is
+// the bit-reflected form of the 0xC704DD7B residual from the spec.
+static constexpr uint32_t CRC_RESIDUAL = 0xDEBB20E3;
+static constexpr size_t CRC_SIZE = 4;
+// Header + CRC
+static constexpr size_t GOODCRC_FRAME_SIZE = 2 + CRC_SIZE;
+
+// Table driven (slice-by-4) CRC update, without final inversion.
+// Use to process data in parts.
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len);
+
+inline uint32_t crc32(const uint8_t* data, size_t len) {
+    return ~crc32_update(CRC_INIT, data, len);
+}
+
+// Check the received frame (header + data + CRC).
+inline bool check_frame(const uint8_t* frame, size_t len) {
+    if (len < GOODCRC_FRAME_SIZE) { return false; }
+    return crc32_update(CRC_INIT, frame, len) == CRC_RESIDUAL;
+}
+
+// Write CRC of `len` bytes at `frame + len`. Buffer must have room
+// for CRC_SIZE more bytes. Returns the new frame size.
+size_t append_crc(uint8_t* frame, size_t len);
+
+// Build a complete GoodCRC frame (header + CRC) to reply to the received
+// message. Message ID and revision are copied from the received header,
+// roles are Sink/UFP. Returns the frame size.
+//
+// Note, GoodCRC should be sent within tTransmit (195 us) after the message
+// end. That is not reachable from the PRL event loop, so the driver should
+// call this from its RX handler.
+size_t build_goodcrc(uint16_t rx_header, uint8_t* out);
+
+} // namespace soft_crc
+} // namespace pd
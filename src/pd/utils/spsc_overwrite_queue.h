@@ -7,6 +7,13 @@
  *   • Capacity (CAP_POW2) must be a power of two.
  *   • push() never blocks; on overflow the oldest element is discarded.
  *   • head_with_flag is even when ready, odd when writing
+ *   • In-place access, without copies through a temporary:
+ *       producer: reserve() the next slot, fill it, commit() it.
+ *       consumer: front() borrows the oldest element, release() validates
+ *       the read and frees the slot.
+ *   • The producer never waits for the consumer, and may overwrite the
+ *     borrowed element. release() reports that, and the consumer should
+ *     discard what it read and retry with front().
  */
 
 #include <etl/array.h>
@@ -58,37 +65,79 @@ class spsc_overwrite_queue {
     }
 
 public:
+    //
+    // Producer side
+    //
+
+    // Start writing the next slot in place. If the queue is full, the
+    // oldest element is dropped. Consumer skips the slot until commit().
+    // Every reserve() must be followed by commit(), there is no cancel:
+    // the slot may already hold partially overwritten data.
+    ETL_NODISCARD T* reserve() noexcept {
+        // make odd; acq_rel: slot writes must not move before this point
+        head_fields_t hf{head_fields.fetch_add(1, etl::memory_order_acq_rel)};
+        return &buf[hf.head & MASK];
+    }
 
-    template<typename U>
-    void push(U&& v) noexcept {
-        // make odd
-        head_fields_t hf{head_fields.fetch_add(1, etl::memory_order_release)};
-        // update data
-        buf[hf.head & MASK] = etl::forward<U>(v);
+    void commit() noexcept {
         // make even
         head_fields.fetch_add(1, etl::memory_order_release);
     }
 
-    ETL_NODISCARD bool pop(T& out) noexcept {
-        while (true) {
-            check_reset();
+    template<typename U>
+    void push(U&& v) noexcept {
+        *reserve() = etl::forward<U>(v);
+        commit();
+    }
 
-            head_fields_t hf{head_fields.load(etl::memory_order_acquire)};
-            auto t = get_adjusted_tail(hf);
+    //
+    // Consumer side
+    //
 
-            if (t == hf.head) { return false; }  // no data
+    // Borrow the oldest element in place, or nullptr if empty. Repeated
+    // calls return the same element, unless it was overwritten meanwhile.
+    ETL_NODISCARD const T* front() noexcept {
+        check_reset();
 
-            T tmp = buf[t & MASK]; // read data
+        head_fields_t hf{head_fields.load(etl::memory_order_acquire)};
+        // Elements lost by overwrite are skipped for good
+        tail = get_adjusted_tail(hf);
 
-            // Check that data was not overwritten during the read (tail not moved)
-            hf.raw = head_fields.load(etl::memory_order_acquire);
-            if (get_adjusted_tail(hf) != t) { continue; }
+        if (tail == hf.head) { return nullptr; }  // no data
+        return &buf[tail & MASK];
+    }
+
+    // Finish the read of the element borrowed by front(). Returns false if
+    // the producer overwrote it or cleared the queue during the read. Then
+    // the data is not valid, and the slot is not consumed.
+    bool release() noexcept {
+        // Seqlock read side: element reads must not move below the head
+        // re-load, and an acquire load alone does not prevent that. On x86
+        // loads are not reordered anyway, so stress tests there can't catch
+        // a missing fence. It matters on weakly ordered targets.
+        etl::atomic_thread_fence(etl::memory_order_acquire);
+
+        // Check that data was not overwritten during the read (tail not moved)
+        head_fields_t hf{head_fields.load(etl::memory_order_relaxed)};
+        if (get_adjusted_tail(hf) != tail) { return false; }
+
+        // Check that data was not discarded by a new reset
+        if (check_reset()) { return false; }
+
+        if (tail == hf.head) { return false; }  // nothing borrowed
+        tail = (tail + 1) & 0x7FFFFFFF;
+        return true;
+    }
+
+    ETL_NODISCARD bool pop(T& out) noexcept {
+        while (true) {
+            auto item = front();
+            if (!item) { return false; }
 
-            // Check that data was not discarded by a new reset
-            if (check_reset()) { continue; }
+            T tmp = *item; // read data
+            if (!release()) { continue; }
 
             out = tmp;
-            tail = (t + 1) & 0x7FFFFFFF;
             return true;
         }
     }
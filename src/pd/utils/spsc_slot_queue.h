@@ -0,0 +1,105 @@
+#pragma once
+/*
+ * spsc_slot_queue.h
+ *
+ * Single-producer / single-consumer lock-free ring of in-place slots.
+ * Elements are never copied in or out. Unlike spsc_overwrite_queue, the
+ * producer never touches unreleased data, so reads need no validation:
+ *   • producer: reserve() a free slot, fill it in place, commit() it.
+ *   • consumer: front() borrows the oldest slot, release() returns it.
+ *   • Capacity (CAP_POW2) must be a power of two.
+ *   • A borrowed slot is never touched by the producer. If the queue is
+ *     full, reserve() returns nullptr and the caller drops the new data.
+ *   • clear_from_producer() is applied lazily by the consumer, on the
+ *     next front()/release()/empty() call.
+ */
+
+#include <etl/array.h>
+#include <etl/atomic.h>
+
+template<typename T, size_t CAP_POW2>
+class spsc_slot_queue {
+    static_assert((CAP_POW2 & (CAP_POW2 - 1)) == 0, "Capacity must be 2^k");
+    static_assert(CAP_POW2 <= 0x7FFFFFFFu, "Capacity must fit unsigned-diff logic");
+
+    static constexpr size_t CAP = CAP_POW2;
+    static constexpr size_t MASK = CAP - 1;
+
+    etl::array<T, CAP> buf;
+    etl::atomic<uint32_t> head{0}; // written by producer only
+    etl::atomic<uint32_t> tail{0}; // written by consumer only
+
+    // for reset functionality
+    etl::atomic<uint32_t> reset_pos{0};
+    etl::atomic<uint32_t> reset_ver{0};
+    uint32_t local_ver{0};
+
+    bool check_reset() {
+        auto ver = reset_ver.load(etl::memory_order_acquire);
+        if (ver != local_ver) {
+            tail.store(reset_pos.load(etl::memory_order_relaxed), etl::memory_order_release);
+            local_ver = ver;
+            return true;
+        }
+        return false;
+    }
+
+public:
+    //
+    // Producer side
+    //
+
+    // Returns a free slot to fill, or nullptr if the queue is full.
+    ETL_NODISCARD T* reserve() noexcept {
+        auto h = head.load(etl::memory_order_relaxed);
+        if (h - tail.load(etl::memory_order_acquire) >= CAP) { return nullptr; }
+        return &buf[h & MASK];
+    }
+
+    // Publish the slot returned by the last reserve(). Not calling commit()
+    // simply leaves the slot free for the next reserve().
+    void commit() noexcept {
+        head.store(head.load(etl::memory_order_relaxed) + 1, etl::memory_order_release);
+    }
+
+    void clear_from_producer() {
+        // Store reset position; publication to the consumer is ensured by the
+        // release on reset_ver below.
+        reset_pos.store(head.load(etl::memory_order_relaxed), etl::memory_order_relaxed);
+        reset_ver.fetch_add(1, etl::memory_order_release);
+    }
+
+    //
+    // Consumer side
+    //
+
+    // Borrow the oldest element in place, or nullptr if empty. The pointer
+    // stays valid until release(). Repeated calls return the same slot.
+    ETL_NODISCARD const T* front() noexcept {
+        check_reset();
+
+        auto t = tail.load(etl::memory_order_relaxed);
+        if (t == head.load(etl::memory_order_acquire)) { return nullptr; }
+        return &buf[t & MASK];
+    }
+
+    // Return the slot borrowed by front() to the producer.
+    void release() noexcept {
+        // If the producer cleared the queue meanwhile, the borrowed slot
+        // is already dropped with the rest of the data.
+        if (check_reset()) { return; }
+
+        auto t = tail.load(etl::memory_order_relaxed);
+        if (t == head.load(etl::memory_order_acquire)) { return; }
+        tail.store(t + 1, etl::memory_order_release);
+    }
+
+    void clear_from_consumer() {
+        tail.store(head.load(etl::memory_order_acquire), etl::memory_order_release);
+    }
+
+    bool empty() {
+        check_reset();
+        return tail.load(etl::memory_order_relaxed) == head.load(etl::memory_order_acquire);
+    }
+};
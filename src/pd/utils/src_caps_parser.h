@@ -0,0 +1,202 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "payload_views.h"
+
+namespace pd {
+
+//
+// Incremental validation of (EPR_)Source_Capabilities. PDOs are checked and
+// indexed one by one, as data arrives. For chunked EPR_Source_Capabilities,
+// PRL feeds each chunk while the next one is requested, so only the last
+// chunk is left to process when the message completes.
+//
+// The result is a summary of the list (variant of each PDO and a mask of
+// present variants), passed to DPM with the stored capabilities. Then DPM
+// does not decode PDOs again to find candidates.
+//
+
+enum class SRC_CAPS_ERROR : uint8_t {
+    NONE,
+    EMPTY,
+    TOO_MANY_PDOS,
+    FIRST_NOT_SAFE5V,
+    EPR_PDO_AT_SPR_POSITION,
+    SPR_PDO_AT_EPR_POSITION,
+    MULTIPLE_SPR_AVS,
+    MULTIPLE_EPR_AVS,
+    FIXED_NOT_ASCENDING,
+    PPS_NOT_ASCENDING
+};
+
+// Describes the PDOs stored in `Port::source_caps` (up to PdoListSize).
+class SRC_CAPS_SUMMARY {
+public:
+    // PDOs described, including padding
+    size_t size() const { return count; }
+
+    // Variant of PDO at `idx`, UNKNOWN for padding and out of range
+    PDO_VARIANT variant(size_t idx) const {
+        return idx < count ? variants[idx] : PDO_VARIANT::UNKNOWN;
+    }
+
+    bool has(PDO_VARIANT id) const { return variants_mask & mask_of(id); }
+
+    // Keep the first `n` PDOs only, as PE does in SPR mode
+    void trim(size_t n) {
+        if (n >= count) { return; }
+        count = uint8_t(n);
+        variants_mask = 0;
+        for (size_t i = 0; i < n; i++) { variants_mask |= mask_of(variants[i]); }
+    }
+
+    void clear() { *this = SRC_CAPS_SUMMARY{}; }
+
+    static constexpr uint8_t mask_of(PDO_VARIANT id) { return uint8_t(1u << unsigned(id)); }
+
+private:
+    friend class SrcCapsParser;
+
+    PDO_VARIANT variants[PdoListSize]{};
+    uint8_t count{0};
+    uint8_t variants_mask{0};
+};
+
+class SrcCapsParser {
+public:
+    void reset() { *this = SrcCapsParser{}; }
+
+    // Process PDOs added since the previous call. `pdos` is the whole list
+    // received so far (it only grows while a message is assembled).
+    void update(PdoSpan pdos);
+
+    template <typename Derived>
+    void update(const PD_MSG_OPS<Derived>& msg) { update(PdoSpan::from_msg(msg)); }
+
+    // All data received, final checks. Returns true if the list is valid.
+    bool finish() {
+        if (err == SRC_CAPS_ERROR::NONE && parsed == 0) { fail(SRC_CAPS_ERROR::EMPTY, 0); }
+        return ok();
+    }
+
+    bool ok() const { return err == SRC_CAPS_ERROR::NONE; }
+    SRC_CAPS_ERROR error() const { return err; }
+    // Zero-based PDO index where validation failed
+    size_t error_position() const { return err_pos; }
+
+    // PDOs processed, including those after an error
+    size_t size() const { return parsed; }
+    const SRC_CAPS_SUMMARY& summary() const { return info; }
+
+    // Validate a complete list at once
+    static SRC_CAPS_ERROR validate(PdoSpan pdos, size_t* error_position = nullptr) {
+        SrcCapsParser parser;
+        parser.update(pdos);
+        parser.finish();
+        if (error_position) { *error_position = parser.error_position(); }
+        return parser.error();
+    }
+
+private:
+    void fail(SRC_CAPS_ERROR e, size_t pos) {
+        err = e;
+        err_pos = pos;
+    }
+
+    void check(const PdoView& pdo, size_t idx);
+
+    SRC_CAPS_SUMMARY info{};
+    size_t parsed{0};
+    SRC_CAPS_ERROR err{SRC_CAPS_ERROR::NONE};
+    size_t err_pos{0};
+
+    uint8_t spr_avs_count{0};
+    uint8_t epr_avs_count{0};
+    uint32_t prev_fixed_voltage{0};
+    uint32_t prev_pps_max_voltage{0};
+};
+
+inline void SrcCapsParser::update(PdoSpan pdos) {
+    for (; parsed < pdos.size(); parsed++) {
+        const auto pdo = pdos.view(parsed);
+
+        // Validation stops at the first error, indexing continues
+        if (ok()) { check(pdo, parsed); }
+
+        if (parsed >= size_t(PdoListSize)) { continue; }
+
+        const auto id = pdo.is_padding() ? PDO_VARIANT::UNKNOWN : pdo.variant();
+        info.variants[parsed] = id;
+        info.variants_mask |= SRC_CAPS_SUMMARY::mask_of(id);
+        info.count = uint8_t(parsed + 1);
+    }
+}
+
+// Rules of [rev3.2] 6.4.1 for the PDO at `idx`, given the previous ones
+inline void SrcCapsParser::check(const PdoView& pdo, size_t idx) {
+    if (idx >= MaxPdoObjects) {
+        fail(SRC_CAPS_ERROR::TOO_MANY_PDOS, idx);
+        return;
+    }
+
+    const auto pdo_variant = pdo.variant();
+
+    // First PDO must be Safe5v
+    if (idx == 0 &&
+        (pdo_variant != PDO_VARIANT::FIXED || dobj::pdo_fixed::get_mv(pdo.raw_value()) != 5000))
+    {
+        fail(SRC_CAPS_ERROR::FIRST_NOT_SAFE5V, idx);
+        return;
+    }
+
+    // EPR PDOs are prohibited at SPR positions (1-7, counted from 1),
+    // and SPR PDOs are prohibited at EPR positions (8+).
+    if (pdo.is_epr()) {
+        if (idx < MaxPdoObjects_SPR) {
+            fail(SRC_CAPS_ERROR::EPR_PDO_AT_SPR_POSITION, idx);
+            return;
+        }
+    } else {
+        if (idx >= MaxPdoObjects_SPR) {
+            fail(SRC_CAPS_ERROR::SPR_PDO_AT_EPR_POSITION, idx);
+            return;
+        }
+    }
+
+    // Max 1 SPR AVS and max 1 EPR AVS
+    if (pdo_variant == PDO_VARIANT::APDO_SPR_AVS) {
+        if (++spr_avs_count > 1) {
+            fail(SRC_CAPS_ERROR::MULTIPLE_SPR_AVS, idx);
+            return;
+        }
+    } else if (pdo_variant == PDO_VARIANT::APDO_EPR_AVS) {
+        if (++epr_avs_count > 1) {
+            fail(SRC_CAPS_ERROR::MULTIPLE_EPR_AVS, idx);
+            return;
+        }
+    }
+
+    // Fixed PDO voltages are strictly ascending (no duplicates)
+    if (pdo_variant == PDO_VARIANT::FIXED) {
+        uint32_t voltage = dobj::pdo_fixed::voltage::get(pdo.raw_value());
+        if (voltage <= prev_fixed_voltage) {
+            fail(SRC_CAPS_ERROR::FIXED_NOT_ASCENDING, idx);
+            return;
+        }
+        prev_fixed_voltage = voltage;
+    }
+
+    // PPS APDO max_voltage is ascending (not strictly - duplicates allowed)
+    if (pdo_variant == PDO_VARIANT::APDO_PPS) {
+        uint32_t max_voltage = dobj::pdo_spr_pps::max_voltage::get(pdo.raw_value());
+        if (max_voltage < prev_pps_max_voltage) {
+            fail(SRC_CAPS_ERROR::PPS_NOT_ASCENDING, idx);
+            return;
+        }
+        prev_pps_max_voltage = max_voltage;
+    }
+}
+
+} // namespace pd
@@ -8,6 +8,99 @@
 
 namespace pd {
 
+namespace details {
+
+// Binary min-heap of timer IDs, ordered by external timestamps. Equal
+// timestamps are ordered by ID.
+template<size_t N>
+class TimerHeap {
+    static_assert(N < 255, "Timer IDs must fit heap index type");
+
+public:
+    TimerHeap() { pos.fill(NOT_IN_HEAP); }
+
+    bool empty() const { return size == 0; }
+    uint8_t top() const { return heap[0]; }
+
+    // Insert or reposition after timestamp change
+    void update(uint8_t id, const uint32_t* keys) {
+        auto p = pos[id];
+        if (p == NOT_IN_HEAP) {
+            p = size++;
+            set(p, id);
+        }
+        sift_up(p, keys);
+        sift_down(pos[id], keys);
+    }
+
+    void remove(uint8_t id, const uint32_t* keys) {
+        auto p = pos[id];
+        if (p == NOT_IN_HEAP) { return; }
+
+        pos[id] = NOT_IN_HEAP;
+        size--;
+        if (p == size) { return; }
+
+        // Move the last element to the hole, and restore the order
+        uint8_t moved = heap[size];
+        set(p, moved);
+        sift_up(p, keys);
+        sift_down(pos[moved], keys);
+    }
+
+private:
+    static constexpr uint8_t NOT_IN_HEAP = 0xFF;
+
+    static bool less(uint8_t a, uint8_t b, const uint32_t* keys) {
+        auto diff = static_cast<int32_t>(keys[a] - keys[b]);
+        return diff < 0 || (diff == 0 && a < b);
+    }
+
+    void set(uint8_t p, uint8_t id) {
+        heap[p] = id;
+        pos[id] = p;
+    }
+
+    void sift_up(uint8_t p, const uint32_t* keys) {
+        uint8_t id = heap[p];
+        while (p > 0) {
+            uint8_t parent = (p - 1) / 2;
+            if (!less(id, heap[parent], keys)) { break; }
+            set(p, heap[parent]);
+            p = parent;
+        }
+        set(p, id);
+    }
+
+    void sift_down(uint8_t p, const uint32_t* keys) {
+        uint8_t id = heap[p];
+        for (;;) {
+            size_t child = size_t(p) * 2 + 1;
+            if (child >= size) { break; }
+            if (child + 1 < size && less(heap[child + 1], heap[child], keys)) { child++; }
+            if (!less(heap[child], id, keys)) { break; }
+            set(p, heap[child]);
+            p = uint8_t(child);
+        }
+        set(p, id);
+    }
+
+    etl::array<uint8_t, N> heap{};
+    etl::array<uint8_t, N> pos{};
+    uint8_t size{0};
+};
+
+} // namespace details
+
+// Active timers are kept in binary min-heaps. Start, stop and expiration
+// checks are O(log N), the next expiration is O(1).
+//
+// A timer can have a tolerance (`slack`): it expires at `period`, but the
+// wakeup for it may be delayed up to `period + slack`, to serve several
+// timers at once. See `get_next_expiration()`.
+//
+// Deadlines are compared with each other, so periods must be below 2^31
+// ticks for correct ordering.
 template<size_t TIMER_COUNT>
 class TimerPack {
 public:
@@ -21,16 +114,20 @@ public:
         now = time;
     }
 
-    void start(int timer_id, uint32_t period) {
+    void start(int timer_id, uint32_t period, uint32_t slack = 0) {
         active.set(timer_id);
         disabled.clear(timer_id);
         expire_at[timer_id] = now + period;
+        wake_at[timer_id] = now + period + (coalescing ? slack : 0);
+        by_expire.update(uint8_t(timer_id), expire_at.data());
+        by_wake.update(uint8_t(timer_id), wake_at.data());
         timers_changed.store(true);
     }
 
     void stop(int timer_id) {
         active.clear(timer_id);
         disabled.set(timer_id);
+        heaps_remove(timer_id);
         timers_changed.store(true);
     }
 
@@ -53,36 +150,51 @@ public:
         return is_inactive(timer_id);
     };
 
+    // Same as `is_expired()`, without deactivation
+    bool has_expired(int timer_id) const {
+        if (active.test(timer_id)) { return time_diff(expire_at[timer_id], now) <= 0; }
+        return is_inactive(timer_id);
+    }
+
     // A simple GC step that deactivates expired timers to reduce regular checks
     void cleanup() {
-        for (size_t i = 0; i < TIMER_COUNT; i++) {
-            if (active.test(i)) { is_expired(i); } // Deactivate
+        cleanup([](int) {});
+    };
+
+    // Same, and reports timers expired since the last check, in expiration
+    // order. Touches only the expired timers.
+    template <typename Fn>
+    void cleanup(Fn&& on_expired) {
+        while (!by_expire.empty() && time_diff(expire_at[by_expire.top()], now) <= 0) {
+            int timer_id = by_expire.top();
+            deactivate(timer_id);
+            on_expired(timer_id);
         }
     };
 
     // Can be used for precise timer management. If regular 1 ms interrupts are
     // used, this is not needed.
+    //
+    // Returns the time to the next wakeup. That's the earliest end of timer
+    // tolerance windows, so a single wakeup serves all timers whose windows
+    // overlap there (greedy, gives the minimal number of wakeups). Without
+    // slack, that's the nearest expiration.
     int32_t get_next_expiration() const {
-        constexpr int32_t MAX_EXPIRE = etl::numeric_limits<int32_t>::max();
-
-        int32_t min = MAX_EXPIRE;
+        if (by_wake.empty()) { return NO_EXPIRE; }
 
-        for (size_t i = 0; i < TIMER_COUNT; i++) {
-            if (active.test(i)) {
-                auto exp_diff = time_diff(expire_at[i], now);
-                if (exp_diff <= 0) { return 0; }
-                if (exp_diff < min) { min = exp_diff; }
-            }
-        }
-
-        return min == MAX_EXPIRE ? NO_EXPIRE : min;
+        auto exp_diff = time_diff(wake_at[by_wake.top()], now);
+        return exp_diff <= 0 ? 0 : exp_diff;
     };
 
+    // Disable to ignore slack and wake at exact expirations
+    void set_coalescing(bool enable) { coalescing = enable; }
+
     static constexpr int32_t NO_EXPIRE = -1;
     etl::atomic<bool> timers_changed{false};
 
 private:
     uint32_t now{0};
+    bool coalescing{true};
 
     // After expiration, timer becomes deactivated, but not disabled, to
     // keep expire status.
@@ -93,15 +205,25 @@ private:
     void deactivate(int timer_id) {
         active.clear(timer_id);
         disabled.clear(timer_id);
+        heaps_remove(timer_id);
         timers_changed.store(true);
     }
 
+    void heaps_remove(int timer_id) {
+        by_expire.remove(uint8_t(timer_id), expire_at.data());
+        by_wake.remove(uint8_t(timer_id), wake_at.data());
+    }
+
     // Timestamps compare with care about overflow
     int32_t time_diff(uint32_t expiration, uint32_t now) const {
         return static_cast<int32_t>(expiration - now);
     }
 
     etl::array<uint32_t, TIMER_COUNT> expire_at{};
+    // Latest time to serve the timer, `expire_at + slack`
+    etl::array<uint32_t, TIMER_COUNT> wake_at{};
+    details::TimerHeap<TIMER_COUNT> by_expire;
+    details::TimerHeap<TIMER_COUNT> by_wake;
 
     AtomicBits<TIMER_COUNT> active;
     AtomicBits<TIMER_COUNT> disabled;
@@ -0,0 +1,212 @@
+#pragma once
+
+//
+// Fake driver and DPM for host simulation, see sim_stack.h.
+//
+// - FakeDriver: TCPC with instant operations and auto GoodCRC (or GoodCRC
+//   checked by PRL, see `tx_auto_goodcrc_check`). Sent chunks are logged
+//   and passed to an optional source model. Optionally bound to a thread,
+//   to test dispatch from other threads, and with timer rearm support, for
+//   tickless simulation.
+// - FakeDpm: default DPM, records notifications.
+//
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <etl/message_router.h>
+
+#include "pd/pd_include.h"
+
+class FakeDriver final : public pd::IDriver {
+public:
+    explicit FakeDriver(pd::Port& port) : port{port} {}
+
+    // Simulated time, shared by all instances
+    static inline uint32_t now{0};
+    static uint32_t get_time() { return now; }
+
+    void setup() override {}
+
+    // Measurements complete at once. As real drivers do, the stack is woken
+    // up to pick the result.
+    void req_scan_cc() override { port.wakeup(); }
+    bool try_scan_cc_result(pd::TCPC_CC_LEVEL::Type& cc1_out, pd::TCPC_CC_LEVEL::Type& cc2_out) override {
+        cc1_out = cc1; cc2_out = cc2;
+        return true;
+    }
+
+    void req_active_cc() override { port.wakeup(); }
+    bool try_active_cc_result(pd::TCPC_CC_LEVEL::Type& cc) override {
+        cc = (polarity == pd::TCPC_POLARITY::CC2) ? cc2 : cc1;
+        return true;
+    }
+
+    bool is_vbus_ok() override { return vbus_ok; }
+
+    void req_set_polarity(pd::TCPC_POLARITY active_cc) override { polarity = active_cc; }
+    bool is_set_polarity_done() override { return true; }
+
+    void req_rx_enable(bool enable) override {
+        rx_enabled = enable;
+        if (!enable) { rx_queue.clear(); }
+    }
+    bool is_rx_enable_done() override { return true; }
+
+    const pd::PD_CHUNK* rx_borrow() override {
+        return rx_queue.empty() ? nullptr : &rx_queue.front();
+    }
+    void rx_release() override {
+        if (!rx_queue.empty()) { rx_queue.pop_front(); }
+    }
+
+    pd::PD_CHUNK_EXT& get_tx_chunk() override { return tx_chunk; }
+    void req_transmit() override {
+        tx_log.push_back(pd::PD_CHUNK{tx_chunk});
+        port.tcpc_tx_status.store(pd::TCPC_TRANSMIT_STATUS::SUCCEEDED);
+        if (!tx_auto_goodcrc_check) { reply_goodcrc(tx_log.back()); }
+        if (on_transmit) { on_transmit(tx_log.back()); }
+        port.wakeup();
+    }
+
+    void req_set_bist(pd::TCPC_BIST_MODE) override {}
+    bool is_set_bist_done() override { return true; }
+
+    void req_hr_send() override { hr_sent++; }
+    bool is_hr_send_done() override { return true; }
+
+    void req_set_low_power(bool enable) override {
+        low_power = enable;
+        low_power_log.push_back(enable);
+    }
+
+    auto get_hw_features() -> pd::TCPC_HW_FEATURES override {
+        return {
+            .rx_auto_goodcrc_send = true,
+            .tx_auto_goodcrc_check = tx_auto_goodcrc_check,
+            .tx_auto_retry = tx_auto_retry,
+            .unchunked_ext_msg = unchunked_ext_msg
+        };
+    }
+
+    pd::ITimer::TimeFunc get_time_func() const override { return &FakeDriver::get_time; }
+    void rearm(uint32_t interval) override {
+        timer_deadline = now + interval;
+        timer_armed = true;
+    }
+    bool is_rearm_supported() override { return rearm_supported; }
+
+    // If `owner` is set, only that thread runs the stack. Others just
+    // request dispatch, and the owner should call `port.wakeup()`.
+    bool is_dispatch_context() override {
+        return !has_owner || std::this_thread::get_id() == owner;
+    }
+    void req_dispatch() override {
+        dispatch_requests++;
+        if (on_req_dispatch) { on_req_dispatch(); }
+    }
+
+    void set_owner(std::thread::id id) { owner = id; has_owner = true; }
+
+    // Put a chunk to RX queue, as if received from the partner
+    void receive(const pd::PD_CHUNK& chunk) {
+        if (!rx_enabled) { return; }
+        rx_queue.push_back(chunk);
+        port.wakeup();
+    }
+
+    void reply_goodcrc(const pd::PD_CHUNK& sent) {
+        if (goodcrc_to_drop > 0) {
+            goodcrc_to_drop--;
+            return;
+        }
+        pd::PD_CHUNK goodcrc{};
+        goodcrc.header.message_type = pd::PD_CTRL_MSGT::GoodCRC;
+        goodcrc.header.port_power_role = 1;
+        goodcrc.header.port_data_role = 1;
+        goodcrc.header.spec_revision = sent.header.spec_revision;
+        goodcrc.header.message_id = sent.header.message_id;
+        if (goodcrc_bad_id > 0) {
+            goodcrc_bad_id--;
+            goodcrc.header.message_id = (sent.header.message_id + 1) & 7;
+        }
+        receive(goodcrc);
+    }
+
+    pd::Port& port;
+
+    pd::TCPC_CC_LEVEL::Type cc1{pd::TCPC_CC_LEVEL::NONE};
+    pd::TCPC_CC_LEVEL::Type cc2{pd::TCPC_CC_LEVEL::NONE};
+    pd::TCPC_POLARITY polarity{pd::TCPC_POLARITY::NONE};
+    bool vbus_ok{false};
+    bool rx_enabled{false};
+    bool low_power{false};
+    std::vector<bool> low_power_log;
+    int hr_sent{0};
+
+    // Long packets, see TCPC_HW_FEATURES
+    bool unchunked_ext_msg{true};
+
+    // Without hardware GoodCRC check, GoodCRC from the partner goes to the
+    // RX queue, before its reply. The next `goodcrc_to_drop` are lost, and
+    // the next `goodcrc_bad_id` come with a wrong message ID.
+    bool tx_auto_goodcrc_check{true};
+    bool tx_auto_retry{true};
+    int goodcrc_to_drop{0};
+    int goodcrc_bad_id{0};
+
+    bool rearm_supported{false};
+    bool timer_armed{false};
+    uint32_t timer_deadline{0};
+
+    std::deque<pd::PD_CHUNK> rx_queue;
+    std::vector<pd::PD_CHUNK> tx_log;
+    std::function<void(const pd::PD_CHUNK&)> on_transmit;
+
+    bool has_owner{false};
+    std::thread::id owner{};
+    std::atomic<int> dispatch_requests{0};
+    std::function<void()> on_req_dispatch;
+
+private:
+    uint8_t tx_storage[pd::PD_CHUNK_EXT::MAX_SIZE]{};
+    pd::PD_CHUNK_EXT tx_chunk{tx_storage};
+};
+
+
+class FakeDpm final : public pd::DPM {
+public:
+    explicit FakeDpm(pd::Port& port) : pd::DPM(port), listener{*this} {}
+
+    void setup() override { port.dpm_rtr = &listener; }
+
+    // Renegotiate with the current trigger, without touching its params
+    using pd::DPM::request_new_power_level;
+
+    bool has_event(etl::message_id_t id) const {
+        for (auto e : events) { if (e == id) { return true; } }
+        return false;
+    }
+
+    std::vector<etl::message_id_t> events;
+    // Optional, called after an event is recorded
+    std::function<void(etl::message_id_t)> on_event;
+
+private:
+    // Records IDs of all notifications
+    class Listener : public etl::message_router<Listener, pd::MsgToDpm_Startup> {
+    public:
+        explicit Listener(FakeDpm& dpm) : dpm{dpm} {}
+        void on_receive(const pd::MsgToDpm_Startup& msg) { on_receive_unknown(msg); }
+        void on_receive_unknown(const etl::imessage& msg) {
+            dpm.events.push_back(msg.get_message_id());
+            if (dpm.on_event) { dpm.on_event(msg.get_message_id()); }
+        }
+    private:
+        FakeDpm& dpm;
+    };
+
+    Listener listener;
+};
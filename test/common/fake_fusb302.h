@@ -0,0 +1,235 @@
+#pragma once
+
+//
+// FUSB302B register model and main loop model, for the superloop driver
+// tests. Can sit behind a shared bus, see `on_irq`.
+//
+
+#include <deque>
+#include <functional>
+#include <vector>
+#include <gtest/gtest.h>
+#include "fake_driver.h"
+#include "pd/drivers/fusb302_superloop.h"
+
+namespace fake_fusb302 {
+
+using namespace pd;
+using namespace pd::fusb302;
+
+//
+// Register-level model of FUSB302B, enough for the driver logic: CC
+// measurement, VBUSOK, RX FIFO with auto GoodCRC, TX FIFO with TXSENT.
+//
+class FakeFusb302Hal : public IFusb302Hal {
+public:
+    static inline uint32_t now{0};
+
+    FakeFusb302Hal() { reset_regs(); }
+
+    void setup() override { setup_calls++; }
+    void set_event_handler(const hal_event_handler_t& h) override { handler = h; }
+    ITimer::TimeFunc get_time_func() const override { return [] { return now; }; }
+    void set_timer_enable(bool enable) override { timer_enabled = enable; }
+
+    bool is_interrupt_active() override {
+        return regs[Interrupt::reg] || regs[Interrupta::reg] || regs[Interruptb::reg];
+    }
+
+    bool read_reg(uint8_t, uint8_t reg, uint8_t& data) override {
+        i2c_ops++;
+        switch (reg) {
+            case Interrupt::reg:
+            case Interrupta::reg:
+            case Interruptb::reg:
+                // Clear on read
+                data = regs[reg];
+                regs[reg] = 0;
+                break;
+            case Status0::reg: {
+                Switches0 sw0{regs[Switches0::reg]};
+                Status0 st{0};
+                st.VBUSOK = vbus_ok ? 1 : 0;
+                if (sw0.MEAS_CC1) { st.BC_LVL = cc1; }
+                else if (sw0.MEAS_CC2) { st.BC_LVL = cc2; }
+                data = st.raw_value;
+                break;
+            }
+            case Status1::reg: {
+                Status1 st{0};
+                st.RX_EMPTY = rx_fifo.empty() ? 1 : 0;
+                data = st.raw_value;
+                break;
+            }
+            case FIFOs::reg:
+                return read_block(0, reg, &data, 1);
+            default:
+                data = regs[reg];
+        }
+        return true;
+    }
+
+    bool write_reg(uint8_t, uint8_t reg, uint8_t data) override {
+        i2c_ops++;
+        switch (reg) {
+            case Reset::reg: {
+                Reset rst{data};
+                if (rst.SW_RES) { reset_regs(); }
+                if (rst.PD_RESET) { rx_fifo.clear(); }
+                return true;
+            }
+            case Control0::reg: {
+                Control0 ctl{data};
+                ctl.TX_FLUSH = 0;
+                data = ctl.raw_value;
+                break;
+            }
+            case Control1::reg: {
+                Control1 ctl{data};
+                if (ctl.RX_FLUSH) { rx_fifo.clear(); }
+                ctl.RX_FLUSH = 0;
+                data = ctl.raw_value;
+                break;
+            }
+            case Control3::reg: {
+                Control3 ctl{data};
+                if (ctl.SEND_HARD_RESET) {
+                    hr_sent++;
+                    Interrupta ia{regs[Interrupta::reg]};
+                    ia.I_HARDSENT = 1;
+                    regs[Interrupta::reg] = ia.raw_value;
+                    raise_irq();
+                }
+                ctl.SEND_HARD_RESET = 0;
+                data = ctl.raw_value;
+                break;
+            }
+            default:
+                break;
+        }
+        regs[reg] = data;
+        return true;
+    }
+
+    bool read_block(uint8_t, uint8_t reg, uint8_t *data, uint32_t size) override {
+        i2c_ops++;
+        if (reg != FIFOs::reg) { return false; }
+        for (uint32_t i = 0; i < size; i++) {
+            if (rx_fifo.empty()) { return false; }
+            data[i] = rx_fifo.front();
+            rx_fifo.pop_front();
+        }
+        return true;
+    }
+
+    bool write_block(uint8_t, uint8_t reg, const uint8_t *data, uint32_t size) override {
+        i2c_ops++;
+        if (reg != FIFOs::reg || size < 7) { return false; }
+
+        // SOP[4] + PACKSYM[1] + HEAD[2] + DATA + TAIL[4]
+        PD_CHUNK chunk{};
+        chunk.header.raw_value = uint16_t(data[5] | (data[6] << 8));
+        uint32_t len = (data[4] & 0x1F) - 2u;
+        chunk.resize(len);
+        for (uint32_t i = 0; i < chunk.data_size(); i++) { chunk.data()[i] = data[7 + i]; }
+        tx_log.push_back(chunk);
+
+        // Partner accepted the message
+        push_packet(PD_CHUNK{}, [](PD_CHUNK& c) { c.header.message_type = PD_CTRL_MSGT::GoodCRC; });
+        Interrupta ia{regs[Interrupta::reg]};
+        ia.I_TXSENT = 1;
+        regs[Interrupta::reg] = ia.raw_value;
+        raise_irq();
+
+        if (on_transmit) { on_transmit(tx_log.back()); }
+        return true;
+    }
+
+    //
+    // Partner side
+    //
+    void raise_irq() {
+        if (on_irq) { on_irq(); }
+        else if (handler.is_valid()) { handler(HAL_EVENT_TYPE::FUSB302_Interrupt, true); }
+    }
+
+    // VBUSOK is detected by the wake circuit, the only block powered in
+    // low power mode. Without it, changes are not reported.
+    void set_vbus(bool ok) {
+        vbus_ok = ok;
+        if (!(regs[Power::reg] & PowerBlock::BANDGAP_WAKE)) { return; }
+        Interrupt irq{regs[Interrupt::reg]};
+        irq.I_VBUSOK = 1;
+        regs[Interrupt::reg] = irq.raw_value;
+        raise_irq();
+    }
+
+    // Message from partner. Accepted (with GoodCRC sent) only if auto
+    // GoodCRC is on, as the real chip does.
+    void receive(const PD_CHUNK& chunk) {
+        if (!Switches1{regs[Switches1::reg]}.AUTO_CRC) { return; }
+        push_packet(chunk, [](PD_CHUNK&) {});
+        Interruptb ib{regs[Interruptb::reg]};
+        ib.I_GCRCSENT = 1;
+        regs[Interruptb::reg] = ib.raw_value;
+        raise_irq();
+    }
+
+    // Register defaults, only those the driver relies on
+    void reset_regs() {
+        regs.assign(regs.size(), 0);
+        regs[Power::reg] = PowerBlock::BANDGAP_WAKE;
+    }
+
+    std::vector<uint8_t> regs = std::vector<uint8_t>(256, 0);
+    std::deque<uint8_t> rx_fifo;
+    std::vector<PD_CHUNK> tx_log;
+    std::function<void(const PD_CHUNK&)> on_transmit;
+    hal_event_handler_t handler;
+    // INT pin routing, if the chip sits behind another HAL
+    std::function<void()> on_irq;
+
+    bool vbus_ok{false};
+    uint8_t cc1{TCPC_CC_LEVEL::NONE};
+    uint8_t cc2{TCPC_CC_LEVEL::NONE};
+    bool timer_enabled{true};
+    int setup_calls{0};
+    int hr_sent{0};
+    int i2c_ops{0};
+
+private:
+    template <typename Fn>
+    void push_packet(PD_CHUNK chunk, Fn&& patch) {
+        patch(chunk);
+        rx_fifo.push_back(0xE0); // SOP token
+        rx_fifo.push_back(uint8_t(chunk.header.raw_value & 0xFF));
+        rx_fifo.push_back(uint8_t(chunk.header.raw_value >> 8));
+        for (uint32_t i = 0; i < chunk.data_size(); i++) { rx_fifo.push_back(chunk.data()[i]); }
+        for (int i = 0; i < 4; i++) { rx_fifo.push_back(0); } // CRC
+    }
+};
+
+// Main loop model: poll, then "sleep" until the deadline or an IRQ.
+template <typename Driver>
+inline int run_loop(Driver& driver, uint32_t ms, std::function<void()> on_wake = nullptr) {
+    int polls = 0;
+    uint32_t end = FakeFusb302Hal::now + ms;
+
+    while (FakeFusb302Hal::now < end) {
+        auto left = driver.poll();
+        polls++;
+        if (polls > 100000) { ADD_FAILURE() << "Main loop does not sleep"; break; }
+        if (on_wake) { on_wake(); }
+        if (driver.has_pending_events()) { continue; }
+        if (left == 0) { continue; }
+
+        uint32_t max_sleep = end - FakeFusb302Hal::now;
+        FakeFusb302Hal::now += (left < max_sleep) ? left : max_sleep;
+    }
+    return polls;
+}
+
+} // namespace fake_fusb302
+
+using fake_fusb302::FakeFusb302Hal;
+using fake_fusb302::run_loop;
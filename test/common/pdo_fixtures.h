@@ -0,0 +1,21 @@
+#pragma once
+
+//
+// Source PDOs for tests, in mV / mA / W.
+//
+
+#include <stdint.h>
+
+#include "pd/utils/dobj_codec.h"
+
+inline uint32_t make_fixed_pdo(uint32_t mv, uint32_t ma) {
+    return pd::dobj::pdo_fixed::encode(mv, ma);
+}
+
+inline uint32_t make_pps_apdo(uint32_t mv_min, uint32_t mv_max, uint32_t ma) {
+    return pd::dobj::pdo_spr_pps::encode(mv_min, mv_max, ma);
+}
+
+inline uint32_t make_epr_avs_apdo(uint32_t mv_min, uint32_t mv_max, uint32_t pdp) {
+    return pd::dobj::pdo_epr_avs::encode(mv_min, mv_max, pdp);
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+//
+// Host simulation of the full sink stack, for tests and benchmarks. All
+// components are wired together, plus a minimal source that answers
+// Request with Accept + PS_RDY, and serves chunk requests of extended
+// messages. `TaskT` allows instrumented Task classes.
+//
+
+#include "fake_driver.h"
+
+template <typename TaskT = pd::Task>
+struct SimStackT {
+    pd::Port port;
+    FakeDriver driver{port};
+    FakeDpm dpm{port};
+    TaskT task{port, driver};
+    pd::PRL prl{port, driver};
+    pd::PE pe{port, dpm, prl, driver};
+    pd::TC tc{port, driver};
+
+    // Source model
+    std::vector<uint32_t> src_pdos{ 0x0801912C }; // Fixed 5V 3A
+    uint8_t src_msg_id{0};
+    bool src_auto_reply{true};
+    // Extended message being sent by chunks
+    uint8_t src_ext_type{0};
+    std::vector<uint8_t> src_ext_data;
+
+    // With `queue`, messages between components are deferred, see msg_queue.h
+    explicit SimStackT(pd::IMsgQueue* queue = nullptr) {
+        port.msg_queue = queue;
+        driver.on_transmit = [this](const pd::PD_CHUNK& chunk) { on_sink_message(chunk); };
+        task.start(tc, dpm, pe, prl, driver);
+    }
+
+    // Advance simulated time with 1 ms timer ticks
+    void run_ms(uint32_t ms) {
+        for (uint32_t i = 0; i < ms; i++) {
+            FakeDriver::now++;
+            task.set_event(pd::Task::EVENT_TIMER_MSK);
+        }
+    }
+
+    template <typename Pred>
+    bool run_until(Pred pred, uint32_t max_ms) {
+        for (uint32_t i = 0; i < max_ms; i++) {
+            if (pred()) { return true; }
+            run_ms(1);
+        }
+        return pred();
+    }
+
+    void plug() {
+        driver.cc1 = pd::TCPC_CC_LEVEL::RP_3_0;
+        driver.cc2 = pd::TCPC_CC_LEVEL::NONE;
+        driver.vbus_ok = true;
+        task.set_event(pd::Task::EVENT_WAKEUP_MSK);
+    }
+
+    void unplug() {
+        driver.cc1 = pd::TCPC_CC_LEVEL::NONE;
+        driver.vbus_ok = false;
+        task.set_event(pd::Task::EVENT_WAKEUP_MSK);
+    }
+
+    pd::PD_CHUNK make_src_msg(uint8_t type, uint8_t data_obj_count) {
+        pd::PD_CHUNK chunk{};
+        chunk.header.message_type = type;
+        chunk.header.data_obj_count = data_obj_count;
+        chunk.header.port_power_role = 1; // Source
+        chunk.header.port_data_role = 1; // DFP
+        chunk.header.spec_revision = pd::PD_REVISION::REV30;
+        chunk.header.message_id = src_msg_id++ & 7;
+        return chunk;
+    }
+
+    void send_src_caps() {
+        auto chunk = make_src_msg(pd::PD_DATA_MSGT::Source_Capabilities, uint8_t(src_pdos.size()));
+        for (auto pdo : src_pdos) { chunk.append32(pdo); }
+        driver.receive(chunk);
+    }
+
+    void send_ctrl(pd::PD_CTRL_MSGT::Type type) {
+        driver.receive(make_src_msg(type, 0));
+    }
+
+    // A chunk of an extended message, padded to data objects. Or the whole
+    // message in a single packet, if unchunked.
+    pd::PD_CHUNK make_src_ext_chunk(uint8_t type, const std::vector<uint8_t>& data,
+                                    bool chunked, uint8_t chunk_number = 0)
+    {
+        size_t offset = chunked ? chunk_number * size_t(pd::MaxExtendedMsgChunkLen) : 0;
+        size_t len = data.size() > offset ? data.size() - offset : 0;
+        if (chunked && len > size_t(pd::MaxExtendedMsgChunkLen)) { len = pd::MaxExtendedMsgChunkLen; }
+
+        pd::PD_EXT_HEADER ehdr{0};
+        ehdr.data_size = uint16_t(data.size());
+        ehdr.chunked = chunked ? 1 : 0;
+        ehdr.chunk_number = chunk_number;
+
+        auto chunk = make_src_msg(type, 0);
+        chunk.header.extended = 1;
+        chunk.append16(ehdr.raw_value);
+        for (size_t i = 0; i < len; i++) {
+            if (chunk.data_size() >= chunk.max_size()) { break; }
+            chunk.resize(chunk.data_size() + 1);
+            chunk.data()[chunk.data_size() - 1] = data[offset + i];
+        }
+        if (chunked) {
+            chunk.header.data_obj_count = chunk.size_to_pdo_count();
+            chunk.resize_by_data_obj_count();
+        }
+        return chunk;
+    }
+
+    // Chunked: the first chunk is sent now, the rest on chunk requests from
+    // the sink (see on_sink_message()).
+    void send_src_ext(uint8_t type, const std::vector<uint8_t>& data, bool chunked = true) {
+        src_ext_type = type;
+        src_ext_data = data;
+        driver.receive(make_src_ext_chunk(type, data, chunked));
+    }
+
+    // Attach and negotiate the first contract
+    bool connect(uint32_t max_ms = 2000) {
+        plug();
+        if (!run_until([this]{ return port.is_prl_running(); }, max_ms)) { return false; }
+        send_src_caps();
+        return run_until([this]{ return dpm.has_event(pd::MSG_TO_DPM__SNK_READY); }, max_ms);
+    }
+
+    void on_sink_message(const pd::PD_CHUNK& chunk) {
+        if (!src_auto_reply) { return; }
+        if (chunk.is_data_msg(pd::PD_DATA_MSGT::Request)) {
+            send_ctrl(pd::PD_CTRL_MSGT::Accept);
+            send_ctrl(pd::PD_CTRL_MSGT::PS_RDY);
+        }
+        if (chunk.header.extended && chunk.header.data_obj_count > 0) {
+            pd::PD_EXT_HEADER ehdr{chunk.read16(0)};
+            if (ehdr.request_chunk) {
+                // Next chunk of our message
+                driver.receive(make_src_ext_chunk(src_ext_type, src_ext_data, true, ehdr.chunk_number));
+            } else if ((ehdr.chunk_number + 1) * pd::MaxExtendedMsgChunkLen < ehdr.data_size) {
+                // Request the next chunk of the sink's message
+                pd::PD_EXT_HEADER req{0};
+                req.request_chunk = 1;
+                req.chunked = 1;
+                req.chunk_number = ehdr.chunk_number + 1;
+                auto reply = make_src_msg(chunk.header.message_type, 1);
+                reply.header.extended = 1;
+                reply.append16(req.raw_value);
+                reply.append16(0);
+                driver.receive(reply);
+            }
+        }
+    }
+};
+
+using SimStack = SimStackT<>;
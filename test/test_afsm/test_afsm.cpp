@@ -8,10 +8,15 @@ using afsm::state_pack;
 using afsm::interceptor;
 using afsm::interceptor_pack;
 
+// The same tests run for the inline backend, see test_afsm_inline
+#if !defined(AFSM_TEST_DISPATCH)
+#define AFSM_TEST_DISPATCH afsm::table_dispatch
+#endif
+
 enum StateID : etl::fsm_state_id_t { SID0 = 0, SID1, SID2, SID3, SID4, SID_Count };
 static constexpr etl::fsm_state_id_t InvalidID = SID_Count;
 
-class TestFSM : public fsm<TestFSM> {
+class TestFSM : public fsm<TestFSM, 0, AFSM_TEST_DISPATCH> {
 public:
     std::array<int, SID_Count> enter_cnt{};
     std::array<int, SID_Count> exit_cnt{};
@@ -484,6 +489,122 @@ TEST(TickFsm, ChangeStateInsideExitIsIgnored) {
     EXPECT_EQ(fsm.get_state_id(), SID1);
 }
 
+//
+// Wake conditions
+//
+
+class WakeFSM : public fsm<WakeFSM, 2, AFSM_TEST_DISPATCH> {
+public:
+    uint32_t a{0};
+    uint32_t b{0};
+    std::array<int, SID_Count> run_cnt{};
+    int interceptor_run_cnt{0};
+
+    static uint32_t get_a(WakeFSM& f) { return f.a; }
+    static uint32_t get_b(WakeFSM& f) { return f.b; }
+};
+
+class WakeInterceptor : public interceptor<WakeFSM, WakeInterceptor> {
+public:
+    static etl::fsm_state_id_t on_enter_state(FSMType&) { return No_State_Change; }
+    static etl::fsm_state_id_t on_run_state(FSMType& f) { f.interceptor_run_cnt++; return No_State_Change; }
+    static void on_exit_state(FSMType&) {}
+};
+
+// W0: waits for a == 5 -> W1
+class W0 : public state<WakeFSM, W0, SID0>,
+           public interceptor_pack<WakeInterceptor>
+{
+public:
+    static constexpr afsm::wake_fn<WakeFSM> wake_on[] = { WakeFSM::get_a, WakeFSM::get_b };
+
+    static etl::fsm_state_id_t on_enter_state(FSMType&) { return No_State_Change; }
+    static etl::fsm_state_id_t on_run_state(FSMType& f) {
+        f.run_cnt[STATE_ID]++;
+        if (f.a == 5) return SID1;
+        return No_State_Change;
+    }
+    static void on_exit_state(FSMType&) {}
+};
+
+// W1: no wake conditions, runs every time
+class W1 : public state<WakeFSM, W1, SID1> {
+public:
+    static etl::fsm_state_id_t on_enter_state(FSMType&) { return No_State_Change; }
+    static etl::fsm_state_id_t on_run_state(FSMType& f) { f.run_cnt[STATE_ID]++; return No_State_Change; }
+    static void on_exit_state(FSMType&) {}
+};
+
+using WakePack = state_pack<W0, W1>;
+static_assert(WakePack::max_wake_count == 2, "");
+static_assert(sizeof(fsm<TestFSM>) < sizeof(fsm<TestFSM, 4>), "No RAM for wake values without slots");
+
+TEST(TickFsmWake, SkipsRunUntilConditionChanges) {
+    WakeFSM fsm;
+    fsm.set_states<WakePack>(SID0);
+
+    for (int i = 0; i < 5; i++) { fsm.run(); }
+    EXPECT_EQ(fsm.run_cnt[SID0], 1);
+    EXPECT_EQ(fsm.run_calls, 1u);
+    EXPECT_EQ(fsm.run_skips, 4u);
+
+    fsm.b = 1;
+    fsm.run();
+    fsm.run();
+    EXPECT_EQ(fsm.run_cnt[SID0], 2);
+
+    fsm.a = 5;
+    fsm.run();
+    EXPECT_EQ(fsm.get_state_id(), SID1);
+}
+
+TEST(TickFsmWake, InterceptorsRunWhileSleeping) {
+    WakeFSM fsm;
+    fsm.set_states<WakePack>(SID0);
+
+    for (int i = 0; i < 3; i++) { fsm.run(); }
+    EXPECT_EQ(fsm.run_cnt[SID0], 1);
+    EXPECT_EQ(fsm.interceptor_run_cnt, 3);
+}
+
+TEST(TickFsmWake, StateChangeDropsConditions) {
+    WakeFSM fsm;
+    fsm.set_states<WakePack>(SID0);
+    fsm.run();
+
+    // States without conditions run every time
+    fsm.change_state(SID1);
+    fsm.run();
+    fsm.run();
+    EXPECT_EQ(fsm.run_cnt[SID1], 2);
+
+    // Same values as before, but the state is entered again
+    fsm.change_state(SID0);
+    fsm.run();
+    EXPECT_EQ(fsm.run_cnt[SID0], 2);
+    fsm.run();
+    EXPECT_EQ(fsm.run_cnt[SID0], 2);
+
+    // Re-enter drops them too
+    fsm.change_state(SID0, true);
+    fsm.run();
+    EXPECT_EQ(fsm.run_cnt[SID0], 3);
+}
+
+TEST(TickFsmWake, WakeForcesRun) {
+    WakeFSM fsm;
+    fsm.set_states<WakePack>(SID0);
+    fsm.run();
+    fsm.run();
+    EXPECT_EQ(fsm.run_cnt[SID0], 1);
+
+    fsm.wake();
+    fsm.run();
+    EXPECT_EQ(fsm.run_cnt[SID0], 2);
+    fsm.run();
+    EXPECT_EQ(fsm.run_cnt[SID0], 2);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,103 @@
+// All test_afsm cases, with the inline dispatch backend
+#define AFSM_TEST_DISPATCH afsm::inline_dispatch
+#include "../test_afsm/test_afsm.cpp"
+
+#include <chrono>
+#include <cstdio>
+
+//
+// Both backends on the same state machine: same behavior, and timings
+//
+
+template<typename Dispatch>
+class BenchFSM : public fsm<BenchFSM<Dispatch>, 0, Dispatch> {
+public:
+    uint32_t ticks{0};
+    uint32_t enters{0};
+    uint32_t exits{0};
+    uint32_t intercepted{0};
+    uint32_t trace{0};
+};
+
+template<typename Dispatch>
+class BenchInterceptor : public interceptor<BenchFSM<Dispatch>, BenchInterceptor<Dispatch>> {
+public:
+    using FSM = BenchFSM<Dispatch>;
+    static etl::fsm_state_id_t on_enter_state(FSM& f) { f.intercepted++; return afsm::No_State_Change; }
+    static etl::fsm_state_id_t on_run_state(FSM& f) { f.intercepted++; return afsm::No_State_Change; }
+    static void on_exit_state(FSM& f) { f.intercepted++; }
+};
+
+// Small states, like most PE / PRL ones: check a condition, switch to the
+// next state sometimes
+template<typename Dispatch, etl::fsm_state_id_t ID, etl::fsm_state_id_t Count>
+class BenchState : public state<BenchFSM<Dispatch>, BenchState<Dispatch, ID, Count>, ID> {
+public:
+    using FSM = BenchFSM<Dispatch>;
+    static etl::fsm_state_id_t on_enter_state(FSM& f) { f.enters++; return afsm::No_State_Change; }
+    static etl::fsm_state_id_t on_run_state(FSM& f) {
+        f.trace = f.trace * 31 + ID;
+        if (++f.ticks % (ID + 3) == 0) { return (ID + 1) % Count; }
+        return afsm::No_State_Change;
+    }
+    static void on_exit_state(FSM& f) { f.exits++; }
+};
+
+template<typename Dispatch, etl::fsm_state_id_t ID, etl::fsm_state_id_t Count>
+class BenchInterceptedState :
+    public BenchState<Dispatch, ID, Count>,
+    public interceptor_pack<BenchInterceptor<Dispatch>>
+{
+public:
+    static constexpr etl::fsm_state_id_t STATE_ID = ID;
+};
+
+template<typename D>
+using BenchPack = state_pack<
+    BenchState<D, 0, 8>,
+    BenchInterceptedState<D, 1, 8>,
+    BenchState<D, 2, 8>,
+    BenchState<D, 3, 8>,
+    BenchInterceptedState<D, 4, 8>,
+    BenchState<D, 5, 8>,
+    BenchState<D, 6, 8>,
+    BenchState<D, 7, 8>>;
+
+template<typename Dispatch>
+static double bench_ns_per_run(BenchFSM<Dispatch>& fsm, uint32_t runs) {
+    fsm.template set_states<BenchPack<Dispatch>>(0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < runs; i++) { fsm.run(); }
+    auto t1 = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / runs;
+}
+
+TEST(AfsmDispatch, BackendsMatch) {
+    static constexpr uint32_t runs = 2000000;
+    BenchFSM<afsm::table_dispatch> table, table_warmup;
+    BenchFSM<afsm::inline_dispatch> inlined, inlined_warmup;
+
+    bench_ns_per_run(table_warmup, runs / 10);
+    bench_ns_per_run(inlined_warmup, runs / 10);
+
+    auto table_ns = bench_ns_per_run(table, runs);
+    auto inline_ns = bench_ns_per_run(inlined, runs);
+
+    EXPECT_EQ(table.get_state_id(), inlined.get_state_id());
+    EXPECT_EQ(table.ticks, inlined.ticks);
+    EXPECT_EQ(table.enters, inlined.enters);
+    EXPECT_EQ(table.exits, inlined.exits);
+    EXPECT_EQ(table.intercepted, inlined.intercepted);
+    EXPECT_EQ(table.trace, inlined.trace);
+    EXPECT_EQ(table.run_calls, inlined.run_calls);
+
+    printf("afsm run(): table %.2f ns, inline %.2f ns (x%.2f)\n",
+        table_ns, inline_ns, table_ns / inline_ns);
+    printf("afsm fsm object: table %zu bytes, inline %zu bytes\n",
+        sizeof(fsm<TestFSM, 0, afsm::table_dispatch>),
+        sizeof(fsm<TestFSM, 0, afsm::inline_dispatch>));
+
+    EXPECT_LE(sizeof(fsm<TestFSM, 0, afsm::inline_dispatch>), sizeof(fsm<TestFSM, 0, afsm::table_dispatch>));
+}
@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
 #include "pd/utils/atomic_bits.h"
+#include "pd/utils/atomic_enum_bits.h"
 
 TEST(AtomicBitsTest, ConstructorInitializesToZero) {
     AtomicBits<32> bits;
@@ -170,6 +175,209 @@ TEST(AtomicBitsTest, MultipleBitsOperations) {
     }
 }
 
+TEST(AtomicBitsTest, MaskTests) {
+    AtomicBits<32> bits;
+    bits.set(1);
+    bits.set(3);
+
+    EXPECT_TRUE(bits.test_any(0b1010));
+    EXPECT_TRUE(bits.test_any(0b0011));
+    EXPECT_FALSE(bits.test_any(0b0101));
+
+    EXPECT_TRUE(bits.test_all(0b1010));
+    EXPECT_FALSE(bits.test_all(0b1011));
+
+    // bit 1 set, bit 0 clear
+    EXPECT_TRUE(bits.test_match(0b0011, 0b0010));
+    EXPECT_FALSE(bits.test_match(0b1011, 0b0010));
+}
+
+TEST(AtomicBitsTest, FetchAndSetClear) {
+    AtomicBits<32> bits;
+    bits.set(2);
+
+    EXPECT_EQ(bits.fetch_and_set(0b0110), 0b0100u);
+    EXPECT_EQ(bits.load_word(), 0b0110u);
+
+    // Returns only bits of the mask
+    EXPECT_EQ(bits.fetch_and_clear(0b0011), 0b0010u);
+    EXPECT_EQ(bits.load_word(), 0b0100u);
+    EXPECT_EQ(bits.fetch_and_clear(0b0011), 0u);
+}
+
+TEST(AtomicBitsTest, CompareExchange) {
+    AtomicBits<32> bits;
+    bits.set(0);
+
+    uint32_t expected = 0b01;
+    EXPECT_TRUE(bits.compare_exchange(expected, 0b10));
+    EXPECT_EQ(bits.load_word(), 0b10u);
+
+    // Fails, and reports the current value
+    expected = 0b01;
+    EXPECT_FALSE(bits.compare_exchange(expected, 0b11));
+    EXPECT_EQ(expected, 0b10u);
+    EXPECT_EQ(bits.load_word(), 0b10u);
+}
+
+TEST(AtomicBitsTest, WordOpsOnSecondWord) {
+    AtomicBits<64> bits;
+    bits.set(33);
+
+    EXPECT_FALSE(bits.test_any(0b10, 0));
+    EXPECT_TRUE(bits.test_any(0b10, 1));
+    EXPECT_EQ(bits.fetch_and_clear(0b10, 1), 0b10u);
+    EXPECT_FALSE(bits.test(33));
+
+    // Out of range word is ignored
+    EXPECT_EQ(bits.fetch_and_set(1, 2), 0u);
+    uint32_t expected = 0;
+    EXPECT_FALSE(bits.compare_exchange(expected, 1, 2));
+}
+
+enum class TEST_FLAG { A, B, C, D, _Count };
+using TestFlags = AtomicEnumBits<TEST_FLAG>;
+
+TEST(AtomicEnumBitsTest, MaskOps) {
+    static_assert(TestFlags::mask(TEST_FLAG::A, TEST_FLAG::C) == 0b0101, "");
+    static_assert(TestFlags::mask() == 0, "");
+
+    TestFlags flags;
+    flags.set(TEST_FLAG::B);
+    flags.set(TEST_FLAG::C);
+
+    EXPECT_TRUE(flags.test_any(TestFlags::mask(TEST_FLAG::A, TEST_FLAG::B)));
+    EXPECT_FALSE(flags.test_any(TestFlags::mask(TEST_FLAG::A, TEST_FLAG::D)));
+    EXPECT_TRUE(flags.test_all(TestFlags::mask(TEST_FLAG::B, TEST_FLAG::C)));
+    EXPECT_FALSE(flags.test_all(TestFlags::mask(TEST_FLAG::A, TEST_FLAG::B)));
+    EXPECT_TRUE(flags.test_match(TestFlags::mask(TEST_FLAG::A, TEST_FLAG::B),
+                                 TestFlags::mask(TEST_FLAG::B)));
+
+    EXPECT_EQ(flags.fetch_and_clear(TestFlags::mask(TEST_FLAG::A, TEST_FLAG::B)),
+              TestFlags::mask(TEST_FLAG::B));
+    EXPECT_EQ(flags.snapshot(), TestFlags::mask(TEST_FLAG::C));
+
+    EXPECT_EQ(flags.fetch_and_set(TestFlags::mask(TEST_FLAG::C, TEST_FLAG::D)),
+              TestFlags::mask(TEST_FLAG::C));
+
+    uint32_t expected = TestFlags::mask(TEST_FLAG::C, TEST_FLAG::D);
+    EXPECT_TRUE(flags.compare_exchange(expected, TestFlags::mask(TEST_FLAG::A)));
+    EXPECT_TRUE(flags.test(TEST_FLAG::A));
+    EXPECT_FALSE(flags.test(TEST_FLAG::D));
+}
+
+// Writer moves a token between A and B with CAS, so exactly one of them is
+// always set. Mask readers must never see another combination. Bit-by-bit
+// readers can (counted, for information only).
+TEST(AtomicBitsStressTest, MaskReadsAreNotTorn) {
+    constexpr int ITERATIONS = 200000;
+    const uint32_t A = TestFlags::mask(TEST_FLAG::A);
+    const uint32_t B = TestFlags::mask(TEST_FLAG::B);
+
+    TestFlags flags;
+    flags.set(TEST_FLAG::A);
+    std::atomic<bool> done{false};
+    std::atomic<int> torn_masked{0};
+    std::atomic<int> torn_bitwise{0};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; t++) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                auto v = flags.snapshot() & (A | B);
+                if (v != A && v != B) { torn_masked++; }
+                if (flags.test_all(A | B) || !flags.test_any(A | B)) { torn_masked++; }
+
+                bool a = flags.test(TEST_FLAG::A);
+                bool b = flags.test(TEST_FLAG::B);
+                if (a == b) { torn_bitwise++; }
+            }
+        });
+    }
+
+    std::thread writer([&] {
+        for (int i = 0; i < ITERATIONS; i++) {
+            uint32_t expected = flags.snapshot();
+            uint32_t desired = (expected & A) ? (expected & ~A) | B : (expected & ~B) | A;
+            while (!flags.compare_exchange(expected, desired)) {
+                desired = (expected & A) ? (expected & ~A) | B : (expected & ~B) | A;
+            }
+        }
+        done = true;
+    });
+
+    writer.join();
+    for (auto& r : readers) { r.join(); }
+
+    EXPECT_EQ(torn_masked.load(), 0);
+    printf("Torn reads: masked %d, bit by bit %d\n", torn_masked.load(), torn_bitwise.load());
+}
+
+// Producers set their own flags, the consumer takes all at once. Every
+// set that found the flag clear must be consumed exactly once.
+TEST(AtomicBitsStressTest, FetchAndClearLosesNothing) {
+    constexpr int PRODUCERS = 3;
+    constexpr int ITERATIONS = 100000;
+    AtomicBits<32> bits;
+
+    std::atomic<int> produced[PRODUCERS]{};
+    std::atomic<bool> done{false};
+    int consumed[PRODUCERS]{};
+
+    auto consume = [&] {
+        auto got = bits.fetch_and_clear((1u << PRODUCERS) - 1);
+        for (int i = 0; i < PRODUCERS; i++) {
+            if (got & (1u << i)) { consumed[i]++; }
+        }
+    };
+
+    std::thread consumer([&] {
+        while (!done.load()) { consume(); }
+        consume();
+    });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < ITERATIONS; i++) {
+                if (bits.fetch_and_set(1u << p) == 0) { produced[p]++; }
+            }
+        });
+    }
+    for (auto& t : producers) { t.join(); }
+    done = true;
+    consumer.join();
+
+    for (int p = 0; p < PRODUCERS; p++) {
+        EXPECT_EQ(consumed[p], produced[p].load()) << "producer " << p;
+        EXPECT_GT(consumed[p], 0);
+    }
+}
+
+// Threads increment a counter in the upper half of the word with CAS,
+// while others toggle low bits. No update may be lost.
+TEST(AtomicBitsStressTest, CompareExchangeCounter) {
+    constexpr int THREADS = 4;
+    constexpr int ITERATIONS = 10000; // fits 16-bit counter
+    AtomicBits<32> bits;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < ITERATIONS; i++) {
+                uint32_t expected = bits.load_word();
+                while (!bits.compare_exchange(expected, expected + (1u << 16))) {}
+                bits.set(size_t(t));
+                bits.clear(size_t(t));
+            }
+        });
+    }
+    for (auto& t : threads) { t.join(); }
+
+    EXPECT_EQ(bits.load_word() >> 16, uint32_t(THREADS * ITERATIONS));
+    EXPECT_EQ(bits.load_word() & 0xFFFF, 0u);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
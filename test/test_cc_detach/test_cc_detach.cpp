@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+// Fast detach checks need `PD_TC_CC_DETACH_DEBOUNCE_MS` > 0, run the
+// `test-desktop-cc-detach` env. The default build checks that VBUS alone
+// is used.
+
+static uint32_t detach_time(SimStack& sim, uint32_t max_ms) {
+    uint32_t start = FakeDriver::now;
+    if (!sim.run_until([&sim]{ return sim.dpm.has_event(MSG_TO_DPM__CABLE_DETACHED); }, max_ms)) {
+        return UINT32_MAX;
+    }
+    return FakeDriver::now - start;
+}
+
+// Source removed Rp, but VBUS has not decayed yet
+static void open_cc(SimStack& sim) {
+    sim.driver.cc1 = TCPC_CC_LEVEL::NONE;
+}
+
+#if PD_TC_CC_DETACH_DEBOUNCE_MS > 0
+
+static void restore_cc(SimStack& sim) {
+    sim.driver.cc1 = TCPC_CC_LEVEL::RP_3_0;
+}
+
+// Poll period of the active CC, see TC_CC_DETACH_POLL
+static constexpr uint32_t POLL_MS = 5;
+
+TEST(CcDetachTest, DetachByCcOpen) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+    sim.dpm.events.clear();
+
+    open_cc(sim);
+    auto t = detach_time(sim, 200);
+
+    // Not earlier than debounce, and not later than debounce + 2 polls
+    EXPECT_GE(t, uint32_t(PD_TC_CC_DETACH_DEBOUNCE_MS));
+    EXPECT_LE(t, uint32_t(PD_TC_CC_DETACH_DEBOUNCE_MS + 2 * POLL_MS));
+    EXPECT_TRUE(sim.driver.vbus_ok);
+    EXPECT_FALSE(sim.port.is_attached);
+}
+
+TEST(CcDetachTest, GlitchRestartsDebounce) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+    sim.dpm.events.clear();
+
+    // Two open periods, each shorter than debounce, total is longer
+    const uint32_t open_ms = PD_TC_CC_DETACH_DEBOUNCE_MS - POLL_MS;
+
+    open_cc(sim);
+    sim.run_ms(open_ms);
+    restore_cc(sim);
+    sim.run_ms(2 * POLL_MS);
+    open_cc(sim);
+    sim.run_ms(open_ms);
+    restore_cc(sim);
+    sim.run_ms(100);
+
+    EXPECT_FALSE(sim.dpm.has_event(MSG_TO_DPM__CABLE_DETACHED));
+    EXPECT_TRUE(sim.port.is_attached);
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+}
+
+#else
+
+TEST(CcDetachTest, DisabledByDefault) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+    sim.dpm.events.clear();
+
+    // No CC polling, open CC is ignored while VBUS is present
+    open_cc(sim);
+    sim.run_ms(200);
+    EXPECT_FALSE(sim.dpm.has_event(MSG_TO_DPM__CABLE_DETACHED));
+    EXPECT_TRUE(sim.port.is_attached);
+
+    sim.unplug();
+    EXPECT_LE(detach_time(sim, 200), 1u);
+}
+
+#endif
+
+// Both modes
+TEST(CcDetachTest, DetachByVbus) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+    sim.dpm.events.clear();
+
+    // VBUS loss is reported by the driver and handled at once
+    sim.driver.vbus_ok = false;
+    sim.task.set_event(Task::EVENT_WAKEUP_MSK);
+    EXPECT_LE(detach_time(sim, 200), 1u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,265 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "pd/data_objects.h"
+#include "pd/utils/dobj_codec.h"
+#include "pd/utils/dobj_utils.h"
+
+using namespace pd;
+
+//
+// Compile time checks against known raw values
+//
+
+// Fixed 5V 3A
+static_assert(dobj::pdo_fixed::encode(5000, 3000) == 0x0001912Cu, "");
+static_assert(dobj::pdo_fixed::get_mv(0x0801912Cu) == 5000, "");
+static_assert(dobj::pdo_fixed::get_ma(0x0801912Cu) == 3000, "");
+static_assert(dobj::pdo_fixed::unconstrained_power::get(0x0801912Cu) == 1, "");
+static_assert(dobj::pdo_fixed::epr_capable::get(0x0801912Cu) == 0, "");
+
+// PPS 3.3-11V 3A
+static_assert(dobj::pdo_spr_pps::encode(3300, 11000, 3000) == 0xC0DC213Cu, "");
+static_assert(dobj::pdo_spr_pps::get_mv_min(0xC0DC213Cu) == 3300, "");
+static_assert(dobj::pdo_spr_pps::get_mv_max(0xC0DC213Cu) == 11000, "");
+static_assert(dobj::pdo_spr_pps::get_ma(0xC0DC213Cu) == 3000, "");
+
+// EPR AVS 15-28V 140W
+static_assert(dobj::pdo_epr_avs::encode(15000, 28000, 140) == 0xD230968Cu, "");
+static_assert(dobj::pdo_epr_avs::pdp::get(0xD230968Cu) == 140, "");
+
+// Variants
+static_assert(dobj::get_pdo_variant(0) == PDO_VARIANT::UNKNOWN, "");
+static_assert(dobj::get_pdo_variant(0x0001912Cu) == PDO_VARIANT::FIXED, "");
+static_assert(dobj::get_pdo_variant(0xC0DC213Cu) == PDO_VARIANT::APDO_PPS, "");
+static_assert(dobj::get_pdo_variant(0xD230968Cu) == PDO_VARIANT::APDO_EPR_AVS, "");
+static_assert(dobj::get_pdo_variant(0x40000000u) == PDO_VARIANT::UNKNOWN, ""); // Battery
+static_assert(dobj::get_pdo_variant(dobj::make_pdo_variant_bits(PDO_VARIANT::APDO_SPR_AVS)) ==
+    PDO_VARIANT::APDO_SPR_AVS, "");
+static_assert(dobj_utils::get_src_pdo_variant(0xC0DC213Cu) == PDO_VARIANT::APDO_PPS, "");
+
+// Sink PDO 1 flags, [rev3.2] Table 6.17
+static_assert(dobj::snk_pdo_fixed::higher_capability::set(
+    dobj::snk_pdo_fixed::unconstrained_power::set(
+        dobj::snk_pdo_fixed::encode(5000, 3000), 1), 1) == 0x1801912Cu, "");
+
+// RDOs
+static_assert(dobj::rdo::obj_position::set(
+    dobj::rdo_fixed::set_limits(0, 3000, 3000), 1) == 0x1004B12Cu, "");
+static_assert(dobj::rdo_pps::set_limits(0, 9000, 2000) == 0x00038428u, "");
+// AVS voltage: 25mV units with two low bits zero, i.e. 100mV effective step
+static_assert(dobj::rdo_avs::set_limits(0, 15050, 3000) == 0x0004B03Cu, "");
+static_assert(dobj::rdo::obj_position::get(0x1004B12Cu) == 1, "");
+
+// Headers and misc objects
+static_assert((dobj::ext_header::chunked::make(1) |
+    dobj::ext_header::chunk_number::make(1) |
+    dobj::ext_header::data_size::make(40)) == 0x8828, "");
+static_assert(dobj::eprmdo::encode(EPR_MODE_ACTION::ENTER, 140) == 0x018C0000u, "");
+static_assert(dobj::bistdo::mode::get(0x50000000u) == 5, "");
+
+// Setters replace only their own field, and truncate too wide values
+static_assert(dobj::field<4, 4>::set(0xFFFFFFFFu, 0) == 0xFFFFFF0Fu, "");
+static_assert(dobj::field<4, 4>::set(0, 0x1F) == 0xF0u, "");
+static_assert(dobj::field<31, 1>::MASK == 1u, "");
+static_assert(dobj::field<0, 32>::MASK == 0xFFFFFFFFu, "");
+
+// Compile time PDO table
+constexpr uint32_t sink_pdos[] = {
+    dobj::snk_pdo_fixed::encode(5000, 3000),
+    dobj::snk_pdo_fixed::encode(9000, 3000),
+    dobj::snk_pdo_spr_pps::encode(5000, 21000, 5000),
+};
+static_assert(dobj::pdo_fixed::get_mv(sink_pdos[1]) == 9000, "");
+static_assert(dobj::get_pdo_variant(sink_pdos[2]) == PDO_VARIANT::APDO_PPS, "");
+
+//
+// Runtime cross-checks against the bitfield unions. GCC / Clang allocate
+// bitfields from LSB, as this project expects, so both must agree.
+//
+
+class DobjCodecTest : public ::testing::Test {
+protected:
+    std::mt19937 rng{12345};
+    uint32_t next() { return rng(); }
+};
+
+TEST_F(DobjCodecTest, SrcPdoFieldsMatchUnions) {
+    for (int i = 0; i < 10000; i++) {
+        auto raw = next();
+
+        PDO_FIXED fixed{raw};
+        EXPECT_EQ(dobj::pdo_fixed::max_current::get(raw), fixed.max_current);
+        EXPECT_EQ(dobj::pdo_fixed::voltage::get(raw), fixed.voltage);
+        EXPECT_EQ(dobj::pdo_fixed::peak_current::get(raw), fixed.peak_current);
+        EXPECT_EQ(dobj::pdo_fixed::epr_capable::get(raw), fixed.epr_capable);
+        EXPECT_EQ(dobj::pdo_fixed::unchunked_ext_msg_supported::get(raw), fixed.unchunked_ext_msg_supported);
+        EXPECT_EQ(dobj::pdo_fixed::dual_role_data::get(raw), fixed.dual_role_data);
+        EXPECT_EQ(dobj::pdo_fixed::usb_comms_capable::get(raw), fixed.usb_comms_capable);
+        EXPECT_EQ(dobj::pdo_fixed::unconstrained_power::get(raw), fixed.unconstrained_power);
+        EXPECT_EQ(dobj::pdo_fixed::usb_suspend_supported::get(raw), fixed.usb_suspend_supported);
+        EXPECT_EQ(dobj::pdo_fixed::dual_role_power::get(raw), fixed.dual_role_power);
+        EXPECT_EQ(dobj::pdo_type::get(raw), fixed.pdo_type);
+
+        PDO_SPR_PPS pps{raw};
+        EXPECT_EQ(dobj::pdo_spr_pps::max_current::get(raw), pps.max_current);
+        EXPECT_EQ(dobj::pdo_spr_pps::min_voltage::get(raw), pps.min_voltage);
+        EXPECT_EQ(dobj::pdo_spr_pps::max_voltage::get(raw), pps.max_voltage);
+        EXPECT_EQ(dobj::pdo_spr_pps::pps_power_limited::get(raw), pps.pps_power_limited);
+        EXPECT_EQ(dobj::apdo_subtype::get(raw), pps.apdo_subtype);
+
+        PDO_SPR_AVS spr_avs{raw};
+        EXPECT_EQ(dobj::pdo_spr_avs::max_current_20v::get(raw), spr_avs.max_current_20v);
+        EXPECT_EQ(dobj::pdo_spr_avs::max_current_15v::get(raw), spr_avs.max_current_15v);
+        EXPECT_EQ(dobj::pdo_spr_avs::peak_current::get(raw), spr_avs.peak_current);
+
+        PDO_EPR_AVS epr_avs{raw};
+        EXPECT_EQ(dobj::pdo_epr_avs::pdp::get(raw), epr_avs.pdp);
+        EXPECT_EQ(dobj::pdo_epr_avs::min_voltage::get(raw), epr_avs.min_voltage);
+        EXPECT_EQ(dobj::pdo_epr_avs::max_voltage::get(raw), epr_avs.max_voltage);
+        EXPECT_EQ(dobj::pdo_epr_avs::peak_current::get(raw), epr_avs.peak_current);
+    }
+}
+
+TEST_F(DobjCodecTest, SnkPdoFieldsMatchUnions) {
+    for (int i = 0; i < 10000; i++) {
+        auto raw = next();
+
+        SNK_PDO_FIXED fixed{raw};
+        EXPECT_EQ(dobj::snk_pdo_fixed::max_current::get(raw), fixed.max_current);
+        EXPECT_EQ(dobj::snk_pdo_fixed::voltage::get(raw), fixed.voltage);
+        EXPECT_EQ(dobj::snk_pdo_fixed::frs_required::get(raw), fixed.frs_required);
+        EXPECT_EQ(dobj::snk_pdo_fixed::dual_role_data::get(raw), fixed.dual_role_data);
+        EXPECT_EQ(dobj::snk_pdo_fixed::usb_comms_capable::get(raw), fixed.usb_comms_capable);
+        EXPECT_EQ(dobj::snk_pdo_fixed::unconstrained_power::get(raw), fixed.unconstrained_power);
+        EXPECT_EQ(dobj::snk_pdo_fixed::higher_capability::get(raw), fixed.higher_capability);
+        EXPECT_EQ(dobj::snk_pdo_fixed::dual_role_power::get(raw), fixed.dual_role_power);
+
+        SNK_PDO_SPR_PPS pps{raw};
+        EXPECT_EQ(dobj::snk_pdo_spr_pps::max_current::get(raw), pps.max_current);
+        EXPECT_EQ(dobj::snk_pdo_spr_pps::min_voltage::get(raw), pps.min_voltage);
+        EXPECT_EQ(dobj::snk_pdo_spr_pps::max_voltage::get(raw), pps.max_voltage);
+
+        SNK_PDO_EPR_AVS epr_avs{raw};
+        EXPECT_EQ(dobj::snk_pdo_epr_avs::pdp::get(raw), epr_avs.pdp);
+        EXPECT_EQ(dobj::snk_pdo_epr_avs::min_voltage::get(raw), epr_avs.min_voltage);
+        EXPECT_EQ(dobj::snk_pdo_epr_avs::max_voltage::get(raw), epr_avs.max_voltage);
+    }
+}
+
+TEST_F(DobjCodecTest, RdoFieldsMatchUnions) {
+    for (int i = 0; i < 10000; i++) {
+        auto raw = next();
+
+        RDO_ANY any{raw};
+        EXPECT_EQ(dobj::rdo::epr_capable::get(raw), any.epr_capable);
+        EXPECT_EQ(dobj::rdo::unchunked_ext_msg_supported::get(raw), any.unchunked_ext_msg_supported);
+        EXPECT_EQ(dobj::rdo::no_usb_suspend::get(raw), any.no_usb_suspend);
+        EXPECT_EQ(dobj::rdo::usb_comm_capable::get(raw), any.usb_comm_capable);
+        EXPECT_EQ(dobj::rdo::capability_mismatch::get(raw), any.capability_mismatch);
+        EXPECT_EQ(dobj::rdo::obj_position::get(raw), any.obj_position);
+
+        RDO_FIXED fixed{raw};
+        EXPECT_EQ(dobj::rdo_fixed::max_current::get(raw), fixed.max_current);
+        EXPECT_EQ(dobj::rdo_fixed::operating_current::get(raw), fixed.operating_current);
+
+        RDO_PPS pps{raw};
+        EXPECT_EQ(dobj::rdo_pps::operating_current::get(raw), pps.operating_current);
+        EXPECT_EQ(dobj::rdo_pps::output_voltage::get(raw), pps.output_voltage);
+
+        RDO_AVS avs{raw};
+        EXPECT_EQ(dobj::rdo_avs::operating_current::get(raw), avs.operating_current);
+        EXPECT_EQ(dobj::rdo_avs::output_voltage::get(raw), avs.output_voltage);
+    }
+}
+
+TEST_F(DobjCodecTest, MiscFieldsMatchUnions) {
+    for (int i = 0; i < 10000; i++) {
+        auto raw = next();
+        auto raw16 = uint16_t(raw);
+
+        PD_HEADER hdr{raw16};
+        EXPECT_EQ(dobj::header::message_type::get(raw16), hdr.message_type);
+        EXPECT_EQ(dobj::header::port_data_role::get(raw16), hdr.port_data_role);
+        EXPECT_EQ(dobj::header::spec_revision::get(raw16), hdr.spec_revision);
+        EXPECT_EQ(dobj::header::port_power_role::get(raw16), hdr.port_power_role);
+        EXPECT_EQ(dobj::header::message_id::get(raw16), hdr.message_id);
+        EXPECT_EQ(dobj::header::data_obj_count::get(raw16), hdr.data_obj_count);
+        EXPECT_EQ(dobj::header::extended::get(raw16), hdr.extended);
+
+        PD_EXT_HEADER ehdr{raw16};
+        EXPECT_EQ(dobj::ext_header::data_size::get(raw16), ehdr.data_size);
+        EXPECT_EQ(dobj::ext_header::request_chunk::get(raw16), ehdr.request_chunk);
+        EXPECT_EQ(dobj::ext_header::chunk_number::get(raw16), ehdr.chunk_number);
+        EXPECT_EQ(dobj::ext_header::chunked::get(raw16), ehdr.chunked);
+
+        EPRMDO mdo{raw};
+        EXPECT_EQ(dobj::eprmdo::data::get(raw), mdo.data);
+        EXPECT_EQ(dobj::eprmdo::action::get(raw), mdo.action);
+
+        ECDB ecdb{raw16};
+        EXPECT_EQ(dobj::ecdb::type::get(raw16), ecdb.type);
+        EXPECT_EQ(dobj::ecdb::data::get(raw16), ecdb.data);
+
+        BISTDO bdo{raw};
+        EXPECT_EQ(dobj::bistdo::mode::get(raw), bdo.mode);
+
+        RMDO rmdo{raw};
+        EXPECT_EQ(dobj::rmdo::ver_minor::get(raw), rmdo.ver_minor);
+        EXPECT_EQ(dobj::rmdo::ver_major::get(raw), rmdo.ver_major);
+        EXPECT_EQ(dobj::rmdo::rev_minor::get(raw), rmdo.rev_minor);
+        EXPECT_EQ(dobj::rmdo::rev_major::get(raw), rmdo.rev_major);
+    }
+}
+
+TEST_F(DobjCodecTest, SetterMatchesUnionAssignment) {
+    for (int i = 0; i < 10000; i++) {
+        auto raw = next();
+        auto value = next();
+
+        PDO_FIXED fixed{raw};
+        fixed.voltage = value;
+        EXPECT_EQ(dobj::pdo_fixed::voltage::set(raw, value), fixed.raw_value);
+
+        RDO_ANY any{raw};
+        any.obj_position = value;
+        EXPECT_EQ(dobj::rdo::obj_position::set(raw, value), any.raw_value);
+
+        PD_EXT_HEADER ehdr{uint16_t(raw)};
+        ehdr.chunk_number = value;
+        EXPECT_EQ(dobj::ext_header::chunk_number::set(uint16_t(raw), value), ehdr.raw_value);
+    }
+}
+
+TEST(DobjCodec, RoundTripLimits) {
+    using namespace dobj_utils;
+
+    auto fixed = get_src_pdo_limits(dobj::pdo_fixed::encode(20000, 5000));
+    EXPECT_EQ(fixed.mv_min, 20000u);
+    EXPECT_EQ(fixed.mv_max, 20000u);
+    EXPECT_EQ(fixed.ma, 5000u);
+
+    auto pps = get_src_pdo_limits(dobj::pdo_spr_pps::encode(5000, 21000, 3000));
+    EXPECT_EQ(pps.mv_min, 5000u);
+    EXPECT_EQ(pps.mv_max, 21000u);
+    EXPECT_EQ(pps.ma, 3000u);
+
+    auto spr_avs = get_src_pdo_limits(dobj::pdo_spr_avs::encode(3000, 2250));
+    EXPECT_EQ(spr_avs.mv_min, 9000u);
+    EXPECT_EQ(spr_avs.mv_max, 20000u);
+    EXPECT_EQ(spr_avs.ma, 2250u);
+
+    auto epr_avs = get_src_pdo_limits(dobj::pdo_epr_avs::encode(15000, 48000, 240));
+    EXPECT_EQ(epr_avs.mv_min, 15000u);
+    EXPECT_EQ(epr_avs.mv_max, 48000u);
+    EXPECT_EQ(epr_avs.pdp, 240u);
+
+    // Sink PDO setter writes the same fields
+    uint32_t snk = create_pdo_variant_bits(PDO_VARIANT::APDO_PPS);
+    set_snk_pdo_limits(snk, PDO_LIMITS().set_mv_min(5000).set_mv_max(11000).set_ma(3000));
+    EXPECT_EQ(snk, dobj::snk_pdo_spr_pps::encode(5000, 11000, 3000));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
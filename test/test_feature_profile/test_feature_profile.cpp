@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+// These tests pass with any feature profile. Run `test-desktop` and
+// `test-desktop-spr-minimal` envs to cover both.
+
+TEST(FeatureProfileTest, BufferSizes) {
+    EXPECT_EQ(PD_MSG::MAX_SIZE, size_t(PD_FEATURE_EXTENDED ? MaxExtendedMsgLen : MaxUnchunkedMsgLen));
+    EXPECT_EQ(PDO_LIST{}.max_size(), size_t(PD_FEATURE_EPR ? MaxPdoObjects : MaxPdoObjects_SPR));
+}
+
+TEST(FeatureProfileTest, UnsupportedExtendedMessage) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+
+    // Single-chunk extended message, not supported by the sink in any profile
+    PD_EXT_HEADER ehdr{0};
+    ehdr.chunked = 1;
+    ehdr.data_size = 6;
+
+    auto chunk = sim.make_src_msg(PD_EXT_MSGT::Status, 2);
+    chunk.header.extended = 1;
+    chunk.append16(ehdr.raw_value);
+    chunk.append32(0);
+    chunk.append16(0);
+
+    sim.driver.tx_log.clear();
+    sim.driver.receive(chunk);
+    sim.run_ms(5);
+
+    ASSERT_FALSE(sim.driver.tx_log.empty());
+    EXPECT_TRUE(sim.driver.tx_log.back().is_ctrl_msg(PD_CTRL_MSGT::Not_Supported));
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+}
+
+TEST(FeatureProfileTest, SinkCapsAndRdo) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+
+    auto caps = sim.dpm.get_sink_pdo_list();
+    EXPECT_EQ(caps.size(), size_t(PD_FEATURE_EPR ? MaxPdoObjects : MaxPdoObjects_SPR));
+
+    RDO_ANY rdo{sim.port.rdo_contracted};
+    EXPECT_EQ(rdo.epr_capable, PD_FEATURE_EPR ? 1u : 0u);
+}
+
+TEST(FeatureProfileTest, Bist) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+
+    BISTDO bdo{0};
+    bdo.mode = BIST_MODE::Carrier;
+    auto chunk = sim.make_src_msg(PD_DATA_MSGT::BIST, 1);
+    chunk.append32(bdo.raw_value);
+
+    sim.driver.tx_log.clear();
+    sim.driver.receive(chunk);
+    sim.run_ms(5);
+
+#if PD_FEATURE_BIST
+    EXPECT_TRUE(sim.driver.tx_log.empty());
+#else
+    ASSERT_FALSE(sim.driver.tx_log.empty());
+    EXPECT_TRUE(sim.driver.tx_log.back().is_ctrl_msg(PD_CTRL_MSGT::Not_Supported));
+#endif
+}
+
+// Not a real test, prints RAM used by the stack objects, on host.
+TEST(FeatureProfileTest, Footprint) {
+    printf("Profile: extended=%d epr=%d bist=%d\n",
+        PD_FEATURE_EXTENDED, PD_FEATURE_EPR, PD_FEATURE_BIST);
+    printf("  sizeof(Port) = %zu\n", sizeof(Port));
+    printf("  sizeof(PE)   = %zu\n", sizeof(PE));
+    printf("  sizeof(PRL)  = %zu\n", sizeof(PRL));
+    printf("  sizeof(TC)   = %zu\n", sizeof(TC));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
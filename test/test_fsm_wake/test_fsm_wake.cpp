@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+// Wake conditions of PE/PRL states. Wakeups come without any change for
+// the stack (like foreign driver events), so waiting states should skip
+// their runs.
+struct FsmWakeTest : public ::testing::Test {
+    SimStack sim;
+
+    void SetUp() override {
+        ASSERT_TRUE(sim.connect());
+        sim.run_ms(10);
+        sim.driver.tx_log.clear();
+    }
+
+    void wakeups(int count) {
+        for (int i = 0; i < count; i++) { sim.port.wakeup(); }
+    }
+};
+
+TEST_F(FsmWakeTest, IdleContractSkipsRuns) {
+    auto pe_calls = sim.pe.run_calls;
+    auto pe_skips = sim.pe.run_skips;
+    auto hr_calls = sim.prl.prl_hr.run_calls;
+
+    wakeups(100);
+
+    // Each wakeup runs the FSMs, but waiting states don't check anything
+    EXPECT_EQ(sim.pe.run_calls, pe_calls);
+    EXPECT_EQ(sim.pe.run_skips, pe_skips + 100);
+    EXPECT_EQ(sim.prl.prl_hr.run_calls, hr_calls);
+    EXPECT_TRUE(sim.driver.tx_log.empty());
+}
+
+TEST_F(FsmWakeTest, DpmRequestWakesReady) {
+    wakeups(10);
+    auto pe_calls = sim.pe.run_calls;
+
+    sim.dpm.request_new_power_level();
+    EXPECT_GT(sim.pe.run_calls, pe_calls);
+    ASSERT_FALSE(sim.driver.tx_log.empty());
+    EXPECT_TRUE(sim.driver.tx_log[0].is_data_msg(PD_DATA_MSGT::Request));
+    EXPECT_FALSE(sim.port.dpm_requests.test(DPM_REQUEST_FLAG::NEW_POWER_LEVEL));
+}
+
+TEST_F(FsmWakeTest, MessageWakesReady) {
+    wakeups(10);
+
+    sim.send_ctrl(PD_CTRL_MSGT::Get_Sink_Cap);
+    ASSERT_EQ(sim.driver.tx_log.size(), 1u);
+    EXPECT_TRUE(sim.driver.tx_log[0].is_data_msg(PD_DATA_MSGT::Sink_Capabilities));
+
+    // Back to sleep
+    auto pe_calls = sim.pe.run_calls;
+    wakeups(10);
+    EXPECT_EQ(sim.pe.run_calls, pe_calls);
+}
+
+TEST_F(FsmWakeTest, HardResetAndWaitCapsTimeout) {
+    auto restarted = [&] { return sim.dpm.has_event(MSG_TO_DPM__STARTUP); };
+
+    // No reply to Request => hard reset
+    sim.src_auto_reply = false;
+    sim.dpm.events.clear();
+    sim.dpm.request_new_power_level();
+    ASSERT_TRUE(sim.run_until(restarted, 1000));
+    EXPECT_EQ(sim.driver.hr_sent, 1);
+    EXPECT_TRUE(sim.dpm.has_event(MSG_TO_DPM__TRANSIT_TO_DEFAULT));
+    sim.src_auto_reply = true;
+
+    // Waiting for caps after reset, wakeups are skipped
+    sim.run_ms(10);
+    auto pe_calls = sim.pe.run_calls;
+    wakeups(10);
+    EXPECT_EQ(sim.pe.run_calls, pe_calls);
+
+    // Timer still works: no caps => one more hard reset
+    sim.dpm.events.clear();
+    ASSERT_TRUE(sim.run_until(restarted, 1000));
+    EXPECT_EQ(sim.driver.hr_sent, 2);
+
+    // And the contract is restored after that
+    sim.dpm.events.clear();
+    sim.send_src_caps();
+    EXPECT_TRUE(sim.run_until([&]{ return sim.dpm.has_event(MSG_TO_DPM__SNK_READY); }, 1000));
+}
+
+TEST_F(FsmWakeTest, Benchmark) {
+    constexpr int ITERATIONS = 200000;
+    auto pe_calls = sim.pe.run_calls;
+    auto pe_skips = sim.pe.run_skips;
+
+    auto start = std::chrono::steady_clock::now();
+    wakeups(ITERATIONS);
+    auto end = std::chrono::steady_clock::now();
+    auto sec = std::chrono::duration<double>(end - start).count();
+
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+
+    printf("Idle contract: %.0f wakeups/s, PE on_run_state: %u, skipped: %u\n",
+        ITERATIONS / sec, sim.pe.run_calls - pe_calls, sim.pe.run_skips - pe_skips);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+#include "../common/fake_fusb302.h"
+
+using namespace pd;
+using namespace pd::fusb302;
+
+struct Fusb302SuperloopTest : public ::testing::Test {
+    Port port;
+    FakeFusb302Hal hal;
+    Fusb302Superloop driver{port, hal};
+
+    void SetUp() override { FakeFusb302Hal::now = 1000; }
+};
+
+TEST_F(Fusb302SuperloopTest, SetupWaitsForVbusSync) {
+    hal.vbus_ok = true;
+    driver.setup();
+
+    EXPECT_EQ(hal.setup_calls, 1);
+    EXPECT_FALSE(driver.flags.test(DRV_FLAG::FUSB_SETUP_DONE));
+    EXPECT_EQ(driver.poll(), 2u);
+    EXPECT_FALSE(driver.flags.test(DRV_FLAG::FUSB_SETUP_DONE));
+
+    FakeFusb302Hal::now += 2;
+    EXPECT_EQ(driver.poll(), Fusb302Superloop::NO_DEADLINE);
+    EXPECT_TRUE(driver.flags.test(DRV_FLAG::FUSB_SETUP_DONE));
+    EXPECT_TRUE(driver.is_vbus_ok());
+    EXPECT_EQ(hal.regs[Power::reg], PowerBlock::ALL);
+    EXPECT_EQ(Control0{hal.regs[Control0::reg]}.INT_MASK, 0);
+}
+
+TEST_F(Fusb302SuperloopTest, IsrEventOnlySetsFlag) {
+    driver.setup();
+    run_loop(driver, 5);
+    ASSERT_TRUE(driver.flags.test(DRV_FLAG::FUSB_SETUP_DONE));
+
+    auto ops = hal.i2c_ops;
+    hal.set_vbus(true);
+
+    EXPECT_EQ(hal.i2c_ops, ops);
+    EXPECT_TRUE(driver.has_pending_events());
+    EXPECT_FALSE(driver.is_vbus_ok());
+
+    EXPECT_EQ(driver.poll(), Fusb302Superloop::NO_DEADLINE);
+    EXPECT_FALSE(driver.has_pending_events());
+    EXPECT_TRUE(driver.is_vbus_ok());
+}
+
+TEST_F(Fusb302SuperloopTest, ScanCcDeadlines) {
+    driver.setup();
+    run_loop(driver, 5);
+    hal.cc1 = TCPC_CC_LEVEL::RP_3_0;
+
+    TCPC_CC_LEVEL::Type cc1, cc2;
+    driver.req_scan_cc();
+    EXPECT_TRUE(driver.has_pending_events());
+
+    // CC1, then CC2 measurement, each waits 2 ms
+    EXPECT_EQ(driver.poll(), 2u);
+    EXPECT_FALSE(driver.try_scan_cc_result(cc1, cc2));
+    FakeFusb302Hal::now += 1;
+    EXPECT_EQ(driver.poll(), 1u);
+    FakeFusb302Hal::now += 1;
+    EXPECT_EQ(driver.poll(), 2u);
+    FakeFusb302Hal::now += 2;
+    EXPECT_EQ(driver.poll(), Fusb302Superloop::NO_DEADLINE);
+
+    ASSERT_TRUE(driver.try_scan_cc_result(cc1, cc2));
+    EXPECT_EQ(cc1, TCPC_CC_LEVEL::RP_3_0);
+    EXPECT_EQ(cc2, TCPC_CC_LEVEL::NONE);
+}
+
+TEST_F(Fusb302SuperloopTest, RearmDeadline) {
+    driver.setup();
+    run_loop(driver, 5);
+
+    driver.rearm(30);
+    EXPECT_EQ(driver.poll(), 30u);
+    FakeFusb302Hal::now += 10;
+    EXPECT_EQ(driver.poll(), 20u);
+
+    // Timer expired, and not rearmed by anyone
+    FakeFusb302Hal::now += 25;
+    EXPECT_EQ(driver.poll(), Fusb302Superloop::NO_DEADLINE);
+}
+
+TEST_F(Fusb302SuperloopTest, LowPowerMode) {
+    driver.setup();
+    run_loop(driver, 5);
+    ASSERT_TRUE(driver.flags.test(DRV_FLAG::FUSB_SETUP_DONE));
+
+    driver.req_set_low_power(true);
+    driver.poll();
+
+    // Only the wake circuit (VBUSOK) is powered, RX/TX interrupts are
+    // masked, and the timer is stopped
+    EXPECT_EQ(hal.regs[Power::reg], PowerBlock::BANDGAP_WAKE);
+    EXPECT_EQ(Mask1{hal.regs[Mask1::reg]}.M_COLLISION, 1);
+    Maska maska{hal.regs[Maska::reg]};
+    EXPECT_EQ(maska.M_HARDRST, 1);
+    EXPECT_EQ(maska.M_TXSENT, 1);
+    EXPECT_EQ(maska.M_HARDSENT, 1);
+    EXPECT_EQ(maska.M_RETRYFAIL, 1);
+    EXPECT_EQ(Maskb{hal.regs[Maskb::reg]}.M_GCRCSENT, 1);
+    EXPECT_EQ(Mask1{hal.regs[Mask1::reg]}.M_VBUSOK, 0);
+    EXPECT_FALSE(hal.timer_enabled);
+
+    // VBUS still wakes up the driver
+    hal.set_vbus(true);
+    EXPECT_TRUE(driver.has_pending_events());
+    driver.poll();
+    EXPECT_TRUE(driver.is_vbus_ok());
+
+    driver.req_set_low_power(false);
+    driver.poll();
+
+    EXPECT_EQ(hal.regs[Power::reg], PowerBlock::ALL);
+    EXPECT_EQ(Mask1{hal.regs[Mask1::reg]}.M_COLLISION, 0);
+    maska = Maska{hal.regs[Maska::reg]};
+    EXPECT_EQ(maska.M_HARDRST, 0);
+    EXPECT_EQ(maska.M_TXSENT, 0);
+    EXPECT_EQ(maska.M_HARDSENT, 0);
+    EXPECT_EQ(maska.M_RETRYFAIL, 0);
+    EXPECT_EQ(Maskb{hal.regs[Maskb::reg]}.M_GCRCSENT, 0);
+    EXPECT_TRUE(hal.timer_enabled);
+}
+
+TEST_F(Fusb302SuperloopTest, TransmitFitsPacket) {
+    driver.setup();
+    run_loop(driver, 5);
+
+    auto& chunk = driver.get_tx_chunk();
+    chunk.clear();
+    chunk.header.message_type = PD_DATA_MSGT::Sink_Capabilities;
+    chunk.header.data_obj_count = 7;
+    chunk.resize(MaxUnchunkedMsgLen);
+    driver.req_transmit();
+    driver.poll();
+
+    EXPECT_EQ(port.tcpc_tx_status.load(), TCPC_TRANSMIT_STATUS::SUCCEEDED);
+    ASSERT_EQ(hal.tx_log.size(), 1u);
+    EXPECT_EQ(hal.tx_log[0].data_size(), uint32_t(MaxUnchunkedMsgLen));
+}
+
+#if PD_FEATURE_UNCHUNKED_EXT
+// FUSB302 has no unchunked extended messages support, longer data fails
+// the transmit instead of sending a truncated packet
+TEST_F(Fusb302SuperloopTest, TransmitTooLongFails) {
+    driver.setup();
+    run_loop(driver, 5);
+
+    auto& chunk = driver.get_tx_chunk();
+    chunk.clear();
+    chunk.header.extended = 1;
+    chunk.resize(MaxUnchunkedMsgLen + 2);
+    driver.req_transmit();
+    driver.poll();
+
+    EXPECT_EQ(port.tcpc_tx_status.load(), TCPC_TRANSMIT_STATUS::FAILED);
+    EXPECT_TRUE(hal.tx_log.empty());
+}
+#endif
+
+struct SuperloopStack {
+    Port port;
+    FakeFusb302Hal hal;
+    Fusb302Superloop driver{port, hal};
+    FakeDpm dpm{port};
+    Task task{port, driver};
+    PRL prl{port, driver};
+    PE pe{port, dpm, prl, driver};
+    TC tc{port, driver};
+
+    uint8_t src_msg_id{0};
+
+    SuperloopStack() {
+        FakeFusb302Hal::now = 1000;
+        hal.on_transmit = [this](const PD_CHUNK& chunk) {
+            if (chunk.is_data_msg(PD_DATA_MSGT::Request)) {
+                hal.receive(make_src_msg(PD_CTRL_MSGT::Accept, 0));
+                hal.receive(make_src_msg(PD_CTRL_MSGT::PS_RDY, 0));
+            }
+        };
+        task.start(tc, dpm, pe, prl, driver);
+    }
+
+    PD_CHUNK make_src_msg(uint8_t type, uint8_t data_obj_count) {
+        PD_CHUNK chunk{};
+        chunk.header.message_type = type;
+        chunk.header.data_obj_count = data_obj_count;
+        chunk.header.port_power_role = 1;
+        chunk.header.port_data_role = 1;
+        chunk.header.spec_revision = PD_REVISION::REV30;
+        chunk.header.message_id = src_msg_id++ & 7;
+        return chunk;
+    }
+
+    void send_src_caps() {
+        auto chunk = make_src_msg(PD_DATA_MSGT::Source_Capabilities, 1);
+        chunk.append32(0x0801912C); // Fixed 5V 3A
+        hal.receive(chunk);
+    }
+};
+
+TEST(Fusb302SuperloopStackTest, Negotiation) {
+    SuperloopStack sim;
+    run_loop(sim.driver, 100);
+    EXPECT_FALSE(sim.port.is_attached);
+
+    // Detached without VBUS, TC put the chip to low power
+    EXPECT_EQ(sim.hal.regs[Power::reg], PowerBlock::BANDGAP_WAKE);
+    EXPECT_FALSE(sim.hal.timer_enabled);
+
+    sim.hal.cc1 = TCPC_CC_LEVEL::RP_3_0;
+    sim.hal.set_vbus(true);
+
+    bool caps_sent = false;
+    int polls = run_loop(sim.driver, 1000, [&] {
+        if (!caps_sent && sim.port.is_prl_running()) {
+            sim.send_src_caps();
+            caps_sent = true;
+        }
+    });
+
+    EXPECT_TRUE(sim.dpm.has_event(MSG_TO_DPM__SNK_READY));
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+    ASSERT_FALSE(sim.hal.tx_log.empty());
+    EXPECT_TRUE(sim.hal.tx_log[0].is_data_msg(PD_DATA_MSGT::Request));
+
+    // The loop sleeps until deadlines, instead of polling every 1 ms
+    printf("Polls in 1000 ms: %d\n", polls);
+    EXPECT_LT(polls, 50);
+
+    // Full power while attached
+    EXPECT_EQ(sim.hal.regs[Power::reg], PowerBlock::ALL);
+    EXPECT_TRUE(sim.hal.timer_enabled);
+
+    // Request-response after contract
+    sim.hal.tx_log.clear();
+    sim.hal.receive(sim.make_src_msg(PD_CTRL_MSGT::Get_Sink_Cap, 0));
+    run_loop(sim.driver, 10);
+    ASSERT_EQ(sim.hal.tx_log.size(), 1u);
+    EXPECT_TRUE(sim.hal.tx_log[0].is_data_msg(PD_DATA_MSGT::Sink_Capabilities));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+// TC asks the TCPC for low power while detached without VBUS, see
+// TC_DETACHED_State. Chip-level effects are tested with the FUSB302 model
+// in test_fusb302_superloop.
+
+// Real drivers wake up the stack when the chip setup is done
+static void start_detached(SimStack& sim) {
+    sim.task.set_event(Task::EVENT_WAKEUP_MSK);
+    sim.run_ms(10);
+}
+
+TEST(LowPowerTest, RequestedWhenDetachedWithoutVbus) {
+    SimStack sim;
+    start_detached(sim);
+
+    EXPECT_FALSE(sim.port.is_attached);
+    EXPECT_TRUE(sim.driver.low_power);
+    ASSERT_EQ(sim.driver.low_power_log.size(), size_t(1));
+
+    // No repeated requests while nothing changes
+    sim.run_ms(100);
+    EXPECT_EQ(sim.driver.low_power_log.size(), size_t(1));
+}
+
+TEST(LowPowerTest, FullPowerOnVbus) {
+    SimStack sim;
+    start_detached(sim);
+    ASSERT_TRUE(sim.driver.low_power);
+
+    // Woken up by VBUS, before the debounce starts
+    sim.plug();
+    EXPECT_FALSE(sim.driver.low_power);
+    EXPECT_FALSE(sim.port.is_attached);
+
+    ASSERT_TRUE(sim.connect());
+    EXPECT_FALSE(sim.driver.low_power);
+    EXPECT_EQ(sim.driver.low_power_log, (std::vector<bool>{ true, false }));
+}
+
+TEST(LowPowerTest, FullPowerOnStateExit) {
+    SimStack sim;
+    start_detached(sim);
+
+    // VBUS glitch, shorter than debounce. Back to low power.
+    sim.plug();
+    sim.run_ms(1);
+    sim.unplug();
+    sim.run_ms(10);
+    EXPECT_TRUE(sim.driver.low_power);
+
+    // Leaving TC_DETACHED, the port stays at full power while attached
+    sim.plug();
+    ASSERT_TRUE(sim.run_until([&sim]{ return sim.port.is_attached; }, 1000));
+    EXPECT_FALSE(sim.driver.low_power);
+    EXPECT_EQ(sim.driver.low_power_log, (std::vector<bool>{ true, false, true, false }));
+
+    // And goes back to low power after unplug
+    sim.unplug();
+    sim.run_ms(10);
+    EXPECT_FALSE(sim.port.is_attached);
+    EXPECT_TRUE(sim.driver.low_power);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
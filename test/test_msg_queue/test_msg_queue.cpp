@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+//
+// Queue and message packing
+//
+
+TEST(MsgQueueTest, FifoWrapAndOverflow) {
+    MsgQueue<3> q;
+    DeferredMsg m{};
+
+    EXPECT_TRUE(q.empty());
+    EXPECT_FALSE(q.pop(m));
+
+    for (uint32_t round = 0; round < 5; round++) {
+        EXPECT_TRUE(q.push({ MSG_QUEUE_TARGET::PE, 1, round * 10 + 0 }));
+        EXPECT_TRUE(q.push({ MSG_QUEUE_TARGET::PRL, 2, round * 10 + 1 }));
+        ASSERT_TRUE(q.pop(m));
+        EXPECT_EQ(m.target, MSG_QUEUE_TARGET::PE);
+        EXPECT_EQ(m.param, round * 10 + 0);
+        ASSERT_TRUE(q.pop(m));
+        EXPECT_EQ(m.target, MSG_QUEUE_TARGET::PRL);
+        EXPECT_EQ(m.index, 2);
+        EXPECT_EQ(m.param, round * 10 + 1);
+    }
+    EXPECT_EQ(q.max_size_used(), 2u);
+
+    EXPECT_TRUE(q.push({ MSG_QUEUE_TARGET::DPM, 0, 1 }));
+    EXPECT_TRUE(q.push({ MSG_QUEUE_TARGET::DPM, 0, 2 }));
+    EXPECT_TRUE(q.push({ MSG_QUEUE_TARGET::DPM, 0, 3 }));
+    EXPECT_FALSE(q.push({ MSG_QUEUE_TARGET::DPM, 0, 4 }));
+    EXPECT_EQ(q.overflow_count(), 1u);
+    EXPECT_EQ(q.size(), 3u);
+    EXPECT_EQ(q.max_size_used(), 3u);
+
+    for (uint32_t i = 1; i <= 3; i++) {
+        ASSERT_TRUE(q.pop(m));
+        EXPECT_EQ(m.param, i);
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(MsgQueueTest, PackAndRebuild) {
+    using namespace msg_queue_details;
+
+    static_assert(index_of<MsgToPe_PrlMessageReceived, PeDeferredMsgs>::value == 0, "");
+    static_assert(index_of<MsgToPe_PrlReportError, PeDeferredMsgs>::value == 2, "");
+    static_assert(!index_of<MsgSysUpdate, PeDeferredMsgs>::found, "");
+    static_assert(!index_of<MsgToPe_PrlReportError, PrlDeferredMsgs>::found, "");
+    // Sent by the driver, outside of the dispatch context
+    static_assert(!index_of<MsgToPrl_TcpcHardReset, PrlDeferredMsgs>::found, "");
+    static_assert(has_param<MsgToDpm_Alert>::value, "");
+    static_assert(!has_param<MsgToDpm_Startup>::value, "");
+
+    auto err = pack(MsgToPe_PrlReportError{PRL_ERROR::TCH_SEND_FAIL}, has_param<MsgToPe_PrlReportError>{});
+    bool called = false;
+    visit(PeDeferredMsgs{}, index_of<MsgToPe_PrlReportError, PeDeferredMsgs>::value, err,
+        [&](const auto& msg) {
+            using T = typename std::decay<decltype(msg)>::type;
+            ASSERT_TRUE((std::is_same<T, MsgToPe_PrlReportError>::value));
+            EXPECT_EQ(msg.get_message_id(), MSG_TO_PE__PRL_REPORT_ERROR);
+            called = true;
+        });
+    EXPECT_TRUE(called);
+
+    // Values survive the round trip, for all param types
+    uint32_t alert = 0x12345678;
+    visit(DpmDeferredMsgs{}, index_of<MsgToDpm_Alert, DpmDeferredMsgs>::value, alert,
+        [&](const auto& msg) {
+            using T = typename std::decay<decltype(msg)>::type;
+            EXPECT_EQ(pack(msg, has_param<T>{}), alert);
+        });
+
+    auto type = pack(MsgToPrl_DataMsgFromPe{PD_DATA_MSGT::Sink_Capabilities}, has_param<MsgToPrl_DataMsgFromPe>{});
+    EXPECT_EQ(type, uint32_t(PD_DATA_MSGT::Sink_Capabilities));
+}
+
+//
+// Full stack traces, with direct and deferred delivery
+//
+
+static constexpr uint32_t PDO_5V_3A = 0x0801912C;
+static constexpr uint32_t PDO_9V_3A = 0x0002D12C;
+
+struct Trace {
+    std::vector<std::string> events;
+    // Max stack used by DPM handlers, relative to the test frame
+    size_t max_dpm_depth{0};
+};
+
+using Scenario = std::function<void(SimStack&)>;
+
+static Trace run_traced(IMsgQueue* queue, const Scenario& scenario) {
+    Trace trace;
+    uintptr_t base = 0;
+    auto t0 = FakeDriver::now;
+    char buf[256];
+
+    SimStack sim{queue};
+
+    sim.dpm.on_event = [&](etl::message_id_t id) {
+        snprintf(buf, sizeof(buf), "t=%u DPM %u", FakeDriver::now - t0, unsigned(id));
+        trace.events.push_back(buf);
+
+        auto depth = base - reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+        if (depth > trace.max_dpm_depth) { trace.max_dpm_depth = depth; }
+    };
+
+    auto src_model = sim.driver.on_transmit;
+    sim.driver.on_transmit = [&, src_model](const PD_CHUNK& chunk) {
+        auto n = snprintf(buf, sizeof(buf), "t=%u TX %04X", FakeDriver::now - t0, chunk.header.raw_value);
+        for (size_t i = 0; i < chunk.data_size() && n < int(sizeof(buf)) - 4; i++) {
+            n += snprintf(buf + n, sizeof(buf) - n, " %02X", chunk.data()[i]);
+        }
+        trace.events.push_back(buf);
+        src_model(chunk);
+    };
+
+    // Depth is counted from here, the stack objects are above
+    [&] {
+        base = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+        scenario(sim);
+    }();
+
+    snprintf(buf, sizeof(buf), "END pe=%d tc=%d rdo=%08X hr=%d attached=%d",
+        sim.pe.get_state_id(), sim.tc.get_state_id(), sim.port.rdo_contracted,
+        sim.driver.hr_sent, int(sim.port.is_attached));
+    trace.events.push_back(buf);
+    return trace;
+}
+
+static void expect_same_traces(const Scenario& scenario, size_t max_queue_size = 8) {
+    MsgQueue<> queue;
+
+    auto direct = run_traced(nullptr, scenario);
+    auto deferred = run_traced(&queue, scenario);
+
+    EXPECT_EQ(direct.events, deferred.events);
+    EXPECT_EQ(queue.overflow_count(), 0u);
+    EXPECT_LE(queue.max_size_used(), max_queue_size);
+    EXPECT_TRUE(queue.empty());
+
+    // A full queue is drained before direct delivery, the order is the same
+    MsgQueue<1> tiny;
+    auto overflowed = run_traced(&tiny, scenario);
+    EXPECT_EQ(direct.events, overflowed.events);
+    EXPECT_TRUE(tiny.empty());
+}
+
+TEST(MsgQueueTraceTest, Handshake) {
+    expect_same_traces([](SimStack& sim) {
+        ASSERT_TRUE(sim.connect());
+        sim.run_ms(50);
+        sim.send_ctrl(PD_CTRL_MSGT::Get_Sink_Cap);
+        sim.run_ms(20);
+        sim.unplug();
+        sim.run_ms(5);
+    });
+}
+
+TEST(MsgQueueTraceTest, Renegotiate) {
+    expect_same_traces([](SimStack& sim) {
+        sim.src_pdos = { PDO_5V_3A, PDO_9V_3A };
+        ASSERT_TRUE(sim.connect());
+        sim.run_ms(10);
+        sim.dpm.trigger_any(9000);
+        sim.run_ms(50);
+        sim.dpm.trigger_any(5000);
+        sim.run_ms(50);
+    });
+}
+
+// DPM requests a new level from its notification handler, while the stack
+// is running
+TEST(MsgQueueTraceTest, TriggerFromDpmHandler) {
+    expect_same_traces([](SimStack& sim) {
+        sim.src_pdos = { PDO_5V_3A, PDO_9V_3A };
+        auto trace_hook = sim.dpm.on_event;
+        bool done = false;
+        sim.dpm.on_event = [&sim, &done, trace_hook](etl::message_id_t id) {
+            trace_hook(id);
+            if (id == MSG_TO_DPM__SNK_READY && !done) {
+                done = true;
+                sim.dpm.trigger_any(9000);
+            }
+        };
+        ASSERT_TRUE(sim.connect());
+        sim.run_ms(100);
+    });
+}
+
+TEST(MsgQueueTraceTest, SoftResetFromSource) {
+    expect_same_traces([](SimStack& sim) {
+        ASSERT_TRUE(sim.connect());
+        sim.run_ms(10);
+        sim.send_ctrl(PD_CTRL_MSGT::Soft_Reset);
+        sim.run_ms(20);
+        sim.send_src_caps();
+        sim.run_ms(50);
+    });
+}
+
+TEST(MsgQueueTraceTest, HardResetFromPartner) {
+    expect_same_traces([](SimStack& sim) {
+        ASSERT_TRUE(sim.connect());
+        sim.run_ms(10);
+        // As the driver does on hard reset signaling
+        sim.port.notify_prl(MsgToPrl_TcpcHardReset{});
+        sim.port.wakeup();
+        sim.run_ms(1000);
+    });
+}
+
+// The driver raises hard reset from its own task. The message must not
+// touch the queue, which is owned by the dispatch context.
+TEST(MsgQueueTraceTest, HardResetFromDriverTask) {
+    MsgQueue<> queue;
+    SimStack sim{&queue};
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+    sim.dpm.events.clear();
+    auto used = queue.max_size_used();
+
+    std::thread driver_task([&sim] { sim.port.notify_prl(MsgToPrl_TcpcHardReset{}); });
+    driver_task.join();
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.max_size_used(), used);
+    EXPECT_TRUE(sim.port.prl_hr_flags.test(PRL_HR_FLAG::HARD_RESET_FROM_PARTNER));
+
+    sim.port.wakeup();
+    sim.run_ms(10);
+    EXPECT_TRUE(sim.dpm.has_event(MSG_TO_DPM__TRANSIT_TO_DEFAULT));
+}
+
+TEST(MsgQueueTraceTest, SourceNotResponding) {
+    expect_same_traces([](SimStack& sim) {
+        sim.src_auto_reply = false;
+        sim.plug();
+        ASSERT_TRUE(sim.run_until([&sim]{ return sim.port.is_prl_running(); }, 2000));
+        sim.send_src_caps();
+        sim.run_ms(1000);
+    });
+}
+
+TEST(MsgQueueTraceTest, UnsupportedMessages) {
+    expect_same_traces([](SimStack& sim) {
+        ASSERT_TRUE(sim.connect());
+        sim.run_ms(10);
+        sim.send_ctrl(PD_CTRL_MSGT::DR_Swap);
+        sim.run_ms(10);
+        sim.send_ctrl(PD_CTRL_MSGT::Get_Source_Cap);
+        sim.run_ms(10);
+        sim.send_ctrl(PD_CTRL_MSGT::Accept); // Unexpected
+        sim.run_ms(50);
+    });
+}
+
+// DPM handlers are called from the top of the tick, not from inside
+// component runs
+TEST(MsgQueueTraceTest, DpmStackDepth) {
+    Scenario scenario = [](SimStack& sim) {
+        sim.src_pdos = { PDO_5V_3A, PDO_9V_3A };
+        ASSERT_TRUE(sim.connect());
+        sim.dpm.trigger_any(9000);
+        sim.run_ms(50);
+        // Error paths: PRL reports to PE, PE resets and notifies DPM
+        sim.send_ctrl(PD_CTRL_MSGT::Accept);
+        sim.run_ms(50);
+        sim.port.notify_prl(MsgToPrl_TcpcHardReset{});
+        sim.port.wakeup();
+        sim.run_ms(1000);
+        sim.unplug();
+        sim.run_ms(5);
+    };
+
+    MsgQueue<> queue;
+    auto direct = run_traced(nullptr, scenario);
+    auto deferred = run_traced(&queue, scenario);
+
+    printf("Max stack at DPM handler: direct %zu bytes, deferred %zu bytes\n",
+        direct.max_dpm_depth, deferred.max_dpm_depth);
+    printf("Max queued messages: %zu\n", queue.max_size_used());
+
+    EXPECT_LT(deferred.max_dpm_depth, direct.max_dpm_depth);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <etl/message_router.h>
+#include "pd/messages.h"
+#include "pd/port.h"
+
+using namespace pd;
+
+// Compares the dispatch cost of the MsgSysUpdate broadcast (TC, PE, PRL on
+// every tick) via etl::message_router (previous implementation) and via
+// direct typed calls (current Port::notify_*). Listeners are the same shape
+// as the real ones: handlers are not inlined, because they live in other
+// translation units.
+
+#define NOINLINE __attribute__((noinline))
+
+struct Counters {
+    uint32_t tc{0}, pe{0}, prl{0};
+};
+
+//
+// Previous: message routers with the same message lists as the real ones
+//
+
+class RouterTC : public etl::message_router<RouterTC, MsgSysUpdate> {
+public:
+    RouterTC(Counters& c) : c{c} {}
+    NOINLINE void on_receive(const MsgSysUpdate&) { c.tc++; }
+    void on_receive_unknown(const etl::imessage&) {}
+    Counters& c;
+};
+
+class RouterPE : public etl::message_router<RouterPE,
+    MsgSysUpdate,
+    MsgToPe_PrlMessageReceived,
+    MsgToPe_PrlMessageSent,
+    MsgToPe_PrlReportError,
+    MsgToPe_PrlReportDiscard,
+    MsgToPe_PrlHardResetFromPartner,
+    MsgToPe_PrlHardResetSent>
+{
+public:
+    RouterPE(Counters& c) : c{c} {}
+    NOINLINE void on_receive(const MsgSysUpdate&) { c.pe++; }
+    template <typename T> void on_receive(const T&) {}
+    void on_receive_unknown(const etl::imessage&) {}
+    Counters& c;
+};
+
+class RouterPRL : public etl::message_router<RouterPRL,
+    MsgToPrl_EnqueueRestart,
+    MsgToPrl_HardResetFromPe,
+    MsgToPrl_PEHardResetDone,
+    MsgToPrl_TcpcHardReset,
+    MsgToPrl_CtlMsgFromPe,
+    MsgToPrl_DataMsgFromPe,
+    MsgToPrl_ExtMsgFromPe,
+    MsgSysUpdate>
+{
+public:
+    RouterPRL(Counters& c) : c{c} {}
+    NOINLINE void on_receive(const MsgSysUpdate&) { c.prl++; }
+    template <typename T> void on_receive(const T&) {}
+    void on_receive_unknown(const etl::imessage&) {}
+    Counters& c;
+};
+
+struct RouterBus {
+    etl::imessage_router* tc_rtr{nullptr};
+    etl::imessage_router* pe_rtr{nullptr};
+    etl::imessage_router* prl_rtr{nullptr};
+
+    NOINLINE void tick() {
+        if (tc_rtr) { tc_rtr->receive(MsgSysUpdate{}); }
+        if (pe_rtr) { pe_rtr->receive(MsgSysUpdate{}); }
+        if (prl_rtr) { prl_rtr->receive(MsgSysUpdate{}); }
+    }
+};
+
+//
+// Current: plain listeners, called by type
+//
+
+struct DirectTC {
+    DirectTC(Counters& c) : c{c} {}
+    NOINLINE void on_receive(const MsgSysUpdate&) { c.tc++; }
+    Counters& c;
+};
+
+struct DirectPE {
+    DirectPE(Counters& c) : c{c} {}
+    NOINLINE void on_receive(const MsgSysUpdate&) { c.pe++; }
+    Counters& c;
+};
+
+struct DirectPRL {
+    DirectPRL(Counters& c) : c{c} {}
+    NOINLINE void on_receive(const MsgSysUpdate&) { c.prl++; }
+    Counters& c;
+};
+
+struct DirectBus {
+    DirectTC* tc_rtr{nullptr};
+    DirectPE* pe_rtr{nullptr};
+    DirectPRL* prl_rtr{nullptr};
+
+    template <typename T> void notify_tc(const T& msg) { if (tc_rtr) { tc_rtr->on_receive(msg); } }
+    template <typename T> void notify_pe(const T& msg) { if (pe_rtr) { pe_rtr->on_receive(msg); } }
+    template <typename T> void notify_prl(const T& msg) { if (prl_rtr) { prl_rtr->on_receive(msg); } }
+
+    NOINLINE void tick() {
+        notify_tc(MsgSysUpdate{});
+        notify_pe(MsgSysUpdate{});
+        notify_prl(MsgSysUpdate{});
+    }
+};
+
+
+TEST(MsgBusTest, PortQueriesWithoutPrl) {
+    Port port;
+    EXPECT_FALSE(port.is_prl_running());
+    EXPECT_FALSE(port.is_prl_busy());
+}
+
+TEST(MsgBusTest, BothBusesDeliverTheSame) {
+    Counters c1, c2;
+    RouterTC rtc{c1}; RouterPE rpe{c1}; RouterPRL rprl{c1};
+    DirectTC dtc{c2}; DirectPE dpe{c2}; DirectPRL dprl{c2};
+
+    RouterBus rbus{&rtc, &rpe, &rprl};
+    DirectBus dbus{&dtc, &dpe, &dprl};
+
+    for (int i = 0; i < 10; i++) { rbus.tick(); dbus.tick(); }
+
+    EXPECT_EQ(c1.tc, 10u); EXPECT_EQ(c1.pe, 10u); EXPECT_EQ(c1.prl, 10u);
+    EXPECT_EQ(c2.tc, 10u); EXPECT_EQ(c2.pe, 10u); EXPECT_EQ(c2.prl, 10u);
+}
+
+// Not a real test, just prints dispatch cost per tick on host.
+TEST(MsgBusTest, Benchmark) {
+    constexpr int ITERATIONS = 2000000;
+    Counters c;
+
+    RouterTC rtc{c}; RouterPE rpe{c}; RouterPRL rprl{c};
+    DirectTC dtc{c}; DirectPE dpe{c}; DirectPRL dprl{c};
+    RouterBus rbus{&rtc, &rpe, &rprl};
+    DirectBus dbus{&dtc, &dpe, &dprl};
+
+    auto measure = [&](auto& bus) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++) { bus.tick(); }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+    };
+
+    auto ns_router = measure(rbus);
+    auto ns_direct = measure(dbus);
+
+    EXPECT_EQ(c.prl, uint32_t(ITERATIONS * 2));
+
+    printf("MsgSysUpdate dispatch per tick: message_router %.2f ns, direct %.2f ns (x%.1f)\n",
+        ns_router, ns_direct, ns_router / ns_direct);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,402 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../common/fake_fusb302.h"
+#include "../common/sim_stack.h"
+#include "pd/drivers/fusb302_bus.h"
+
+using namespace pd;
+using namespace pd::fusb302;
+
+//
+// Several simulated ports in one TaskGroup, with fake drivers
+//
+
+// Records the order of ticks over all ports
+class OrderedTask : public Task {
+public:
+    using Task::Task;
+
+    void tick() override {
+        if (log) { log->push_back(id); }
+        Task::tick();
+
+        // Busy port: every tick leaves more work
+        if (busy_ticks > 0) {
+            busy_ticks--;
+            set_event(EVENT_WAKEUP_MSK);
+        }
+    }
+
+    int id{0};
+    int busy_ticks{0};
+    std::vector<int>* log{nullptr};
+};
+
+using Sim = SimStackT<OrderedTask>;
+
+struct MultiPortTest : public ::testing::Test {
+    static constexpr int PORTS = 3;
+
+    std::vector<std::unique_ptr<Sim>> sims;
+    TaskGroup<PORTS> group;
+    std::vector<int> log;
+
+    void SetUp() override {
+        for (int i = 0; i < PORTS; i++) {
+            sims.emplace_back(new Sim());
+            sims[i]->task.id = i;
+            sims[i]->task.log = &log;
+            ASSERT_TRUE(group.add(sims[i]->task));
+        }
+    }
+
+    // Shared time, one timer event per port and tick
+    void run_ms(uint32_t ms) {
+        for (uint32_t i = 0; i < ms; i++) {
+            FakeDriver::now++;
+            for (auto& sim : sims) { sim->task.set_event(Task::EVENT_TIMER_MSK); }
+        }
+    }
+
+    bool is_ready(int i) { return sims[i]->dpm.has_event(MSG_TO_DPM__SNK_READY); }
+
+    // Leave wakeups on all ports, without dispatch
+    void leave_wakeups() {
+        std::thread other([] {});
+        auto other_id = other.get_id();
+        other.join();
+        for (auto& sim : sims) {
+            sim->driver.set_owner(other_id);
+            sim->port.wakeup();
+            sim->driver.set_owner(std::this_thread::get_id());
+        }
+    }
+};
+
+TEST_F(MultiPortTest, GroupCapacity) {
+    Port port;
+    FakeDriver driver{port};
+    Task extra{port, driver};
+    EXPECT_EQ(group.size(), size_t(PORTS));
+    EXPECT_FALSE(group.add(extra));
+}
+
+TEST_F(MultiPortTest, PortsNegotiateIndependently) {
+    // Port 2 is plugged later, and port 1 gets no source caps
+    sims[0]->plug();
+    sims[1]->plug();
+    run_ms(200);
+    sims[2]->plug();
+
+    bool caps_sent[PORTS]{};
+    for (int ms = 0; ms < 2000 && !(is_ready(0) && is_ready(2)); ms++) {
+        for (int i : {0, 2}) {
+            if (!caps_sent[i] && sims[i]->port.is_prl_running()) {
+                sims[i]->send_src_caps();
+                caps_sent[i] = true;
+            }
+        }
+        run_ms(1);
+    }
+
+    EXPECT_TRUE(is_ready(0));
+    EXPECT_TRUE(is_ready(2));
+    EXPECT_FALSE(is_ready(1));
+    EXPECT_TRUE(sims[1]->port.is_attached);
+    EXPECT_TRUE(sims[1]->driver.tx_log.empty());
+
+    // Timers are per port: without source caps, port 1 goes hard reset
+    // on its own schedule, and others keep their contracts.
+    for (int i = 0; i < PORTS; i++) { sims[i]->dpm.events.clear(); }
+    run_ms(1000);
+    EXPECT_GT(sims[1]->driver.hr_sent, 0);
+    EXPECT_TRUE(sims[0]->port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+    EXPECT_TRUE(sims[2]->port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+}
+
+TEST_F(MultiPortTest, BusyPortDoesNotStarveOthers) {
+    for (int i = 0; i < PORTS; i++) { ASSERT_TRUE(sims[i]->connect()); }
+
+    leave_wakeups();
+    sims[0]->task.busy_ticks = 10;
+    log.clear();
+    group.dispatch();
+
+    // Every pass serves each ready port once
+    ASSERT_GE(log.size(), size_t(PORTS));
+    std::vector<int> first_pass(log.begin(), log.begin() + PORTS);
+    std::sort(first_pass.begin(), first_pass.end());
+    EXPECT_EQ(first_pass, (std::vector<int>{0, 1, 2}));
+
+    EXPECT_EQ(std::count(log.begin(), log.end(), 0), 11);
+    EXPECT_EQ(std::count(log.begin(), log.end(), 1), 1);
+    EXPECT_EQ(std::count(log.begin(), log.end(), 2), 1);
+}
+
+TEST_F(MultiPortTest, PassOrderRotates) {
+    for (int i = 0; i < PORTS; i++) { ASSERT_TRUE(sims[i]->connect()); }
+
+    // Each round starts from the next port
+    std::vector<int> leaders;
+    for (int round = 0; round < PORTS; round++) {
+        leave_wakeups();
+        log.clear();
+        group.dispatch();
+        ASSERT_EQ(log.size(), size_t(PORTS));
+        leaders.push_back(log[0]);
+    }
+    std::sort(leaders.begin(), leaders.end());
+    EXPECT_EQ(leaders, (std::vector<int>{0, 1, 2}));
+}
+
+//
+// Several FUSB302 chips on one I2C bus, served by one main loop
+//
+
+// I2C bus with a mux. Chips with NO_MUX are always visible, others only
+// when their mux channel is selected.
+class FakeI2cBus : public IFusb302Hal {
+public:
+    struct Device {
+        FakeFusb302Hal* chip;
+        uint8_t addr;
+        int16_t mux;
+    };
+
+    void setup() override { setup_calls++; }
+    void set_event_handler(const hal_event_handler_t& h) override { handler = h; }
+    ITimer::TimeFunc get_time_func() const override { return [] { return FakeFusb302Hal::now; }; }
+    void set_timer_enable(bool enable) override { timer_enabled = enable; }
+    bool is_interrupt_active() override { return false; }
+
+    bool read_reg(uint8_t addr, uint8_t reg, uint8_t& data) override {
+        auto chip = find(addr);
+        return chip && chip->read_reg(addr, reg, data);
+    }
+    bool write_reg(uint8_t addr, uint8_t reg, uint8_t data) override {
+        auto chip = find(addr);
+        return chip && chip->write_reg(addr, reg, data);
+    }
+    bool read_block(uint8_t addr, uint8_t reg, uint8_t *data, uint32_t size) override {
+        auto chip = find(addr);
+        return chip && chip->read_block(addr, reg, data, size);
+    }
+    bool write_block(uint8_t addr, uint8_t reg, const uint8_t *data, uint32_t size) override {
+        auto chip = find(addr);
+        return chip && chip->write_block(addr, reg, data, size);
+    }
+
+    bool select_mux(uint8_t channel) {
+        mux = channel;
+        mux_switches++;
+        return true;
+    }
+
+    std::vector<Device> devices;
+    hal_event_handler_t handler;
+    int16_t mux{Fusb302Bus::NO_MUX};
+    int mux_switches{0};
+    int setup_calls{0};
+    int collisions{0};
+    bool timer_enabled{true};
+
+private:
+    FakeFusb302Hal* find(uint8_t addr) {
+        FakeFusb302Hal* found = nullptr;
+        for (auto& dev : devices) {
+            if (dev.addr != addr) { continue; }
+            if (dev.mux != Fusb302Bus::NO_MUX && dev.mux != mux) { continue; }
+            if (found) { collisions++; }
+            found = dev.chip;
+        }
+        return found;
+    }
+};
+
+// One port: chip model, its channel on the bus and the driver
+struct BusPort {
+    FakeFusb302Hal chip;
+    Port port;
+    Fusb302BusChannel channel;
+    Fusb302Superloop driver{port, channel};
+
+    BusPort(Fusb302Bus& bus, FakeI2cBus& i2c, uint8_t addr, int16_t mux)
+        : channel{bus, addr, mux}
+    {
+        i2c.devices.push_back({&chip, addr, mux});
+        chip.on_irq = [this] { channel.notify_interrupt(true); };
+        channel.int_pin = etl::delegate<bool()>::create<FakeFusb302Hal, &FakeFusb302Hal::is_interrupt_active>(chip);
+    }
+};
+
+// Main loop for all drivers: poll each, then sleep until the nearest
+// deadline or an IRQ.
+template <typename Ports>
+static int run_bus_loop(Ports& ports, uint32_t ms, std::function<void()> on_wake = nullptr) {
+    int polls = 0;
+    uint32_t end = FakeFusb302Hal::now + ms;
+
+    while (FakeFusb302Hal::now < end) {
+        uint32_t left = Fusb302Superloop::NO_DEADLINE;
+        for (auto& p : ports) {
+            auto next = p->driver.poll();
+            if (next < left) { left = next; }
+            polls++;
+        }
+        if (polls > 100000) { ADD_FAILURE() << "Main loop does not sleep"; break; }
+        if (on_wake) { on_wake(); }
+
+        bool pending = false;
+        for (auto& p : ports) { pending = pending || p->driver.has_pending_events(); }
+        if (pending || left == 0) { continue; }
+
+        uint32_t max_sleep = end - FakeFusb302Hal::now;
+        FakeFusb302Hal::now += (left < max_sleep) ? left : max_sleep;
+    }
+    return polls;
+}
+
+struct Fusb302BusTest : public ::testing::Test {
+    FakeI2cBus i2c;
+    Fusb302Bus bus{i2c};
+    std::vector<std::unique_ptr<BusPort>> ports;
+
+    void SetUp() override {
+        FakeFusb302Hal::now = 1000;
+        bus.select_mux = etl::delegate<bool(uint8_t)>::create<FakeI2cBus, &FakeI2cBus::select_mux>(i2c);
+
+        // Two chips with the same address behind the mux, one direct
+        ports.emplace_back(new BusPort(bus, i2c, ChipAddress::FUSB302B01, Fusb302Bus::NO_MUX));
+        ports.emplace_back(new BusPort(bus, i2c, ChipAddress::FUSB302B, 0));
+        ports.emplace_back(new BusPort(bus, i2c, ChipAddress::FUSB302B, 1));
+    }
+};
+
+TEST_F(Fusb302BusTest, AddressAndMuxSelection) {
+    for (auto& p : ports) { p->driver.setup(); }
+    run_bus_loop(ports, 10);
+
+    EXPECT_EQ(i2c.setup_calls, 1);
+    EXPECT_EQ(i2c.collisions, 0);
+    for (auto& p : ports) {
+        EXPECT_TRUE(p->channel.is_attached());
+        EXPECT_TRUE(p->driver.flags.test(DRV_FLAG::FUSB_SETUP_DONE));
+        EXPECT_EQ(p->chip.regs[Power::reg], PowerBlock::ALL);
+        EXPECT_GT(p->chip.i2c_ops, 0);
+    }
+
+    // The mux is switched only when the channel changes
+    auto switches = i2c.mux_switches;
+    ports[1]->chip.set_vbus(true);
+    run_bus_loop(ports, 1);
+    EXPECT_TRUE(ports[1]->driver.is_vbus_ok());
+    EXPECT_FALSE(ports[2]->driver.is_vbus_ok());
+    EXPECT_EQ(i2c.mux_switches, switches + 1);
+    EXPECT_EQ(i2c.mux, 0);
+}
+
+TEST_F(Fusb302BusTest, TimerRunsWhileAnyChipNeedsIt) {
+    for (auto& p : ports) { p->driver.setup(); }
+    run_bus_loop(ports, 10);
+
+    ports[0]->channel.set_timer_enable(false);
+    EXPECT_TRUE(i2c.timer_enabled);
+    ports[1]->channel.set_timer_enable(false);
+    ports[2]->channel.set_timer_enable(false);
+    EXPECT_FALSE(i2c.timer_enabled);
+    ports[2]->channel.set_timer_enable(true);
+    EXPECT_TRUE(i2c.timer_enabled);
+
+    // Bus timer events go to all drivers
+    i2c.handler(HAL_EVENT_TYPE::Timer, true);
+    for (auto& p : ports) { EXPECT_TRUE(p->driver.has_pending_events()); }
+}
+
+TEST_F(Fusb302BusTest, MuxSelectFailure) {
+    bus.select_mux = etl::delegate<bool(uint8_t)>();
+    uint8_t data;
+    EXPECT_FALSE(ports[1]->channel.read_reg(0, DeviceID::reg, data));
+    EXPECT_TRUE(ports[0]->channel.read_reg(0, DeviceID::reg, data));
+}
+
+// Full stacks of all ports in one group and one main loop
+struct BusStack {
+    BusPort& hw;
+    FakeDpm dpm{hw.port};
+    Task task{hw.port, hw.driver};
+    PRL prl{hw.port, hw.driver};
+    PE pe{hw.port, dpm, prl, hw.driver};
+    TC tc{hw.port, hw.driver};
+
+    uint8_t src_msg_id{0};
+
+    explicit BusStack(BusPort& hw) : hw{hw} {
+        hw.chip.on_transmit = [this](const PD_CHUNK& chunk) {
+            if (chunk.is_data_msg(PD_DATA_MSGT::Request)) {
+                this->hw.chip.receive(make_src_msg(PD_CTRL_MSGT::Accept, 0));
+                this->hw.chip.receive(make_src_msg(PD_CTRL_MSGT::PS_RDY, 0));
+            }
+        };
+    }
+
+    PD_CHUNK make_src_msg(uint8_t type, uint8_t data_obj_count) {
+        PD_CHUNK chunk{};
+        chunk.header.message_type = type;
+        chunk.header.data_obj_count = data_obj_count;
+        chunk.header.port_power_role = 1;
+        chunk.header.port_data_role = 1;
+        chunk.header.spec_revision = PD_REVISION::REV30;
+        chunk.header.message_id = src_msg_id++ & 7;
+        return chunk;
+    }
+
+    void send_src_caps() {
+        auto chunk = make_src_msg(PD_DATA_MSGT::Source_Capabilities, 1);
+        chunk.append32(0x0801912C); // Fixed 5V 3A
+        hw.chip.receive(chunk);
+    }
+};
+
+TEST_F(Fusb302BusTest, AllPortsNegotiate) {
+    TaskGroup<3> group;
+    std::vector<std::unique_ptr<BusStack>> stacks;
+    for (auto& p : ports) {
+        stacks.emplace_back(new BusStack(*p));
+        ASSERT_TRUE(group.add(stacks.back()->task));
+    }
+    for (auto& s : stacks) { s->task.start(s->tc, s->dpm, s->pe, s->prl, s->hw.driver); }
+    run_bus_loop(ports, 100);
+
+    for (auto& p : ports) {
+        p->chip.cc1 = TCPC_CC_LEVEL::RP_3_0;
+        p->chip.set_vbus(true);
+    }
+
+    std::vector<bool> caps_sent(stacks.size(), false);
+    int polls = run_bus_loop(ports, 1000, [&] {
+        for (size_t i = 0; i < stacks.size(); i++) {
+            if (!caps_sent[i] && stacks[i]->hw.port.is_prl_running()) {
+                stacks[i]->send_src_caps();
+                caps_sent[i] = true;
+            }
+        }
+    });
+
+    EXPECT_EQ(i2c.collisions, 0);
+    for (auto& s : stacks) {
+        EXPECT_TRUE(s->dpm.has_event(MSG_TO_DPM__SNK_READY));
+        EXPECT_TRUE(s->hw.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+        ASSERT_FALSE(s->hw.chip.tx_log.empty());
+        EXPECT_TRUE(s->hw.chip.tx_log[0].is_data_msg(PD_DATA_MSGT::Request));
+    }
+    printf("Polls in 1000 ms, %zu ports: %d, mux switches: %d\n",
+        ports.size(), polls, i2c.mux_switches);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
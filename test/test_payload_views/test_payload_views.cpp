@@ -0,0 +1,333 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include "pd/dpm.h"
+#include "pd/pe.h"
+#include "pd/port.h"
+#include "pd/utils/payload_views.h"
+#include "../common/pdo_fixtures.h"
+
+using namespace pd;
+using namespace pd::dobj_utils;
+
+// Fixed size buffers, to test EPR sized payloads in all feature profiles
+using TestMsg = PD_MSG_TPL<MaxExtendedMsgLen>;
+using PdoStore = etl::vector<uint32_t, MaxPdoObjects>;
+
+static TestMsg make_data_msg(uint8_t type, std::initializer_list<uint32_t> objects) {
+    TestMsg msg{};
+    msg.header.message_type = type;
+    msg.header.data_obj_count = uint16_t(objects.size());
+    for (auto obj : objects) { msg.append32(obj); }
+    return msg;
+}
+
+static TestMsg make_caps_msg() {
+    return make_data_msg(PD_DATA_MSGT::Source_Capabilities, {
+        make_fixed_pdo(5000, 3000),
+        make_fixed_pdo(9000, 3000),
+        make_fixed_pdo(15000, 3000),
+        make_fixed_pdo(20000, 5000),
+        make_pps_apdo(3300, 11000, 5000),
+        make_pps_apdo(3300, 21000, 5000),
+        0,
+        make_fixed_pdo(28000, 5000),
+        make_fixed_pdo(36000, 5000),
+        make_fixed_pdo(48000, 5000),
+        make_epr_avs_apdo(15000, 48000, 240)
+    });
+}
+
+TEST(PayloadViewsTest, PdoSpanFromMessage) {
+    auto msg = make_caps_msg();
+    auto caps = PdoSpan::from_msg(msg);
+
+    ASSERT_EQ(caps.size(), 11u);
+    for (size_t i = 0; i < caps.size(); i++) {
+        EXPECT_EQ(caps[i], msg.read32(i * 4)) << "PDO " << i;
+    }
+
+    EXPECT_EQ(caps.view(0).variant(), PDO_VARIANT::FIXED);
+    EXPECT_EQ(caps.view(4).variant(), PDO_VARIANT::APDO_PPS);
+    EXPECT_TRUE(caps.view(6).is_padding());
+    EXPECT_EQ(caps.view(6).variant(), PDO_VARIANT::UNKNOWN);
+    EXPECT_EQ(caps.view(10).variant(), PDO_VARIANT::APDO_EPR_AVS);
+
+    EXPECT_FALSE(caps.view(3).is_epr());
+    EXPECT_TRUE(caps.view(7).is_epr());
+    EXPECT_TRUE(caps.view(10).is_epr());
+
+    auto limits = caps.view(5).limits();
+    EXPECT_EQ(limits.mv_min, 3300u);
+    EXPECT_EQ(limits.mv_max, 21000u);
+    EXPECT_EQ(limits.ma, 5000u);
+
+    size_t n = 0;
+    for (auto pdo : caps) { EXPECT_EQ(pdo, caps[n++]); }
+    EXPECT_EQ(n, 11u);
+
+    EXPECT_EQ(caps.first(7).size(), 7u);
+    EXPECT_EQ(caps.first(20).size(), 11u);
+}
+
+TEST(PayloadViewsTest, PdoSpanTruncatedPayload) {
+    // Partial trailing object is not included
+    PD_MSG msg{};
+    msg.append32(make_fixed_pdo(5000, 3000));
+    msg.append16(0x1234);
+    EXPECT_EQ(PdoSpan::from_msg(msg).size(), 1u);
+
+    msg.clear();
+    EXPECT_TRUE(PdoSpan::from_msg(msg).empty());
+    EXPECT_EQ(PdoSpan::from_msg(msg).begin(), PdoSpan::from_msg(msg).end());
+}
+
+TEST(PayloadViewsTest, PdoSpanFromList) {
+    PDO_LIST list;
+    list.push_back(make_fixed_pdo(5000, 3000));
+    list.push_back(make_pps_apdo(3300, 11000, 3000));
+
+    PdoSpan caps{list};
+    ASSERT_EQ(caps.size(), 2u);
+    EXPECT_EQ(caps[1], list[1]);
+    EXPECT_EQ(caps.view(1).variant(), PDO_VARIANT::APDO_PPS);
+}
+
+TEST(PayloadViewsTest, RdoView) {
+    RDO_PPS rdo{};
+    rdo.obj_position = 5;
+    rdo.epr_capable = 1;
+    rdo.output_voltage = 9000 / 20;
+
+    RdoView view{rdo.raw_value};
+    EXPECT_TRUE(view.valid());
+    EXPECT_EQ(view.position(), 5u);
+    EXPECT_TRUE(view.is_epr_capable());
+    EXPECT_FALSE(view.is_capability_mismatch());
+    EXPECT_EQ(view.pdo(), 0u);
+
+    auto pdo = make_fixed_pdo(28000, 5000);
+    auto msg = make_data_msg(PD_DATA_MSGT::EPR_Request, {rdo.raw_value, pdo});
+    auto epr = RdoView::from_msg(msg);
+    EXPECT_EQ(epr.raw_value(), rdo.raw_value);
+    EXPECT_EQ(epr.pdo(), pdo);
+
+    PD_MSG empty{};
+    EXPECT_FALSE(RdoView::from_msg(empty).valid());
+    EXPECT_EQ(RdoView{}.position(), 0u);
+}
+
+TEST(PayloadViewsTest, ExtHeaderView) {
+    PD_EXT_HEADER ehdr{0};
+    ehdr.data_size = 44;
+    ehdr.chunk_number = 1;
+    ehdr.chunked = 1;
+
+    PD_CHUNK chunk{};
+    chunk.header.extended = 1;
+    chunk.header.message_type = PD_EXT_MSGT::EPR_Source_Capabilities;
+    chunk.append16(ehdr.raw_value);
+    chunk.append32(make_fixed_pdo(5000, 3000));
+
+    ExtHeaderView view{chunk};
+    ASSERT_TRUE(view.valid());
+    EXPECT_EQ(view.raw_value(), ehdr.raw_value);
+    EXPECT_EQ(view.data_size(), 44u);
+    EXPECT_EQ(view.chunk_number(), 1u);
+    EXPECT_TRUE(view.is_chunked());
+    EXPECT_FALSE(view.is_request_chunk());
+
+    // Not extended
+    chunk.header.extended = 0;
+    EXPECT_FALSE(ExtHeaderView{chunk}.valid());
+
+    // Too short
+    chunk.header.extended = 1;
+    chunk.resize(1);
+    ExtHeaderView short_view{chunk};
+    EXPECT_FALSE(short_view.valid());
+    EXPECT_EQ(short_view.data_size(), 0u);
+}
+
+TEST(PayloadViewsTest, EprModeView) {
+    EPRMDO mdo{0};
+    mdo.action = EPR_MODE_ACTION::ENTER_FAILED;
+    mdo.data = 3;
+
+    auto msg = make_data_msg(PD_DATA_MSGT::EPR_Mode, {mdo.raw_value});
+    EprModeView view{msg};
+    ASSERT_TRUE(view.valid());
+    EXPECT_EQ(view.action(), uint32_t(EPR_MODE_ACTION::ENTER_FAILED));
+    EXPECT_EQ(view.data(), 3u);
+    EXPECT_EQ(view.raw_value(), mdo.raw_value);
+
+    // Other message types are not decoded
+    auto other = make_data_msg(PD_DATA_MSGT::Alert, {mdo.raw_value});
+    EprModeView other_view{other};
+    EXPECT_FALSE(other_view.valid());
+    EXPECT_EQ(other_view.action(), 0u);
+}
+
+//
+// Reference: decoding as before views, with per-object reads and repeated
+// variant / limits decoding.
+//
+
+static bool validate_reference(const etl::ivector<uint32_t>& src_caps) {
+    if (src_caps.empty() || src_caps.size() > MaxPdoObjects) { return false; }
+    if (get_src_pdo_variant(src_caps[0]) != PDO_VARIANT::FIXED ||
+        PDO_FIXED{src_caps[0]}.voltage != 100) { return false; }
+
+    for (size_t i = 0; i < src_caps.size(); i++) {
+        auto pdo = src_caps[i];
+        auto v = get_src_pdo_variant(pdo);
+        bool epr = v == PDO_VARIANT::APDO_EPR_AVS ||
+            (v == PDO_VARIANT::FIXED && PDO_FIXED{pdo}.voltage > 400);
+        if (epr ? i < MaxPdoObjects_SPR : i >= MaxPdoObjects_SPR) { return false; }
+    }
+    int spr_avs = 0, epr_avs = 0;
+    for (size_t i = 0; i < src_caps.size(); i++) {
+        auto v = get_src_pdo_variant(src_caps[i]);
+        if (v == PDO_VARIANT::APDO_SPR_AVS && ++spr_avs > 1) { return false; }
+        if (v == PDO_VARIANT::APDO_EPR_AVS && ++epr_avs > 1) { return false; }
+    }
+    uint32_t prev = 0;
+    for (size_t i = 0; i < src_caps.size(); i++) {
+        if (get_src_pdo_variant(src_caps[i]) != PDO_VARIANT::FIXED) { continue; }
+        if (PDO_FIXED{src_caps[i]}.voltage <= prev) { return false; }
+        prev = PDO_FIXED{src_caps[i]}.voltage;
+    }
+    prev = 0;
+    for (size_t i = 0; i < src_caps.size(); i++) {
+        if (get_src_pdo_variant(src_caps[i]) != PDO_VARIANT::APDO_PPS) { continue; }
+        if (PDO_SPR_PPS{src_caps[i]}.max_voltage < prev) { return false; }
+        prev = PDO_SPR_PPS{src_caps[i]}.max_voltage;
+    }
+    return true;
+}
+
+static uint32_t select_reference(const etl::ivector<uint32_t>& src_caps, uint32_t mv, uint32_t ma) {
+    for (uint32_t i = 0; i < src_caps.size(); i++) {
+        const auto pdo = src_caps[i];
+        if (pdo == 0 || get_src_pdo_variant(pdo) == PDO_VARIANT::UNKNOWN) { continue; }
+        if (!match_limits(pdo, mv, ma)) { continue; }
+        auto limits = get_src_pdo_limits(pdo);
+        return i + 1 + limits.mv_min;
+    }
+    return 0;
+}
+
+static uint32_t select_views(PdoSpan caps, uint32_t mv, uint32_t ma) {
+    for (uint32_t i = 0; i < caps.size(); i++) {
+        const auto pdo = caps.view(i);
+        if (pdo.is_padding() || pdo.variant() == PDO_VARIANT::UNKNOWN) { continue; }
+        auto limits = pdo.limits();
+        if (!match_limits(pdo.variant(), limits, mv, ma)) { continue; }
+        return i + 1 + limits.mv_min;
+    }
+    return 0;
+}
+
+TEST(PayloadViewsTest, SameResultsAsReference) {
+    auto msg = make_caps_msg();
+
+    PdoStore list;
+    for (int i = 0; i < msg.size_to_pdo_count(); i++) { list.push_back(msg.read32(i * 4)); }
+    auto caps = PdoSpan::from_msg(msg);
+
+    EXPECT_EQ(PE::validate_source_caps(caps), validate_reference(list));
+    EXPECT_TRUE(PE::validate_source_caps(caps));
+
+    for (uint32_t mv : {5000u, 9000u, 10000u, 20000u, 36000u, 40000u}) {
+        EXPECT_EQ(select_views(caps, mv, 3000), select_reference(list, mv, 3000)) << mv;
+    }
+
+    // Broken order must fail the same way
+    auto bad = make_data_msg(PD_DATA_MSGT::Source_Capabilities, {
+        make_fixed_pdo(5000, 3000), make_fixed_pdo(15000, 3000), make_fixed_pdo(9000, 3000)});
+    PdoStore bad_list;
+    for (int i = 0; i < bad.size_to_pdo_count(); i++) { bad_list.push_back(bad.read32(i * 4)); }
+    EXPECT_FALSE(PE::validate_source_caps(PdoSpan::from_msg(bad)));
+    EXPECT_FALSE(validate_reference(bad_list));
+}
+
+TEST(PayloadViewsTest, DpmSelectsFromList) {
+    Port port;
+    DPM dpm{port};
+    auto msg = make_caps_msg();
+
+    PdoStore list;
+    for (auto pdo : PdoSpan::from_msg(msg)) { list.push_back(pdo); }
+
+    // Empty summary, PDOs are decoded
+    const SRC_CAPS_SUMMARY none{};
+
+    dpm.trigger_any(9000);
+    auto rdo_pdo = dpm.get_request_data_object(list, none);
+    EXPECT_EQ(RdoView{rdo_pdo.first}.position(), 2u);
+    EXPECT_EQ(rdo_pdo.second, list[1]);
+
+    dpm.trigger_variant(PDO_VARIANT::APDO_PPS, 16000, 2000);
+    rdo_pdo = dpm.get_request_data_object(list, none);
+    EXPECT_EQ(RdoView{rdo_pdo.first}.position(), 6u);
+    EXPECT_EQ(RDO_PPS{rdo_pdo.first}.output_voltage, 16000u / 20);
+    EXPECT_EQ(RDO_PPS{rdo_pdo.first}.operating_current, 2000u / 50);
+
+    // Same result with variants from the summary (SPR part, fits all
+    // feature profiles)
+    list.resize(MaxPdoObjects_SPR - 1);
+    SrcCapsParser parser;
+    parser.update(PdoSpan{list});
+    ASSERT_EQ(parser.summary().size(), list.size());
+    EXPECT_EQ(dpm.get_request_data_object(list, parser.summary()), rdo_pdo);
+
+    // The summary passed is trusted: without PPS in it, PDOs are not
+    // scanned and vSafe5V is selected
+    PdoStore padded = list;
+    padded[4] = 0;
+    padded[5] = 0;
+    SrcCapsParser no_pps;
+    no_pps.update(PdoSpan{padded});
+    ASSERT_FALSE(no_pps.summary().has(PDO_VARIANT::APDO_PPS));
+    rdo_pdo = dpm.get_request_data_object(list, no_pps.summary());
+    EXPECT_EQ(RdoView{rdo_pdo.first}.position(), 1u);
+}
+
+// Source_Capabilities handling: copy / validate / select PDO
+TEST(PayloadViewsTest, Benchmark) {
+    constexpr int ITERATIONS = 200000;
+    auto msg = make_caps_msg();
+
+    auto measure = [&](auto fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++) { fn(i); }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+    };
+
+    volatile uint32_t sink = 0;
+    PdoStore list;
+
+    auto ns_reference = measure([&](int i) {
+        msg.buf[0] = uint8_t(i & 0x3F); // vary current of PDO 1
+        list.clear();
+        for (int n = 0; n < msg.size_to_pdo_count(); n++) { list.push_back(msg.read32(n * 4)); }
+        sink = sink + validate_reference(list) + select_reference(list, 36000, 3000);
+    });
+
+    auto ns_views = measure([&](int i) {
+        msg.buf[0] = uint8_t(i & 0x3F);
+        auto caps = PdoSpan::from_msg(msg);
+        list.clear();
+        for (auto pdo : caps) { list.push_back(pdo); }
+        sink = sink + PE::validate_source_caps(caps) + select_views(caps, 36000, 3000);
+    });
+
+    printf("Source_Capabilities (11 PDOs): per-object reads %.1f ns, views %.1f ns (x%.1f)\n",
+        ns_reference, ns_views, ns_reference / ns_views);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <type_traits>
+#include "pd/data_objects.h"
+
+using namespace pd;
+
+// Full size, independent of the feature profile
+using PD_EXT_MSG = PD_MSG_TPL<MaxExtendedMsgLen>;
+
+static_assert(std::is_trivially_copyable<PD_CHUNK>::value, "");
+static_assert(std::is_trivially_copyable<PD_MSG>::value, "");
+static_assert(std::is_standard_layout<PD_CHUNK>::value, "");
+static_assert(!std::is_polymorphic<PD_MSG>::value, "");
+
+static void fill(PD_EXT_MSG& msg, size_t size) {
+    msg.clear();
+    msg.resize(size);
+    for (size_t i = 0; i < size; i++) { msg.data()[i] = uint8_t(i); }
+}
+
+TEST(PdMsgTest, AppendAndRead) {
+    PD_CHUNK chunk{};
+    chunk.append16(0x1234);
+    chunk.append32(0xAABBCCDD);
+
+    EXPECT_EQ(chunk.data_size(), 6u);
+    EXPECT_EQ(chunk.read16(0), 0x1234);
+    EXPECT_EQ(chunk.read32(2), 0xAABBCCDDu);
+    EXPECT_EQ(chunk.size_to_pdo_count(), 2);
+}
+
+TEST(PdMsgTest, ReadOutOfRangeIsZeroPadded) {
+    PD_CHUNK chunk{};
+    chunk.append16(0x1234);
+
+    EXPECT_EQ(chunk.read32(0), 0x1234u);
+    EXPECT_EQ(chunk.read16(1), 0x12);
+    EXPECT_EQ(chunk.read32(100), 0u);
+}
+
+TEST(PdMsgTest, AppendIsTruncatedAtCapacity) {
+    PD_CHUNK chunk{};
+    for (size_t i = 0; i < PD_CHUNK::MAX_SIZE / 4 + 2; i++) { chunk.append32(0x11111111u * (i & 0xF)); }
+
+    EXPECT_EQ(chunk.data_size(), PD_CHUNK::MAX_SIZE);
+    EXPECT_EQ(chunk.read32(24), 0x66666666u);
+
+    chunk.resize(1000);
+    EXPECT_EQ(chunk.data_size(), PD_CHUNK::MAX_SIZE);
+}
+
+TEST(PdMsgTest, GrowIsZeroFilled) {
+    PD_CHUNK chunk{};
+    chunk.append32(0xAABBCCDD);
+    chunk.append32(0x11223344);
+
+    // Shrink, then grow back: old bytes must not reappear
+    chunk.resize(2);
+    chunk.resize(8);
+    EXPECT_EQ(chunk.read32(0), 0xCCDDu);
+    EXPECT_EQ(chunk.read32(4), 0u);
+}
+
+TEST(PdMsgTest, ResizeByDataObjCountHidesStaleBytes) {
+    PD_MSG msg{};
+    msg.append32(0x0801912C);
+    msg.append32(0x0002D12C);
+
+    // Shorter message received into the same buffer, header claims more
+    // data objects than there are bytes.
+    PD_CHUNK rx{};
+    rx.header.data_obj_count = 2;
+    rx.append32(0x0801912C);
+    msg = rx;
+    msg.resize_by_data_obj_count();
+
+    EXPECT_EQ(msg.data_size(), 8u);
+    EXPECT_EQ(msg.read32(0), 0x0801912Cu);
+    EXPECT_EQ(msg.read32(4), 0u);
+}
+
+TEST(PdMsgTest, CrossSizeCopy) {
+    PD_CHUNK chunk{};
+    chunk.header.message_type = PD_DATA_MSGT::Source_Capabilities;
+    chunk.header.data_obj_count = 2;
+    chunk.append32(0x0801912C);
+    chunk.append32(0x0002D12C);
+
+    PD_EXT_MSG msg{};
+    msg.append32(0xFFFFFFFF);
+    msg = chunk;
+    EXPECT_EQ(msg.header.raw_value, chunk.header.raw_value);
+    EXPECT_EQ(msg.data_size(), 8u);
+    EXPECT_EQ(msg.read32(4), 0x0002D12Cu);
+    EXPECT_TRUE(msg.is_data_msg(PD_DATA_MSGT::Source_Capabilities));
+
+    // Large -> small is truncated
+    fill(msg, 40);
+    PD_CHUNK small{msg};
+    EXPECT_EQ(small.data_size(), std::min<size_t>(40, PD_CHUNK::MAX_SIZE));
+    EXPECT_EQ(small.data()[27], 27);
+}
+
+TEST(PdMsgTest, SameTypeCopyIsIndependent) {
+    PD_CHUNK a{};
+    a.append16(0x0102);
+    PD_CHUNK b = a;
+    b.append16(0x0304);
+
+    EXPECT_EQ(a.data_size(), 2u);
+    EXPECT_EQ(b.data_size(), 4u);
+    EXPECT_EQ(b.read16(0), 0x0102);
+}
+
+TEST(PdMsgTest, AppendFromRange) {
+    PD_EXT_MSG src{};
+    fill(src, 60);
+
+    PD_EXT_MSG dst{};
+    dst.append_from(src, 10, 20);
+    dst.append_from(src, 50, 100); // clamped to source size
+    dst.append_from(src, 30, 30);  // empty
+
+    ASSERT_EQ(dst.data_size(), 20u);
+    EXPECT_EQ(dst.data()[0], 10);
+    EXPECT_EQ(dst.data()[9], 19);
+    EXPECT_EQ(dst.data()[10], 50);
+    EXPECT_EQ(dst.data()[19], 59);
+}
+
+TEST(PdMsgTest, ExternalStorageChunk) {
+    uint8_t frame[4 + PD_CHUNK_EXT::MAX_SIZE + 4]{};
+    PD_CHUNK_EXT ext{frame + 4};
+
+    PD_EXT_MSG msg{};
+    fill(msg, 40);
+    msg.header.message_type = PD_EXT_MSGT::Source_Capabilities_Extended;
+    msg.header.extended = 1;
+
+    ext = msg;
+    EXPECT_EQ(ext.data_size(), std::min<size_t>(40, PD_CHUNK_EXT::MAX_SIZE));
+    EXPECT_TRUE(ext.is_ext_msg(PD_EXT_MSGT::Source_Capabilities_Extended));
+    EXPECT_EQ(frame[4], 0);
+    EXPECT_EQ(frame[4 + 27], 27);
+    EXPECT_EQ(frame[4 + ext.data_size()], 0); // Nothing written past the data area
+
+    PD_CHUNK copy{ext};
+    EXPECT_EQ(copy.header.raw_value, ext.header.raw_value);
+    EXPECT_EQ(copy.read32(24), ext.read32(24));
+}
+
+// Compare chunk copies with a byte-by-byte loop, as used by the previous
+// vector-based buffers.
+TEST(PdMsgTest, Benchmark) {
+    constexpr int ITERATIONS = 200000;
+    constexpr uint32_t CHUNK_DATA = MaxExtendedMsgChunkLen;
+
+    PD_EXT_MSG ext_msg{};
+    fill(ext_msg, MaxExtendedMsgLen);
+
+    // Extended header + data
+    PD_CHUNK rx_chunk{};
+    rx_chunk.resize(2 + CHUNK_DATA);
+
+    auto bytewise_append = [](PD_EXT_MSG& dst, const uint8_t* src, uint32_t len) {
+        for (uint32_t i = 0; i < len && dst.data_size() < PD_EXT_MSG::MAX_SIZE; i++) {
+            dst.resize(dst.data_size() + 1);
+            dst.data()[dst.data_size() - 1] = src[i];
+        }
+    };
+
+    auto measure = [&](auto&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++) { fn(i); }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+    };
+
+    volatile uint32_t sink = 0;
+    PD_EXT_MSG rx_msg{};
+
+    // RCH: reassemble 260 bytes from 26-byte chunks
+    auto ns_rch_memcpy = measure([&](int i) {
+        rx_msg.clear();
+        rx_chunk.data()[2] = uint8_t(i);
+        while (rx_msg.data_size() < MaxExtendedMsgLen) {
+            rx_msg.append_from(rx_chunk, 2, 2 + CHUNK_DATA);
+        }
+        sink = sink + rx_msg.data()[0];
+    });
+    auto ns_rch_bytes = measure([&](int i) {
+        rx_msg.clear();
+        rx_chunk.data()[2] = uint8_t(i);
+        while (rx_msg.data_size() < MaxExtendedMsgLen) {
+            bytewise_append(rx_msg, rx_chunk.data() + 2, CHUNK_DATA);
+        }
+        sink = sink + rx_msg.data()[0];
+    });
+
+    // TCH: slice 260 bytes into 26-byte chunks
+    uint8_t frame[PD_CHUNK_EXT::MAX_SIZE]{};
+    PD_CHUNK_EXT tx_chunk{frame};
+    auto ns_tch = measure([&](int i) {
+        ext_msg.data()[0] = uint8_t(i);
+        for (uint32_t offset = 0; offset < MaxExtendedMsgLen; offset += CHUNK_DATA) {
+            tx_chunk.clear();
+            tx_chunk.append16(0);
+            tx_chunk.append_from(ext_msg, offset, offset + CHUNK_DATA);
+            sink = sink + frame[2];
+        }
+    });
+
+    printf("RCH reassembly of %u bytes: memcpy %.1f ns, bytewise %.1f ns (x%.1f)\n",
+        MaxExtendedMsgLen, ns_rch_memcpy, ns_rch_bytes, ns_rch_bytes / ns_rch_memcpy);
+    printf("TCH disassembly of %u bytes: %.1f ns\n", MaxExtendedMsgLen, ns_tch);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
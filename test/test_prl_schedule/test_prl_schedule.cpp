@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+// Tests step the stack manually, to inspect a single PRL update. Task
+// routing is detached, so driver wakeups don't start nested ticks.
+struct PrlScheduleTest : public ::testing::Test {
+    SimStack sim;
+
+    void SetUp() override {
+        ASSERT_TRUE(sim.connect());
+        sim.port.task_rtr = nullptr;
+        sim.driver.tx_log.clear();
+        sim.dpm.events.clear();
+    }
+
+    // Same order as Task::tick()
+    void tick() {
+        sim.port.notify_tc(MsgSysUpdate{});
+        sim.port.notify_pe(MsgSysUpdate{});
+        sim.port.notify_prl(MsgSysUpdate{});
+    }
+
+    void queue(const PD_CHUNK& chunk) { sim.driver.rx_queue.push_back(chunk); }
+};
+
+TEST_F(PrlScheduleTest, IdleUpdate) {
+    tick();
+    EXPECT_EQ(sim.prl.last_run_passes, 1);
+    EXPECT_EQ(sim.prl.last_run_calls, 4);
+}
+
+TEST_F(PrlScheduleTest, PingsDrainedInOneUpdate) {
+    for (int i = 0; i < 3; i++) { queue(sim.make_src_msg(PD_CTRL_MSGT::Ping, 0)); }
+
+    // Each ping costs one extra pass, with Rx only
+    sim.port.notify_prl(MsgSysUpdate{});
+    EXPECT_TRUE(sim.driver.rx_queue.empty());
+    EXPECT_EQ(sim.prl.last_run_passes, 5);
+    EXPECT_EQ(sim.prl.last_run_calls, 8);
+}
+
+TEST_F(PrlScheduleTest, PingsThenMessage) {
+    for (int i = 0; i < 2; i++) { queue(sim.make_src_msg(PD_CTRL_MSGT::Ping, 0)); }
+    queue(sim.make_src_msg(PD_CTRL_MSGT::Get_Sink_Cap, 0));
+
+    sim.port.notify_prl(MsgSysUpdate{});
+    EXPECT_EQ(sim.prl.last_run_passes, 4);
+    EXPECT_EQ(sim.prl.last_run_calls, 8);
+
+    // The message waits in PRL until PE takes it
+    EXPECT_EQ(sim.driver.rx_queue.size(), 1u);
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::MSG_RECEIVED));
+
+    for (int i = 0; i < 5; i++) { tick(); }
+    EXPECT_TRUE(sim.driver.rx_queue.empty());
+    ASSERT_FALSE(sim.driver.tx_log.empty());
+    EXPECT_TRUE(sim.driver.tx_log.back().is_data_msg(PD_DATA_MSGT::Sink_Capabilities));
+}
+
+TEST_F(PrlScheduleTest, OneMessagePerUpdate) {
+    queue(sim.make_src_msg(PD_CTRL_MSGT::Get_Sink_Cap, 0));
+    queue(sim.make_src_msg(PD_CTRL_MSGT::Get_Sink_Cap, 0));
+
+    // PE has a single message buffer. Draining stops after the first
+    // report, and the next chunk stays in the driver queue.
+    sim.port.notify_prl(MsgSysUpdate{});
+    EXPECT_EQ(sim.driver.rx_queue.size(), 2u);
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::MSG_RECEIVED));
+    EXPECT_EQ(sim.prl.last_run_passes, 2);
+
+    tick();
+    EXPECT_EQ(sim.driver.rx_queue.size(), 1u);
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::MSG_RECEIVED));
+
+    tick();
+    EXPECT_TRUE(sim.driver.rx_queue.empty());
+}
+
+TEST_F(PrlScheduleTest, TransmitInOneUpdate) {
+    queue(sim.make_src_msg(PD_CTRL_MSGT::Get_Sink_Cap, 0));
+    sim.port.notify_prl(MsgSysUpdate{});
+    sim.port.notify_pe(MsgSysUpdate{});
+
+    // PE requested the reply. One PRL update sends it and reports
+    // completion back to PE.
+    sim.port.notify_prl(MsgSysUpdate{});
+    ASSERT_EQ(sim.driver.tx_log.size(), 1u);
+    EXPECT_TRUE(sim.driver.tx_log[0].is_data_msg(PD_DATA_MSGT::Sink_Capabilities));
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::TX_COMPLETE));
+    EXPECT_EQ(sim.prl.last_run_passes, 4);
+    EXPECT_EQ(sim.prl.last_run_calls, 13);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include "../common/sim_stack.h"
+#include "pd/utils/soft_crc.h"
+
+using namespace pd;
+using namespace pd::soft_crc;
+
+// Bit-by-bit reference implementation, slow
+static uint32_t crc32_update_bitwise(uint32_t crc, const uint8_t* data, size_t len) {
+    while (len--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0u);
+        }
+    }
+    return crc;
+}
+
+TEST(SoftCrcTest, KnownVector) {
+    const uint8_t data[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    EXPECT_EQ(crc32(data, sizeof(data)), 0xCBF43926u);
+    EXPECT_EQ(crc32(data, 0), 0u);
+}
+
+TEST(SoftCrcTest, MatchesBitwiseReference) {
+    std::mt19937 rng(12345);
+    uint8_t buf[64];
+
+    for (int iter = 0; iter < 1000; iter++) {
+        size_t len = rng() % sizeof(buf);
+        for (size_t i = 0; i < len; i++) { buf[i] = rng() & 0xFF; }
+
+        EXPECT_EQ(crc32_update(CRC_INIT, buf, len),
+            crc32_update_bitwise(CRC_INIT, buf, len)) << "len = " << len;
+    }
+}
+
+TEST(SoftCrcTest, IncrementalUpdate) {
+    uint8_t buf[30];
+    for (size_t i = 0; i < sizeof(buf); i++) { buf[i] = uint8_t(i * 7 + 3); }
+
+    for (size_t split = 0; split <= sizeof(buf); split++) {
+        auto crc = crc32_update(CRC_INIT, buf, split);
+        crc = crc32_update(crc, buf + split, sizeof(buf) - split);
+        EXPECT_EQ(~crc, crc32(buf, sizeof(buf)));
+    }
+}
+
+TEST(SoftCrcTest, AppendAndCheckFrame) {
+    // Header + 2 data objects + CRC
+    uint8_t frame[2 + 8 + CRC_SIZE] = {0x41, 0x12, 1, 2, 3, 4, 5, 6, 7, 8};
+
+    EXPECT_EQ(append_crc(frame, 10), sizeof(frame));
+    EXPECT_TRUE(check_frame(frame, sizeof(frame)));
+
+    // Any single bit error is detected
+    for (size_t bit = 0; bit < sizeof(frame) * 8; bit++) {
+        frame[bit / 8] ^= uint8_t(1 << (bit % 8));
+        EXPECT_FALSE(check_frame(frame, sizeof(frame))) << "bit = " << bit;
+        frame[bit / 8] ^= uint8_t(1 << (bit % 8));
+    }
+
+    EXPECT_FALSE(check_frame(frame, 3));
+}
+
+TEST(SoftCrcTest, BuildGoodCrc) {
+    PD_HEADER rx{0};
+    rx.message_type = PD_DATA_MSGT::Source_Capabilities;
+    rx.spec_revision = 2;
+    rx.port_power_role = 1;
+    rx.port_data_role = 1;
+    rx.message_id = 5;
+    rx.data_obj_count = 3;
+
+    uint8_t out[GOODCRC_FRAME_SIZE];
+    EXPECT_EQ(build_goodcrc(rx.raw_value, out), GOODCRC_FRAME_SIZE);
+    EXPECT_TRUE(check_frame(out, sizeof(out)));
+
+    PD_HEADER hdr{uint16_t(out[0] | (out[1] << 8))};
+    EXPECT_EQ(hdr.message_type, PD_CTRL_MSGT::GoodCRC);
+    EXPECT_EQ(hdr.spec_revision, 2);
+    EXPECT_EQ(hdr.message_id, 5);
+    EXPECT_EQ(hdr.port_power_role, 0);
+    EXPECT_EQ(hdr.port_data_role, 0);
+    EXPECT_EQ(hdr.data_obj_count, 0);
+    EXPECT_EQ(hdr.extended, 0);
+}
+
+// Not a real test, just prints the kernel speed on host. Compares with
+// the bitwise version, which is close to what a naive MCU port would do.
+TEST(SoftCrcTest, Benchmark) {
+    // Max size of PD frame: header + 7 data objects + CRC
+    uint8_t frame[2 + 28 + CRC_SIZE];
+    for (size_t i = 0; i < sizeof(frame); i++) { frame[i] = uint8_t(i); }
+
+    constexpr int ITERATIONS = 200000;
+
+    auto measure = [&](uint32_t (*fn)(uint32_t, const uint8_t*, size_t)) {
+        volatile uint32_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++) {
+            frame[0] = uint8_t(i);
+            sink = sink + fn(CRC_INIT, frame, sizeof(frame));
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+    };
+
+    auto ns_bitwise = measure(crc32_update_bitwise);
+    auto ns_slice4 = measure(crc32_update);
+
+    printf("CRC-32 of %zu-byte frame: bitwise %.1f ns, slice-by-4 %.1f ns (x%.1f)\n",
+        sizeof(frame), ns_bitwise, ns_slice4, ns_bitwise / ns_slice4);
+}
+
+//
+// PRL with GoodCRC checked in software (TCPC_HW_FEATURES::tx_auto_goodcrc_check
+// is off)
+//
+
+struct SoftGoodCrcSim : SimStack {
+    SoftGoodCrcSim() {
+        driver.tx_auto_goodcrc_check = false;
+        driver.tx_auto_retry = false;
+    }
+
+    // Ask the sink for a reply, and return sent chunks of this type
+    size_t get_sink_cap(uint32_t run_ms = 20) {
+        driver.tx_log.clear();
+        send_ctrl(PD_CTRL_MSGT::Get_Sink_Cap);
+        this->run_ms(run_ms);
+        return count_sent(PD_DATA_MSGT::Sink_Capabilities);
+    }
+
+    size_t count_sent(uint8_t data_msg_type) {
+        size_t n = 0;
+        for (auto& chunk : driver.tx_log) {
+            if (chunk.is_data_msg(data_msg_type)) { n++; }
+        }
+        return n;
+    }
+};
+
+TEST(SoftGoodCrcTest, MatchingGoodCrcCompletesTransmit) {
+    SoftGoodCrcSim sim;
+    ASSERT_TRUE(sim.connect());
+
+    auto msg_id = sim.port.tx_msg_id_counter.get();
+    EXPECT_EQ(sim.get_sink_cap(), 1u);
+
+    // PRL_Tx_Message_Sent advances the counter, no retries
+    EXPECT_EQ(sim.port.tx_msg_id_counter.get(), (msg_id + 1) & 7);
+    EXPECT_EQ(sim.driver.tx_log.size(), 1u);
+    EXPECT_EQ(sim.driver.tx_log[0].header.message_id, msg_id);
+}
+
+TEST(SoftGoodCrcTest, MessageIdMismatchRetries) {
+    SoftGoodCrcSim sim;
+    ASSERT_TRUE(sim.connect());
+
+    auto msg_id = sim.port.tx_msg_id_counter.get();
+    sim.driver.goodcrc_bad_id = 1;
+    EXPECT_EQ(sim.get_sink_cap(), 2u);
+
+    // Same message resent, then accepted
+    EXPECT_EQ(sim.driver.tx_log[0].header.message_id, msg_id);
+    EXPECT_EQ(sim.driver.tx_log[1].header.message_id, msg_id);
+    EXPECT_EQ(sim.port.tx_msg_id_counter.get(), (msg_id + 1) & 7);
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+}
+
+TEST(SoftGoodCrcTest, ReceiveTimeoutRetries) {
+    SoftGoodCrcSim sim;
+    ASSERT_TRUE(sim.connect());
+
+    auto msg_id = sim.port.tx_msg_id_counter.get();
+    sim.driver.goodcrc_to_drop = 1;
+    EXPECT_EQ(sim.get_sink_cap(), 2u);
+    EXPECT_EQ(sim.port.tx_msg_id_counter.get(), (msg_id + 1) & 7);
+}
+
+TEST(SoftGoodCrcTest, TransmitErrorAfterRetries) {
+    SoftGoodCrcSim sim;
+    ASSERT_TRUE(sim.connect());
+
+    // No GoodCRC for the reply: first try + nRetryCount, then PRL reports
+    // the error, and PE starts soft reset
+    auto msg_id = sim.port.tx_msg_id_counter.get();
+    sim.driver.goodcrc_to_drop = 1 + nRetryCount;
+    EXPECT_EQ(sim.get_sink_cap(), size_t(1 + nRetryCount));
+
+    ASSERT_GT(sim.driver.tx_log.size(), size_t(1 + nRetryCount));
+    EXPECT_TRUE(sim.driver.tx_log[1 + nRetryCount].is_ctrl_msg(PD_CTRL_MSGT::Soft_Reset));
+    for (int i = 0; i <= nRetryCount; i++) {
+        EXPECT_EQ(sim.driver.tx_log[i].header.message_id, msg_id);
+    }
+}
+
+TEST(SoftGoodCrcTest, StaleGoodCrcClearedOnTransmit) {
+    SoftGoodCrcSim sim;
+    ASSERT_TRUE(sim.connect());
+
+    // GoodCRC with the ID of the next message arrives while idle
+    auto msg_id = sim.port.tx_msg_id_counter.get();
+    auto stale = sim.make_src_msg(PD_CTRL_MSGT::GoodCRC, 0);
+    stale.header.message_id = msg_id;
+    sim.driver.receive(stale);
+    sim.run_ms(5);
+    ASSERT_TRUE(sim.port.prl_tx_flags.test(PRL_TX_FLAG::GOODCRC_RECEIVED));
+
+    // Not taken as the reply to the next message, which is retried
+    sim.driver.goodcrc_to_drop = 1;
+    EXPECT_EQ(sim.get_sink_cap(), 2u);
+    EXPECT_EQ(sim.port.tx_msg_id_counter.get(), (msg_id + 1) & 7);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 #include <etl/vector.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <thread>
 #include "pd/utils/spsc_overwrite_queue.h"
 
 // Basic functionality tests
@@ -304,6 +308,256 @@ TEST(SPSCOverwriteQueueTest, CustomType) {
     EXPECT_TRUE(queue.empty());
 }
 
+// In-place API tests
+TEST(SPSCOverwriteQueueTest, ReserveCommitFrontRelease) {
+    spsc_overwrite_queue<int, 4> queue;
+    EXPECT_EQ(queue.front(), nullptr);
+
+    *queue.reserve() = 1;
+    // Not visible until committed
+    EXPECT_EQ(queue.front(), nullptr);
+    EXPECT_TRUE(queue.empty());
+    queue.commit();
+
+    *queue.reserve() = 2;
+    queue.commit();
+
+    // Repeated front() returns the same element
+    auto item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 1);
+    EXPECT_EQ(queue.front(), item);
+    EXPECT_TRUE(queue.release());
+
+    item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 2);
+    EXPECT_TRUE(queue.release());
+
+    EXPECT_EQ(queue.front(), nullptr);
+    EXPECT_FALSE(queue.release());
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCOverwriteQueueTest, ReserveHidesOldestWhenFull) {
+    spsc_overwrite_queue<int, 4> queue;
+    for (int i = 1; i <= 4; i++) { queue.push(i); }
+
+    // The slot of 1 is being rewritten, so 1 is dropped right away
+    *queue.reserve() = 5;
+    auto item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 2);
+    queue.commit();
+
+    EXPECT_TRUE(queue.release());
+    int value;
+    for (int expected = 3; expected <= 5; expected++) {
+        EXPECT_TRUE(queue.pop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCOverwriteQueueTest, ProducerLapsBorrowedElement) {
+    spsc_overwrite_queue<int, 4> queue;
+    for (int i = 1; i <= 4; i++) { queue.push(i); }
+
+    auto item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 1);
+
+    // Producer overwrites the borrowed slot during the read
+    queue.push(5);
+    EXPECT_FALSE(queue.release());
+
+    // Retry starts from the new oldest element
+    item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 2);
+    EXPECT_TRUE(queue.release());
+
+    // Reserve alone is enough to invalidate the read
+    item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 3);
+    queue.push(6);
+    queue.push(7);
+    *queue.reserve() = 8;
+    EXPECT_FALSE(queue.release());
+    queue.commit();
+
+    int value;
+    for (int expected = 5; expected <= 8; expected++) {
+        EXPECT_TRUE(queue.pop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCOverwriteQueueTest, ClearFromProducerDuringRead) {
+    spsc_overwrite_queue<int, 4> queue;
+    queue.push(1);
+    queue.push(2);
+
+    auto item = queue.front();
+    ASSERT_NE(item, nullptr);
+    queue.clear_from_producer();
+    EXPECT_FALSE(queue.release());
+
+    EXPECT_EQ(queue.front(), nullptr);
+    EXPECT_TRUE(queue.empty());
+
+    queue.push(3);
+    item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 3);
+    EXPECT_TRUE(queue.release());
+}
+
+// Element large enough to make copies visible, filled with its sequence
+// number. Any mix of two writes is detected.
+struct Frame {
+    static constexpr size_t WORDS = 64;
+    uint32_t seq;
+    uint32_t words[WORDS];
+
+    void fill(uint32_t n) {
+        seq = n;
+        for (auto& w : words) { w = n; }
+    }
+
+    bool is_consistent(uint32_t n) const {
+        if (seq != n) { return false; }
+        for (auto w : words) { if (w != n) { return false; } }
+        return true;
+    }
+};
+
+TEST(SPSCOverwriteQueueStressTest, InPlaceProducerConsumer) {
+    constexpr uint32_t COUNT = 500000;
+    spsc_overwrite_queue<Frame, 4> queue;
+    std::atomic<bool> started{false};
+    std::atomic<bool> done{false};
+
+    std::thread producer([&] {
+        while (!started) { std::this_thread::yield(); }
+        for (uint32_t n = 1; n <= COUNT; n++) {
+            queue.reserve()->fill(n);
+            queue.commit();
+            if ((n & 7) == 0) { std::this_thread::yield(); }
+        }
+        done = true;
+    });
+    started = true;
+
+    uint32_t received = 0;
+    uint32_t last = 0;
+    uint32_t retries = 0;
+    int torn = 0;
+    int out_of_order = 0;
+
+    for (;;) {
+        bool finished = done.load();
+        auto item = queue.front();
+        if (!item) {
+            if (finished) { break; }
+            continue;
+        }
+
+        uint32_t seq = item->seq;
+        // Let the producer run in the middle of some reads, to lap the
+        // consumer even on a single core
+        if ((seq & 3) == 0) { std::this_thread::yield(); }
+        bool consistent = item->is_consistent(seq);
+        if (!queue.release()) {
+            retries++;
+            continue;
+        }
+        // Validated reads must be whole and in order
+        if (!consistent) { torn++; }
+        if (seq <= last) { out_of_order++; }
+        last = seq;
+        received++;
+    }
+    producer.join();
+
+    EXPECT_EQ(torn, 0);
+    EXPECT_EQ(out_of_order, 0);
+    EXPECT_EQ(last, COUNT);
+    EXPECT_GT(received, 0u);
+    printf("Received %u of %u, lapped reads retried: %u\n", received, COUNT, retries);
+}
+
+TEST(SPSCOverwriteQueueStressTest, PopMatchesInPlace) {
+    constexpr uint32_t COUNT = 200000;
+    spsc_overwrite_queue<Frame, 4> queue;
+    std::atomic<bool> done{false};
+
+    std::thread producer([&] {
+        Frame frame;
+        for (uint32_t n = 1; n <= COUNT; n++) {
+            frame.fill(n);
+            queue.push(frame);
+        }
+        done = true;
+    });
+
+    Frame frame;
+    uint32_t last = 0;
+    int errors = 0;
+    for (;;) {
+        bool finished = done.load();
+        if (!queue.pop(frame)) {
+            if (finished) { break; }
+            continue;
+        }
+        if (!frame.is_consistent(frame.seq) || frame.seq <= last) { errors++; }
+        last = frame.seq;
+    }
+    producer.join();
+
+    EXPECT_EQ(errors, 0);
+    EXPECT_EQ(last, COUNT);
+}
+
+TEST(SPSCOverwriteQueueTest, Benchmark) {
+    constexpr int ITERATIONS = 200000;
+    spsc_overwrite_queue<Frame, 4> queue;
+
+    auto measure = [&](auto fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++) { fn(uint32_t(i)); }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+    };
+
+    volatile uint32_t sink = 0;
+    Frame src;
+    Frame dst;
+    src.fill(0);
+
+    // Typical use: build a frame, then read its header
+    auto ns_copy = measure([&](uint32_t n) {
+        src.seq = n;
+        queue.push(src);
+        if (queue.pop(dst)) { sink = sink + dst.seq; }
+    });
+
+    auto ns_in_place = measure([&](uint32_t n) {
+        auto slot = queue.reserve();
+        slot->seq = n;
+        queue.commit();
+        auto item = queue.front();
+        if (item) {
+            uint32_t seq = item->seq;
+            if (queue.release()) { sink = sink + seq; }
+        }
+    });
+
+    printf("%zu-byte element, push+pop: copy %.1f ns, in place %.1f ns (x%.1f)\n",
+        sizeof(Frame), ns_copy, ns_in_place, ns_copy / ns_in_place);
+}
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
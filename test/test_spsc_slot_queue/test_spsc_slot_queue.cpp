@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include "pd/utils/spsc_slot_queue.h"
+
+// Helper: reserve + fill + commit
+template<typename Q>
+static bool put(Q& queue, int value) {
+    auto slot = queue.reserve();
+    if (!slot) { return false; }
+    *slot = value;
+    queue.commit();
+    return true;
+}
+
+// Basic functionality tests
+TEST(SPSCSlotQueueTest, InitiallyEmpty) {
+    spsc_slot_queue<int, 4> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.front(), nullptr);
+}
+
+TEST(SPSCSlotQueueTest, CommitSingleElement) {
+    spsc_slot_queue<int, 4> queue;
+
+    EXPECT_TRUE(put(queue, 42));
+    EXPECT_FALSE(queue.empty());
+
+    auto item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 42);
+
+    queue.release();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.front(), nullptr);
+}
+
+TEST(SPSCSlotQueueTest, ReserveWithoutCommitIsInvisible) {
+    spsc_slot_queue<int, 4> queue;
+
+    auto slot = queue.reserve();
+    ASSERT_NE(slot, nullptr);
+    *slot = 1;
+    EXPECT_TRUE(queue.empty());
+
+    // Uncommitted slot is reused by the next reserve()
+    EXPECT_EQ(queue.reserve(), slot);
+}
+
+TEST(SPSCSlotQueueTest, FrontIsStableUntilRelease) {
+    spsc_slot_queue<int, 4> queue;
+
+    put(queue, 1);
+    put(queue, 2);
+
+    auto a = queue.front();
+    auto b = queue.front();
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(*a, 1);
+
+    queue.release();
+    auto c = queue.front();
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(*c, 2);
+}
+
+TEST(SPSCSlotQueueTest, FullQueueRejectsReserve) {
+    spsc_slot_queue<int, 4> queue;
+
+    for (int i = 1; i <= 4; i++) { EXPECT_TRUE(put(queue, i)); }
+    EXPECT_EQ(queue.reserve(), nullptr);
+
+    // Data is intact, the newest one was dropped
+    for (int expected = 1; expected <= 4; expected++) {
+        auto item = queue.front();
+        ASSERT_NE(item, nullptr);
+        EXPECT_EQ(*item, expected);
+        queue.release();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCSlotQueueTest, BorrowedSlotIsNotReused) {
+    spsc_slot_queue<int, 4> queue;
+
+    for (int i = 1; i <= 4; i++) { put(queue, i); }
+
+    auto borrowed = queue.front();
+    ASSERT_NE(borrowed, nullptr);
+
+    // Still full while borrowed
+    EXPECT_EQ(queue.reserve(), nullptr);
+    EXPECT_EQ(*borrowed, 1);
+
+    queue.release();
+    auto slot = queue.reserve();
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(slot, borrowed);
+}
+
+TEST(SPSCSlotQueueTest, WrapAround) {
+    spsc_slot_queue<int, 4> queue;
+
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(put(queue, i));
+        EXPECT_TRUE(put(queue, i + 1000));
+
+        auto item = queue.front();
+        ASSERT_NE(item, nullptr);
+        EXPECT_EQ(*item, i);
+        queue.release();
+
+        item = queue.front();
+        ASSERT_NE(item, nullptr);
+        EXPECT_EQ(*item, i + 1000);
+        queue.release();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+// Clear tests
+TEST(SPSCSlotQueueTest, ClearFromConsumer) {
+    spsc_slot_queue<int, 4> queue;
+
+    put(queue, 1);
+    put(queue, 2);
+    queue.clear_from_consumer();
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.front(), nullptr);
+}
+
+TEST(SPSCSlotQueueTest, ClearFromProducer) {
+    spsc_slot_queue<int, 4> queue;
+
+    put(queue, 1);
+    put(queue, 2);
+    queue.clear_from_producer();
+
+    EXPECT_TRUE(queue.empty());
+
+    put(queue, 3);
+    auto item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 3);
+}
+
+TEST(SPSCSlotQueueTest, ClearFromProducerWhileBorrowed) {
+    spsc_slot_queue<int, 4> queue;
+
+    put(queue, 1);
+    put(queue, 2);
+
+    auto borrowed = queue.front();
+    ASSERT_NE(borrowed, nullptr);
+
+    queue.clear_from_producer();
+    put(queue, 3);
+
+    // Borrowed data is still intact
+    EXPECT_EQ(*borrowed, 1);
+
+    // Release after clear must not skip the new element
+    queue.release();
+    auto item = queue.front();
+    ASSERT_NE(item, nullptr);
+    EXPECT_EQ(*item, 3);
+
+    queue.release();
+    EXPECT_TRUE(queue.empty());
+
+    // Extra release on empty queue is harmless
+    queue.release();
+    EXPECT_TRUE(queue.empty());
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,330 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+#include "../common/pdo_fixtures.h"
+#include "../common/sim_stack.h"
+#include "pd/utils/src_caps_parser.h"
+
+using namespace pd;
+
+// Fixed size buffer, to test EPR sized payloads in all feature profiles
+using TestMsg = PD_MSG_TPL<MaxExtendedMsgLen>;
+
+static std::vector<uint8_t> to_bytes(const std::vector<uint32_t>& pdos) {
+    std::vector<uint8_t> bytes;
+    for (auto pdo : pdos) {
+        for (int i = 0; i < 4; i++) { bytes.push_back(uint8_t(pdo >> (i * 8))); }
+    }
+    return bytes;
+}
+
+// Feed `bytes` to the parser by chunks, as RCH assembles them. Returns PDOs
+// parsed after each chunk.
+static std::vector<size_t> feed_by_chunks(SrcCapsParser& parser, const std::vector<uint8_t>& bytes) {
+    TestMsg msg{};
+    std::vector<size_t> progress;
+    for (size_t pos = 0; pos < bytes.size(); pos += MaxExtendedMsgChunkLen) {
+        msg.resize(std::min(bytes.size(), pos + MaxExtendedMsgChunkLen));
+        for (size_t i = pos; i < msg.data_size(); i++) { msg.data()[i] = bytes[i]; }
+        parser.update(msg);
+        progress.push_back(parser.size());
+    }
+    return progress;
+}
+
+static const std::vector<uint32_t> spr_caps{
+    make_fixed_pdo(5000, 3000),
+    make_fixed_pdo(9000, 3000),
+    make_fixed_pdo(15000, 3000),
+    make_fixed_pdo(20000, 5000),
+    make_pps_apdo(3300, 11000, 5000),
+    make_pps_apdo(3300, 21000, 5000)
+};
+
+static const std::vector<uint32_t> epr_caps{
+    make_fixed_pdo(5000, 3000),
+    make_fixed_pdo(9000, 3000),
+    make_fixed_pdo(15000, 3000),
+    make_fixed_pdo(20000, 5000),
+    make_pps_apdo(3300, 21000, 5000),
+    0,
+    0,
+    make_fixed_pdo(28000, 5000),
+    make_fixed_pdo(36000, 5000),
+    make_fixed_pdo(48000, 5000),
+    make_epr_avs_apdo(15000, 48000, 240)
+};
+
+//
+// Parser
+//
+
+TEST(SrcCapsParserTest, ChunksGiveSameResultAsWholeList) {
+    std::vector<std::vector<uint32_t>> lists{
+        spr_caps,
+        epr_caps,
+        // Broken fixed order in the second chunk
+        { make_fixed_pdo(5000, 3000), make_fixed_pdo(9000, 3000), make_fixed_pdo(15000, 3000),
+          make_fixed_pdo(20000, 3000), 0, 0, 0, make_fixed_pdo(36000, 5000), make_fixed_pdo(28000, 5000) },
+        // Two EPR AVS
+        { make_fixed_pdo(5000, 3000), 0, 0, 0, 0, 0, 0,
+          make_epr_avs_apdo(15000, 48000, 240), make_epr_avs_apdo(15000, 36000, 140) },
+        // Too many
+        std::vector<uint32_t>(12, make_fixed_pdo(5000, 3000)),
+    };
+
+    for (size_t n = 0; n < lists.size(); n++) {
+        const auto& list = lists[n];
+        auto bytes = to_bytes(list);
+        PdoSpan whole{bytes.data(), list.size()};
+
+        SrcCapsParser streamed;
+        feed_by_chunks(streamed, bytes);
+        streamed.finish();
+
+        size_t pos = 0;
+        EXPECT_EQ(streamed.error(), SrcCapsParser::validate(whole, &pos)) << n;
+        EXPECT_EQ(streamed.error_position(), pos) << n;
+        EXPECT_EQ(streamed.ok(), PE::validate_source_caps(whole)) << n;
+        EXPECT_EQ(streamed.size(), list.size()) << n;
+    }
+}
+
+TEST(SrcCapsParserTest, PdoSplitBetweenChunks) {
+    SrcCapsParser parser;
+    auto progress = feed_by_chunks(parser, to_bytes(epr_caps));
+
+    // 26 bytes per chunk: the 7th PDO is completed by the second chunk
+    ASSERT_EQ(progress.size(), size_t(2));
+    EXPECT_EQ(progress[0], size_t(6));
+    EXPECT_EQ(progress[1], size_t(11));
+    EXPECT_TRUE(parser.finish());
+}
+
+TEST(SrcCapsParserTest, ErrorFoundBeforeLastChunk) {
+    auto list = epr_caps;
+    list[2] = make_fixed_pdo(28000, 5000); // EPR voltage at SPR position
+
+    auto bytes = to_bytes(list);
+    TestMsg msg{};
+    msg.resize(MaxExtendedMsgChunkLen);
+    for (size_t i = 0; i < size_t(MaxExtendedMsgChunkLen); i++) { msg.data()[i] = bytes[i]; }
+
+    SrcCapsParser parser;
+    parser.update(msg);
+    EXPECT_FALSE(parser.ok());
+    EXPECT_EQ(parser.error(), SRC_CAPS_ERROR::EPR_PDO_AT_SPR_POSITION);
+    EXPECT_EQ(parser.error_position(), size_t(2));
+}
+
+TEST(SrcCapsParserTest, EmptyAndPartialPdo) {
+    SrcCapsParser parser;
+    EXPECT_FALSE(parser.finish());
+    EXPECT_EQ(parser.error(), SRC_CAPS_ERROR::EMPTY);
+
+    // Trailing bytes of an incomplete PDO are ignored, as in PdoSpan
+    parser.reset();
+    TestMsg msg{};
+    msg.append32(make_fixed_pdo(5000, 3000));
+    msg.append16(0x1234);
+    parser.update(msg);
+    EXPECT_EQ(parser.size(), size_t(1));
+    EXPECT_TRUE(parser.finish());
+}
+
+TEST(SrcCapsParserTest, Summary) {
+    SrcCapsParser parser;
+    auto bytes = to_bytes(epr_caps);
+    parser.update(PdoSpan{bytes.data(), epr_caps.size()});
+    ASSERT_TRUE(parser.finish());
+
+    auto summary = parser.summary();
+    EXPECT_EQ(summary.size(), size_t(PdoListSize));
+    EXPECT_EQ(summary.variant(0), PDO_VARIANT::FIXED);
+    EXPECT_EQ(summary.variant(4), PDO_VARIANT::APDO_PPS);
+    EXPECT_EQ(summary.variant(5), PDO_VARIANT::UNKNOWN); // Padding
+    EXPECT_TRUE(summary.has(PDO_VARIANT::APDO_PPS));
+    EXPECT_FALSE(summary.has(PDO_VARIANT::APDO_SPR_AVS));
+    EXPECT_EQ(summary.has(PDO_VARIANT::APDO_EPR_AVS), bool(PD_FEATURE_EPR));
+    EXPECT_EQ(summary.variant(10), PD_FEATURE_EPR ? PDO_VARIANT::APDO_EPR_AVS : PDO_VARIANT::UNKNOWN);
+
+    summary.trim(MaxPdoObjects_SPR);
+    EXPECT_EQ(summary.size(), size_t(MaxPdoObjects_SPR));
+    EXPECT_FALSE(summary.has(PDO_VARIANT::APDO_EPR_AVS));
+    EXPECT_EQ(summary.variant(10), PDO_VARIANT::UNKNOWN);
+}
+
+//
+// Full stack
+//
+
+TEST(SrcCapsParserTest, SummaryForDpm) {
+    SimStack sim;
+    sim.src_pdos = spr_caps;
+    ASSERT_TRUE(sim.connect());
+
+    const auto& summary = sim.port.source_caps_summary;
+    EXPECT_EQ(summary.size(), spr_caps.size());
+    EXPECT_TRUE(summary.has(PDO_VARIANT::APDO_PPS));
+
+    // No SPR AVS, fallback to 5V without scanning
+    sim.dpm.trigger_variant(PDO_VARIANT::APDO_SPR_AVS, 9000);
+    sim.run_ms(50);
+    EXPECT_EQ(RdoView{sim.port.rdo_contracted}.position(), 1u);
+
+    sim.dpm.trigger_variant(PDO_VARIANT::APDO_PPS, 16000, 2000);
+    sim.run_ms(50);
+    EXPECT_EQ(RdoView{sim.port.rdo_contracted}.position(), 6u);
+}
+
+#if PD_FEATURE_EPR
+
+// Source model, with chunk requests held until released by the test
+struct HeldChunksSim : SimStack {
+    std::vector<uint8_t> held_requests;
+
+    HeldChunksSim() {
+        auto src_model = driver.on_transmit;
+        driver.on_transmit = [this, src_model](const PD_CHUNK& chunk) {
+            if (chunk.header.extended && chunk.header.data_obj_count > 0) {
+                PD_EXT_HEADER ehdr{chunk.read16(0)};
+                if (ehdr.request_chunk) {
+                    held_requests.push_back(uint8_t(ehdr.chunk_number));
+                    return;
+                }
+            }
+            src_model(chunk);
+        };
+    }
+
+    void send_epr_caps_chunk(const std::vector<uint32_t>& list, uint8_t chunk_number) {
+        driver.receive(make_src_ext_chunk(PD_EXT_MSGT::EPR_Source_Capabilities,
+            to_bytes(list), true, chunk_number));
+    }
+
+    size_t requests_sent() const {
+        size_t count = 0;
+        for (auto& chunk : driver.tx_log) {
+            if (chunk.is_data_msg(PD_DATA_MSGT::Request)) { count++; }
+        }
+        return count;
+    }
+};
+
+TEST(SrcCapsParserTest, ParsedWhileNextChunkRequested) {
+    HeldChunksSim sim;
+    sim.src_pdos = spr_caps;
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+    auto requests = sim.requests_sent();
+
+    sim.send_epr_caps_chunk(epr_caps, 0);
+    sim.run_ms(1);
+
+    // First chunk is already validated, while waiting for the second one
+    ASSERT_EQ(sim.held_requests, std::vector<uint8_t>{1});
+    EXPECT_EQ(sim.port.src_caps_parser.size(), size_t(6));
+    EXPECT_TRUE(sim.port.src_caps_parser.ok());
+
+    sim.send_epr_caps_chunk(epr_caps, 1);
+    sim.run_ms(10);
+
+    EXPECT_EQ(sim.port.src_caps_parser.size(), epr_caps.size());
+    EXPECT_EQ(sim.requests_sent(), requests + 1);
+    // SPR mode, trimmed with the caps
+    EXPECT_EQ(sim.port.source_caps.size(), size_t(MaxPdoObjects_SPR));
+    EXPECT_EQ(sim.port.source_caps_summary.size(), size_t(MaxPdoObjects_SPR));
+    EXPECT_FALSE(sim.port.source_caps_summary.has(PDO_VARIANT::APDO_EPR_AVS));
+}
+
+TEST(SrcCapsParserTest, InvalidPdoInFirstChunk) {
+    HeldChunksSim sim;
+    sim.src_pdos = spr_caps;
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+
+    auto list = epr_caps;
+    list[1] = make_fixed_pdo(36000, 5000);
+
+    sim.send_epr_caps_chunk(list, 0);
+    sim.run_ms(1);
+    EXPECT_EQ(sim.port.src_caps_parser.error(), SRC_CAPS_ERROR::EPR_PDO_AT_SPR_POSITION);
+
+    sim.driver.tx_log.clear();
+    sim.send_epr_caps_chunk(list, 1);
+    sim.run_ms(10);
+
+    ASSERT_FALSE(sim.driver.tx_log.empty());
+    EXPECT_TRUE(sim.driver.tx_log.back().is_ctrl_msg(PD_CTRL_MSGT::Not_Supported));
+}
+
+// A chunk with a wrong number breaks the sequence. The partial parse is not
+// used, and the next message starts from scratch.
+TEST(SrcCapsParserTest, MalformedChunkSequence) {
+    HeldChunksSim sim;
+    sim.src_pdos = spr_caps;
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+    auto requests = sim.requests_sent();
+
+    sim.send_epr_caps_chunk(epr_caps, 0);
+    sim.run_ms(1);
+    sim.send_epr_caps_chunk(epr_caps, 0); // Repeated instead of chunk 1
+    sim.run_ms(50);
+
+    EXPECT_EQ(sim.requests_sent(), requests);
+    EXPECT_EQ(sim.port.source_caps.size(), spr_caps.size());
+    EXPECT_EQ(sim.port.source_caps_summary.size(), spr_caps.size());
+
+    // Recover with a valid sequence
+    sim.send_src_caps();
+    sim.run_ms(20);
+    requests = sim.requests_sent();
+    sim.held_requests.clear();
+
+    sim.send_epr_caps_chunk(epr_caps, 0);
+    sim.run_ms(1);
+    EXPECT_EQ(sim.port.src_caps_parser.size(), size_t(6));
+    sim.send_epr_caps_chunk(epr_caps, 1);
+    sim.run_ms(10);
+
+    EXPECT_EQ(sim.requests_sent(), requests + 1);
+    EXPECT_TRUE(sim.port.src_caps_parser.ok());
+}
+
+// Source stops sending chunks. Nothing is passed up, stored caps are kept.
+TEST(SrcCapsParserTest, TruncatedChunkSequence) {
+    HeldChunksSim sim;
+    sim.src_pdos = spr_caps;
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+    auto requests = sim.requests_sent();
+
+    sim.send_epr_caps_chunk(epr_caps, 0);
+    // Past tChunkSenderResponse
+    sim.run_ms(40);
+
+    EXPECT_EQ(sim.held_requests, std::vector<uint8_t>{1});
+    EXPECT_EQ(sim.requests_sent(), requests);
+    EXPECT_EQ(sim.port.source_caps.size(), spr_caps.size());
+    EXPECT_EQ(sim.port.source_caps_summary.size(), spr_caps.size());
+
+    // An unrelated extended message resets the partial state
+    PD_EXT_HEADER ehdr{0};
+    ehdr.chunked = 1;
+    ehdr.data_size = 2;
+    auto chunk = sim.make_src_msg(PD_EXT_MSGT::Status, 1);
+    chunk.header.extended = 1;
+    chunk.append16(ehdr.raw_value);
+    chunk.append16(0);
+    sim.driver.receive(chunk);
+    sim.run_ms(10);
+    EXPECT_EQ(sim.port.src_caps_parser.size(), size_t(0));
+}
+
+#endif
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
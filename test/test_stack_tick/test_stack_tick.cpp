@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+TEST(StackTickTest, Negotiates) {
+    SimStack sim;
+
+    ASSERT_TRUE(sim.connect());
+    EXPECT_TRUE(sim.port.is_attached);
+    EXPECT_TRUE(sim.dpm.has_event(MSG_TO_DPM__CABLE_ATTACHED));
+    EXPECT_TRUE(sim.dpm.has_event(MSG_TO_DPM__SRC_CAPS_RECEIVED));
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+
+    sim.unplug();
+    sim.run_ms(1);
+    EXPECT_FALSE(sim.port.is_attached);
+    EXPECT_TRUE(sim.dpm.has_event(MSG_TO_DPM__CABLE_DETACHED));
+}
+
+struct RunCounts {
+    uint32_t runs[Task::RUN_COUNT]{};
+    uint32_t skipped[Task::RUN_COUNT]{};
+
+    // Difference since `start`
+    static RunCounts since(const Task& task, const RunCounts& start) {
+        RunCounts d;
+        for (size_t i = 0; i < Task::RUN_COUNT; i++) {
+            d.runs[i] = task.runs[i] - start.runs[i];
+            d.skipped[i] = task.skipped_runs[i] - start.skipped[i];
+        }
+        return d;
+    }
+    static RunCounts of(const Task& task) { return since(task, RunCounts{}); }
+};
+
+static constexpr size_t TC_IDX = size_t(TASK_RUN_FLAG::TC);
+static constexpr size_t PE_IDX = size_t(TASK_RUN_FLAG::PE);
+static constexpr size_t PRL_IDX = size_t(TASK_RUN_FLAG::PRL);
+
+TEST(StackTickTest, IdleTicksRunNothing) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+
+    auto start = RunCounts::of(sim.task);
+    sim.run_ms(1000);
+    auto d = RunCounts::since(sim.task, start);
+
+    for (size_t i = 0; i < Task::RUN_COUNT; i++) {
+        EXPECT_EQ(d.runs[i], 0u);
+        EXPECT_EQ(d.skipped[i], 1000u);
+    }
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+}
+
+TEST(StackTickTest, WakeupRunsAll) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+
+    auto start = RunCounts::of(sim.task);
+    sim.port.wakeup();
+    auto d = RunCounts::since(sim.task, start);
+
+    for (size_t i = 0; i < Task::RUN_COUNT; i++) { EXPECT_EQ(d.runs[i], 1u); }
+}
+
+TEST(StackTickTest, TimerRunsOwnerOnly) {
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+
+    // PE_SNK_Ready does not use this timer, so PE runs once and stays
+    sim.port.timers.start(PD_TIMEOUT::tSenderResponse);
+    auto start = RunCounts::of(sim.task);
+    sim.run_ms(100);
+    auto d = RunCounts::since(sim.task, start);
+
+    EXPECT_EQ(d.runs[TC_IDX], 0u);
+    EXPECT_EQ(d.runs[PE_IDX], 1u);
+    EXPECT_EQ(d.runs[PRL_IDX], 0u);
+}
+
+// Not a real test, just prints the cost of an idle timer tick (contract
+// established, nothing to do), on host.
+TEST(StackTickTest, Benchmark) {
+    constexpr int ITERATIONS = 200000;
+    SimStack sim;
+    ASSERT_TRUE(sim.connect());
+
+    auto start = std::chrono::steady_clock::now();
+    sim.run_ms(ITERATIONS);
+    auto end = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+
+    printf("Idle tick: %.1f ns, runs TC/PE/PRL: %u/%u/%u, skipped: %u/%u/%u\n",
+        ns,
+        sim.task.runs[TC_IDX], sim.task.runs[PE_IDX], sim.task.runs[PRL_IDX],
+        sim.task.skipped_runs[TC_IDX], sim.task.skipped_runs[PE_IDX], sim.task.skipped_runs[PRL_IDX]);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
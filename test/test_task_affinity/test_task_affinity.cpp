@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+// Records threads that run the stack
+class RecordingTask : public Task {
+public:
+    using Task::Task;
+
+    void tick() override {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            threads.insert(std::this_thread::get_id());
+        }
+        ticks++;
+        Task::tick();
+    }
+
+    std::set<std::thread::id> get_threads() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return threads;
+    }
+
+    std::atomic<int> ticks{0};
+
+private:
+    std::mutex mtx;
+    std::set<std::thread::id> threads;
+};
+
+using Sim = SimStackT<RecordingTask>;
+
+static int count_requests(const std::vector<PD_CHUNK>& log) {
+    int n = 0;
+    for (auto& chunk : log) { if (chunk.is_data_msg(PD_DATA_MSGT::Request)) { n++; } }
+    return n;
+}
+
+TEST(TaskAffinityTest, ForeignWakeupOnlySetsEvent) {
+    Sim sim;
+    ASSERT_TRUE(sim.connect());
+
+    std::thread other([] {});
+    auto other_id = other.get_id();
+    other.join();
+
+    // Pretend the stack belongs to another thread
+    sim.driver.set_owner(other_id);
+    int ticks = sim.task.ticks;
+    sim.port.wakeup();
+    sim.port.wakeup();
+    EXPECT_EQ(sim.task.ticks, ticks);
+    EXPECT_EQ(sim.driver.dispatch_requests, 2);
+
+    // The owner picks up pending events
+    sim.driver.set_owner(std::this_thread::get_id());
+    sim.port.wakeup();
+    EXPECT_EQ(sim.task.ticks, ticks + 1);
+}
+
+TEST(TaskAffinityTest, PowerRequestWithoutTimerTick) {
+    Sim sim;
+    ASSERT_TRUE(sim.connect());
+    sim.driver.tx_log.clear();
+
+    // No timer ticks needed to start negotiation
+    sim.dpm.request_new_power_level();
+    EXPECT_EQ(count_requests(sim.driver.tx_log), 1);
+}
+
+TEST(TaskAffinityTest, MultiThreadedWakeups) {
+    Sim sim;
+    ASSERT_TRUE(sim.connect());
+    sim.driver.tx_log.clear();
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool kicked = false;
+    bool stop = false;
+    std::atomic<bool> ready{false};
+
+    sim.driver.on_req_dispatch = [&] {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            kicked = true;
+        }
+        cv.notify_one();
+    };
+
+    // Driver thread, the only one to run the stack. Simulated time is not
+    // advanced, so all progress comes from wakeups.
+    std::thread driver_thread([&] {
+        sim.driver.set_owner(std::this_thread::get_id());
+        ready = true;
+
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait_for(lock, std::chrono::milliseconds(1), [&] { return kicked || stop; });
+            if (stop && !kicked) { break; }
+            kicked = false;
+            lock.unlock();
+
+            sim.port.wakeup();
+        }
+    });
+    while (!ready) { std::this_thread::yield(); }
+    auto driver_id = driver_thread.get_id();
+
+    constexpr int THREADS = 4;
+    constexpr int ITERATIONS = 200;
+    std::vector<std::thread> app_threads;
+    for (int t = 0; t < THREADS; t++) {
+        app_threads.emplace_back([&] {
+            for (int i = 0; i < ITERATIONS; i++) {
+                sim.dpm.request_new_power_level();
+                std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : app_threads) { t.join(); }
+
+    // Let the driver thread finish the last negotiation
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (sim.port.dpm_requests.test(DPM_REQUEST_FLAG::NEW_POWER_LEVEL) &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    cv.notify_one();
+    driver_thread.join();
+
+    auto threads = sim.task.get_threads();
+    ASSERT_EQ(threads.count(driver_id), 1u);
+    // Main thread ran the stack only during connect(), before the owner
+    // was set.
+    threads.erase(driver_id);
+    threads.erase(std::this_thread::get_id());
+    EXPECT_TRUE(threads.empty());
+
+    EXPECT_FALSE(sim.port.dpm_requests.test(DPM_REQUEST_FLAG::NEW_POWER_LEVEL));
+    EXPECT_GT(sim.driver.dispatch_requests, 0);
+    EXPECT_GE(count_requests(sim.driver.tx_log), 1);
+    EXPECT_TRUE(sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+    EXPECT_TRUE(sim.dpm.has_event(MSG_TO_DPM__SNK_READY));
+
+    printf("Foreign wakeups: %d, ticks: %d, requests sent: %d\n",
+        sim.driver.dispatch_requests.load(), sim.task.ticks.load(),
+        count_requests(sim.driver.tx_log));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
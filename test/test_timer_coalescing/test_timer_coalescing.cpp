@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+// Tickless host simulation: the driver timer is rearmed by the stack, and
+// time jumps to the next timer deadline or source reply. Counts wakeups in
+// steady-state contracts, with and without timer coalescing.
+struct TicklessSim {
+    SimStack sim;
+    // Source replies, by time
+    std::multimap<uint32_t, std::function<void()>> events;
+    int timer_wakeups{0};
+    int message_wakeups{0};
+
+    static constexpr uint32_t ACCEPT_DELAY_MS = 2;
+    static constexpr uint32_t PS_RDY_DELAY_MS = 15;
+
+    explicit TicklessSim(bool coalescing) {
+        sim.driver.rearm_supported = true;
+        sim.port.timers.set_coalescing(coalescing);
+    }
+
+    // Switch the source model to delayed replies
+    void use_delayed_source() {
+        sim.driver.on_transmit = [this](const PD_CHUNK& chunk) {
+            if (!chunk.is_data_msg(PD_DATA_MSGT::Request)) { return; }
+            auto now = FakeDriver::now;
+            events.emplace(now + ACCEPT_DELAY_MS, [this] { sim.send_ctrl(PD_CTRL_MSGT::Accept); });
+            events.emplace(now + PS_RDY_DELAY_MS, [this] { sim.send_ctrl(PD_CTRL_MSGT::PS_RDY); });
+        };
+    }
+
+    void run_for(uint32_t ms) {
+        const uint32_t end = FakeDriver::now + ms;
+
+        for (;;) {
+            bool has_timer = sim.driver.timer_armed &&
+                int32_t(sim.driver.timer_deadline - end) <= 0;
+            bool has_event = !events.empty() && int32_t(events.begin()->first - end) <= 0;
+            if (!has_timer && !has_event) { break; }
+
+            if (has_event && (!has_timer ||
+                int32_t(events.begin()->first - sim.driver.timer_deadline) < 0))
+            {
+                FakeDriver::now = events.begin()->first;
+                auto fn = events.begin()->second;
+                events.erase(events.begin());
+                message_wakeups++;
+                fn();
+            } else {
+                FakeDriver::now = sim.driver.timer_deadline;
+                sim.driver.timer_armed = false;
+                timer_wakeups++;
+                sim.task.set_event(Task::EVENT_TIMER_MSK);
+            }
+        }
+        FakeDriver::now = end;
+    }
+};
+
+struct Result {
+    int timer_wakeups;
+    double timer_per_min;
+    double total_per_min;
+    int requests;
+};
+
+static constexpr uint32_t SIM_MINUTES = 10;
+static constexpr uint32_t PPS_PDO = 0xC0DC213C; // PPS 3.3-11V 3A
+
+template <typename Setup>
+static Result run_steady_state(bool coalescing, Setup&& setup) {
+    TicklessSim t{coalescing};
+    setup(t.sim);
+    EXPECT_TRUE(t.sim.connect());
+    t.sim.run_ms(100);
+    t.use_delayed_source();
+    t.sim.driver.tx_log.clear();
+
+    t.run_for(SIM_MINUTES * 60 * 1000);
+
+    EXPECT_TRUE(t.sim.port.pe_flags.test(PE_FLAG::HAS_EXPLICIT_CONTRACT));
+    EXPECT_EQ(t.sim.driver.hr_sent, 0);
+
+    int requests = 0;
+    for (auto& chunk : t.sim.driver.tx_log) {
+        if (chunk.is_data_msg(PD_DATA_MSGT::Request)) { requests++; }
+    }
+    return {
+        t.timer_wakeups,
+        double(t.timer_wakeups) / SIM_MINUTES,
+        double(t.timer_wakeups + t.message_wakeups) / SIM_MINUTES,
+        requests
+    };
+}
+
+static void print(const char* name, const Result& before, const Result& after) {
+    printf("%s, wakeups/min (timer / total): before %.1f / %.1f, after %.1f / %.1f\n",
+        name, before.timer_per_min, before.total_per_min,
+        after.timer_per_min, after.total_per_min);
+}
+
+TEST(TimerCoalescingSim, FixedContract) {
+    auto setup = [](SimStack&) {};
+    auto before = run_steady_state(false, setup);
+    auto after = run_steady_state(true, setup);
+    print("Fixed 5V", before, after);
+
+    // Nothing to refresh. Only the deadline left from the connect may fire.
+    EXPECT_LE(before.timer_wakeups, 1);
+    EXPECT_LE(after.timer_wakeups, 1);
+}
+
+TEST(TimerCoalescingSim, PpsContract) {
+    auto setup = [](SimStack& sim) {
+        sim.src_pdos.push_back(PPS_PDO);
+        sim.dpm.trigger_variant(PDO_VARIANT::APDO_PPS, 9000, 2000);
+    };
+    auto before = run_steady_state(false, setup);
+    auto after = run_steady_state(true, setup);
+    print("PPS 9V", before, after);
+
+    // Refresh every 5 s, or up to 8 s with slack. Both keep the 10 s limit.
+    EXPECT_GE(before.requests, int(SIM_MINUTES * 60 / 5) - 1);
+    EXPECT_GE(after.requests, int(SIM_MINUTES * 60 / 8) - 1);
+    EXPECT_LT(after.timer_per_min, before.timer_per_min);
+    EXPECT_LT(after.total_per_min, before.total_per_min);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
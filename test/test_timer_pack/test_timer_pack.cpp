@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
 #include "pd/utils/timer_pack.h"
 
 using namespace pd;
@@ -105,6 +110,26 @@ TEST_F(TimerPackTest, Cleanup) {
     EXPECT_FALSE(timers.is_expired(TIMER_1));
 }
 
+TEST_F(TimerPackTest, CleanupReportsExpired) {
+    timers.start(TIMER_0, 100);
+    timers.start(TIMER_1, 200);
+    timers.start(TIMER_2, 50);
+    advance_time(150);
+
+    // TIMER_2 expiration was already seen
+    EXPECT_TRUE(timers.is_expired(TIMER_2));
+
+    std::vector<int> expired;
+    timers.cleanup([&](int id) { expired.push_back(id); });
+    EXPECT_THAT(expired, ::testing::ElementsAre(TIMER_0));
+
+    // Reported once
+    expired.clear();
+    advance_time(100);
+    timers.cleanup([&](int id) { expired.push_back(id); });
+    EXPECT_THAT(expired, ::testing::ElementsAre(TIMER_1));
+}
+
 TEST_F(TimerPackTest, NextExpiration) {
     EXPECT_EQ(timers.get_next_expiration(), TimerPack<TEST_TIMER_COUNT>::NO_EXPIRE);
 
@@ -204,6 +229,244 @@ TEST_F(TimerPackTest, EdgeTimeValues) {
     EXPECT_TRUE(timers.is_expired(timer_id));
 }
 
+// Reference model: the scan over all timers TimerPack did before the heap,
+// plus slack. Used for differential tests and as a benchmark baseline.
+template<size_t N>
+class ScanTimerPack {
+public:
+    ScanTimerPack() { disabled.set_all(); }
+
+    void set_time(uint32_t time) { now = time; }
+
+    void start(int id, uint32_t period, uint32_t slack = 0) {
+        active.set(id);
+        disabled.clear(id);
+        expire_at[id] = now + period;
+        wake_at[id] = now + period + slack;
+    }
+
+    void stop(int id) {
+        active.clear(id);
+        disabled.set(id);
+    }
+
+    void stop_range(int first, int last) {
+        for (int i = first; i <= last; i++) { stop(i); }
+    }
+
+    bool is_disabled(int id) const { return disabled.test(id); }
+
+    bool is_expired(int id) {
+        if (active.test(id)) {
+            if (diff(expire_at[id]) <= 0) {
+                active.clear(id);
+                return true;
+            }
+            return false;
+        }
+        return !disabled.test(id);
+    }
+
+    std::vector<int> cleanup() {
+        std::vector<int> expired;
+        for (size_t i = 0; i < N; i++) {
+            if (active.test(i) && is_expired(int(i))) { expired.push_back(int(i)); }
+        }
+        return expired;
+    }
+
+    int32_t get_next_expiration() const {
+        int32_t min = INT32_MAX;
+        for (size_t i = 0; i < N; i++) {
+            if (active.test(i)) {
+                auto d = diff(wake_at[i]);
+                if (d <= 0) { return 0; }
+                if (d < min) { min = d; }
+            }
+        }
+        return min == INT32_MAX ? TimerPack<N>::NO_EXPIRE : min;
+    }
+
+private:
+    int32_t diff(uint32_t exp) const { return static_cast<int32_t>(exp - now); }
+
+    uint32_t now{0};
+    AtomicBits<N> active;
+    AtomicBits<N> disabled;
+    uint32_t expire_at[N]{};
+    uint32_t wake_at[N]{};
+};
+
+template<size_t N>
+static void run_differential(uint32_t seed, uint32_t start_time, int steps) {
+    std::mt19937 rng(seed);
+    auto rand = [&](uint32_t max) { return std::uniform_int_distribution<uint32_t>(0, max)(rng); };
+
+    TimerPack<N> timers;
+    ScanTimerPack<N> ref;
+    uint32_t now = start_time;
+    timers.set_time(now);
+    ref.set_time(now);
+
+    for (int step = 0; step < steps; step++) {
+        int id = int(rand(N - 1));
+
+        switch (rand(7)) {
+        case 0:
+        case 1: {
+            // Short periods collide often, to test equal deadlines
+            uint32_t period = rand(1) ? rand(20) : rand(5000);
+            uint32_t slack = rand(1) ? 0 : rand(100);
+            timers.start(id, period, slack);
+            ref.start(id, period, slack);
+            break;
+        }
+        case 2:
+            timers.stop(id);
+            ref.stop(id);
+            break;
+        case 3: {
+            int last = std::min(int(N - 1), id + int(rand(4)));
+            timers.stop_range(id, last);
+            ref.stop_range(id, last);
+            break;
+        }
+        case 4:
+            now += rand(1) ? rand(10) : rand(1000);
+            timers.set_time(now);
+            ref.set_time(now);
+            break;
+        case 5:
+            ASSERT_EQ(timers.is_expired(id), ref.is_expired(id)) << "step " << step;
+            break;
+        case 6: {
+            std::vector<int> expired;
+            timers.cleanup([&](int i) { expired.push_back(i); });
+            std::sort(expired.begin(), expired.end());
+            ASSERT_EQ(expired, ref.cleanup()) << "step " << step;
+            break;
+        }
+        default:
+            break;
+        }
+
+        ASSERT_EQ(timers.get_next_expiration(), ref.get_next_expiration()) << "step " << step;
+        ASSERT_EQ(timers.is_disabled(id), ref.is_disabled(id)) << "step " << step;
+    }
+}
+
+TEST(TimerPackDiffTest, RandomOps) {
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        run_differential<TEST_TIMER_COUNT>(seed, 1000, 5000);
+        if (HasFatalFailure()) { return; }
+    }
+}
+
+TEST(TimerPackDiffTest, RandomOpsManyTimers) {
+    for (uint32_t seed = 1; seed <= 5; seed++) {
+        run_differential<200>(seed, 1000, 20000);
+        if (HasFatalFailure()) { return; }
+    }
+}
+
+TEST(TimerPackDiffTest, RandomOpsTimeOverflow) {
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        run_differential<TEST_TIMER_COUNT>(seed, UINT32_MAX - 50000, 5000);
+        if (HasFatalFailure()) { return; }
+    }
+}
+
+TEST_F(TimerPackTest, CleanupInExpirationOrder) {
+    timers.start(TIMER_3, 30);
+    timers.start(TIMER_1, 10);
+    timers.start(TIMER_2, 30);
+    timers.start(TIMER_0, 20);
+    advance_time(100);
+
+    std::vector<int> expired;
+    timers.cleanup([&](int id) { expired.push_back(id); });
+    EXPECT_THAT(expired, ::testing::ElementsAre(TIMER_1, TIMER_0, TIMER_2, TIMER_3));
+    EXPECT_EQ(timers.get_next_expiration(), TimerPack<TEST_TIMER_COUNT>::NO_EXPIRE);
+}
+
+TEST_F(TimerPackTest, SlackSharesWakeup) {
+    timers.start(TIMER_0, 100, 50);
+    timers.start(TIMER_1, 130);
+
+    // One wakeup at 130 serves both
+    EXPECT_EQ(timers.get_next_expiration(), 130);
+
+    // Expiration itself is not delayed
+    advance_time(100);
+    EXPECT_TRUE(timers.has_expired(TIMER_0));
+
+    advance_time(30);
+    std::vector<int> expired;
+    timers.cleanup([&](int id) { expired.push_back(id); });
+    EXPECT_THAT(expired, ::testing::ElementsAre(TIMER_0, TIMER_1));
+    EXPECT_EQ(timers.get_next_expiration(), TimerPack<TEST_TIMER_COUNT>::NO_EXPIRE);
+}
+
+TEST_F(TimerPackTest, SlackWindowsApart) {
+    timers.start(TIMER_0, 100, 10);
+    timers.start(TIMER_1, 130, 10);
+
+    // Windows don't overlap, each timer needs its own wakeup
+    EXPECT_EQ(timers.get_next_expiration(), 110);
+    advance_time(110);
+    timers.cleanup();
+    EXPECT_FALSE(timers.is_disabled(TIMER_1));
+    EXPECT_EQ(timers.get_next_expiration(), 30);
+}
+
+TEST_F(TimerPackTest, CoalescingDisabled) {
+    timers.set_coalescing(false);
+    timers.start(TIMER_0, 100, 50);
+    timers.start(TIMER_1, 130);
+    EXPECT_EQ(timers.get_next_expiration(), 100);
+}
+
+// Typical stack load: restart timers and query the next deadline after
+// each tick.
+template<typename Pack>
+static double bench_ns_per_op(size_t count, int ops) {
+    std::mt19937 rng(42);
+    std::vector<std::pair<int, uint32_t>> starts(ops);
+    for (auto& s : starts) { s = {int(rng() % count), 1000 + rng() % 1000}; }
+
+    Pack timers;
+    uint32_t now = 0;
+    timers.set_time(now);
+    for (size_t i = 0; i < count; i++) { timers.start(int(i), 1000 + rng() % 1000); }
+
+    int32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& s : starts) {
+        timers.set_time(++now);
+        timers.start(s.first, s.second);
+        sink += timers.get_next_expiration();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    EXPECT_NE(sink, 0);
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+template<size_t N>
+static void bench_print(int ops) {
+    auto heap_ns = bench_ns_per_op<TimerPack<N>>(N, ops);
+    auto scan_ns = bench_ns_per_op<ScanTimerPack<N>>(N, ops);
+    printf("%3zu timers, start + next expiration: heap %.1f ns, scan %.1f ns\n",
+        N, heap_ns, scan_ns);
+}
+
+TEST(TimerPackBenchmark, ManyTimers) {
+    constexpr int OPS = 200000;
+    bench_print<15>(OPS);
+    bench_print<64>(OPS);
+    bench_print<200>(OPS);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <vector>
+#include "../common/sim_stack.h"
+
+using namespace pd;
+
+// Negotiation checks pass with any feature profile. Transfers need
+// `PD_FEATURE_UNCHUNKED_EXT`, run the `test-desktop-unchunked` env.
+
+static constexpr uint32_t PDO_5V_3A = 0x0801912C;
+static constexpr uint32_t PDO_9V_3A = 0x0002D12C;
+static constexpr uint32_t PDO_EPR_28V_5A = 0x0008C1F4;
+static constexpr uint32_t PDO_UNCHUNKED_EXT_BIT = 1u << 24;
+
+static void connect_unchunked(SimStack& sim) {
+    sim.src_pdos = { PDO_5V_3A | PDO_UNCHUNKED_EXT_BIT, PDO_9V_3A };
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+}
+
+//
+// Negotiation
+//
+
+TEST(UnchunkedExtTest, NegotiatedWhenAllSupport) {
+    SimStack sim;
+    connect_unchunked(sim);
+
+    RDO_ANY rdo{sim.port.rdo_contracted};
+    EXPECT_EQ(rdo.unchunked_ext_msg_supported, PD_FEATURE_UNCHUNKED_EXT ? 1u : 0u);
+    EXPECT_EQ(sim.port.unchunked_ext_msg, bool(PD_FEATURE_UNCHUNKED_EXT));
+}
+
+TEST(UnchunkedExtTest, NotNegotiatedWithoutSourceSupport) {
+    SimStack sim;
+    sim.src_pdos = { PDO_5V_3A, PDO_9V_3A };
+    ASSERT_TRUE(sim.connect());
+
+    EXPECT_FALSE(sim.port.unchunked_ext_msg);
+}
+
+TEST(UnchunkedExtTest, NotNegotiatedWithoutTcpcSupport) {
+    SimStack sim;
+    sim.driver.unchunked_ext_msg = false;
+    connect_unchunked(sim);
+
+    RDO_ANY rdo{sim.port.rdo_contracted};
+    EXPECT_EQ(rdo.unchunked_ext_msg_supported, 0u);
+    EXPECT_FALSE(sim.port.unchunked_ext_msg);
+}
+
+TEST(UnchunkedExtTest, ClearedOnSoftReset) {
+    SimStack sim;
+    connect_unchunked(sim);
+
+    sim.src_pdos = { PDO_5V_3A, PDO_9V_3A };
+    sim.send_ctrl(PD_CTRL_MSGT::Soft_Reset);
+    sim.run_ms(20);
+    EXPECT_FALSE(sim.port.unchunked_ext_msg);
+
+    sim.dpm.events.clear();
+    sim.send_src_caps();
+    ASSERT_TRUE(sim.run_until([&sim]{ return sim.dpm.has_event(MSG_TO_DPM__SNK_READY); }, 100));
+    EXPECT_FALSE(sim.port.unchunked_ext_msg);
+}
+
+//
+// Transfers
+//
+
+#if PD_FEATURE_UNCHUNKED_EXT
+
+static std::vector<uint8_t> pdos_to_bytes(const std::vector<uint32_t>& pdos) {
+    std::vector<uint8_t> bytes;
+    for (auto pdo : pdos) {
+        for (int i = 0; i < 4; i++) { bytes.push_back(uint8_t(pdo >> (i * 8))); }
+    }
+    return bytes;
+}
+
+// SPR part (7 slots) + 1 EPR slot, 32 bytes => 2 chunks
+static const std::vector<uint32_t> epr_caps{
+    PDO_5V_3A | PDO_UNCHUNKED_EXT_BIT, PDO_9V_3A, 0, 0, 0, 0, 0, PDO_EPR_28V_5A };
+
+static bool is_chunk_request(const PD_CHUNK& chunk) {
+    if (!chunk.header.extended || chunk.header.data_obj_count == 0) { return false; }
+    return PD_EXT_HEADER{chunk.read16(0)}.request_chunk;
+}
+
+TEST(UnchunkedExtTest, ReceiveSinglePacket) {
+    SimStack sim;
+    connect_unchunked(sim);
+
+    sim.driver.tx_log.clear();
+    sim.send_src_ext(PD_EXT_MSGT::EPR_Source_Capabilities, pdos_to_bytes(epr_caps), false);
+    sim.run_ms(20);
+
+    ASSERT_FALSE(sim.driver.tx_log.empty());
+    for (auto& chunk : sim.driver.tx_log) { EXPECT_FALSE(is_chunk_request(chunk)); }
+    EXPECT_TRUE(sim.driver.tx_log.front().is_data_msg(PD_DATA_MSGT::Request));
+    // SPR mode, EPR part is dropped
+    EXPECT_EQ(sim.port.source_caps.size(), size_t(MaxPdoObjects_SPR));
+    EXPECT_EQ(sim.driver.hr_sent, 0);
+}
+
+// Chunked messages are still accepted from partners that prefer them
+TEST(UnchunkedExtTest, ReceiveChunkedWhenNegotiated) {
+    SimStack sim;
+    connect_unchunked(sim);
+
+    sim.driver.tx_log.clear();
+    sim.send_src_ext(PD_EXT_MSGT::EPR_Source_Capabilities, pdos_to_bytes(epr_caps), true);
+    sim.run_ms(20);
+
+    ASSERT_GE(sim.driver.tx_log.size(), size_t(2));
+    EXPECT_TRUE(is_chunk_request(sim.driver.tx_log[0]));
+    EXPECT_TRUE(sim.driver.tx_log[1].is_data_msg(PD_DATA_MSGT::Request));
+}
+
+TEST(UnchunkedExtTest, RejectWhenNotNegotiated) {
+    SimStack sim;
+    sim.src_pdos = { PDO_5V_3A, PDO_9V_3A };
+    ASSERT_TRUE(sim.connect());
+    sim.run_ms(10);
+
+    sim.driver.tx_log.clear();
+    sim.send_src_ext(PD_EXT_MSGT::EPR_Source_Capabilities, pdos_to_bytes(epr_caps), false);
+    sim.run_ms(20);
+
+    // Dropped by PRL, no reply to the message itself
+    for (auto& chunk : sim.driver.tx_log) {
+        EXPECT_FALSE(chunk.is_data_msg(PD_DATA_MSGT::Request));
+    }
+}
+
+TEST(UnchunkedExtTest, TransmitSinglePacket) {
+    SimStack sim;
+    connect_unchunked(sim);
+
+    ECDB ecdb{0};
+    ecdb.type = PD_EXT_CTRL_MSGT::EPR_Get_Sink_Cap;
+
+    sim.driver.tx_log.clear();
+    sim.send_src_ext(PD_EXT_MSGT::Extended_Control, { uint8_t(ecdb.raw_value), uint8_t(ecdb.raw_value >> 8) }, false);
+    sim.run_ms(20);
+
+    ASSERT_EQ(sim.driver.tx_log.size(), size_t(1));
+    auto& chunk = sim.driver.tx_log[0];
+    EXPECT_TRUE(chunk.is_ext_msg(PD_EXT_MSGT::EPR_Sink_Capabilities));
+    EXPECT_EQ(chunk.header.data_obj_count, 0u);
+
+    PD_EXT_HEADER ehdr{chunk.read16(0)};
+    EXPECT_EQ(ehdr.chunked, 0u);
+    EXPECT_EQ(size_t(chunk.data_size()), size_t(2 + ehdr.data_size));
+    EXPECT_EQ(size_t(ehdr.data_size), sim.dpm.get_sink_pdo_list().size() * 4);
+}
+
+// Not a real test. Packets on the bus for EPR_Source_Capabilities, with and
+// without chunking. Each one also takes a GoodCRC and TX turnaround.
+TEST(UnchunkedExtTest, CapsExchangePackets) {
+    auto count = [](bool chunked) {
+        SimStack sim;
+        connect_unchunked(sim);
+
+        size_t src_packets = 0;
+        auto src_model = sim.driver.on_transmit;
+        sim.driver.on_transmit = [&](const PD_CHUNK& chunk) {
+            if (is_chunk_request(chunk)) { src_packets++; }
+            src_model(chunk);
+        };
+
+        sim.driver.tx_log.clear();
+        sim.send_src_ext(PD_EXT_MSGT::EPR_Source_Capabilities, pdos_to_bytes(epr_caps), chunked);
+        src_packets++;
+        sim.run_until([&sim]{
+            for (auto& chunk : sim.driver.tx_log) {
+                if (chunk.is_data_msg(PD_DATA_MSGT::Request)) { return true; }
+            }
+            return false;
+        }, 100);
+
+        // Sink packets before the Request + source packets
+        size_t sink_packets = 0;
+        while (sink_packets < sim.driver.tx_log.size() &&
+            !sim.driver.tx_log[sink_packets].is_data_msg(PD_DATA_MSGT::Request)) { sink_packets++; }
+        return sink_packets + src_packets;
+    };
+
+    auto chunked = count(true);
+    auto unchunked = count(false);
+
+    printf("EPR_Source_Capabilities (%zu PDOs): chunked %zu packets, unchunked %zu packets\n",
+        epr_caps.size(), chunked, unchunked);
+
+    EXPECT_EQ(chunked, size_t(3));
+    EXPECT_EQ(unchunked, size_t(1));
+}
+
+#endif
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}